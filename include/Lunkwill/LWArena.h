@@ -0,0 +1,83 @@
+/*
+ * LWArena.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_ARENA_H__
+#define __LUNKWILL_ARENA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+
+#pragma mark Creating Arenas
+
+LW_EXPORT
+LWArena *LWArenaCreate(size_t aChunkSize);
+
+LW_EXPORT
+LWArena *LWArenaCreateWithAllocator(size_t aChunkSize, LWAllocator *aParentAllocator);
+
+#pragma mark -
+#pragma mark Deleting Arenas
+
+LW_EXPORT
+void LWArenaDelete(LWArena *aArena);
+
+#pragma mark -
+#pragma mark Using Arenas
+
+LW_EXPORT
+LWAllocator *LWArenaGetAllocator(LWArena *aArena);
+
+LW_EXPORT
+void LWArenaReset(LWArena *aArena);
+
+#pragma mark -
+#pragma mark Querying Arenas
+
+LW_EXPORT
+size_t LWArenaGetUsedLength(LWArena *aArena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
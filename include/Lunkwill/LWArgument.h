@@ -47,14 +47,23 @@ extern "C" {
 #include <Lunkwill/LunkwillDefines.h>
 #include <Lunkwill/LunkwillTypes.h>
 
+// arguments shorter than this rarely compress well enough to be worth it
+#define kLWArgumentDefaultCompressionThreshold	(1024)
+
 #pragma mark Creating Arguments
 
 LW_EXPORT
 LWArgument *LWArgumentCreate(void *aData, size_t aLength);
 
+LW_EXPORT
+LWArgument *LWArgumentCreateWithAllocator(void *aData, size_t aLength, LWAllocator *aAllocator);
+
 LW_EXPORT
 LWArgument *LWArgumentCreateWithoutCopying(void *aData, size_t aLength);
 
+LW_EXPORT
+LWArgument *LWArgumentCreateWithoutCopyingWithAllocator(void *aData, size_t aLength, LWAllocator *aAllocator);
+
 LW_EXPORT
 LWArgument *LWArgumentCreateFromString(char *aString);
 
@@ -76,6 +85,39 @@ LWArgument *LWArgumentCreateFrom32BitInteger(int32_t aInteger);
 LW_EXPORT
 LWArgument *LWArgumentCreateFrom32BitUnsignedInteger(uint32_t aInteger);
 
+LW_EXPORT
+LWArgument *LWArgumentCreateFrom64BitInteger(int64_t aInteger);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFrom64BitUnsignedInteger(uint64_t aInteger);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFromFloat(float aFloat);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFromDouble(double aDouble);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFromVarint(uint64_t aInteger);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFromSignedVarint(int64_t aInteger);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFrom16BitIntegerArray(int16_t *aIntegers, size_t aCount);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFrom32BitIntegerArray(int32_t *aIntegers, size_t aCount);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFrom64BitIntegerArray(int64_t *aIntegers, size_t aCount);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFromFloatArray(float *aFloats, size_t aCount);
+
+LW_EXPORT
+LWArgument *LWArgumentCreateFromDoubleArray(double *aDoubles, size_t aCount);
+
 #pragma mark -
 #pragma mark Altering Arguments
 
@@ -85,6 +127,21 @@ void LWArgumentSetRetainable(LWArgument *aArgument, bool aIsRetainable);
 LW_EXPORT
 void LWArgumentSetOwnsData(LWArgument *aArgument, bool aOwnsData);
 
+#pragma mark -
+#pragma mark Compressing Arguments
+
+LW_EXPORT
+bool LWArgumentCompress(LWArgument *aArgument, size_t aThreshold);
+
+LW_EXPORT
+bool LWArgumentIsCompressed(LWArgument *aArgument);
+
+LW_EXPORT
+size_t LWArgumentGetDecompressedLength(const void *aData, size_t aLength);
+
+LW_EXPORT
+bool LWArgumentDecompressData(const void *aData, size_t aLength, void *aBuffer, size_t aDecompressedLength);
+
 #pragma mark -
 #pragma mark Querying Arguments
 
@@ -115,6 +172,48 @@ int32_t LWArgumentGet32BitIntegerValue(LWArgument *aArgument);
 LW_EXPORT
 uint32_t LWArgumentGet32BitUnsignedIntegerValue(LWArgument *aArgument);
 
+LW_EXPORT
+int64_t LWArgumentGet64BitIntegerValue(LWArgument *aArgument);
+
+LW_EXPORT
+uint64_t LWArgumentGet64BitUnsignedIntegerValue(LWArgument *aArgument);
+
+LW_EXPORT
+float LWArgumentGetFloatValue(LWArgument *aArgument);
+
+LW_EXPORT
+double LWArgumentGetDoubleValue(LWArgument *aArgument);
+
+LW_EXPORT
+bool LWArgumentGetVarintValue(LWArgument *aArgument, uint64_t *aInteger);
+
+LW_EXPORT
+bool LWArgumentGetSignedVarintValue(LWArgument *aArgument, int64_t *aInteger);
+
+LW_EXPORT
+bool LWArgumentGet16BitIntegerArrayValue(LWArgument *aArgument, int16_t *aIntegers, size_t aCount);
+
+LW_EXPORT
+bool LWArgumentGet32BitIntegerArrayValue(LWArgument *aArgument, int32_t *aIntegers, size_t aCount);
+
+LW_EXPORT
+bool LWArgumentGet64BitIntegerArrayValue(LWArgument *aArgument, int64_t *aIntegers, size_t aCount);
+
+LW_EXPORT
+bool LWArgumentGetFloatArrayValue(LWArgument *aArgument, float *aFloats, size_t aCount);
+
+LW_EXPORT
+bool LWArgumentGetDoubleArrayValue(LWArgument *aArgument, double *aDoubles, size_t aCount);
+
+#pragma mark -
+#pragma mark Retaining And Releasing Arguments
+
+LW_EXPORT
+LWArgument *LWArgumentRetain(LWArgument *aArgument);
+
+LW_EXPORT
+void LWArgumentRelease(LWArgument *aArgument);
+
 #pragma mark -
 #pragma mark Deleting Arguments
 
@@ -0,0 +1,86 @@
+/*
+ * LWCountingAllocator.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_COUNTINGALLOCATOR_H__
+#define __LUNKWILL_COUNTINGALLOCATOR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+
+#pragma mark Creating Counting Allocators
+
+LW_EXPORT
+LWCountingAllocator *LWCountingAllocatorCreate(LWAllocator *aParentAllocator);
+
+#pragma mark -
+#pragma mark Deleting Counting Allocators
+
+LW_EXPORT
+void LWCountingAllocatorDelete(LWCountingAllocator *aCountingAllocator);
+
+#pragma mark -
+#pragma mark Using Counting Allocators
+
+LW_EXPORT
+LWAllocator *LWCountingAllocatorGetAllocator(LWCountingAllocator *aCountingAllocator);
+
+LW_EXPORT
+void LWCountingAllocatorReset(LWCountingAllocator *aCountingAllocator);
+
+#pragma mark -
+#pragma mark Querying Counting Allocators
+
+LW_EXPORT
+uint64_t LWCountingAllocatorGetAllocationCount(LWCountingAllocator *aCountingAllocator);
+
+LW_EXPORT
+uint64_t LWCountingAllocatorGetReallocationCount(LWCountingAllocator *aCountingAllocator);
+
+LW_EXPORT
+uint64_t LWCountingAllocatorGetFreeCount(LWCountingAllocator *aCountingAllocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -50,6 +50,9 @@ extern "C" {
 LW_EXPORT
 LWDataHandler *LWDataHandlerCreate(void *aUserInfo);
 
+LW_EXPORT
+LWDataHandler *LWDataHandlerCreateWithAllocator(void *aUserInfo, LWAllocator *aAllocator);
+
 #pragma mark -
 #pragma mark Deleting Data Handlers
 
@@ -71,18 +74,117 @@ void LWDataHandlerSetMessageCallback(LWDataHandler *aDataHandler, uint8_t aMessa
 LW_EXPORT
 void LWDataHandlerClearMessageCallbacks(LWDataHandler *aDataHandler);
 
+#pragma mark -
+#pragma mark Setting Relays
+
+LW_EXPORT
+void LWDataHandlerSetRelayWriter(LWDataHandler *aDataHandler, uint8_t aMessageID, LWWriter *aWriter);
+
+LW_EXPORT
+void LWDataHandlerSetRelayCallback(LWDataHandler *aDataHandler, uint8_t aMessageID, LWDataHandlerRelayCallback aCallback);
+
+LW_EXPORT
+void LWDataHandlerClearRelays(LWDataHandler *aDataHandler);
+
+#pragma mark -
+#pragma mark Setting Priorities
+
+LW_EXPORT
+void LWDataHandlerSetMessagePriority(LWDataHandler *aDataHandler, uint8_t aMessageID, uint8_t aPriority);
+
+#pragma mark -
+#pragma mark Collecting Stats
+
+LW_EXPORT
+bool LWDataHandlerSetStatsEnabled(LWDataHandler *aDataHandler, bool aIsEnabled);
+
+LW_EXPORT
+LWDataHandlerStats *LWDataHandlerGetStats(LWDataHandler *aDataHandler);
+
+#pragma mark -
+#pragma mark Decoding Into Arenas
+
+LW_EXPORT
+bool LWDataHandlerSetArenaEnabled(LWDataHandler *aDataHandler, bool aIsEnabled);
+
+#pragma mark -
+#pragma mark Choosing Wire Formats
+
+LW_EXPORT
+bool LWDataHandlerSetWireFormat(LWDataHandler *aDataHandler, uint8_t aWireFormat);
+
+LW_EXPORT
+uint8_t LWDataHandlerGetWireFormat(LWDataHandler *aDataHandler);
+
+#pragma mark -
+#pragma mark Interning Arguments
+
+LW_EXPORT
+void LWDataHandlerSetInternTable(LWDataHandler *aDataHandler, LWInternTable *aInternTable);
+
+LW_EXPORT
+LWInternTable *LWDataHandlerGetInternTable(LWDataHandler *aDataHandler);
+
+#pragma mark -
+#pragma mark Checksumming Frames
+
+LW_EXPORT
+bool LWDataHandlerSetChecksumEnabled(LWDataHandler *aDataHandler, bool aIsEnabled);
+
+LW_EXPORT
+bool LWDataHandlerIsChecksumEnabled(LWDataHandler *aDataHandler);
+
 #pragma mark -
 #pragma mark Setting Validators
 
 LW_EXPORT
 void LWDataHandlerSetValidator(LWDataHandler *aDataHandler, LWValidator *aValidator);
 
+#pragma mark -
+#pragma mark Setting Dispatch Budgets
+
+LW_EXPORT
+void LWDataHandlerSetDispatchBudget(LWDataHandler *aDataHandler, size_t aMaxMessageCount, uint64_t aMaxNanoseconds);
+
+#pragma mark -
+#pragma mark Setting Timeouts
+
+LW_EXPORT
+void LWDataHandlerSetTimerWheel(LWDataHandler *aDataHandler, LWTimerWheel *aTimerWheel);
+
+LW_EXPORT
+bool LWDataHandlerSetIdleTimeout(LWDataHandler *aDataHandler, uint64_t aTimeout, LWDataHandlerTimeoutCallback aCallback);
+
+LW_EXPORT
+bool LWDataHandlerSetStallTimeout(LWDataHandler *aDataHandler, uint64_t aTimeout, LWDataHandlerTimeoutCallback aCallback);
+
+#pragma mark -
+#pragma mark Moving Data Handlers Between Threads
+
+LW_EXPORT
+bool LWDataHandlerDetach(LWDataHandler *aDataHandler);
+
+LW_EXPORT
+bool LWDataHandlerAttach(LWDataHandler *aDataHandler, LWTimerWheel *aTimerWheel);
+
+LW_EXPORT
+bool LWDataHandlerIsDetached(LWDataHandler *aDataHandler);
+
 #pragma mark -
 #pragma mark Handling Data
 
 LW_EXPORT
 bool LWDataHandlerHandleData(LWDataHandler *aDataHandler, void *aData, size_t aDataLength);
 
+LW_EXPORT
+bool LWDataHandlerHandleDataInPlace(LWDataHandler *aDataHandler, void *aData, size_t aDataLength, size_t *aBytesUsed);
+
+LW_EXPORT
+bool LWDataHandlerResumeDispatch(LWDataHandler *aDataHandler);
+
+LW_EXPORT
+bool LWDataHandlerHasPendingMessages(LWDataHandler *aDataHandler);
+
 #ifdef __cplusplus
 }
 #endif
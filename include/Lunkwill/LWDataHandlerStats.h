@@ -0,0 +1,110 @@
+/*
+ * LWDataHandlerStats.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_DATAHANDLERSTATS_H__
+#define __LUNKWILL_DATAHANDLERSTATS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+
+// bucket 0 counts callbacks that took 0 ns, bucket i those that took [2^(i-1), 2^i) ns
+#define kLWDataHandlerStatsBucketCount	(64)
+
+#pragma mark Creating Stats
+
+LW_EXPORT
+LWDataHandlerStats *LWDataHandlerStatsCreate(void);
+
+LW_EXPORT
+LWDataHandlerStats *LWDataHandlerStatsCreateWithAllocator(LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Stats
+
+LW_EXPORT
+void LWDataHandlerStatsDelete(LWDataHandlerStats *aStats);
+
+#pragma mark -
+#pragma mark Aggregating Stats
+
+LW_EXPORT
+void LWDataHandlerStatsReset(LWDataHandlerStats *aStats);
+
+LW_EXPORT
+bool LWDataHandlerStatsAdd(LWDataHandlerStats *aStats, LWDataHandlerStats *aOtherStats);
+
+#pragma mark -
+#pragma mark Querying Stats
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetMessageCount(LWDataHandlerStats *aStats, uint8_t aMessageID);
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetByteCount(LWDataHandlerStats *aStats, uint8_t aMessageID);
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetInvalidMessageCount(LWDataHandlerStats *aStats);
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetUnrecognisedMessageCount(LWDataHandlerStats *aStats);
+
+LW_EXPORT
+size_t LWDataHandlerStatsGetBufferHighWaterMark(LWDataHandlerStats *aStats);
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetReallocationCount(LWDataHandlerStats *aStats);
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetCarryOverByteCount(LWDataHandlerStats *aStats);
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetCallbackTimeCount(LWDataHandlerStats *aStats, uint8_t aMessageID, size_t aBucket);
+
+LW_EXPORT
+uint64_t LWDataHandlerStatsGetCallbackTimePercentile(LWDataHandlerStats *aStats, uint8_t aMessageID, double aPercentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
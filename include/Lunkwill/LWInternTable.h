@@ -0,0 +1,92 @@
+/*
+ * LWInternTable.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_INTERNTABLE_H__
+#define __LUNKWILL_INTERNTABLE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+
+// only the first 32 arguments of a message can be interned
+#define kLWInternTableMaxArgumentIndex	(31)
+
+#pragma mark Creating Intern Tables
+
+LW_EXPORT
+LWInternTable *LWInternTableCreate(uint16_t aCapacity);
+
+LW_EXPORT
+LWInternTable *LWInternTableCreateWithAllocator(uint16_t aCapacity, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Intern Tables
+
+LW_EXPORT
+void LWInternTableDelete(LWInternTable *aInternTable);
+
+#pragma mark -
+#pragma mark Choosing Interned Arguments
+
+LW_EXPORT
+bool LWInternTableSetArgumentInterned(LWInternTable *aInternTable, uint8_t aMessageID, size_t aArgumentIndex, bool aIsInterned);
+
+LW_EXPORT
+bool LWInternTableIsArgumentInterned(LWInternTable *aInternTable, uint8_t aMessageID, size_t aArgumentIndex);
+
+#pragma mark -
+#pragma mark Querying Intern Tables
+
+LW_EXPORT
+uint16_t LWInternTableGetCapacity(LWInternTable *aInternTable);
+
+LW_EXPORT
+uint16_t LWInternTableGetCount(LWInternTable *aInternTable);
+
+LW_EXPORT
+LWArgument *LWInternTableGetArgumentInSlot(LWInternTable *aInternTable, uint16_t aSlot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
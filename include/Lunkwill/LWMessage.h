@@ -47,6 +47,14 @@ extern "C" {
 #include <Lunkwill/LunkwillTypes.h>
 #include <Lunkwill/LWArgument.h>
 
+#define kLWWireFormatAutomatic	(0)
+#define kLWWireFormatVersion1	(1)
+#define kLWWireFormatVersion2	(2)
+
+// sent once at the start of a connection that uses version 2 frames
+#define kLWWireFormatVersion2Preamble		("\xffLW\x02")
+#define kLWWireFormatVersion2PreambleLength	(4)
+
 #pragma mark Creating Messages
 
 LW_EXPORT
@@ -55,6 +63,18 @@ LWMessage *LWMessageCreate(uint8_t aMessageID, LWArgument *aArguments, ...);
 LW_EXPORT
 LWMessage *LWMessageCreate2(uint8_t aMessageID, size_t aArgumentCount, LWArgument **aArguments);
 
+LW_EXPORT
+LWMessage *LWMessageCreateWithAllocator(uint8_t aMessageID, size_t aArgumentCount, LWArgument **aArguments, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Retaining And Releasing Messages
+
+LW_EXPORT
+LWMessage *LWMessageRetain(LWMessage *aMessage);
+
+LW_EXPORT
+void LWMessageRelease(LWMessage *aMessage);
+
 #pragma mark -
 #pragma mark Deleting Messages
 
@@ -67,15 +87,57 @@ void LWMessageDelete(LWMessage *aMessage);
 LW_EXPORT
 void LWMessageAddArgument(LWMessage *aMessage, LWArgument *aArgument);
 
+#pragma mark -
+#pragma mark Compressing Arguments
+
+LW_EXPORT
+bool LWMessageCompressArguments(LWMessage *aMessage, size_t aThreshold);
+
 #pragma mark -
 #pragma mark Serializing And Deserializing Messages
 
+LW_EXPORT
+size_t LWMessageGetSerializedLength(LWMessage *aMessage);
+
+LW_EXPORT
+size_t LWMessageSerializeIntoBuffer(LWMessage *aMessage, void *aBuffer);
+
 LW_EXPORT
 bool LWMessageSerialize(LWMessage *aMessage, size_t *aLength, void **aSerializedMessage);
 
+LW_EXPORT
+bool LWMessageGetFrameLength(void *aData, size_t aLength, size_t *aFrameLength);
+
 LW_EXPORT
 LWMessage *LWMessageDeserialize(void *aData, size_t aLength, size_t *aBytesUsed);
 
+LW_EXPORT
+LWMessage *LWMessageDeserializeWithAllocator(void *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator);
+
+LW_EXPORT
+LWMessage *LWMessageDeserializeInArena(void *aData, size_t aLength, size_t *aBytesUsed, LWArena *aArena);
+
+#pragma mark -
+#pragma mark Choosing Wire Formats
+
+LW_EXPORT
+size_t LWMessageGetSerializedLengthWithWireFormat(LWMessage *aMessage, uint8_t aWireFormat);
+
+LW_EXPORT
+size_t LWMessageSerializeIntoBufferWithWireFormat(LWMessage *aMessage, void *aBuffer, uint8_t aWireFormat);
+
+LW_EXPORT
+bool LWMessageSerializeWithWireFormat(LWMessage *aMessage, size_t *aLength, void **aSerializedMessage, uint8_t aWireFormat);
+
+LW_EXPORT
+bool LWMessageGetFrameLengthWithWireFormat(void *aData, size_t aLength, size_t *aFrameLength, uint8_t aWireFormat);
+
+LW_EXPORT
+LWMessage *LWMessageDeserializeWithWireFormat(void *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator, uint8_t aWireFormat);
+
+LW_EXPORT
+LWMessage *LWMessageDeserializeInArenaWithWireFormat(void *aData, size_t aLength, size_t *aBytesUsed, LWArena *aArena, uint8_t aWireFormat);
+
 #pragma mark -
 #pragma mark Validating Messages
 
@@ -0,0 +1,109 @@
+/*
+ * LWMultiplexer.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_MULTIPLEXER_H__
+#define __LUNKWILL_MULTIPLEXER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriter.h>
+
+#define kLWMultiplexerControlChannelID	(0)
+
+#pragma mark Creating Multiplexers
+
+LW_EXPORT
+LWMultiplexer *LWMultiplexerCreate(LWWriter *aWriter, void *aUserInfo);
+
+LW_EXPORT
+LWMultiplexer *LWMultiplexerCreateWithAllocator(LWWriter *aWriter, void *aUserInfo, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Multiplexers
+
+LW_EXPORT
+void LWMultiplexerDelete(LWMultiplexer *aMultiplexer);
+
+#pragma mark -
+#pragma mark Managing Channels
+
+LW_EXPORT
+void LWMultiplexerSetWindowSize(LWMultiplexer *aMultiplexer, size_t aWindowSize);
+
+LW_EXPORT
+bool LWMultiplexerOpenChannel(LWMultiplexer *aMultiplexer, uint8_t aChannelID, LWDataHandler *aDataHandler);
+
+LW_EXPORT
+void LWMultiplexerCloseChannel(LWMultiplexer *aMultiplexer, uint8_t aChannelID);
+
+#pragma mark -
+#pragma mark Sending Messages
+
+LW_EXPORT
+bool LWMultiplexerSendMessage(LWMultiplexer *aMultiplexer, uint8_t aChannelID, LWMessage *aMessage);
+
+LW_EXPORT
+bool LWMultiplexerFlush(LWMultiplexer *aMultiplexer);
+
+#pragma mark -
+#pragma mark Handling Data
+
+LW_EXPORT
+bool LWMultiplexerHandleData(LWMultiplexer *aMultiplexer, void *aData, size_t aDataLength);
+
+#pragma mark -
+#pragma mark Querying Multiplexers
+
+LW_EXPORT
+size_t LWMultiplexerGetPendingLength(LWMultiplexer *aMultiplexer, uint8_t aChannelID);
+
+LW_EXPORT
+ssize_t LWMultiplexerGetSendCredit(LWMultiplexer *aMultiplexer, uint8_t aChannelID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
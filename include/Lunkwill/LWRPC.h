@@ -0,0 +1,100 @@
+/*
+ * LWRPC.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_RPC_H__
+#define __LUNKWILL_RPC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWWriter.h>
+
+#pragma mark Creating RPCs
+
+LW_EXPORT
+LWRPC *LWRPCCreate(LWWriter *aWriter);
+
+LW_EXPORT
+LWRPC *LWRPCCreateWithAllocator(LWWriter *aWriter, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting RPCs
+
+LW_EXPORT
+void LWRPCDelete(LWRPC *aRPC);
+
+#pragma mark -
+#pragma mark Sending Requests
+
+LW_EXPORT
+bool LWRPCSendRequest(LWRPC *aRPC, LWMessage *aRequest, LWRPCResponseCallback aCallback, void *aContext, uint32_t *aCorrelationID);
+
+LW_EXPORT
+bool LWRPCCancelRequest(LWRPC *aRPC, uint32_t aCorrelationID);
+
+#pragma mark -
+#pragma mark Handling Responses
+
+LW_EXPORT
+bool LWRPCHandleResponse(LWRPC *aRPC, LWMessage *aResponse);
+
+#pragma mark -
+#pragma mark Sending Responses
+
+LW_EXPORT
+bool LWRPCWriteResponse(LWWriter *aWriter, uint32_t aCorrelationID, LWMessage *aResponse);
+
+#pragma mark -
+#pragma mark Querying RPCs
+
+LW_EXPORT
+bool LWRPCGetCorrelationID(LWMessage *aMessage, uint32_t *aCorrelationID);
+
+LW_EXPORT
+size_t LWRPCGetInFlightRequestCount(LWRPC *aRPC);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
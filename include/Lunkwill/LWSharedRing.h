@@ -0,0 +1,109 @@
+/*
+ * LWSharedRing.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_SHAREDRING_H__
+#define __LUNKWILL_SHAREDRING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+
+#pragma mark Creating Shared Rings
+
+LW_EXPORT
+LWSharedRing *LWSharedRingCreate(size_t aCapacity);
+
+LW_EXPORT
+LWSharedRing *LWSharedRingCreateWithAllocator(size_t aCapacity, LWAllocator *aAllocator);
+
+LW_EXPORT
+LWSharedRing *LWSharedRingCreateWithFileDescriptor(int aFileDescriptor);
+
+LW_EXPORT
+LWSharedRing *LWSharedRingCreateWithFileDescriptorAndAllocator(int aFileDescriptor, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Shared Rings
+
+LW_EXPORT
+void LWSharedRingDelete(LWSharedRing *aSharedRing);
+
+#pragma mark -
+#pragma mark Producing Data
+
+LW_EXPORT
+bool LWSharedRingWriteData(LWSharedRing *aSharedRing, void *aData, size_t aLength);
+
+LW_EXPORT
+bool LWSharedRingWriteMessage(LWSharedRing *aSharedRing, LWMessage *aMessage);
+
+LW_EXPORT
+bool LWSharedRingWaitForSpace(LWSharedRing *aSharedRing, size_t aLength, int aTimeout);
+
+#pragma mark -
+#pragma mark Consuming Data
+
+LW_EXPORT
+bool LWSharedRingHandleData(LWSharedRing *aSharedRing, LWDataHandler *aDataHandler);
+
+LW_EXPORT
+bool LWSharedRingWaitForData(LWSharedRing *aSharedRing, int aTimeout);
+
+#pragma mark -
+#pragma mark Querying Shared Rings
+
+LW_EXPORT
+int LWSharedRingGetFileDescriptor(LWSharedRing *aSharedRing);
+
+LW_EXPORT
+size_t LWSharedRingGetCapacity(LWSharedRing *aSharedRing);
+
+LW_EXPORT
+size_t LWSharedRingGetAvailableLength(LWSharedRing *aSharedRing);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
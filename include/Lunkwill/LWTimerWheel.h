@@ -0,0 +1,116 @@
+/*
+ * LWTimerWheel.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_TIMERWHEEL_H__
+#define __LUNKWILL_TIMERWHEEL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+
+#pragma mark Creating Timer Wheels
+
+LW_EXPORT
+LWTimerWheel *LWTimerWheelCreate(uint64_t aCurrentTime);
+
+LW_EXPORT
+LWTimerWheel *LWTimerWheelCreateWithAllocator(uint64_t aCurrentTime, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Timer Wheels
+
+LW_EXPORT
+void LWTimerWheelDelete(LWTimerWheel *aTimerWheel);
+
+#pragma mark -
+#pragma mark Advancing Timer Wheels
+
+LW_EXPORT
+size_t LWTimerWheelAdvance(LWTimerWheel *aTimerWheel, uint64_t aCurrentTime);
+
+#pragma mark -
+#pragma mark Querying Timer Wheels
+
+LW_EXPORT
+uint64_t LWTimerWheelGetCurrentTime(LWTimerWheel *aTimerWheel);
+
+LW_EXPORT
+size_t LWTimerWheelGetTimerCount(LWTimerWheel *aTimerWheel);
+
+#pragma mark -
+#pragma mark Creating Timers
+
+LW_EXPORT
+LWTimer *LWTimerCreate(LWTimerCallback aCallback, void *aUserInfo);
+
+LW_EXPORT
+LWTimer *LWTimerCreateWithAllocator(LWTimerCallback aCallback, void *aUserInfo, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Timers
+
+LW_EXPORT
+void LWTimerDelete(LWTimer *aTimer);
+
+#pragma mark -
+#pragma mark Arming Timers
+
+LW_EXPORT
+void LWTimerArm(LWTimer *aTimer, LWTimerWheel *aTimerWheel, uint64_t aTimeout);
+
+LW_EXPORT
+void LWTimerCancel(LWTimer *aTimer);
+
+#pragma mark -
+#pragma mark Querying Timers
+
+LW_EXPORT
+bool LWTimerIsArmed(LWTimer *aTimer);
+
+LW_EXPORT
+uint64_t LWTimerGetExpirationTime(LWTimer *aTimer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
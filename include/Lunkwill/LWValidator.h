@@ -49,6 +49,9 @@ extern "C" {
 LW_EXPORT
 LWValidator *LWValidatorCreate(void);
 
+LW_EXPORT
+LWValidator *LWValidatorCreateWithAllocator(LWAllocator *aAllocator);
+
 #pragma mark -
 #pragma mark Deleting Validators
 
@@ -0,0 +1,103 @@
+/*
+ * LWWriteQueue.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_WRITEQUEUE_H__
+#define __LUNKWILL_WRITEQUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWBuffer.h>
+#include <Lunkwill/LWMessage.h>
+
+#pragma mark Creating Write Queues
+
+LW_EXPORT
+LWWriteQueue *LWWriteQueueCreate(void);
+
+LW_EXPORT
+LWWriteQueue *LWWriteQueueCreateWithAllocator(LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Write Queues
+
+LW_EXPORT
+void LWWriteQueueDelete(LWWriteQueue *aWriteQueue);
+
+#pragma mark -
+#pragma mark Enqueueing Data
+
+LW_EXPORT
+bool LWWriteQueueEnqueueBuffer(LWWriteQueue *aWriteQueue, LWBuffer *aBuffer);
+
+LW_EXPORT
+bool LWWriteQueueEnqueueMessage(LWWriteQueue *aWriteQueue, LWMessage *aMessage);
+
+LW_EXPORT
+bool LWWriteQueueBroadcastMessage(LWMessage *aMessage, LWWriteQueue **aWriteQueues, size_t aWriteQueueCount);
+
+#pragma mark -
+#pragma mark Writing Data
+
+LW_EXPORT
+void *LWWriteQueuePeek(LWWriteQueue *aWriteQueue, size_t *aLength);
+
+LW_EXPORT
+void LWWriteQueueConsume(LWWriteQueue *aWriteQueue, size_t aLength);
+
+LW_EXPORT
+bool LWWriteQueueWriteToFileDescriptor(LWWriteQueue *aWriteQueue, int aFileDescriptor);
+
+#pragma mark -
+#pragma mark Querying Write Queues
+
+LW_EXPORT
+bool LWWriteQueueIsEmpty(LWWriteQueue *aWriteQueue);
+
+LW_EXPORT
+size_t LWWriteQueueGetPendingLength(LWWriteQueue *aWriteQueue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
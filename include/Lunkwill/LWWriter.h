@@ -0,0 +1,140 @@
+/*
+ * LWWriter.h
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_WRITER_H__
+#define __LUNKWILL_WRITER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWBuffer.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWWriteQueue.h>
+
+#pragma mark Creating Writers
+
+LW_EXPORT
+LWWriter *LWWriterCreate(int aFileDescriptor, void *aUserInfo);
+
+LW_EXPORT
+LWWriter *LWWriterCreateWithAllocator(int aFileDescriptor, void *aUserInfo, LWAllocator *aAllocator);
+
+#pragma mark -
+#pragma mark Deleting Writers
+
+LW_EXPORT
+void LWWriterDelete(LWWriter *aWriter);
+
+#pragma mark -
+#pragma mark Setting Backpressure Options
+
+LW_EXPORT
+void LWWriterSetWatermarks(LWWriter *aWriter, size_t aLowWatermark, size_t aHighWatermark);
+
+LW_EXPORT
+void LWWriterSetWritabilityCallback(LWWriter *aWriter, LWWriterWritabilityCallback aCallback);
+
+#pragma mark -
+#pragma mark Choosing Wire Formats
+
+LW_EXPORT
+bool LWWriterSetWireFormat(LWWriter *aWriter, uint8_t aWireFormat);
+
+LW_EXPORT
+uint8_t LWWriterGetWireFormat(LWWriter *aWriter);
+
+#pragma mark -
+#pragma mark Interning Arguments
+
+LW_EXPORT
+void LWWriterSetInternTable(LWWriter *aWriter, LWInternTable *aInternTable);
+
+LW_EXPORT
+LWInternTable *LWWriterGetInternTable(LWWriter *aWriter);
+
+#pragma mark -
+#pragma mark Checksumming Frames
+
+LW_EXPORT
+void LWWriterSetChecksumEnabled(LWWriter *aWriter, bool aIsEnabled);
+
+LW_EXPORT
+bool LWWriterIsChecksumEnabled(LWWriter *aWriter);
+
+#pragma mark -
+#pragma mark Writing Data
+
+LW_EXPORT
+bool LWWriterWriteMessage(LWWriter *aWriter, LWMessage *aMessage);
+
+LW_EXPORT
+bool LWWriterWriteBuffer(LWWriter *aWriter, LWBuffer *aBuffer);
+
+LW_EXPORT
+bool LWWriterWriteData(LWWriter *aWriter, void *aData, size_t aLength);
+
+LW_EXPORT
+bool LWWriterWriteFrame(LWWriter *aWriter, void *aFrame, size_t aLength);
+
+LW_EXPORT
+bool LWWriterBroadcastMessage(LWMessage *aMessage, LWWriter **aWriters, size_t aWriterCount);
+
+LW_EXPORT
+bool LWWriterFlush(LWWriter *aWriter);
+
+#pragma mark -
+#pragma mark Querying Writers
+
+LW_EXPORT
+bool LWWriterIsWritable(LWWriter *aWriter);
+
+LW_EXPORT
+size_t LWWriterGetPendingLength(LWWriter *aWriter);
+
+LW_EXPORT
+int LWWriterGetFileDescriptor(LWWriter *aWriter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -40,10 +40,24 @@
 extern "C" {
 #endif
 
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArena.h>
+#include <Lunkwill/LWCountingAllocator.h>
 #include <Lunkwill/LWArgument.h>
 #include <Lunkwill/LWMessage.h>
 #include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWDataHandlerStats.h>
 #include <Lunkwill/LWValidator.h>
+#include <Lunkwill/LWBuffer.h>
+#include <Lunkwill/LWWriteQueue.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWInternTable.h>
+#include <Lunkwill/LWSharedRing.h>
+#include <Lunkwill/LWMultiplexer.h>
+#include <Lunkwill/LWTimerWheel.h>
+#include <Lunkwill/LWRPC.h>
+#include <Lunkwill/LWClientPool.h>
+#include <Lunkwill/LWTrace.h>
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,952 @@
+/*
+ * Lunkwill.hpp
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_LUNKWILL_HPP__
+#define __LUNKWILL_LUNKWILL_HPP__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 202002L && defined(__has_include)
+#	if __has_include(<span>)
+#		include <span>
+#		define LW_HAS_STD_SPAN
+#	endif
+#endif
+
+#include <Lunkwill/Lunkwill.h>
+
+// typed messages on top of the C API. a message type lists its field types:
+//
+//   using Position = Lunkwill::Message<12, uint32_t, double, double, std::string_view>;
+//
+// and is encoded and decoded straight to and from frames, without creating
+// LWArgument or LWMessage objects. the frames are the same as those made by
+// LWMessageSerialize, with every field sent as one argument.
+
+namespace Lunkwill {
+
+#pragma mark Spans
+
+#ifdef LW_HAS_STD_SPAN
+
+template <typename T>
+using Span = std::span<T>;
+
+#else
+
+// the part of std::span that is used here, for C++17
+template <typename T>
+class Span
+{
+public:
+	constexpr Span() noexcept : mData(nullptr), mSize(0) {}
+	constexpr Span(T *aData, size_t aSize) noexcept : mData(aData), mSize(aSize) {}
+
+	template <size_t N>
+	constexpr Span(T (&aArray)[N]) noexcept : mData(aArray), mSize(N) {}
+
+	template <typename Container, typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<Container &>().data()), T *>>>
+	constexpr Span(Container &aContainer) noexcept : mData(aContainer.data()), mSize(aContainer.size()) {}
+
+	template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+	constexpr Span(const Span<U> &aSpan) noexcept : mData(aSpan.data()), mSize(aSpan.size()) {}
+
+	constexpr T *data() const noexcept { return mData; }
+	constexpr size_t size() const noexcept { return mSize; }
+	constexpr bool empty() const noexcept { return 0 == mSize; }
+	constexpr T *begin() const noexcept { return mData; }
+	constexpr T *end() const noexcept { return mData + mSize; }
+	constexpr T &operator[](size_t aIndex) const noexcept { return mData[aIndex]; }
+
+private:
+	T		*mData;
+	size_t	mSize;
+};
+
+#endif
+
+#pragma mark -
+#pragma mark Owning C Objects
+
+// deletes or releases C objects when their owner goes away
+template <auto aDelete>
+struct Deleter
+{
+	template <typename T>
+	void operator()(T *aObject) const noexcept
+	{
+		aDelete(aObject);
+	}
+};
+
+using UniqueArena		= std::unique_ptr<LWArena, Deleter<&LWArenaDelete>>;
+using UniqueArgument	= std::unique_ptr<LWArgument, Deleter<&LWArgumentRelease>>;
+using UniqueMessage		= std::unique_ptr<LWMessage, Deleter<&LWMessageRelease>>;
+using UniqueBuffer		= std::unique_ptr<LWBuffer, Deleter<&LWBufferRelease>>;
+using UniqueValidator	= std::unique_ptr<LWValidator, Deleter<&LWValidatorDelete>>;
+using UniqueDataHandler	= std::unique_ptr<LWDataHandler, Deleter<&LWDataHandlerDelete>>;
+using UniqueWriteQueue	= std::unique_ptr<LWWriteQueue, Deleter<&LWWriteQueueDelete>>;
+using UniqueWriter		= std::unique_ptr<LWWriter, Deleter<&LWWriterDelete>>;
+using UniqueInternTable	= std::unique_ptr<LWInternTable, Deleter<&LWInternTableDelete>>;
+using UniqueTimerWheel	= std::unique_ptr<LWTimerWheel, Deleter<&LWTimerWheelDelete>>;
+
+#pragma mark -
+#pragma mark Field Types
+
+// field types besides integers, floating-point numbers and std::string_view
+struct Varint {};
+struct SignedVarint {};
+struct Bytes {};
+template <typename T> struct Array {};
+
+inline constexpr size_t kUnboundedLength = SIZE_MAX;
+
+namespace Detail {
+
+template <size_t aSize> struct UnsignedInteger;
+template <> struct UnsignedInteger<1> { using Type = uint8_t; };
+template <> struct UnsignedInteger<2> { using Type = uint16_t; };
+template <> struct UnsignedInteger<4> { using Type = uint32_t; };
+template <> struct UnsignedInteger<8> { using Type = uint64_t; };
+
+template <typename T>
+inline void writeNetworkOrder(uint8_t *aBuffer, T aValue) noexcept
+{
+	// compilers turn these loops into a byte swap and a single store or load
+	typename UnsignedInteger<sizeof(T)>::Type value;
+	std::memcpy(&value, &aValue, sizeof(T));
+	for(size_t i = 0; i < sizeof(T); ++i)
+		aBuffer[i] = static_cast<uint8_t>(value >> (8*(sizeof(T) - 1 - i)));
+}
+
+template <typename T>
+inline T readNetworkOrder(const uint8_t *aData) noexcept
+{
+	typename UnsignedInteger<sizeof(T)>::Type value = 0;
+	for(size_t i = 0; i < sizeof(T); ++i)
+		value = static_cast<decltype(value)>((value << 8) | aData[i]);
+
+	T result;
+	std::memcpy(&result, &value, sizeof(T));
+	return result;
+}
+
+constexpr size_t getVarintLength(uint64_t aValue) noexcept
+{
+	size_t length = 1;
+	for(; aValue >= 0x80; aValue >>= 7)
+		++length;
+
+	return length;
+}
+
+inline size_t writeVarint(uint8_t *aBuffer, uint64_t aValue) noexcept
+{
+	size_t length = 0;
+	for(; aValue >= 0x80; aValue >>= 7)
+		aBuffer[length++] = static_cast<uint8_t>(aValue | 0x80);
+	aBuffer[length++] = static_cast<uint8_t>(aValue);
+
+	return length;
+}
+
+inline bool readVarint(const uint8_t *aData, size_t aLength, uint64_t *aValue, size_t *aBytesUsed) noexcept
+{
+	uint64_t value = 0;
+	for(size_t i = 0; i < aLength && i < 10; ++i)
+	{
+		value |= static_cast<uint64_t>(aData[i] & 0x7f) << (7*i);
+		if(!(aData[i] & 0x80))
+		{
+			*aValue		= value;
+			*aBytesUsed	= i + 1;
+			return true;
+		}
+	}
+
+	// incomplete or too long
+	return false;
+}
+
+inline bool decodeVarint(const uint8_t *aData, size_t aLength, uint64_t *aValue) noexcept
+{
+	// the varint must fill the argument exactly, like LWArgumentGetVarintValue
+	size_t bytesUsed;
+	return readVarint(aData, aLength, aValue, &bytesUsed) && bytesUsed == aLength;
+}
+
+// length of an argument in version 1 frames, split into 255-byte chunks
+constexpr size_t getChunkedLength(size_t aLength) noexcept
+{
+	return aLength/255 + aLength + 1;
+}
+
+}
+
+// views over received arrays, which are in network byte order and may not be
+// aligned, so elements are converted as they are read
+template <typename T>
+class ArrayView
+{
+public:
+	class Iterator
+	{
+	public:
+		using iterator_category	= std::input_iterator_tag;
+		using value_type		= T;
+		using difference_type	= ptrdiff_t;
+		using pointer			= const T *;
+		using reference			= T;
+
+		explicit Iterator(const uint8_t *aData) noexcept : mData(aData) {}
+		T operator*() const noexcept { return Detail::readNetworkOrder<T>(mData); }
+		Iterator &operator++() noexcept { mData += sizeof(T); return *this; }
+		Iterator operator++(int) noexcept { Iterator iterator = *this; mData += sizeof(T); return iterator; }
+		bool operator==(const Iterator &aIterator) const noexcept { return mData == aIterator.mData; }
+		bool operator!=(const Iterator &aIterator) const noexcept { return mData != aIterator.mData; }
+
+	private:
+		const uint8_t *mData;
+	};
+
+	constexpr ArrayView() noexcept : mData(nullptr), mSize(0) {}
+	constexpr ArrayView(const uint8_t *aData, size_t aSize) noexcept : mData(aData), mSize(aSize) {}
+
+	size_t size() const noexcept { return mSize; }
+	bool empty() const noexcept { return 0 == mSize; }
+	T operator[](size_t aIndex) const noexcept { return Detail::readNetworkOrder<T>(mData + aIndex*sizeof(T)); }
+	Iterator begin() const noexcept { return Iterator(mData); }
+	Iterator end() const noexcept { return Iterator(mData + mSize*sizeof(T)); }
+
+	// raw bytes, in network byte order
+	Span<const uint8_t> getBytes() const noexcept { return Span<const uint8_t>(mData, mSize*sizeof(T)); }
+
+	void copyTo(T *aValues) const noexcept
+	{
+		for(size_t i = 0; i < mSize; ++i)
+			aValues[i] = (*this)[i];
+	}
+
+private:
+	const uint8_t	*mData;
+	size_t			mSize;
+};
+
+// how each field type is encoded; the encodings are those of the matching
+// LWArgumentCreateFrom... functions
+template <typename T, typename = void>
+struct Field;
+
+// integers and floating-point numbers, in network byte order
+template <typename T>
+struct Field<T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>>
+{
+	using Value	= T;
+	using View	= T;
+
+	static constexpr bool	kIsFixedLength	= true;
+	static constexpr bool	kIsRaw			= false;
+	static constexpr size_t	kMaxLength		= sizeof(T);
+
+	static constexpr size_t getLength(Value) noexcept { return sizeof(T); }
+	static void write(uint8_t *aBuffer, Value aValue) noexcept { Detail::writeNetworkOrder(aBuffer, aValue); }
+
+	static bool read(const uint8_t *aData, size_t aLength, View *aView) noexcept
+	{
+		if(sizeof(T) != aLength)
+			return false;
+
+		*aView = Detail::readNetworkOrder<T>(aData);
+		return true;
+	}
+};
+
+// little-endian base 128 integers, as made by LWArgumentCreateFromVarint
+template <>
+struct Field<Varint>
+{
+	using Value	= uint64_t;
+	using View	= uint64_t;
+
+	static constexpr bool	kIsFixedLength	= false;
+	static constexpr bool	kIsRaw			= false;
+	static constexpr size_t	kMaxLength		= 10;
+
+	static constexpr size_t getLength(Value aValue) noexcept { return Detail::getVarintLength(aValue); }
+	static void write(uint8_t *aBuffer, Value aValue) noexcept { Detail::writeVarint(aBuffer, aValue); }
+	static bool read(const uint8_t *aData, size_t aLength, View *aView) noexcept { return Detail::decodeVarint(aData, aLength, aView); }
+};
+
+// zigzag-encoded varints, as made by LWArgumentCreateFromSignedVarint
+template <>
+struct Field<SignedVarint>
+{
+	using Value	= int64_t;
+	using View	= int64_t;
+
+	static constexpr bool	kIsFixedLength	= false;
+	static constexpr bool	kIsRaw			= false;
+	static constexpr size_t	kMaxLength		= 10;
+
+	static constexpr uint64_t encode(Value aValue) noexcept { return (static_cast<uint64_t>(aValue) << 1) ^ static_cast<uint64_t>(aValue >> 63); }
+	static constexpr size_t getLength(Value aValue) noexcept { return Detail::getVarintLength(encode(aValue)); }
+	static void write(uint8_t *aBuffer, Value aValue) noexcept { Detail::writeVarint(aBuffer, encode(aValue)); }
+
+	static bool read(const uint8_t *aData, size_t aLength, View *aView) noexcept
+	{
+		uint64_t value;
+		if(!Detail::decodeVarint(aData, aLength, &value))
+			return false;
+
+		*aView = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+		return true;
+	}
+};
+
+// strings, without terminator
+template <>
+struct Field<std::string_view>
+{
+	using Value	= std::string_view;
+	using View	= std::string_view;
+
+	static constexpr bool	kIsFixedLength	= false;
+	static constexpr bool	kIsRaw			= true;
+	static constexpr size_t	kMaxLength		= kUnboundedLength;
+
+	static constexpr size_t getLength(Value aValue) noexcept { return aValue.size(); }
+	static const void *getData(Value aValue) noexcept { return aValue.data(); }
+	static void write(uint8_t *aBuffer, Value aValue) noexcept { std::memcpy(aBuffer, aValue.data(), aValue.size()); }
+
+	static bool read(const uint8_t *aData, size_t aLength, View *aView) noexcept
+	{
+		*aView = std::string_view(reinterpret_cast<const char *>(aData), aLength);
+		return true;
+	}
+};
+
+// raw data
+template <>
+struct Field<Bytes>
+{
+	using Value	= Span<const uint8_t>;
+	using View	= Span<const uint8_t>;
+
+	static constexpr bool	kIsFixedLength	= false;
+	static constexpr bool	kIsRaw			= true;
+	static constexpr size_t	kMaxLength		= kUnboundedLength;
+
+	static constexpr size_t getLength(Value aValue) noexcept { return aValue.size(); }
+	static const void *getData(Value aValue) noexcept { return aValue.data(); }
+	static void write(uint8_t *aBuffer, Value aValue) noexcept { std::memcpy(aBuffer, aValue.data(), aValue.size()); }
+
+	static bool read(const uint8_t *aData, size_t aLength, View *aView) noexcept
+	{
+		*aView = View(aData, aLength);
+		return true;
+	}
+};
+
+// arrays in network byte order, as made by LWArgumentCreateFrom...Array
+template <typename T>
+struct Field<Array<T>>
+{
+	static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "arrays hold integers or floating-point numbers");
+
+	using Value	= Span<const T>;
+	using View	= ArrayView<T>;
+
+	static constexpr bool	kIsFixedLength	= false;
+	static constexpr bool	kIsRaw			= false;
+	static constexpr size_t	kMaxLength		= kUnboundedLength;
+
+	static constexpr size_t getLength(Value aValue) noexcept { return aValue.size()*sizeof(T); }
+
+	static void write(uint8_t *aBuffer, Value aValue) noexcept
+	{
+		for(size_t i = 0; i < aValue.size(); ++i)
+			Detail::writeNetworkOrder(aBuffer + i*sizeof(T), aValue[i]);
+	}
+
+	static bool read(const uint8_t *aData, size_t aLength, View *aView) noexcept
+	{
+		if(0 != aLength % sizeof(T))
+			return false;
+
+		*aView = View(aData, aLength/sizeof(T));
+		return true;
+	}
+};
+
+#pragma mark -
+#pragma mark Messages
+
+template <uint8_t aMessageID, typename... Fields>
+class Message
+{
+public:
+	static constexpr uint8_t	kMessageID		= aMessageID;
+	static constexpr size_t		kFieldCount		= sizeof...(Fields);
+	static constexpr bool		kIsFixedLength	= (Field<Fields>::kIsFixedLength && ...);
+
+	// serialized length of fixed-length messages in version 1 frames, or zero
+	static constexpr size_t kSerializedLength = (kIsFixedLength ? 2 + (Detail::getChunkedLength(Field<Fields>::kMaxLength) + ... + 0) : 0);
+
+	// longest version 1 frame, or zero if fields can be arbitrarily long
+	static constexpr size_t kMaxSerializedLength = (((Field<Fields>::kMaxLength != kUnboundedLength) && ...) ? 2 + (Detail::getChunkedLength(Field<Fields>::kMaxLength) + ... + 0) : 0);
+
+	using Views = std::tuple<typename Field<Fields>::View...>;
+
+	// decoded messages view the frame they were decoded from, and own a copy
+	// only of arguments that were split into several chunks or compressed
+	class Decoded
+	{
+	public:
+		Decoded(Decoded &&) noexcept = default;
+		Decoded &operator=(Decoded &&) noexcept = default;
+		Decoded(const Decoded &) = delete;
+		Decoded &operator=(const Decoded &) = delete;
+
+		template <size_t aIndex>
+		const std::tuple_element_t<aIndex, Views> &get() const noexcept { return std::get<aIndex>(mViews); }
+
+		const Views &getViews() const noexcept { return mViews; }
+
+	private:
+		friend class Message;
+
+		Decoded() = default;
+
+		Views						mViews;
+		std::unique_ptr<uint8_t[]>	mStorage;
+	};
+
+	#pragma mark Serializing
+
+	// returns zero for messages that cannot be sent: frames have no room for
+	// empty arguments
+	static size_t getSerializedLength(const typename Field<Fields>::Value &... aValues) noexcept
+	{
+		if constexpr(kIsFixedLength)
+			return kSerializedLength;
+		else
+		{
+			if(((0 == Field<Fields>::getLength(aValues)) || ...))
+				return 0;
+
+			return 2 + (Detail::getChunkedLength(Field<Fields>::getLength(aValues)) + ... + 0);
+		}
+	}
+
+	// the buffer must hold getSerializedLength() bytes
+	static size_t serializeIntoBuffer(void *aBuffer, const typename Field<Fields>::Value &... aValues) noexcept
+	{
+		uint8_t *buffer = static_cast<uint8_t *>(aBuffer);
+
+		buffer[0] = kMessageID;
+		size_t position = 1;
+		(writeArgument<Fields>(buffer, &position, aValues), ...);
+		buffer[position] = 0;
+
+		return position + 1;
+	}
+
+	static size_t getSerializedLengthWithWireFormat(uint8_t aWireFormat, const typename Field<Fields>::Value &... aValues) noexcept
+	{
+		if(kLWWireFormatVersion2 != aWireFormat)
+			return getSerializedLength(aValues...);
+
+		if(((0 == Field<Fields>::getLength(aValues)) || ...))
+			return 0;
+
+		size_t bodyLength = getBodyLengthVersion2(aValues...);
+		return Detail::getVarintLength(bodyLength) + bodyLength;
+	}
+
+	static size_t serializeIntoBufferWithWireFormat(void *aBuffer, uint8_t aWireFormat, const typename Field<Fields>::Value &... aValues) noexcept
+	{
+		if(kLWWireFormatVersion2 != aWireFormat)
+			return serializeIntoBuffer(aBuffer, aValues...);
+
+		uint8_t *buffer = static_cast<uint8_t *>(aBuffer);
+
+		size_t position = Detail::writeVarint(buffer, getBodyLengthVersion2(aValues...));
+		buffer[position++] = kMessageID;
+		(writeArgumentVersion2<Fields>(buffer, &position, aValues), ...);
+
+		return position;
+	}
+
+	// writes the message in the writer's wire format, with a trailer if the
+	// writer has checksums enabled
+	static bool write(LWWriter *aWriter, const typename Field<Fields>::Value &... aValues) noexcept
+	{
+		uint8_t wireFormat = LWWriterGetWireFormat(aWriter);
+		size_t length = getSerializedLengthWithWireFormat(wireFormat, aValues...);
+		if(0 == length)
+			return false;
+
+		// serialize small messages on the stack
+		uint8_t						stackBuffer[kStackBufferLength];
+		std::unique_ptr<uint8_t[]>	heapBuffer;
+		uint8_t						*buffer = stackBuffer;
+		if(length > kStackBufferLength)
+		{
+			heapBuffer.reset(new (std::nothrow) uint8_t[length]);
+			if(!heapBuffer)
+				return false;
+			buffer = heapBuffer.get();
+		}
+		serializeIntoBufferWithWireFormat(buffer, wireFormat, aValues...);
+
+		return LWWriterWriteFrame(aWriter, buffer, length);
+	}
+
+	#pragma mark Deserializing
+
+	// like LWMessageDeserialize: without a message, zero bytes used mean the
+	// frame is incomplete, and any other number that it is malformed or does
+	// not match this message type and should be skipped
+	static std::optional<Decoded> deserialize(const void *aData, size_t aLength, size_t *aBytesUsed)
+	{
+		const uint8_t *data = static_cast<const uint8_t *>(aData);
+
+		// fixed-length frames have their chunk headers in known places
+		if constexpr(kIsFixedLength)
+		{
+			if(aLength >= kSerializedLength && hasFixedLayout(data, std::index_sequence_for<Fields...>()))
+			{
+				Decoded decoded;
+				readFixedArguments(data, &decoded, std::index_sequence_for<Fields...>());
+				*aBytesUsed = kSerializedLength;
+				return decoded;
+			}
+		}
+
+		return deserializeVersion1(data, aLength, aBytesUsed);
+	}
+
+	static std::optional<Decoded> deserializeWithWireFormat(const void *aData, size_t aLength, size_t *aBytesUsed, uint8_t aWireFormat)
+	{
+		if(kLWWireFormatVersion2 != aWireFormat)
+			return deserialize(aData, aLength, aBytesUsed);
+
+		return deserializeVersion2(static_cast<const uint8_t *>(aData), aLength, aBytesUsed);
+	}
+
+private:
+	static constexpr size_t kStackBufferLength = 512;
+
+	struct ArgumentRange
+	{
+		const uint8_t	*data;
+		size_t			length;
+	};
+
+	#pragma mark Serializing Arguments
+
+	template <typename F>
+	static void writeArgument(uint8_t *aBuffer, size_t *aPosition, const typename Field<F>::Value &aValue) noexcept
+	{
+		size_t	length	= Field<F>::getLength(aValue);
+		uint8_t	*buffer	= aBuffer + *aPosition;
+		*aPosition += Detail::getChunkedLength(length);
+
+		// short arguments take a single chunk
+		if(Field<F>::kMaxLength < 255 || length < 255)
+		{
+			buffer[0] = static_cast<uint8_t>(length);
+			Field<F>::write(buffer + 1, aValue);
+			return;
+		}
+
+		if constexpr(Field<F>::kIsRaw)
+		{
+			// copy raw data chunk by chunk
+			const uint8_t *data = static_cast<const uint8_t *>(Field<F>::getData(aValue));
+			for(size_t i = 0; i <= length/255; ++i, buffer += 256, data += 255)
+			{
+				size_t chunkLength = (length - 255*i > 255 ? 255 : length - 255*i);
+				buffer[0] = static_cast<uint8_t>(chunkLength);
+				std::memcpy(buffer + 1, data, chunkLength);
+			}
+		}
+		else
+		{
+			// write converted data in one piece, then move chunks apart, last one first
+			Field<F>::write(buffer + 1, aValue);
+			for(size_t i = length/255; i > 0; --i)
+			{
+				size_t chunkLength = length - 255*i;
+				if(chunkLength > 255)
+					chunkLength = 255;
+				std::memmove(buffer + 256*i + 1, buffer + 255*i + 1, chunkLength);
+				buffer[256*i] = static_cast<uint8_t>(chunkLength);
+			}
+			buffer[0] = 255;
+		}
+	}
+
+	static size_t getBodyLengthVersion2(const typename Field<Fields>::Value &... aValues) noexcept
+	{
+		return 1 + ((Detail::getVarintLength(static_cast<uint64_t>(Field<Fields>::getLength(aValues)) << 1) + Field<Fields>::getLength(aValues)) + ... + 0);
+	}
+
+	template <typename F>
+	static void writeArgumentVersion2(uint8_t *aBuffer, size_t *aPosition, const typename Field<F>::Value &aValue) noexcept
+	{
+		size_t length = Field<F>::getLength(aValue);
+		*aPosition += Detail::writeVarint(aBuffer + *aPosition, static_cast<uint64_t>(length) << 1);
+		Field<F>::write(aBuffer + *aPosition, aValue);
+		*aPosition += length;
+	}
+
+	#pragma mark Deserializing Arguments
+
+	static constexpr std::array<size_t, sizeof...(Fields)> getFixedOffsets() noexcept
+	{
+		// offsets of the chunk headers
+		std::array<size_t, sizeof...(Fields)>	offsets{};
+		size_t									lengths[] = { Field<Fields>::kMaxLength..., 0 };
+		size_t									offset = 1;
+		for(size_t i = 0; i < kFieldCount; ++i)
+		{
+			offsets[i]	= offset;
+			offset		+= 1 + lengths[i];
+		}
+
+		return offsets;
+	}
+
+	template <size_t... aIndices>
+	static bool hasFixedLayout(const uint8_t *aData, std::index_sequence<aIndices...>) noexcept
+	{
+		[[maybe_unused]] constexpr std::array<size_t, sizeof...(Fields)> offsets = getFixedOffsets();
+		return kMessageID == aData[0]
+			&& ((Field<Fields>::kMaxLength == aData[offsets[aIndices]]) && ...)
+			&& 0 == aData[kSerializedLength - 1];
+	}
+
+	template <size_t... aIndices>
+	static void readFixedArguments([[maybe_unused]] const uint8_t *aData, [[maybe_unused]] Decoded *aDecoded, std::index_sequence<aIndices...>) noexcept
+	{
+		[[maybe_unused]] constexpr std::array<size_t, sizeof...(Fields)> offsets = getFixedOffsets();
+		(Field<Fields>::read(aData + offsets[aIndices] + 1, Field<Fields>::kMaxLength, &std::get<aIndices>(aDecoded->mViews)), ...);
+	}
+
+	template <size_t... aIndices>
+	static bool readArguments([[maybe_unused]] const ArgumentRange *aRanges, [[maybe_unused]] Decoded *aDecoded, std::index_sequence<aIndices...>) noexcept
+	{
+		return (Field<Fields>::read(aRanges[aIndices].data, aRanges[aIndices].length, &std::get<aIndices>(aDecoded->mViews)) && ...);
+	}
+
+	static std::optional<Decoded> deserializeVersion1(const uint8_t *aData, size_t aLength, size_t *aBytesUsed)
+	{
+		*aBytesUsed = 0;
+
+		// find arguments and the end of the frame
+		ArgumentRange	ranges[kFieldCount + 1];
+		size_t			argumentCount					= 0;
+		size_t			storageLength					= 0;
+		size_t			position						= 1;
+		bool			previousArgumentWasIncomplete	= false;
+		if(aLength < 2)
+			return std::nullopt;
+		while(true)
+		{
+			// check bounds
+			if(position >= aLength)
+				return std::nullopt;
+
+			// at end of message
+			uint8_t chunkLength = aData[position];
+			if(0 == chunkLength && !previousArgumentWasIncomplete)
+				break;
+
+			// at start of argument
+			if(!previousArgumentWasIncomplete && argumentCount++ < kFieldCount)
+				ranges[argumentCount - 1] = ArgumentRange{ aData + position + 1, 0 };
+
+			// arguments split into chunks are copied
+			if(argumentCount <= kFieldCount)
+			{
+				ArgumentRange &range = ranges[argumentCount - 1];
+				range.length += chunkLength;
+				if(range.length > 255 && range.length - chunkLength <= 255)
+					storageLength += range.length;
+				else if(range.length > 255)
+					storageLength += chunkLength;
+			}
+
+			previousArgumentWasIncomplete = (255 == chunkLength);
+			position += 1ul + chunkLength;
+		}
+		*aBytesUsed = position + 1;
+
+		// check message type
+		if(kMessageID != aData[0] || kFieldCount != argumentCount)
+			return std::nullopt;
+
+		// concatenate split arguments
+		Decoded decoded;
+		if(storageLength > 0)
+		{
+			decoded.mStorage.reset(new (std::nothrow) uint8_t[storageLength]);
+			if(!decoded.mStorage)
+				return std::nullopt;
+		}
+		uint8_t *storage = decoded.mStorage.get();
+		for(size_t i = 0; i < kFieldCount; ++i)
+		{
+			ArgumentRange &range = ranges[i];
+			if(range.length <= 255)
+				continue;
+
+			const uint8_t *chunk = range.data - 1;
+			for(size_t copiedLength = 0; copiedLength < range.length; chunk += 1ul + chunk[0])
+			{
+				std::memcpy(storage + copiedLength, chunk + 1, chunk[0]);
+				copiedLength += chunk[0];
+			}
+			range.data = storage;
+			storage += range.length;
+		}
+
+		if(!readArguments(ranges, &decoded, std::index_sequence_for<Fields...>()))
+			return std::nullopt;
+
+		return decoded;
+	}
+
+	static std::optional<Decoded> deserializeVersion2(const uint8_t *aData, size_t aLength, size_t *aBytesUsed)
+	{
+		*aBytesUsed = 0;
+
+		// find frame
+		uint64_t	bodyLength;
+		size_t		headerLength;
+		if(!Detail::readVarint(aData, aLength, &bodyLength, &headerLength) || bodyLength > aLength - headerLength)
+			return std::nullopt;
+		size_t frameLength = headerLength + static_cast<size_t>(bodyLength);
+		*aBytesUsed = frameLength;
+
+		// check message type
+		if(0 == bodyLength || kMessageID != aData[headerLength])
+			return std::nullopt;
+
+		// find arguments
+		ArgumentRange	ranges[kFieldCount + 1];
+		size_t			decompressedLengths[kFieldCount + 1];
+		size_t			storageLength	= 0;
+		size_t			position		= headerLength + 1;
+		for(size_t i = 0; i < kFieldCount; ++i)
+		{
+			uint64_t	lengthAndFlags;
+			size_t		varintLength;
+			if(!Detail::readVarint(aData + position, frameLength - position, &lengthAndFlags, &varintLength))
+				return std::nullopt;
+
+			uint64_t length = lengthAndFlags >> 1;
+			if(0 == length || length > frameLength - position - varintLength)
+				return std::nullopt;
+
+			ranges[i]	= ArgumentRange{ aData + position + varintLength, static_cast<size_t>(length) };
+			position	+= varintLength + static_cast<size_t>(length);
+
+			// compressed arguments are decompressed into storage
+			decompressedLengths[i] = 0;
+			if(lengthAndFlags & 1)
+			{
+				decompressedLengths[i] = LWArgumentGetDecompressedLength(ranges[i].data, ranges[i].length);
+				if(0 == decompressedLengths[i])
+					return std::nullopt;
+				storageLength += decompressedLengths[i];
+			}
+		}
+		if(position != frameLength)
+			return std::nullopt;
+
+		// decompress arguments
+		Decoded decoded;
+		if(storageLength > 0)
+		{
+			decoded.mStorage.reset(new (std::nothrow) uint8_t[storageLength]);
+			if(!decoded.mStorage)
+				return std::nullopt;
+		}
+		uint8_t *storage = decoded.mStorage.get();
+		for(size_t i = 0; i < kFieldCount; ++i)
+		{
+			if(0 == decompressedLengths[i])
+				continue;
+
+			if(!LWArgumentDecompressData(ranges[i].data, ranges[i].length, storage, decompressedLengths[i]))
+				return std::nullopt;
+			ranges[i]	= ArgumentRange{ storage, decompressedLengths[i] };
+			storage		+= decompressedLengths[i];
+		}
+
+		if(!readArguments(ranges, &decoded, std::index_sequence_for<Fields...>()))
+			return std::nullopt;
+
+		return decoded;
+	}
+};
+
+#pragma mark -
+#pragma mark Dispatching Messages
+
+namespace Detail {
+
+template <typename... Messages>
+constexpr bool hasUniqueMessageIDs() noexcept
+{
+	uint8_t messageIDs[] = { Messages::kMessageID..., 0 };
+	for(size_t i = 0; i < sizeof...(Messages); ++i)
+	{
+		for(size_t j = i + 1; j < sizeof...(Messages); ++j)
+		{
+			if(messageIDs[i] == messageIDs[j])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+inline bool getFrameMessageID(const uint8_t *aFrame, size_t aLength, uint8_t aWireFormat, uint8_t *aMessageID) noexcept
+{
+	// version 1 frames start with the message ID
+	size_t offset = 0;
+	if(kLWWireFormatVersion2 == aWireFormat)
+	{
+		uint64_t bodyLength;
+		if(!readVarint(aFrame, aLength, &bodyLength, &offset))
+			return false;
+	}
+
+	if(offset >= aLength)
+		return false;
+
+	*aMessageID = aFrame[offset];
+
+	return true;
+}
+
+}
+
+// calls a handler with the decoded message, picking the message type for a
+// message ID with a table built at compile time. the handler must be callable
+// with the Decoded type of every message type
+template <typename... Messages>
+class Dispatcher
+{
+	static_assert(Detail::hasUniqueMessageIDs<Messages...>(), "message IDs must be unique");
+
+public:
+	// returns false for unknown message IDs and malformed frames
+	template <typename Handler>
+	static bool dispatch(const void *aFrame, size_t aLength, uint8_t aWireFormat, Handler &aHandler)
+	{
+		const uint8_t *frame = static_cast<const uint8_t *>(aFrame);
+
+		uint8_t messageID;
+		if(!Detail::getFrameMessageID(frame, aLength, aWireFormat, &messageID))
+			return false;
+
+		constexpr std::array<Function, 256> functions = getFunctions<Handler>();
+		if(!functions[messageID])
+			return false;
+
+		return functions[messageID](frame, aLength, aWireFormat, &aHandler);
+	}
+
+	// lets a data handler pass frames of these message types to the handler
+	// without decoding them into LWMessage objects first. the data handler's
+	// user info must point to the handler. like all relays, this skips the
+	// validator and intern table
+	template <typename Handler>
+	static void setRelayCallbacks(LWDataHandler *aDataHandler)
+	{
+		(LWDataHandlerSetRelayCallback(aDataHandler, Messages::kMessageID, &relayFrame<Messages, Handler>), ...);
+	}
+
+private:
+	using Function = bool (*)(const uint8_t *aFrame, size_t aLength, uint8_t aWireFormat, void *aHandler);
+
+	template <typename M, typename Handler>
+	static bool dispatchMessage(const uint8_t *aFrame, size_t aLength, uint8_t aWireFormat, void *aHandler)
+	{
+		static_assert(std::is_invocable_v<Handler &, const typename M::Decoded &>, "handler must accept every message type");
+
+		size_t bytesUsed;
+		std::optional<typename M::Decoded> decoded = M::deserializeWithWireFormat(aFrame, aLength, &bytesUsed, aWireFormat);
+		if(!decoded)
+			return false;
+
+		(*static_cast<Handler *>(aHandler))(*decoded);
+
+		return true;
+	}
+
+	template <typename Handler>
+	static constexpr std::array<Function, 256> getFunctions() noexcept
+	{
+		std::array<Function, 256> functions{};
+		((functions[Messages::kMessageID] = &dispatchMessage<Messages, Handler>), ...);
+
+		return functions;
+	}
+
+	template <typename M, typename Handler>
+	static void relayFrame(LWDataHandler *aDataHandler, void *aFrame, size_t aFrameLength, void *aUserInfo)
+	{
+		dispatchMessage<M, Handler>(static_cast<const uint8_t *>(aFrame), aFrameLength, LWDataHandlerGetWireFormat(aDataHandler), aUserInfo);
+	}
+};
+
+}
+
+#endif
@@ -40,18 +40,113 @@
 extern "C" {
 #endif
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 
 #include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWAllocator.h>
+
+// Atomic operations
+#if defined(__GNUC__)
+#	define LW_ATOMIC_INCREMENT(aPointer)	__atomic_add_fetch((aPointer), 1, __ATOMIC_RELAXED)
+#	define LW_ATOMIC_DECREMENT(aPointer)	__atomic_sub_fetch((aPointer), 1, __ATOMIC_ACQ_REL)
+#	define LW_ATOMIC_LOAD(aPointer)			__atomic_load_n((aPointer), __ATOMIC_ACQUIRE)
+#	define LW_ATOMIC_STORE(aPointer, aValue)	__atomic_store_n((aPointer), (aValue), __ATOMIC_RELEASE)
+#	define LW_ATOMIC_FENCE()				__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#	define LW_ATOMIC_INCREMENT(aPointer)	(++*(aPointer))
+#	define LW_ATOMIC_DECREMENT(aPointer)	(--*(aPointer))
+#	define LW_ATOMIC_LOAD(aPointer)			(*(aPointer))
+#	define LW_ATOMIC_STORE(aPointer, aValue)	(*(aPointer) = (aValue))
+#	define LW_ATOMIC_FENCE()
+#endif
+
+// Byte order
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#	define LW_NETWORK_ORDER_64(aValue)	(aValue)
+#	define LW_LITTLE_ENDIAN_64(aValue)	__builtin_bswap64(aValue)
+#else
+#	define LW_NETWORK_ORDER_64(aValue)	__builtin_bswap64(aValue)
+#	define LW_LITTLE_ENDIAN_64(aValue)	(aValue)
+#endif
+
+// Varints
+#define kLWVarintMaxLength	(10)
+
+// Compression
+#define kLWCompressionMaxRatio	(255)
+
+// Checksums
+#define kLWChecksumLength	(4)
+
+// Tracing
+#ifdef LW_ENABLE_TRACING
+#	if defined(__has_include)
+#		if __has_include(<sys/sdt.h>)
+#			include <sys/sdt.h>
+#		endif
+#	endif
+#	ifdef STAP_PROBE2
+#		define LW_TRACE_PROBE1(aProbe, aArgument1)				STAP_PROBE1(lunkwill, aProbe, aArgument1)
+#		define LW_TRACE_PROBE2(aProbe, aArgument1, aArgument2)	STAP_PROBE2(lunkwill, aProbe, aArgument1, aArgument2)
+#	else
+#		define LW_TRACE_PROBE1(aProbe, aArgument1)
+#		define LW_TRACE_PROBE2(aProbe, aArgument1, aArgument2)
+#	endif
+#	define LW_TRACE_START(aProbe, aStartTime, aArgument) \
+		uint64_t aStartTime = (LW_ATOMIC_LOAD(&gLWTraceCallback) ? LWTraceGetTime() : 0); \
+		LW_TRACE_PROBE1(aProbe##__start, aArgument)
+#	define LW_TRACE_DONE(aProbe, aEvent, aStartTime, aMessageID, aLength) \
+		do { \
+			LW_TRACE_PROBE2(aProbe##__done, aMessageID, aLength); \
+			if(aStartTime) \
+				LWTraceFire(aEvent, aMessageID, aLength, aStartTime); \
+		} while(0)
+#else
+#	define LW_TRACE_START(aProbe, aStartTime, aArgument)
+#	define LW_TRACE_DONE(aProbe, aEvent, aStartTime, aMessageID, aLength)
+#endif
+
+// Arena chunk
+struct _LWArenaChunk {
+	struct _LWArenaChunk	*next;
+	size_t					capacity;
+	size_t					length;
+	uint8_t					data[];
+};
+
+// Arena
+struct _LWArena {
+	LWAllocator				allocator;
+	LWAllocator				*parentAllocator;
+	struct _LWArenaChunk	*firstChunk;
+	struct _LWArenaChunk	*currentChunk;
+	size_t					chunkSize;
+	size_t					usedLength;
+};
+
+// Counting allocator
+struct _LWCountingAllocator {
+	LWAllocator		allocator;
+	LWAllocator		*parentAllocator;
+	uint64_t		allocationCount;
+	uint64_t		reallocationCount;
+	uint64_t		freeCount;
+};
 
 // Argument
 struct _LWArgument {
-	size_t	length;
-	uint8_t	*data;
-	bool	ownsData;
-	bool	isRetainable;
+	size_t		length;
+	uint8_t		*data;
+	bool		ownsData;
+	bool		isRetainable;
+	uint32_t	retainCount;
+	LWAllocator	*allocator;
+	uint8_t		*compressedData;
+	size_t		compressedLength;
 };
 
 // Message
@@ -60,36 +155,370 @@ struct _LWMessage {
 	size_t		argumentCapacity;
 	size_t		argumentCount;
 	LWArgument	**arguments;
+	uint32_t	retainCount;
+	LWAllocator	*allocator;
+};
+
+// Data handler stats
+struct _LWDataHandlerStats {
+	LWAllocator	*allocator;
+	uint64_t	messageCounts[256];
+	uint64_t	byteCounts[256];
+	uint64_t	*callbackTimeHistograms[256];
+	uint64_t	invalidMessageCount;
+	uint64_t	unrecognisedMessageCount;
+	size_t		bufferHighWaterMark;
+	uint64_t	reallocationCount;
+	uint64_t	carryOverByteCount;
+};
+
+// Data handler frame
+struct _LWDataHandlerFrame {
+	size_t	offset;
+	size_t	length;
+	uint8_t	priority;
+	bool	isDispatched;
 };
 
 // Data handler
 struct _LWDataHandler {
+	// Allocator
+	LWAllocator						*allocator;
+
 	// Buffer
-	uint8_t					*buffer;
-	size_t					bufferCapacity;
-	size_t					availableDataLength;
+	uint8_t							*buffer;
+	size_t							bufferCapacity;
+	size_t							availableDataLength;
 
 	// User info
-	void					*userInfo;
+	void							*userInfo;
 
 	// Callbacks
-	LWDataHandlerCallback	unrecognisedMessageCallback;
-	LWDataHandlerCallback	invalidMessageCallback;
-	LWDataHandlerCallback	messageCallbacks[256];
+	LWDataHandlerCallback			unrecognisedMessageCallback;
+	LWDataHandlerCallback			invalidMessageCallback;
+	LWDataHandlerCallback			messageCallbacks[256];
+
+	// Relays
+	LWWriter						*relayWriters[256];
+	LWDataHandlerRelayCallback		relayCallbacks[256];
 
 	// Deletion
-	bool					isHandlingData;
-	bool					isScheduledForDeletion;
+	bool							isHandlingData;
+	bool							isScheduledForDeletion;
 
 	// Validator
-	LWValidator				*validator;
+	LWValidator						*validator;
+
+	// Dispatch budget
+	size_t							maxDispatchMessageCount;
+	uint64_t						maxDispatchTime;
+	bool							hasPendingMessages;
+
+	// Timeouts
+	LWTimerWheel					*timerWheel;
+	LWTimer							*idleTimer;
+	uint64_t						idleTimeout;
+	LWDataHandlerTimeoutCallback	idleTimeoutCallback;
+	LWTimer							*stallTimer;
+	uint64_t						stallTimeout;
+	LWDataHandlerTimeoutCallback	stallTimeoutCallback;
+
+	// Migration
+	bool							isDetached;
+
+	// Priorities
+	uint8_t							messagePriorities[256];
+	bool							hasMessagePriorities;
+	struct _LWDataHandlerFrame		*frames;
+	size_t							*frameOrder;
+	size_t							frameCapacity;
+
+	// Stats
+	LWDataHandlerStats				*stats;
+
+	// Arena
+	LWArena							*arena;
+
+	// Wire format
+	uint8_t							wireFormat;
+
+	// Interning
+	LWInternTable					*internTable;
+
+	// Checksums
+	bool							isChecksumEnabled;
 };
 
 // Validator
 struct _LWValidator {
+	LWAllocator								*allocator;
 	LWValidatorMessageValidationCallback	messageValidationCallbacks[256];
 };
 
+// Buffer
+struct _LWBuffer {
+	uint8_t		*data;
+	size_t		length;
+	size_t		capacity;
+	uint32_t	retainCount;
+	LWAllocator	*allocator;
+};
+
+// Write queue
+struct _LWWriteQueue {
+	// Allocator
+	LWAllocator	*allocator;
+
+	// Buffers (circular)
+	LWBuffer	**buffers;
+	size_t		bufferCapacity;
+	size_t		firstBufferIndex;
+	size_t		bufferCount;
+
+	// Progress
+	size_t		firstBufferOffset;
+	size_t		pendingLength;
+};
+
+// Writer
+struct _LWWriter {
+	// Allocator
+	LWAllocator					*allocator;
+
+	// Destination
+	int							fileDescriptor;
+	LWWriteQueue				*writeQueue;
+
+	// Coalescing
+	LWBuffer					*tailBuffer;
+
+	// Backpressure
+	size_t						lowWatermark;
+	size_t						highWatermark;
+	bool						isWritable;
+	LWWriterWritabilityCallback	writabilityCallback;
+
+	// Wire format
+	uint8_t						wireFormat;
+
+	// Interning
+	LWInternTable				*internTable;
+
+	// Checksums
+	bool						isChecksumEnabled;
+
+	// User info
+	void						*userInfo;
+};
+
+// Intern table
+#define kLWInternTableNoSlot	(0xffff)
+#define kLWInternTagReference	(0)
+#define kLWInternTagDefinition	(1)
+
+struct _LWInternTableSlot {
+	LWArgument	*argument;
+	uint32_t	hash;
+	uint16_t	previousSlot;
+	uint16_t	nextSlot;
+};
+
+struct _LWInternTable {
+	// Allocator
+	LWAllocator					*allocator;
+
+	// Configuration
+	uint32_t					internedArguments[256];
+
+	// Slots, most recently used first
+	struct _LWInternTableSlot	*slots;
+	uint16_t					capacity;
+	uint16_t					count;
+	uint16_t					firstSlot;
+	uint16_t					lastSlot;
+
+	// Slots by argument hash, plus one
+	uint32_t					*buckets;
+	uint32_t					bucketMask;
+};
+
+// Intern table change, kept until the frame using it is queued
+struct _LWInternTableChange {
+	uint16_t	slot;
+	uint16_t	previousSlot;
+	uint16_t	nextSlot;
+	bool		isDefinition;
+	LWArgument	*evictedArgument;
+	uint32_t	evictedHash;
+};
+
+// Shared ring
+struct _LWSharedRing {
+	// Allocator
+	LWAllocator					*allocator;
+
+	// Mapping
+	int							fileDescriptor;
+	struct _LWSharedRingHeader	*header;
+	uint8_t						*data;
+	size_t						capacity;
+	size_t						mappingLength;
+};
+
+// Multiplexer channel
+struct _LWMultiplexerChannel {
+	// Receiving
+	LWDataHandler	*dataHandler;
+	size_t			receivedLength;
+
+	// Sending
+	LWWriteQueue	*writeQueue;
+	ssize_t			sendCredit;
+};
+
+// Multiplexer
+struct _LWMultiplexer {
+	// Allocator
+	LWAllocator						*allocator;
+
+	// Buffer
+	uint8_t							*buffer;
+	size_t							bufferCapacity;
+	size_t							availableDataLength;
+
+	// Channels
+	struct _LWMultiplexerChannel	*channels[256];
+	size_t							windowSize;
+	uint8_t							nextChannelID;
+
+	// Destination
+	LWWriter						*writer;
+
+	// User info
+	void							*userInfo;
+
+	// Deletion
+	bool							isHandlingData;
+	bool							isScheduledForDeletion;
+};
+
+// Timer wheel
+#define kLWTimerWheelLevelCount	(4)
+#define kLWTimerWheelSlotCount	(256)
+struct _LWTimerWheel {
+	// Allocator
+	LWAllocator		*allocator;
+
+	// Slots
+	struct _LWTimer	*slots[kLWTimerWheelLevelCount][kLWTimerWheelSlotCount];
+
+	// Time
+	uint64_t		currentTime;
+	size_t			timerCount;
+};
+
+// Timer
+struct _LWTimer {
+	// Allocator
+	LWAllocator		*allocator;
+
+	// Slot
+	struct _LWTimer	*next;
+	struct _LWTimer	**link;
+	LWTimerWheel	*timerWheel;
+	uint64_t		expirationTime;
+
+	// Callback
+	LWTimerCallback	callback;
+	void			*userInfo;
+};
+
+// RPC request
+struct _LWRPCRequest {
+	uint32_t				correlationID;
+	LWRPCResponseCallback	callback;
+	void					*context;
+};
+
+// RPC
+struct _LWRPC {
+	// Allocator
+	LWAllocator				*allocator;
+
+	// Destination
+	LWWriter				*writer;
+
+	// In-flight requests
+	struct _LWRPCRequest	*requests;
+	size_t					requestCapacity;
+	size_t					requestCount;
+	uint32_t				nextCorrelationID;
+};
+
+// Client pool connection
+struct _LWClientPoolConnection {
+	// Socket
+	int						fileDescriptor;
+	uint8_t					state;
+	uint64_t				reconnectTime;
+
+	// Protocol
+	LWDataHandler			*dataHandler;
+	LWWriter				*writer;
+	LWRPC					*rpc;
+};
+
+// Client pool
+struct _LWClientPool {
+	// Allocator
+	LWAllocator						*allocator;
+
+	// Endpoint
+	struct sockaddr_storage			address;
+	socklen_t						addressLength;
+
+	// Connections
+	struct _LWClientPoolConnection	*connections;
+	size_t							connectionCount;
+	size_t							connectedCount;
+	uint64_t						reconnectInterval;
+	bool							responseMessageIDs[256];
+
+	// Thread
+	pthread_t						thread;
+	pthread_mutex_t					mutex;
+	pthread_cond_t					connectedCondition;
+	int								wakeupFileDescriptors[2];
+	bool							isWakeupPending;
+	bool							isStopping;
+};
+
+// Private variables
+extern LWTraceCallback gLWTraceCallback;
+
+// Private functions
+LWBuffer *LWBufferCreateWithCapacity(size_t aCapacity);
+LWBuffer *LWBufferCreateWithCapacityAndAllocator(size_t aCapacity, LWAllocator *aAllocator);
+LWBuffer *LWBufferCreateFromMessageWithWireFormatAndAllocator(LWMessage *aMessage, uint8_t aWireFormat, LWAllocator *aAllocator);
+void LWTraceFire(uint8_t aEvent, uint8_t aMessageID, size_t aLength, uint64_t aStartTime);
+void LWByteOrderConvertArray(void *aDestination, const void *aSource, size_t aCount, size_t aElementSize);
+size_t LWVarintGetLength(uint64_t aValue);
+size_t LWVarintWrite(uint8_t *aBuffer, uint64_t aValue);
+bool LWVarintRead(uint8_t *aData, size_t aLength, uint64_t *aValue, size_t *aBytesUsed);
+bool LWVarintDecode(uint8_t *aData, size_t aLength, uint64_t *aValue);
+size_t LWCompressionCompress(uint8_t *aData, size_t aLength, uint8_t *aBuffer, size_t aCapacity);
+bool LWCompressionDecompress(uint8_t *aData, size_t aLength, uint8_t *aBuffer, size_t aDecompressedLength);
+uint32_t LWChecksumUpdate(uint32_t aChecksum, const void *aData, size_t aLength);
+uint32_t LWChecksumCopy(uint32_t aChecksum, void *aDestination, const void *aSource, size_t aLength);
+void LWChecksumWrite(uint8_t *aBuffer, uint32_t aChecksum);
+uint32_t LWChecksumRead(const uint8_t *aBuffer);
+size_t LWMessageSerializeIntoBufferWithChecksum(LWMessage *aMessage, void *aBuffer, uint8_t aWireFormat);
+LWMessage *LWMessageDeserializeWithChecksum(void *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator, LWArena *aArena, uint8_t aWireFormat, bool *aIsChecksumValid);
+bool LWInternTableEncodeArgument(LWInternTable *aInternTable, LWArgument *aArgument, LWArgument *aEncodedArgument, uint8_t *aReferenceData, struct _LWInternTableChange *aChange);
+void LWInternTableCommitChange(LWInternTable *aInternTable, struct _LWInternTableChange *aChange);
+void LWInternTableRevertChange(LWInternTable *aInternTable, struct _LWInternTableChange *aChange);
+bool LWInternTableResolveArgument(LWInternTable *aInternTable, LWMessage *aMessage, size_t aArgumentIndex);
+
 #ifdef __cplusplus
 }
 #endif
@@ -49,10 +49,33 @@ typedef struct _LWArgument		LWArgument;
 typedef struct _LWMessage		LWMessage;
 typedef struct _LWDataHandler	LWDataHandler;
 typedef struct _LWValidator		LWValidator;
+typedef struct _LWBuffer		LWBuffer;
+typedef struct _LWWriteQueue	LWWriteQueue;
+typedef struct _LWWriter		LWWriter;
+typedef struct _LWSharedRing	LWSharedRing;
+typedef struct _LWMultiplexer	LWMultiplexer;
+typedef struct _LWTimerWheel	LWTimerWheel;
+typedef struct _LWTimer			LWTimer;
+typedef struct _LWRPC			LWRPC;
+typedef struct _LWClientPool	LWClientPool;
+typedef struct _LWDataHandlerStats	LWDataHandlerStats;
+typedef struct _LWAllocator		LWAllocator;
+typedef struct _LWArena			LWArena;
+typedef struct _LWCountingAllocator	LWCountingAllocator;
+typedef struct _LWInternTable	LWInternTable;
 
 // Types for callbacks
 typedef void (*LWDataHandlerCallback)(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo);
 typedef bool (*LWValidatorMessageValidationCallback)(struct _LWMessage *);
+typedef void (*LWDataHandlerRelayCallback)(LWDataHandler *aDataHandler, void *aFrame, size_t aFrameLength, void *aUserInfo);
+typedef void (*LWDataHandlerTimeoutCallback)(LWDataHandler *aDataHandler, void *aUserInfo);
+typedef void (*LWWriterWritabilityCallback)(LWWriter *aWriter, bool aIsWritable, void *aUserInfo);
+typedef void (*LWTimerCallback)(LWTimer *aTimer, void *aUserInfo);
+typedef void (*LWRPCResponseCallback)(LWRPC *aRPC, LWMessage *aResponse, void *aContext);
+typedef void *(*LWAllocatorAllocateCallback)(size_t aSize, void *aContext);
+typedef void *(*LWAllocatorReallocateCallback)(void *aPointer, size_t aSize, void *aContext);
+typedef void (*LWAllocatorFreeCallback)(void *aPointer, void *aContext);
+typedef void (*LWTraceCallback)(uint8_t aEvent, uint8_t aMessageID, size_t aLength, uint64_t aStartTime, uint64_t aEndTime, void *aUserInfo);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,106 @@
+/*
+ * LWLoadClient.h
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_LOADCLIENT_H__
+#define __LUNKWILL_LOADCLIENT_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <Lunkwill/LunkwillTypes.h>
+
+#include "load/LWLoadHistogram.h"
+
+#define kLoadMaximumMixEntryCount	(16)
+
+struct load_mix_entry {
+	uint8_t		messageID;
+	uint32_t	requestLength;
+	uint32_t	responseLength;
+	uint32_t	weight;
+};
+
+struct load_configuration {
+	struct sockaddr_storage	address;
+	socklen_t				addressLength;
+
+	struct load_mix_entry	mix[kLoadMaximumMixEntryCount];
+	size_t					mixEntryCount;
+
+	// requests per second per client; zero means closed loop
+	uint64_t				rate;
+	// requests in flight per client in closed loop
+	size_t					window;
+
+	// in nanoseconds, since the common start time
+	uint64_t				startTime;
+	uint64_t				warmup;
+	uint64_t				duration;
+
+	// shared by all clients, or NULL for one connection per client
+	LWClientPool			*clientPool;
+};
+
+struct load_request;
+
+struct load_client {
+	struct load_configuration	*configuration;
+	pthread_t					thread;
+	pthread_mutex_t				mutex;
+	pthread_cond_t				condition;
+	uint32_t					seed;
+
+	LWMessage					*requests[kLoadMaximumMixEntryCount];
+	struct load_request			*slots;
+	size_t						*freeSlots;
+	size_t						freeSlotCount;
+	size_t						inFlightCount;
+
+	// results
+	struct load_histogram		histogram;
+	uint64_t					responseCount;
+	uint64_t					errorCount;
+	uint64_t					droppedCount;
+};
+
+uint64_t load_get_time(void);
+
+bool load_client_start(struct load_client *aClient, struct load_configuration *aConfiguration, uint32_t aSeed);
+void load_client_join(struct load_client *aClient);
+void load_client_finish(struct load_client *aClient);
+
+#endif
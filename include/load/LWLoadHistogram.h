@@ -0,0 +1,59 @@
+/*
+ * LWLoadHistogram.h
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LUNKWILL_LOADHISTOGRAM_H__
+#define __LUNKWILL_LOADHISTOGRAM_H__
+
+#include <stdint.h>
+
+// log-linear buckets: 32 per power of two, so values are accurate to ~3%
+#define kLoadHistogramSubBucketBits		(5)
+#define kLoadHistogramSubBucketCount	(1 << kLoadHistogramSubBucketBits)
+#define kLoadHistogramBucketCount		((64 - kLoadHistogramSubBucketBits + 1)*kLoadHistogramSubBucketCount)
+
+struct load_histogram {
+	uint64_t	counts[kLoadHistogramBucketCount];
+	uint64_t	count;
+	uint64_t	sum;
+	uint64_t	min;
+	uint64_t	max;
+};
+
+void load_histogram_reset(struct load_histogram *aHistogram);
+void load_histogram_record(struct load_histogram *aHistogram, uint64_t aValue);
+void load_histogram_merge(struct load_histogram *aHistogram, struct load_histogram *aOtherHistogram);
+uint64_t load_histogram_get_percentile(struct load_histogram *aHistogram, double aPercentile);
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ * LWAllocator.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+
+static void *LWSystemAllocatorAllocate(size_t aSize, void *aContext);
+static void *LWSystemAllocatorReallocate(void *aPointer, size_t aSize, void *aContext);
+static void LWSystemAllocatorFree(void *aPointer, void *aContext);
+
+static LWAllocator gLWSystemAllocator = {
+	&LWSystemAllocatorAllocate,
+	&LWSystemAllocatorReallocate,
+	&LWSystemAllocatorFree,
+	NULL
+};
+
+static LWAllocator *gLWDefaultAllocator = &gLWSystemAllocator;
+
+#pragma mark System Allocator
+
+static void *LWSystemAllocatorAllocate(size_t aSize, void *aContext)
+{
+#pragma unused (aContext)
+
+	return malloc(aSize);
+}
+
+static void *LWSystemAllocatorReallocate(void *aPointer, size_t aSize, void *aContext)
+{
+#pragma unused (aContext)
+
+	return realloc(aPointer, aSize);
+}
+
+static void LWSystemAllocatorFree(void *aPointer, void *aContext)
+{
+#pragma unused (aContext)
+
+	free(aPointer);
+}
+
+#pragma mark -
+#pragma mark Getting Allocators
+
+LWAllocator *LWAllocatorGetSystem(void)
+{
+	return &gLWSystemAllocator;
+}
+
+LWAllocator *LWAllocatorGetDefault(void)
+{
+	return gLWDefaultAllocator;
+}
+
+void LWAllocatorSetDefault(LWAllocator *aAllocator)
+{
+	gLWDefaultAllocator = (aAllocator ? aAllocator : &gLWSystemAllocator);
+}
+
+#pragma mark -
+#pragma mark Allocating Memory
+
+void *LWAllocatorAllocate(LWAllocator *aAllocator, size_t aSize)
+{
+	LWAllocator *allocator = (aAllocator ? aAllocator : gLWDefaultAllocator);
+	return allocator->allocate(aSize, allocator->context);
+}
+
+void *LWAllocatorAllocateZeroed(LWAllocator *aAllocator, size_t aSize)
+{
+	void *pointer = LWAllocatorAllocate(aAllocator, aSize);
+	if(pointer)
+		memset(pointer, 0, aSize);
+
+	return pointer;
+}
+
+void *LWAllocatorReallocate(LWAllocator *aAllocator, void *aPointer, size_t aSize)
+{
+	LWAllocator *allocator = (aAllocator ? aAllocator : gLWDefaultAllocator);
+	return allocator->reallocate(aPointer, aSize, allocator->context);
+}
+
+void LWAllocatorFree(LWAllocator *aAllocator, void *aPointer)
+{
+	// like free(), accept NULL
+	if(!aPointer)
+		return;
+
+	LWAllocator *allocator = (aAllocator ? aAllocator : gLWDefaultAllocator);
+	allocator->free(aPointer, allocator->context);
+}
@@ -0,0 +1,229 @@
+/*
+ * LWArena.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArena.h>
+
+#define kLWArenaDefaultChunkSize	(65536)
+#define kLWArenaAlignment			(16)
+
+static void *LWArenaAllocate(size_t aSize, void *aContext);
+static void *LWArenaReallocate(void *aPointer, size_t aSize, void *aContext);
+static void LWArenaFree(void *aPointer, void *aContext);
+
+#pragma mark Creating Arenas
+
+LWArena *LWArenaCreate(size_t aChunkSize)
+{
+	return LWArenaCreateWithAllocator(aChunkSize, NULL);
+}
+
+LWArena *LWArenaCreateWithAllocator(size_t aChunkSize, LWAllocator *aParentAllocator)
+{
+	// find allocator for chunks
+	LWAllocator *parentAllocator = (aParentAllocator ? aParentAllocator : LWAllocatorGetDefault());
+
+	// allocate arena
+	LWArena *arena = LWAllocatorAllocate(parentAllocator, sizeof(LWArena));
+	if(!arena)
+		return NULL;
+
+	// initialize allocator
+	arena->allocator.allocate	= &LWArenaAllocate;
+	arena->allocator.reallocate	= &LWArenaReallocate;
+	arena->allocator.free		= &LWArenaFree;
+	arena->allocator.context	= arena;
+
+	// initialize chunks
+	arena->parentAllocator	= parentAllocator;
+	arena->firstChunk		= NULL;
+	arena->currentChunk		= NULL;
+	arena->chunkSize		= (0 == aChunkSize ? kLWArenaDefaultChunkSize : aChunkSize);
+	arena->usedLength		= 0;
+
+	return arena;
+}
+
+#pragma mark -
+#pragma mark Deleting Arenas
+
+void LWArenaDelete(LWArena *aArena)
+{
+	// delete chunks
+	struct _LWArenaChunk *chunk = aArena->firstChunk;
+	while(chunk)
+	{
+		struct _LWArenaChunk *nextChunk = chunk->next;
+		LWAllocatorFree(aArena->parentAllocator, chunk);
+		chunk = nextChunk;
+	}
+
+	// delete arena
+	LWAllocatorFree(aArena->parentAllocator, aArena);
+}
+
+#pragma mark -
+#pragma mark Using Arenas
+
+LWAllocator *LWArenaGetAllocator(LWArena *aArena)
+{
+	return &aArena->allocator;
+}
+
+void LWArenaReset(LWArena *aArena)
+{
+	if(!aArena->firstChunk)
+		return;
+
+	// keep the first chunk, delete the others
+	struct _LWArenaChunk *chunk = aArena->firstChunk->next;
+	while(chunk)
+	{
+		struct _LWArenaChunk *nextChunk = chunk->next;
+		LWAllocatorFree(aArena->parentAllocator, chunk);
+		chunk = nextChunk;
+	}
+
+	// rewind
+	aArena->firstChunk->next	= NULL;
+	aArena->firstChunk->length	= 0;
+	aArena->currentChunk		= aArena->firstChunk;
+	aArena->usedLength			= 0;
+}
+
+#pragma mark -
+#pragma mark Querying Arenas
+
+size_t LWArenaGetUsedLength(LWArena *aArena)
+{
+	return aArena->usedLength;
+}
+
+#pragma mark -
+#pragma mark Allocator Callbacks
+
+static uint8_t *LWArenaFindBlock(struct _LWArenaChunk *aChunk, size_t aSize)
+{
+	// blocks are aligned and preceded by their size
+	uintptr_t start = (uintptr_t)(aChunk->data + aChunk->length) + sizeof(size_t);
+	uintptr_t block = (start + kLWArenaAlignment - 1) & ~((uintptr_t)kLWArenaAlignment - 1);
+
+	// check bounds
+	if(block + aSize > (uintptr_t)(aChunk->data + aChunk->capacity))
+		return NULL;
+
+	return (uint8_t *)block;
+}
+
+static void *LWArenaAllocate(size_t aSize, void *aContext)
+{
+	LWArena *arena = aContext;
+
+	// find room in current chunk
+	uint8_t *block = (arena->currentChunk ? LWArenaFindBlock(arena->currentChunk, aSize) : NULL);
+	if(!block)
+	{
+		// allocate new chunk, large enough for oversized blocks
+		size_t capacity = aSize + sizeof(size_t) + kLWArenaAlignment;
+		if(capacity < arena->chunkSize)
+			capacity = arena->chunkSize;
+		struct _LWArenaChunk *chunk = LWAllocatorAllocate(arena->parentAllocator, sizeof(struct _LWArenaChunk) + capacity);
+		if(!chunk)
+			return NULL;
+		chunk->next		= NULL;
+		chunk->capacity	= capacity;
+		chunk->length	= 0;
+
+		// append chunk
+		if(arena->currentChunk)
+			arena->currentChunk->next = chunk;
+		else
+			arena->firstChunk = chunk;
+		arena->currentChunk = chunk;
+
+		block = LWArenaFindBlock(chunk, aSize);
+	}
+
+	// record block size
+	memcpy(block - sizeof(size_t), &aSize, sizeof(size_t));
+	arena->currentChunk->length = (size_t)(block + aSize - arena->currentChunk->data);
+	arena->usedLength += aSize;
+
+	return block;
+}
+
+static void *LWArenaReallocate(void *aPointer, size_t aSize, void *aContext)
+{
+	LWArena *arena = aContext;
+
+	if(!aPointer)
+		return LWArenaAllocate(aSize, aContext);
+
+	// get old block size
+	uint8_t *block = aPointer;
+	size_t oldSize;
+	memcpy(&oldSize, block - sizeof(size_t), sizeof(size_t));
+
+	// resize in place if this is the most recent block and it fits
+	struct _LWArenaChunk *chunk = arena->currentChunk;
+	if(block + oldSize == chunk->data + chunk->length && block + aSize <= chunk->data + chunk->capacity)
+	{
+		memcpy(block - sizeof(size_t), &aSize, sizeof(size_t));
+		chunk->length = (size_t)(block + aSize - chunk->data);
+		arena->usedLength = arena->usedLength - oldSize + aSize;
+		return block;
+	}
+
+	// move block
+	void *newBlock = LWArenaAllocate(aSize, aContext);
+	if(!newBlock)
+		return NULL;
+	memcpy(newBlock, block, (oldSize < aSize ? oldSize : aSize));
+
+	return newBlock;
+}
+
+static void LWArenaFree(void *aPointer, void *aContext)
+{
+#pragma unused (aPointer, aContext)
+
+	// memory is reclaimed by LWArenaReset() and LWArenaDelete()
+}
@@ -48,33 +48,48 @@
 #include <Lunkwill/LunkwillDefines.h>
 #include <Lunkwill/LunkwillTypes.h>
 #include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
 #include <Lunkwill/LWArgument.h>
 
 #pragma mark Creating Arguments
 
 LWArgument *LWArgumentCreate(void *aData, size_t aLength)
+{
+	return LWArgumentCreateWithAllocator(aData, aLength, NULL);
+}
+
+LWArgument *LWArgumentCreateWithAllocator(void *aData, size_t aLength, LWAllocator *aAllocator)
 {
 	// don't create argument with length equal to zero
 	if(0 == aLength)
 		return NULL;
 
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
 	// create argument
-	LWArgument *argument = malloc(sizeof(LWArgument));
+	LWArgument *argument = LWAllocatorAllocate(allocator, sizeof(LWArgument));
 	if(!argument)
 		return NULL;
+	argument->allocator = allocator;
 
 	// set retainable
 	argument->isRetainable = true;
+	argument->retainCount = 1;
 
 	// create data
-	argument->data = malloc((aLength+1)*sizeof(uint8_t));
+	argument->data = LWAllocatorAllocate(allocator, (aLength+1)*sizeof(uint8_t));
 	if(!argument->data)
 	{
-		free(argument);
+		LWAllocatorFree(allocator, argument);
 		return NULL;
 	}
 	argument->ownsData = true;
 
+	// not compressed
+	argument->compressedData	= NULL;
+	argument->compressedLength	= 0;
+
 	// copy data
 	argument->length = aLength;
 	memcpy(argument->data, aData, aLength);
@@ -84,24 +99,38 @@ LWArgument *LWArgumentCreate(void *aData, size_t aLength)
 }
 
 LWArgument *LWArgumentCreateWithoutCopying(void *aData, size_t aLength)
+{
+	return LWArgumentCreateWithoutCopyingWithAllocator(aData, aLength, NULL);
+}
+
+LWArgument *LWArgumentCreateWithoutCopyingWithAllocator(void *aData, size_t aLength, LWAllocator *aAllocator)
 {
 	// don't create argument with length equal to zero
 	if(0 == aLength)
 		return NULL;
 
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
 	// create argument
-	LWArgument *argument = malloc(sizeof(LWArgument));
+	LWArgument *argument = LWAllocatorAllocate(allocator, sizeof(LWArgument));
 	if(!argument)
 		return NULL;
+	argument->allocator = allocator;
 
 	// set retainable
 	argument->isRetainable = true;
+	argument->retainCount = 1;
 
 	// create data
 	argument->data = aData;
 	argument->length = aLength;
 	argument->ownsData = false;
 
+	// not compressed
+	argument->compressedData	= NULL;
+	argument->compressedLength	= 0;
+
 	return argument;
 }
 
@@ -144,6 +173,97 @@ LWArgument *LWArgumentCreateFrom32BitUnsignedInteger(uint32_t aInteger)
 	return LWArgumentCreate(&newInteger, sizeof(uint32_t));
 }
 
+LWArgument *LWArgumentCreateFrom64BitInteger(int64_t aInteger)
+{
+	return LWArgumentCreateFrom64BitUnsignedInteger((uint64_t)aInteger);
+}
+
+LWArgument *LWArgumentCreateFrom64BitUnsignedInteger(uint64_t aInteger)
+{
+	uint64_t newInteger = LW_NETWORK_ORDER_64(aInteger);
+	return LWArgumentCreate(&newInteger, sizeof(uint64_t));
+}
+
+LWArgument *LWArgumentCreateFromFloat(float aFloat)
+{
+	// floats are sent as their IEEE 754 bits
+	uint32_t integer;
+	memcpy(&integer, &aFloat, sizeof(float));
+	return LWArgumentCreateFrom32BitUnsignedInteger(integer);
+}
+
+LWArgument *LWArgumentCreateFromDouble(double aDouble)
+{
+	// doubles are sent as their IEEE 754 bits
+	uint64_t integer;
+	memcpy(&integer, &aDouble, sizeof(double));
+	return LWArgumentCreateFrom64BitUnsignedInteger(integer);
+}
+
+LWArgument *LWArgumentCreateFromVarint(uint64_t aInteger)
+{
+	uint8_t data[kLWVarintMaxLength];
+	return LWArgumentCreate(data, LWVarintWrite(data, aInteger));
+}
+
+LWArgument *LWArgumentCreateFromSignedVarint(int64_t aInteger)
+{
+	// zigzag encoding keeps small negative numbers small
+	return LWArgumentCreateFromVarint(((uint64_t)aInteger << 1) ^ (uint64_t)(aInteger >> 63));
+}
+
+static LWArgument *LWArgumentCreateFromArray(void *aElements, size_t aCount, size_t aElementSize)
+{
+	// don't create argument with length equal to zero
+	size_t length = aCount*aElementSize;
+	if(0 == length)
+		return NULL;
+
+	// convert elements straight into the argument's data
+	LWAllocator *allocator = LWAllocatorGetDefault();
+	uint8_t *data = LWAllocatorAllocate(allocator, (length+1)*sizeof(uint8_t));
+	if(!data)
+		return NULL;
+	LWByteOrderConvertArray(data, aElements, aCount, aElementSize);
+	data[length] = '\0';
+
+	// create argument
+	LWArgument *argument = LWArgumentCreateWithoutCopyingWithAllocator(data, length, allocator);
+	if(!argument)
+	{
+		LWAllocatorFree(allocator, data);
+		return NULL;
+	}
+	LWArgumentSetOwnsData(argument, true);
+
+	return argument;
+}
+
+LWArgument *LWArgumentCreateFrom16BitIntegerArray(int16_t *aIntegers, size_t aCount)
+{
+	return LWArgumentCreateFromArray(aIntegers, aCount, sizeof(int16_t));
+}
+
+LWArgument *LWArgumentCreateFrom32BitIntegerArray(int32_t *aIntegers, size_t aCount)
+{
+	return LWArgumentCreateFromArray(aIntegers, aCount, sizeof(int32_t));
+}
+
+LWArgument *LWArgumentCreateFrom64BitIntegerArray(int64_t *aIntegers, size_t aCount)
+{
+	return LWArgumentCreateFromArray(aIntegers, aCount, sizeof(int64_t));
+}
+
+LWArgument *LWArgumentCreateFromFloatArray(float *aFloats, size_t aCount)
+{
+	return LWArgumentCreateFromArray(aFloats, aCount, sizeof(float));
+}
+
+LWArgument *LWArgumentCreateFromDoubleArray(double *aDoubles, size_t aCount)
+{
+	return LWArgumentCreateFromArray(aDoubles, aCount, sizeof(double));
+}
+
 #pragma mark -
 #pragma mark Altering Arguments
 
@@ -157,6 +277,78 @@ void LWArgumentSetOwnsData(LWArgument *aArgument, bool aOwnsData)
 	aArgument->ownsData = aOwnsData;
 }
 
+#pragma mark -
+#pragma mark Compressing Arguments
+
+// compressed arguments are only sent compressed in version 2 frames, as
+//
+//   [varint uncompressed length][compressed data]
+
+bool LWArgumentCompress(LWArgument *aArgument, size_t aThreshold)
+{
+	// skip short and already compressed arguments
+	if(aArgument->length < aThreshold || aArgument->compressedData)
+		return true;
+
+	// compressing must save at least one byte
+	size_t prefixLength = LWVarintGetLength(aArgument->length);
+	if(aArgument->length <= prefixLength + 1)
+		return true;
+	uint8_t *compressedData = LWAllocatorAllocate(aArgument->allocator, aArgument->length - 1);
+	if(!compressedData)
+		return false;
+
+	// compress, giving up on incompressible data
+	LWVarintWrite(compressedData, aArgument->length);
+	size_t compressedLength = LWCompressionCompress(aArgument->data, aArgument->length, compressedData + prefixLength, aArgument->length - 1 - prefixLength);
+	if(0 == compressedLength)
+	{
+		LWAllocatorFree(aArgument->allocator, compressedData);
+		return true;
+	}
+
+	// keep compressed data alongside the original
+	aArgument->compressedLength	= prefixLength + compressedLength;
+	aArgument->compressedData	= LWAllocatorReallocate(aArgument->allocator, compressedData, aArgument->compressedLength);
+	if(!aArgument->compressedData)
+		aArgument->compressedData = compressedData;
+
+	return true;
+}
+
+bool LWArgumentIsCompressed(LWArgument *aArgument)
+{
+	return NULL != aArgument->compressedData;
+}
+
+size_t LWArgumentGetDecompressedLength(const void *aData, size_t aLength)
+{
+	uint64_t	length;
+	size_t		prefixLength;
+	if(!LWVarintRead((uint8_t *)aData, aLength, &length, &prefixLength) || prefixLength == aLength)
+		return 0;
+
+	// no data decompresses to much more than it could describe
+	if(length > (uint64_t)(aLength - prefixLength)*kLWCompressionMaxRatio)
+		return 0;
+
+	return (size_t)length;
+}
+
+bool LWArgumentDecompressData(const void *aData, size_t aLength, void *aBuffer, size_t aDecompressedLength)
+{
+	// the buffer must fit the data exactly
+	if(0 == aDecompressedLength || LWArgumentGetDecompressedLength(aData, aLength) != aDecompressedLength)
+		return false;
+
+	// skip uncompressed length
+	uint64_t	length;
+	size_t		prefixLength;
+	LWVarintRead((uint8_t *)aData, aLength, &length, &prefixLength);
+
+	return LWCompressionDecompress((uint8_t *)aData + prefixLength, aLength - prefixLength, aBuffer, aDecompressedLength);
+}
+
 #pragma mark -
 #pragma mark Querying Arguments
 
@@ -172,7 +364,7 @@ size_t LWArgumentGetLength(LWArgument *aArgument)
 
 char *LWArgumentGetStringValue(LWArgument *aArgument)
 {
-	char *string = malloc(sizeof(char)*(aArgument->length+1));
+	char *string = LWAllocatorAllocate(NULL, sizeof(char)*(aArgument->length+1));
 	memcpy(string, aArgument->data, aArgument->length);
 	string[aArgument->length] = '\0';
 
@@ -209,14 +401,115 @@ uint32_t LWArgumentGet32BitUnsignedIntegerValue(LWArgument *aArgument)
 	return ntohl(*((int32_t *)(aArgument->data)));
 }
 
+int64_t LWArgumentGet64BitIntegerValue(LWArgument *aArgument)
+{
+	return (int64_t)LWArgumentGet64BitUnsignedIntegerValue(aArgument);
+}
+
+uint64_t LWArgumentGet64BitUnsignedIntegerValue(LWArgument *aArgument)
+{
+	// data decoded into an arena is not necessarily aligned
+	uint64_t integer;
+	memcpy(&integer, aArgument->data, sizeof(uint64_t));
+	return LW_NETWORK_ORDER_64(integer);
+}
+
+float LWArgumentGetFloatValue(LWArgument *aArgument)
+{
+	uint32_t integer = LWArgumentGet32BitUnsignedIntegerValue(aArgument);
+	float value;
+	memcpy(&value, &integer, sizeof(float));
+	return value;
+}
+
+double LWArgumentGetDoubleValue(LWArgument *aArgument)
+{
+	uint64_t integer = LWArgumentGet64BitUnsignedIntegerValue(aArgument);
+	double value;
+	memcpy(&value, &integer, sizeof(double));
+	return value;
+}
+
+bool LWArgumentGetVarintValue(LWArgument *aArgument, uint64_t *aInteger)
+{
+	return LWVarintDecode(aArgument->data, aArgument->length, aInteger);
+}
+
+bool LWArgumentGetSignedVarintValue(LWArgument *aArgument, int64_t *aInteger)
+{
+	uint64_t integer;
+	if(!LWVarintDecode(aArgument->data, aArgument->length, &integer))
+		return false;
+
+	*aInteger = (int64_t)(integer >> 1) ^ -(int64_t)(integer & 1);
+
+	return true;
+}
+
+static bool LWArgumentGetArrayValue(LWArgument *aArgument, void *aElements, size_t aCount, size_t aElementSize)
+{
+	// argument must hold exactly the requested number of elements
+	if(aArgument->length != aCount*aElementSize)
+		return false;
+
+	LWByteOrderConvertArray(aElements, aArgument->data, aCount, aElementSize);
+
+	return true;
+}
+
+bool LWArgumentGet16BitIntegerArrayValue(LWArgument *aArgument, int16_t *aIntegers, size_t aCount)
+{
+	return LWArgumentGetArrayValue(aArgument, aIntegers, aCount, sizeof(int16_t));
+}
+
+bool LWArgumentGet32BitIntegerArrayValue(LWArgument *aArgument, int32_t *aIntegers, size_t aCount)
+{
+	return LWArgumentGetArrayValue(aArgument, aIntegers, aCount, sizeof(int32_t));
+}
+
+bool LWArgumentGet64BitIntegerArrayValue(LWArgument *aArgument, int64_t *aIntegers, size_t aCount)
+{
+	return LWArgumentGetArrayValue(aArgument, aIntegers, aCount, sizeof(int64_t));
+}
+
+bool LWArgumentGetFloatArrayValue(LWArgument *aArgument, float *aFloats, size_t aCount)
+{
+	return LWArgumentGetArrayValue(aArgument, aFloats, aCount, sizeof(float));
+}
+
+bool LWArgumentGetDoubleArrayValue(LWArgument *aArgument, double *aDoubles, size_t aCount)
+{
+	return LWArgumentGetArrayValue(aArgument, aDoubles, aCount, sizeof(double));
+}
+
+#pragma mark -
+#pragma mark Retaining And Releasing Arguments
+
+LWArgument *LWArgumentRetain(LWArgument *aArgument)
+{
+	LW_ATOMIC_INCREMENT(&aArgument->retainCount);
+	return aArgument;
+}
+
+void LWArgumentRelease(LWArgument *aArgument)
+{
+	// only delete argument when the last reference is gone
+	if(0 != LW_ATOMIC_DECREMENT(&aArgument->retainCount))
+		return;
+
+	if(aArgument->ownsData)
+		LWAllocatorFree(aArgument->allocator, aArgument->data);
+	if(aArgument->compressedData)
+		LWAllocatorFree(aArgument->allocator, aArgument->compressedData);
+	LWAllocatorFree(aArgument->allocator, aArgument);
+}
+
 #pragma mark -
 #pragma mark Deleting Arguments
 
 void LWArgumentDelete(LWArgument *aArgument)
 {
-	if(aArgument->ownsData)
-		free(aArgument->data);
-	free(aArgument);
+	LWArgumentRelease(aArgument);
 }
 
 #pragma mark -
@@ -0,0 +1,141 @@
+/*
+ * LWBuffer.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWBuffer.h>
+
+#pragma mark Creating Buffers
+
+LWBuffer *LWBufferCreateWithCapacity(size_t aCapacity)
+{
+	return LWBufferCreateWithCapacityAndAllocator(aCapacity, NULL);
+}
+
+LWBuffer *LWBufferCreateWithCapacityAndAllocator(size_t aCapacity, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate buffer and data in one go
+	LWBuffer *buffer = LWAllocatorAllocate(allocator, sizeof(LWBuffer) + aCapacity*sizeof(uint8_t));
+	if(!buffer)
+		return NULL;
+	buffer->allocator = allocator;
+
+	// initialize buffer
+	buffer->data		= (uint8_t *)(buffer + 1);
+	buffer->length		= 0;
+	buffer->capacity	= aCapacity;
+	buffer->retainCount	= 1;
+
+	return buffer;
+}
+
+LWBuffer *LWBufferCreate(void *aData, size_t aLength)
+{
+	// create buffer
+	LWBuffer *buffer = LWBufferCreateWithCapacity(aLength);
+	if(!buffer)
+		return NULL;
+
+	// copy data
+	memcpy(buffer->data, aData, aLength);
+	buffer->length = aLength;
+
+	return buffer;
+}
+
+LWBuffer *LWBufferCreateFromMessage(LWMessage *aMessage)
+{
+	return LWBufferCreateFromMessageWithWireFormat(aMessage, kLWWireFormatVersion1);
+}
+
+LWBuffer *LWBufferCreateFromMessageWithWireFormat(LWMessage *aMessage, uint8_t aWireFormat)
+{
+	return LWBufferCreateFromMessageWithWireFormatAndAllocator(aMessage, aWireFormat, NULL);
+}
+
+LWBuffer *LWBufferCreateFromMessageWithWireFormatAndAllocator(LWMessage *aMessage, uint8_t aWireFormat, LWAllocator *aAllocator)
+{
+	// create buffer
+	size_t length = LWMessageGetSerializedLengthWithWireFormat(aMessage, aWireFormat);
+	if(0 == length)
+		return NULL;
+	LWBuffer *buffer = LWBufferCreateWithCapacityAndAllocator(length, aAllocator);
+	if(!buffer)
+		return NULL;
+
+	// serialize message directly into buffer
+	buffer->length = LWMessageSerializeIntoBufferWithWireFormat(aMessage, buffer->data, aWireFormat);
+
+	return buffer;
+}
+
+#pragma mark -
+#pragma mark Retaining And Releasing Buffers
+
+LWBuffer *LWBufferRetain(LWBuffer *aBuffer)
+{
+	LW_ATOMIC_INCREMENT(&aBuffer->retainCount);
+	return aBuffer;
+}
+
+void LWBufferRelease(LWBuffer *aBuffer)
+{
+	// only delete buffer when the last reference is gone
+	if(0 != LW_ATOMIC_DECREMENT(&aBuffer->retainCount))
+		return;
+
+	LWAllocatorFree(aBuffer->allocator, aBuffer);
+}
+
+#pragma mark -
+#pragma mark Querying Buffers
+
+void *LWBufferGetData(LWBuffer *aBuffer)
+{
+	return aBuffer->data;
+}
+
+size_t LWBufferGetLength(LWBuffer *aBuffer)
+{
+	return aBuffer->length;
+}
@@ -0,0 +1,182 @@
+/*
+ * LWByteOrder.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	define LW_BYTE_ORDER_HAS_X86_KERNELS
+#	include <immintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#	define LW_BYTE_ORDER_IS_NETWORK_ORDER
+#endif
+
+#ifndef LW_BYTE_ORDER_IS_NETWORK_ORDER
+
+#pragma mark Scalar Kernel
+
+static void LWByteOrderSwapScalar(uint8_t *aDestination, const uint8_t *aSource, size_t aCount, size_t aElementSize)
+{
+	// memcpy keeps unaligned accesses legal and compiles to plain loads and stores
+	switch(aElementSize)
+	{
+		case 2:
+			for(size_t i = 0; i < aCount; ++i)
+			{
+				uint16_t value;
+				memcpy(&value, aSource + 2*i, 2);
+				value = __builtin_bswap16(value);
+				memcpy(aDestination + 2*i, &value, 2);
+			}
+			break;
+
+		case 4:
+			for(size_t i = 0; i < aCount; ++i)
+			{
+				uint32_t value;
+				memcpy(&value, aSource + 4*i, 4);
+				value = __builtin_bswap32(value);
+				memcpy(aDestination + 4*i, &value, 4);
+			}
+			break;
+
+		case 8:
+			for(size_t i = 0; i < aCount; ++i)
+			{
+				uint64_t value;
+				memcpy(&value, aSource + 8*i, 8);
+				value = __builtin_bswap64(value);
+				memcpy(aDestination + 8*i, &value, 8);
+			}
+			break;
+	}
+}
+
+#pragma mark -
+#pragma mark Vector Kernels
+
+#ifdef LW_BYTE_ORDER_HAS_X86_KERNELS
+
+// shuffle masks that reverse the bytes of each 2-, 4- and 8-byte element in a 16-byte lane
+static const int8_t gLWByteOrderShuffleMasks[9][16] = {
+	[2] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+	[4] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+	[8] = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 }
+};
+
+__attribute__((target("ssse3")))
+static void LWByteOrderSwapSSSE3(uint8_t *aDestination, const uint8_t *aSource, size_t aCount, size_t aElementSize)
+{
+	__m128i	mask	= _mm_loadu_si128((const __m128i *)gLWByteOrderShuffleMasks[aElementSize]);
+	size_t	length	= aCount*aElementSize;
+	size_t	i		= 0;
+	for(; i + 16 <= length; i += 16)
+	{
+		__m128i data = _mm_loadu_si128((const __m128i *)(aSource + i));
+		_mm_storeu_si128((__m128i *)(aDestination + i), _mm_shuffle_epi8(data, mask));
+	}
+
+	LWByteOrderSwapScalar(aDestination + i, aSource + i, (length - i)/aElementSize, aElementSize);
+}
+
+__attribute__((target("avx2")))
+static void LWByteOrderSwapAVX2(uint8_t *aDestination, const uint8_t *aSource, size_t aCount, size_t aElementSize)
+{
+	__m128i	laneMask	= _mm_loadu_si128((const __m128i *)gLWByteOrderShuffleMasks[aElementSize]);
+	__m256i	mask		= _mm256_broadcastsi128_si256(laneMask);
+	size_t	length		= aCount*aElementSize;
+	size_t	i			= 0;
+	for(; i + 64 <= length; i += 64)
+	{
+		__m256i data1 = _mm256_loadu_si256((const __m256i *)(aSource + i));
+		__m256i data2 = _mm256_loadu_si256((const __m256i *)(aSource + i + 32));
+		_mm256_storeu_si256((__m256i *)(aDestination + i), _mm256_shuffle_epi8(data1, mask));
+		_mm256_storeu_si256((__m256i *)(aDestination + i + 32), _mm256_shuffle_epi8(data2, mask));
+	}
+	for(; i + 16 <= length; i += 16)
+	{
+		__m128i data = _mm_loadu_si128((const __m128i *)(aSource + i));
+		_mm_storeu_si128((__m128i *)(aDestination + i), _mm_shuffle_epi8(data, laneMask));
+	}
+
+	LWByteOrderSwapScalar(aDestination + i, aSource + i, (length - i)/aElementSize, aElementSize);
+}
+
+#endif
+
+#pragma mark -
+#pragma mark Converting Arrays
+
+typedef void (*LWByteOrderKernel)(uint8_t *aDestination, const uint8_t *aSource, size_t aCount, size_t aElementSize);
+
+static LWByteOrderKernel LWByteOrderGetKernel(void)
+{
+	// pick the widest kernel the CPU supports, once
+	static LWByteOrderKernel kernel = NULL;
+	LWByteOrderKernel currentKernel = LW_ATOMIC_LOAD(&kernel);
+	if(currentKernel)
+		return currentKernel;
+
+	currentKernel = &LWByteOrderSwapScalar;
+#ifdef LW_BYTE_ORDER_HAS_X86_KERNELS
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		currentKernel = &LWByteOrderSwapAVX2;
+	else if(__builtin_cpu_supports("ssse3"))
+		currentKernel = &LWByteOrderSwapSSSE3;
+#endif
+	LW_ATOMIC_STORE(&kernel, currentKernel);
+
+	return currentKernel;
+}
+
+#endif
+
+void LWByteOrderConvertArray(void *aDestination, const void *aSource, size_t aCount, size_t aElementSize)
+{
+#ifdef LW_BYTE_ORDER_IS_NETWORK_ORDER
+	// nothing to swap
+	if(aDestination != aSource)
+		memmove(aDestination, aSource, aCount*aElementSize);
+#else
+	LWByteOrderGetKernel()(aDestination, aSource, aCount, aElementSize);
+#endif
+}
@@ -0,0 +1,276 @@
+/*
+ * LWChecksum.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#	define LW_CHECKSUM_HAS_X86_KERNELS
+#	include <immintrin.h>
+#endif
+
+// checksums are CRC32C (Castagnoli), as computed by the SSE4.2 crc32
+// instruction: reflected polynomial, initial value and final value inverted
+
+#define kLWChecksumPolynomial	(0x82f63b78)
+
+#pragma mark Table Kernel
+
+// slicing-by-8 tables; table k gives the checksum of a byte followed by k zero bytes
+static uint32_t			gLWChecksumTables[8][256];
+static pthread_once_t	gLWChecksumTablesOnce = PTHREAD_ONCE_INIT;
+
+static void LWChecksumBuildTables(void)
+{
+	for(uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t state = i;
+		for(size_t bit = 0; bit < 8; ++bit)
+			state = (state >> 1) ^ (kLWChecksumPolynomial & (0 - (state & 1)));
+		gLWChecksumTables[0][i] = state;
+	}
+
+	for(size_t k = 1; k < 8; ++k)
+	{
+		for(size_t i = 0; i < 256; ++i)
+		{
+			uint32_t previous = gLWChecksumTables[k - 1][i];
+			gLWChecksumTables[k][i] = (previous >> 8) ^ gLWChecksumTables[0][previous & 0xff];
+		}
+	}
+}
+
+static inline uint32_t LWChecksumUpdateWord(uint32_t aState, uint64_t aWord)
+{
+	// the first byte of the word is the lowest one
+	uint64_t word = LW_LITTLE_ENDIAN_64(aWord) ^ aState;
+	return gLWChecksumTables[7][word & 0xff]
+		^ gLWChecksumTables[6][(word >> 8) & 0xff]
+		^ gLWChecksumTables[5][(word >> 16) & 0xff]
+		^ gLWChecksumTables[4][(word >> 24) & 0xff]
+		^ gLWChecksumTables[3][(word >> 32) & 0xff]
+		^ gLWChecksumTables[2][(word >> 40) & 0xff]
+		^ gLWChecksumTables[1][(word >> 48) & 0xff]
+		^ gLWChecksumTables[0][word >> 56];
+}
+
+static uint32_t LWChecksumCopyTable(uint32_t aState, uint8_t *aDestination, const uint8_t *aSource, size_t aLength)
+{
+	uint32_t	state	= aState;
+	size_t		i		= 0;
+
+	// memcpy keeps unaligned accesses legal and compiles to plain loads and stores
+	if(aDestination)
+	{
+		for(; i + 8 <= aLength; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, aSource + i, 8);
+			memcpy(aDestination + i, &word, 8);
+			state = LWChecksumUpdateWord(state, word);
+		}
+		for(; i < aLength; ++i)
+		{
+			aDestination[i] = aSource[i];
+			state = (state >> 8) ^ gLWChecksumTables[0][(state ^ aSource[i]) & 0xff];
+		}
+	}
+	else
+	{
+		for(; i + 8 <= aLength; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, aSource + i, 8);
+			state = LWChecksumUpdateWord(state, word);
+		}
+		for(; i < aLength; ++i)
+			state = (state >> 8) ^ gLWChecksumTables[0][(state ^ aSource[i]) & 0xff];
+	}
+
+	return state;
+}
+
+#ifdef LW_CHECKSUM_HAS_X86_KERNELS
+
+#pragma mark -
+#pragma mark SSE4.2 Kernel
+
+// the crc32 instruction takes three cycles but can start every cycle, so long
+// data is checksummed as three interleaved streams. the checksums of the first
+// streams are then shifted past the data that followed them, which is a
+// linear function of the checksum and done with a table per checksum byte
+#define kLWChecksumStreamLength	(256)
+
+static uint32_t			gLWChecksumShiftTables[4][256];
+static pthread_once_t	gLWChecksumShiftTablesOnce = PTHREAD_ONCE_INIT;
+
+__attribute__((target("sse4.2")))
+static void LWChecksumBuildShiftTables(void)
+{
+	for(size_t k = 0; k < 4; ++k)
+	{
+		for(uint32_t i = 0; i < 256; ++i)
+		{
+			uint64_t state = (uint64_t)i << (8*k);
+			for(size_t j = 0; j < kLWChecksumStreamLength; j += 8)
+				state = _mm_crc32_u64(state, 0);
+			gLWChecksumShiftTables[k][i] = (uint32_t)state;
+		}
+	}
+}
+
+static inline uint64_t LWChecksumShiftSSE42(uint64_t aState)
+{
+	return gLWChecksumShiftTables[0][aState & 0xff]
+		^ gLWChecksumShiftTables[1][(aState >> 8) & 0xff]
+		^ gLWChecksumShiftTables[2][(aState >> 16) & 0xff]
+		^ gLWChecksumShiftTables[3][(aState >> 24) & 0xff];
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t LWChecksumCopySSE42(uint32_t aState, uint8_t *aDestination, const uint8_t *aSource, size_t aLength)
+{
+	uint64_t	state	= aState;
+	size_t		i		= 0;
+
+	// checksum three streams at once
+	for(; i + 3*kLWChecksumStreamLength <= aLength; i += 3*kLWChecksumStreamLength)
+	{
+		const uint8_t	*source	= aSource + i;
+		uint64_t		state1	= state;
+		uint64_t		state2	= 0;
+		uint64_t		state3	= 0;
+		for(size_t j = 0; j < kLWChecksumStreamLength; j += 8)
+		{
+			uint64_t word1, word2, word3;
+			memcpy(&word1, source + j, 8);
+			memcpy(&word2, source + kLWChecksumStreamLength + j, 8);
+			memcpy(&word3, source + 2*kLWChecksumStreamLength + j, 8);
+			if(aDestination)
+			{
+				memcpy(aDestination + i + j, &word1, 8);
+				memcpy(aDestination + i + kLWChecksumStreamLength + j, &word2, 8);
+				memcpy(aDestination + i + 2*kLWChecksumStreamLength + j, &word3, 8);
+			}
+			state1 = _mm_crc32_u64(state1, word1);
+			state2 = _mm_crc32_u64(state2, word2);
+			state3 = _mm_crc32_u64(state3, word3);
+		}
+		state = LWChecksumShiftSSE42(LWChecksumShiftSSE42(state1) ^ state2) ^ state3;
+	}
+
+	// checksum the rest as one stream
+	for(; i + 8 <= aLength; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, aSource + i, 8);
+		if(aDestination)
+			memcpy(aDestination + i, &word, 8);
+		state = _mm_crc32_u64(state, word);
+	}
+	for(; i < aLength; ++i)
+	{
+		if(aDestination)
+			aDestination[i] = aSource[i];
+		state = _mm_crc32_u8((uint32_t)state, aSource[i]);
+	}
+
+	return (uint32_t)state;
+}
+
+#endif
+
+#pragma mark -
+#pragma mark Computing Checksums
+
+typedef uint32_t (*LWChecksumKernel)(uint32_t aState, uint8_t *aDestination, const uint8_t *aSource, size_t aLength);
+
+static LWChecksumKernel LWChecksumGetKernel(void)
+{
+	// pick the fastest kernel the CPU supports, once
+	static LWChecksumKernel kernel = NULL;
+	LWChecksumKernel currentKernel = LW_ATOMIC_LOAD(&kernel);
+	if(currentKernel)
+		return currentKernel;
+
+	currentKernel = &LWChecksumCopyTable;
+#ifdef LW_CHECKSUM_HAS_X86_KERNELS
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse4.2"))
+	{
+		pthread_once(&gLWChecksumShiftTablesOnce, &LWChecksumBuildShiftTables);
+		currentKernel = &LWChecksumCopySSE42;
+	}
+#endif
+	if(&LWChecksumCopyTable == currentKernel)
+		pthread_once(&gLWChecksumTablesOnce, &LWChecksumBuildTables);
+	LW_ATOMIC_STORE(&kernel, currentKernel);
+
+	return currentKernel;
+}
+
+uint32_t LWChecksumUpdate(uint32_t aChecksum, const void *aData, size_t aLength)
+{
+	return ~LWChecksumGetKernel()(~aChecksum, NULL, aData, aLength);
+}
+
+uint32_t LWChecksumCopy(uint32_t aChecksum, void *aDestination, const void *aSource, size_t aLength)
+{
+	return ~LWChecksumGetKernel()(~aChecksum, aDestination, aSource, aLength);
+}
+
+#pragma mark -
+#pragma mark Reading And Writing Trailers
+
+void LWChecksumWrite(uint8_t *aBuffer, uint32_t aChecksum)
+{
+	// trailers are in network byte order
+	aBuffer[0] = (uint8_t)(aChecksum >> 24);
+	aBuffer[1] = (uint8_t)(aChecksum >> 16);
+	aBuffer[2] = (uint8_t)(aChecksum >> 8);
+	aBuffer[3] = (uint8_t)aChecksum;
+}
+
+uint32_t LWChecksumRead(const uint8_t *aBuffer)
+{
+	return ((uint32_t)aBuffer[0] << 24) | ((uint32_t)aBuffer[1] << 16) | ((uint32_t)aBuffer[2] << 8) | aBuffer[3];
+}
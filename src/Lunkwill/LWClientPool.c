@@ -0,0 +1,518 @@
+/*
+ * LWClientPool.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _XOPEN_SOURCE (600)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWRPC.h>
+#include <Lunkwill/LWClientPool.h>
+
+#define kLWClientPoolDefaultReconnectInterval	(1000)
+#define kLWClientPoolReadBufferSize				(4096)
+
+enum {
+	kLWClientPoolConnectionStateDisconnected,
+	kLWClientPoolConnectionStateConnecting,
+	kLWClientPoolConnectionStateConnected
+};
+
+static void *LWClientPoolRun(void *aClientPool);
+
+#pragma mark Creating Client Pools
+
+LWClientPool *LWClientPoolCreate(struct sockaddr *aAddress, socklen_t aAddressLength, size_t aConnectionCount)
+{
+	return LWClientPoolCreateWithAllocator(aAddress, aAddressLength, aConnectionCount, NULL);
+}
+
+LWClientPool *LWClientPoolCreateWithAllocator(struct sockaddr *aAddress, socklen_t aAddressLength, size_t aConnectionCount, LWAllocator *aAllocator)
+{
+	// check address
+	if(aAddressLength > sizeof(struct sockaddr_storage) || 0 == aConnectionCount)
+		return NULL;
+
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate client pool
+	LWClientPool *clientPool = LWAllocatorAllocate(allocator, sizeof(LWClientPool));
+	if(!clientPool)
+		return NULL;
+	clientPool->allocator = allocator;
+
+	// allocate connections
+	clientPool->connections = LWAllocatorAllocate(allocator, aConnectionCount*sizeof(struct _LWClientPoolConnection));
+	if(!clientPool->connections)
+	{
+		LWAllocatorFree(allocator, clientPool);
+		return NULL;
+	}
+	for(size_t i = 0; i < aConnectionCount; ++i)
+	{
+		clientPool->connections[i].fileDescriptor	= -1;
+		clientPool->connections[i].state			= kLWClientPoolConnectionStateDisconnected;
+		clientPool->connections[i].reconnectTime	= 0;
+		clientPool->connections[i].dataHandler		= NULL;
+		clientPool->connections[i].writer			= NULL;
+		clientPool->connections[i].rpc				= NULL;
+	}
+	clientPool->connectionCount		= aConnectionCount;
+	clientPool->connectedCount		= 0;
+	clientPool->reconnectInterval	= kLWClientPoolDefaultReconnectInterval;
+	for(uint16_t i = 0; i < 256; ++i)
+		clientPool->responseMessageIDs[i] = false;
+
+	// set endpoint
+	memcpy(&clientPool->address, aAddress, aAddressLength);
+	clientPool->addressLength = aAddressLength;
+
+	// create wakeup pipe
+	if(0 != pipe(clientPool->wakeupFileDescriptors))
+	{
+		LWAllocatorFree(allocator, clientPool->connections);
+		LWAllocatorFree(allocator, clientPool);
+		return NULL;
+	}
+	fcntl(clientPool->wakeupFileDescriptors[0], F_SETFL, O_NONBLOCK);
+	fcntl(clientPool->wakeupFileDescriptors[1], F_SETFL, O_NONBLOCK);
+	clientPool->isWakeupPending	= false;
+	clientPool->isStopping		= false;
+
+	// create lock; recursive, so callbacks can send requests
+	pthread_mutexattr_t mutexAttributes;
+	pthread_mutexattr_init(&mutexAttributes);
+	pthread_mutexattr_settype(&mutexAttributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&clientPool->mutex, &mutexAttributes);
+	pthread_mutexattr_destroy(&mutexAttributes);
+	pthread_cond_init(&clientPool->connectedCondition, NULL);
+
+	// start I/O thread, which connects in the background
+	if(0 != pthread_create(&clientPool->thread, NULL, &LWClientPoolRun, clientPool))
+	{
+		pthread_cond_destroy(&clientPool->connectedCondition);
+		pthread_mutex_destroy(&clientPool->mutex);
+		close(clientPool->wakeupFileDescriptors[0]);
+		close(clientPool->wakeupFileDescriptors[1]);
+		LWAllocatorFree(allocator, clientPool->connections);
+		LWAllocatorFree(allocator, clientPool);
+		return NULL;
+	}
+
+	return clientPool;
+}
+
+#pragma mark -
+#pragma mark Managing Connections
+
+static uint64_t LWClientPoolGetTime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec*1000 + (uint64_t)now.tv_nsec/1000000;
+}
+
+static void LWClientPoolWakeUp(LWClientPool *aClientPool)
+{
+	// one byte in the pipe is enough
+	if(aClientPool->isWakeupPending)
+		return;
+	aClientPool->isWakeupPending = true;
+
+	uint8_t byte = 0;
+	write(aClientPool->wakeupFileDescriptors[1], &byte, 1);
+}
+
+static void LWClientPoolResponseCallback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler)
+
+	struct _LWClientPoolConnection *connection = aUserInfo;
+	LWRPCHandleResponse(connection->rpc, aMessage);
+}
+
+static void LWClientPoolDisconnect(LWClientPool *aClientPool, struct _LWClientPoolConnection *aConnection)
+{
+	// detach protocol objects first, so that requests retried from failure
+	// callbacks cannot pick this connection
+	bool			wasConnected	= (kLWClientPoolConnectionStateConnected == aConnection->state);
+	LWRPC			*rpc			= aConnection->rpc;
+	LWWriter		*writer			= aConnection->writer;
+	LWDataHandler	*dataHandler	= aConnection->dataHandler;
+	aConnection->rpc			= NULL;
+	aConnection->writer			= NULL;
+	aConnection->dataHandler	= NULL;
+	aConnection->state			= kLWClientPoolConnectionStateDisconnected;
+	if(wasConnected)
+		--aClientPool->connectedCount;
+
+	// close socket
+	if(-1 != aConnection->fileDescriptor)
+		close(aConnection->fileDescriptor);
+	aConnection->fileDescriptor	= -1;
+
+	if(wasConnected)
+	{
+		// fail requests in flight
+		LWRPCDelete(rpc);
+		LWWriterDelete(writer);
+		LWDataHandlerDelete(dataHandler);
+	}
+}
+
+static void LWClientPoolFinishConnecting(LWClientPool *aClientPool, struct _LWClientPoolConnection *aConnection)
+{
+	// create data handler
+	aConnection->dataHandler = LWDataHandlerCreateWithAllocator(aConnection, aClientPool->allocator);
+	if(!aConnection->dataHandler)
+	{
+		LWClientPoolDisconnect(aClientPool, aConnection);
+		return;
+	}
+	for(uint16_t i = 0; i < 256; ++i)
+	{
+		if(aClientPool->responseMessageIDs[i])
+			LWDataHandlerSetMessageCallback(aConnection->dataHandler, (uint8_t)i, &LWClientPoolResponseCallback);
+	}
+
+	// create writer and RPC
+	aConnection->writer = LWWriterCreateWithAllocator(aConnection->fileDescriptor, NULL, aClientPool->allocator);
+	aConnection->rpc = aConnection->writer ? LWRPCCreateWithAllocator(aConnection->writer, aClientPool->allocator) : NULL;
+	if(!aConnection->rpc)
+	{
+		if(aConnection->writer)
+			LWWriterDelete(aConnection->writer);
+		LWDataHandlerDelete(aConnection->dataHandler);
+		LWClientPoolDisconnect(aClientPool, aConnection);
+		return;
+	}
+
+	// connection is ready
+	aConnection->state = kLWClientPoolConnectionStateConnected;
+	++aClientPool->connectedCount;
+	pthread_cond_broadcast(&aClientPool->connectedCondition);
+}
+
+static void LWClientPoolConnect(LWClientPool *aClientPool, struct _LWClientPoolConnection *aConnection, uint64_t aCurrentTime)
+{
+	// try again later if this attempt fails
+	aConnection->reconnectTime = aCurrentTime + aClientPool->reconnectInterval;
+
+	// create socket
+	int fileDescriptor = socket(aClientPool->address.ss_family, SOCK_STREAM, 0);
+	if(-1 == fileDescriptor)
+		return;
+	fcntl(fileDescriptor, F_SETFL, O_NONBLOCK);
+	if(AF_INET == aClientPool->address.ss_family || AF_INET6 == aClientPool->address.ss_family)
+	{
+		// requests are small and latency matters
+		int noDelay = 1;
+		setsockopt(fileDescriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	}
+	aConnection->fileDescriptor = fileDescriptor;
+
+	// connect without blocking
+	if(0 == connect(fileDescriptor, (struct sockaddr *)&aClientPool->address, aClientPool->addressLength))
+		LWClientPoolFinishConnecting(aClientPool, aConnection);
+	else if(EINPROGRESS == errno)
+		aConnection->state = kLWClientPoolConnectionStateConnecting;
+	else
+		LWClientPoolDisconnect(aClientPool, aConnection);
+}
+
+static void LWClientPoolHandleEvents(LWClientPool *aClientPool, struct _LWClientPoolConnection *aConnection, short aEvents)
+{
+	// finish connecting
+	if(kLWClientPoolConnectionStateConnecting == aConnection->state)
+	{
+		int			error		= 0;
+		socklen_t	errorLength	= sizeof(error);
+		if(0 != getsockopt(aConnection->fileDescriptor, SOL_SOCKET, SO_ERROR, &error, &errorLength) || 0 != error)
+			LWClientPoolDisconnect(aClientPool, aConnection);
+		else
+			LWClientPoolFinishConnecting(aClientPool, aConnection);
+		return;
+	}
+
+	// read responses
+	if(aEvents & (POLLIN | POLLERR | POLLHUP))
+	{
+		uint8_t buffer[kLWClientPoolReadBufferSize];
+		while(true)
+		{
+			ssize_t length = read(aConnection->fileDescriptor, buffer, sizeof(buffer));
+			if(length > 0)
+			{
+				if(!LWDataHandlerHandleData(aConnection->dataHandler, buffer, (size_t)length))
+				{
+					LWClientPoolDisconnect(aClientPool, aConnection);
+					return;
+				}
+			}
+			else if(-1 == length && (EAGAIN == errno || EWOULDBLOCK == errno))
+				break;
+			else if(-1 == length && EINTR == errno)
+				continue;
+			else
+			{
+				LWClientPoolDisconnect(aClientPool, aConnection);
+				return;
+			}
+		}
+	}
+
+	// send requests
+	if(!LWWriterFlush(aConnection->writer))
+		LWClientPoolDisconnect(aClientPool, aConnection);
+}
+
+static void *LWClientPoolRun(void *aClientPool)
+{
+	LWClientPool *clientPool = aClientPool;
+
+	// allocate poll set; first entry is the wakeup pipe
+	size_t pollFileDescriptorCount = 1 + clientPool->connectionCount;
+	struct pollfd *pollFileDescriptors = LWAllocatorAllocate(clientPool->allocator, pollFileDescriptorCount*sizeof(struct pollfd));
+	if(!pollFileDescriptors)
+		return NULL;
+
+	pthread_mutex_lock(&clientPool->mutex);
+	while(!clientPool->isStopping)
+	{
+		// reconnect
+		uint64_t	currentTime	= LWClientPoolGetTime();
+		int			timeout		= -1;
+		for(size_t i = 0; i < clientPool->connectionCount; ++i)
+		{
+			struct _LWClientPoolConnection *connection = &clientPool->connections[i];
+			if(kLWClientPoolConnectionStateDisconnected != connection->state)
+				continue;
+
+			if(currentTime >= connection->reconnectTime)
+				LWClientPoolConnect(clientPool, connection, currentTime);
+			if(kLWClientPoolConnectionStateDisconnected == connection->state)
+			{
+				int connectionTimeout = (int)(connection->reconnectTime - currentTime);
+				if(-1 == timeout || connectionTimeout < timeout)
+					timeout = connectionTimeout;
+			}
+		}
+
+		// build poll set
+		pollFileDescriptors[0].fd		= clientPool->wakeupFileDescriptors[0];
+		pollFileDescriptors[0].events	= POLLIN;
+		for(size_t i = 0; i < clientPool->connectionCount; ++i)
+		{
+			struct _LWClientPoolConnection *connection = &clientPool->connections[i];
+			pollFileDescriptors[1 + i].fd = connection->fileDescriptor;
+			if(kLWClientPoolConnectionStateConnecting == connection->state)
+				pollFileDescriptors[1 + i].events = POLLOUT;
+			else if(kLWClientPoolConnectionStateConnected == connection->state)
+				pollFileDescriptors[1 + i].events = POLLIN | (LWWriterGetPendingLength(connection->writer) ? POLLOUT : 0);
+		}
+		clientPool->isWakeupPending = false;
+
+		// wait for events without holding the lock
+		pthread_mutex_unlock(&clientPool->mutex);
+		int eventCount = poll(pollFileDescriptors, pollFileDescriptorCount, timeout);
+		pthread_mutex_lock(&clientPool->mutex);
+		if(eventCount <= 0)
+			continue;
+
+		// empty wakeup pipe
+		if(pollFileDescriptors[0].revents)
+		{
+			uint8_t buffer[64];
+			while(read(clientPool->wakeupFileDescriptors[0], buffer, sizeof(buffer)) > 0)
+				;
+		}
+
+		// handle connection events
+		for(size_t i = 0; i < clientPool->connectionCount; ++i)
+		{
+			struct _LWClientPoolConnection *connection = &clientPool->connections[i];
+			if(pollFileDescriptors[1 + i].revents && -1 != connection->fileDescriptor && connection->fileDescriptor == pollFileDescriptors[1 + i].fd)
+				LWClientPoolHandleEvents(clientPool, connection, pollFileDescriptors[1 + i].revents);
+		}
+	}
+	pthread_mutex_unlock(&clientPool->mutex);
+
+	LWAllocatorFree(clientPool->allocator, pollFileDescriptors);
+
+	return NULL;
+}
+
+#pragma mark -
+#pragma mark Deleting Client Pools
+
+void LWClientPoolDelete(LWClientPool *aClientPool)
+{
+	// stop I/O thread
+	pthread_mutex_lock(&aClientPool->mutex);
+	aClientPool->isStopping = true;
+	LWClientPoolWakeUp(aClientPool);
+	pthread_mutex_unlock(&aClientPool->mutex);
+	pthread_join(aClientPool->thread, NULL);
+
+	// close connections
+	for(size_t i = 0; i < aClientPool->connectionCount; ++i)
+		LWClientPoolDisconnect(aClientPool, &aClientPool->connections[i]);
+
+	// delete client pool
+	pthread_cond_destroy(&aClientPool->connectedCondition);
+	pthread_mutex_destroy(&aClientPool->mutex);
+	close(aClientPool->wakeupFileDescriptors[0]);
+	close(aClientPool->wakeupFileDescriptors[1]);
+	LWAllocatorFree(aClientPool->allocator, aClientPool->connections);
+	LWAllocatorFree(aClientPool->allocator, aClientPool);
+}
+
+#pragma mark -
+#pragma mark Configuring Client Pools
+
+void LWClientPoolSetResponseMessageID(LWClientPool *aClientPool, uint8_t aMessageID)
+{
+	pthread_mutex_lock(&aClientPool->mutex);
+
+	// route responses with this message ID to the RPCs
+	aClientPool->responseMessageIDs[aMessageID] = true;
+	for(size_t i = 0; i < aClientPool->connectionCount; ++i)
+	{
+		if(kLWClientPoolConnectionStateConnected == aClientPool->connections[i].state)
+			LWDataHandlerSetMessageCallback(aClientPool->connections[i].dataHandler, aMessageID, &LWClientPoolResponseCallback);
+	}
+
+	pthread_mutex_unlock(&aClientPool->mutex);
+}
+
+void LWClientPoolSetReconnectInterval(LWClientPool *aClientPool, uint64_t aReconnectInterval)
+{
+	pthread_mutex_lock(&aClientPool->mutex);
+	aClientPool->reconnectInterval = aReconnectInterval;
+	pthread_mutex_unlock(&aClientPool->mutex);
+}
+
+#pragma mark -
+#pragma mark Sending Requests
+
+bool LWClientPoolSendRequest(LWClientPool *aClientPool, LWMessage *aRequest, LWRPCResponseCallback aCallback, void *aContext)
+{
+	pthread_mutex_lock(&aClientPool->mutex);
+
+	// find connection with fewest requests in flight
+	struct _LWClientPoolConnection	*connection				= NULL;
+	size_t							inFlightRequestCount	= 0;
+	for(size_t i = 0; i < aClientPool->connectionCount; ++i)
+	{
+		if(kLWClientPoolConnectionStateConnected != aClientPool->connections[i].state)
+			continue;
+
+		size_t count = LWRPCGetInFlightRequestCount(aClientPool->connections[i].rpc);
+		if(!connection || count < inFlightRequestCount)
+		{
+			connection				= &aClientPool->connections[i];
+			inFlightRequestCount	= count;
+		}
+	}
+
+	// send request right away; the I/O thread sends whatever does not fit
+	bool success = connection && LWRPCSendRequest(connection->rpc, aRequest, aCallback, aContext, NULL);
+	if(success)
+	{
+		LWWriterFlush(connection->writer);
+		if(LWWriterGetPendingLength(connection->writer))
+			LWClientPoolWakeUp(aClientPool);
+	}
+
+	pthread_mutex_unlock(&aClientPool->mutex);
+
+	return success;
+}
+
+#pragma mark -
+#pragma mark Querying Client Pools
+
+bool LWClientPoolWaitForConnection(LWClientPool *aClientPool, int aTimeout)
+{
+	// determine deadline
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec		+= aTimeout/1000;
+	deadline.tv_nsec	+= (aTimeout%1000)*1000000l;
+	if(deadline.tv_nsec >= 1000000000l)
+	{
+		deadline.tv_sec		+= 1;
+		deadline.tv_nsec	-= 1000000000l;
+	}
+
+	// wait for any connection
+	pthread_mutex_lock(&aClientPool->mutex);
+	while(0 == aClientPool->connectedCount)
+	{
+		if(aTimeout < 0)
+			pthread_cond_wait(&aClientPool->connectedCondition, &aClientPool->mutex);
+		else if(ETIMEDOUT == pthread_cond_timedwait(&aClientPool->connectedCondition, &aClientPool->mutex, &deadline))
+			break;
+	}
+	bool isConnected = (aClientPool->connectedCount > 0);
+	pthread_mutex_unlock(&aClientPool->mutex);
+
+	return isConnected;
+}
+
+size_t LWClientPoolGetConnectedCount(LWClientPool *aClientPool)
+{
+	pthread_mutex_lock(&aClientPool->mutex);
+	size_t connectedCount = aClientPool->connectedCount;
+	pthread_mutex_unlock(&aClientPool->mutex);
+
+	return connectedCount;
+}
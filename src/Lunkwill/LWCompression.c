@@ -0,0 +1,251 @@
+/*
+ * LWCompression.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+
+// compressed data uses the LZ4 block format: a sequence of
+//
+//   [token][extra literal length][literals][offset][extra match length]
+//
+// where the high nibble of the token is the literal length and the low nibble
+// is the match length minus four. a nibble of 15 is continued by bytes that
+// are added to it, up to and including the first byte below 255. offsets are
+// two bytes, little-endian. the last sequence has literals only.
+
+#define kLWCompressionMinimumMatchLength	(4)
+#define kLWCompressionLastLiteralsLength	(5)
+#define kLWCompressionMatchFindLimit		(12)
+#define kLWCompressionMaxOffset				(65535)
+#define kLWCompressionHashBits				(12)
+#define kLWCompressionCopyLength			(16)
+
+#pragma mark Helpers
+
+static uint32_t LWCompressionRead32(const uint8_t *aData)
+{
+	uint32_t value;
+	memcpy(&value, aData, sizeof(value));
+	return value;
+}
+
+static uint32_t LWCompressionHash(const uint8_t *aData)
+{
+	return (LWCompressionRead32(aData) * UINT32_C(2654435761)) >> (32 - kLWCompressionHashBits);
+}
+
+static uint8_t *LWCompressionWriteLength(uint8_t *aBuffer, size_t aLength)
+{
+	// lengths are counted from 15 on
+	for(aLength -= 15; aLength >= 255; aLength -= 255)
+		*aBuffer++ = 255;
+	*aBuffer++ = (uint8_t)aLength;
+
+	return aBuffer;
+}
+
+static bool LWCompressionReadLength(const uint8_t **aData, const uint8_t *aDataEnd, size_t *aLength)
+{
+	uint8_t byte;
+	do
+	{
+		if(*aData >= aDataEnd)
+			return false;
+		byte = *(*aData)++;
+		*aLength += byte;
+	} while(255 == byte);
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Compressing
+
+size_t LWCompressionCompress(uint8_t *aData, size_t aLength, uint8_t *aBuffer, size_t aCapacity)
+{
+	const uint8_t	*input			= aData;
+	const uint8_t	*inputEnd		= aData + aLength;
+	const uint8_t	*literals		= aData;
+	uint8_t			*output			= aBuffer;
+	uint8_t			*outputEnd		= aBuffer + aCapacity;
+
+	// look for matches only where a whole match and the last literals still fit
+	if(aLength >= kLWCompressionMatchFindLimit + 1)
+	{
+		const uint8_t	*matchFindEnd	= inputEnd - kLWCompressionMatchFindLimit;
+		const uint8_t	*matchEnd		= inputEnd - kLWCompressionLastLiteralsLength;
+		uint32_t		positions[1 << kLWCompressionHashBits];
+		memset(positions, 0, sizeof(positions));
+
+		for(++input; input < matchFindEnd; )
+		{
+			// look up the last position with the same four bytes
+			uint32_t		hash		= LWCompressionHash(input);
+			const uint8_t	*candidate	= aData + positions[hash];
+			positions[hash] = (uint32_t)(input - aData);
+			if((size_t)(input - candidate) > kLWCompressionMaxOffset || LWCompressionRead32(candidate) != LWCompressionRead32(input))
+			{
+				// skip ahead faster through incompressible data
+				input += 1 + ((size_t)(input - literals) >> 6);
+				continue;
+			}
+			size_t offset = (size_t)(input - candidate);
+
+			// extend match backwards and forwards
+			while(input > literals && candidate > aData && input[-1] == candidate[-1])
+			{
+				--input;
+				--candidate;
+			}
+			const uint8_t *matchStart = input;
+			input		+= kLWCompressionMinimumMatchLength;
+			candidate	+= kLWCompressionMinimumMatchLength;
+			while(input < matchEnd && *input == *candidate)
+			{
+				++input;
+				++candidate;
+			}
+
+			// check space for the worst case, including the last literals
+			size_t literalLength	= (size_t)(matchStart - literals);
+			size_t matchLength		= (size_t)(input - matchStart) - kLWCompressionMinimumMatchLength;
+			if((size_t)(outputEnd - output) < 1 + literalLength/255 + 1 + literalLength + 2 + matchLength/255 + 1)
+				return 0;
+
+			// write token and literals
+			uint8_t *token = output++;
+			*token = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+			if(literalLength >= 15)
+				output = LWCompressionWriteLength(output, literalLength);
+			memcpy(output, literals, literalLength);
+			output += literalLength;
+
+			// write offset and match length
+			*output++ = (uint8_t)(offset & 0xff);
+			*output++ = (uint8_t)(offset >> 8);
+			*token |= (uint8_t)(matchLength < 15 ? matchLength : 15);
+			if(matchLength >= 15)
+				output = LWCompressionWriteLength(output, matchLength);
+
+			// remember a position inside the match, for the next lookups
+			if(input < matchFindEnd)
+				positions[LWCompressionHash(input - 2)] = (uint32_t)(input - 2 - aData);
+			literals = input;
+		}
+	}
+
+	// write last literals
+	size_t literalLength = (size_t)(inputEnd - literals);
+	if((size_t)(outputEnd - output) < 1 + literalLength/255 + 1 + literalLength)
+		return 0;
+	*output++ = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+	if(literalLength >= 15)
+		output = LWCompressionWriteLength(output, literalLength);
+	memcpy(output, literals, literalLength);
+	output += literalLength;
+
+	return (size_t)(output - aBuffer);
+}
+
+#pragma mark -
+#pragma mark Decompressing
+
+bool LWCompressionDecompress(uint8_t *aData, size_t aLength, uint8_t *aBuffer, size_t aDecompressedLength)
+{
+	const uint8_t	*input		= aData;
+	const uint8_t	*inputEnd	= aData + aLength;
+	uint8_t			*output		= aBuffer;
+	uint8_t			*outputEnd	= aBuffer + aDecompressedLength;
+
+	while(input < inputEnd)
+	{
+		uint8_t token = *input++;
+
+		// copy literals
+		size_t literalLength = token >> 4;
+		if(15 == literalLength && !LWCompressionReadLength(&input, inputEnd, &literalLength))
+			return false;
+		if(literalLength > (size_t)(inputEnd - input) || literalLength > (size_t)(outputEnd - output))
+			return false;
+		if(literalLength <= kLWCompressionCopyLength && inputEnd - input >= kLWCompressionCopyLength && outputEnd - output >= kLWCompressionCopyLength)
+			memcpy(output, input, kLWCompressionCopyLength);
+		else
+			memcpy(output, input, literalLength);
+		input	+= literalLength;
+		output	+= literalLength;
+
+		// the last sequence has no match
+		if(input == inputEnd)
+			break;
+
+		// read offset and match length
+		if(inputEnd - input < 2)
+			return false;
+		size_t offset = (size_t)input[0] | ((size_t)input[1] << 8);
+		input += 2;
+		if(0 == offset || offset > (size_t)(output - aBuffer))
+			return false;
+		size_t matchLength = token & 15;
+		if(15 == matchLength && !LWCompressionReadLength(&input, inputEnd, &matchLength))
+			return false;
+		matchLength += kLWCompressionMinimumMatchLength;
+		if(matchLength > (size_t)(outputEnd - output))
+			return false;
+
+		// copy match, which may overlap the bytes it produces
+		const uint8_t *match = output - offset;
+		if(offset >= kLWCompressionCopyLength && (size_t)(outputEnd - output) >= matchLength + kLWCompressionCopyLength)
+		{
+			// copy in fixed-size chunks, which only ever read bytes already written
+			for(size_t i = 0; i < matchLength; i += kLWCompressionCopyLength)
+				memcpy(output + i, match + i, kLWCompressionCopyLength);
+		}
+		else if(offset >= matchLength)
+			memcpy(output, match, matchLength);
+		else
+		{
+			for(size_t i = 0; i < matchLength; ++i)
+				output[i] = match[i];
+		}
+		output += matchLength;
+	}
+
+	// the data must decompress to exactly the announced length
+	return output == outputEnd;
+}
@@ -0,0 +1,139 @@
+/*
+ * LWCountingAllocator.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWCountingAllocator.h>
+
+static void *LWCountingAllocatorAllocate(size_t aSize, void *aContext);
+static void *LWCountingAllocatorReallocate(void *aPointer, size_t aSize, void *aContext);
+static void LWCountingAllocatorFree(void *aPointer, void *aContext);
+
+#pragma mark Creating Counting Allocators
+
+LWCountingAllocator *LWCountingAllocatorCreate(LWAllocator *aParentAllocator)
+{
+	// find parent allocator
+	LWAllocator *parentAllocator = (aParentAllocator ? aParentAllocator : LWAllocatorGetSystem());
+
+	// allocate counting allocator
+	LWCountingAllocator *countingAllocator = LWAllocatorAllocate(parentAllocator, sizeof(LWCountingAllocator));
+	if(!countingAllocator)
+		return NULL;
+
+	// initialize allocator
+	countingAllocator->allocator.allocate	= &LWCountingAllocatorAllocate;
+	countingAllocator->allocator.reallocate	= &LWCountingAllocatorReallocate;
+	countingAllocator->allocator.free		= &LWCountingAllocatorFree;
+	countingAllocator->allocator.context	= countingAllocator;
+	countingAllocator->parentAllocator		= parentAllocator;
+
+	// initialize counts
+	LWCountingAllocatorReset(countingAllocator);
+
+	return countingAllocator;
+}
+
+#pragma mark -
+#pragma mark Deleting Counting Allocators
+
+void LWCountingAllocatorDelete(LWCountingAllocator *aCountingAllocator)
+{
+	LWAllocatorFree(aCountingAllocator->parentAllocator, aCountingAllocator);
+}
+
+#pragma mark -
+#pragma mark Using Counting Allocators
+
+LWAllocator *LWCountingAllocatorGetAllocator(LWCountingAllocator *aCountingAllocator)
+{
+	return &aCountingAllocator->allocator;
+}
+
+void LWCountingAllocatorReset(LWCountingAllocator *aCountingAllocator)
+{
+	LW_ATOMIC_STORE(&aCountingAllocator->allocationCount, 0);
+	LW_ATOMIC_STORE(&aCountingAllocator->reallocationCount, 0);
+	LW_ATOMIC_STORE(&aCountingAllocator->freeCount, 0);
+}
+
+#pragma mark -
+#pragma mark Querying Counting Allocators
+
+uint64_t LWCountingAllocatorGetAllocationCount(LWCountingAllocator *aCountingAllocator)
+{
+	return LW_ATOMIC_LOAD(&aCountingAllocator->allocationCount);
+}
+
+uint64_t LWCountingAllocatorGetReallocationCount(LWCountingAllocator *aCountingAllocator)
+{
+	return LW_ATOMIC_LOAD(&aCountingAllocator->reallocationCount);
+}
+
+uint64_t LWCountingAllocatorGetFreeCount(LWCountingAllocator *aCountingAllocator)
+{
+	return LW_ATOMIC_LOAD(&aCountingAllocator->freeCount);
+}
+
+#pragma mark -
+#pragma mark Allocator Callbacks
+
+static void *LWCountingAllocatorAllocate(size_t aSize, void *aContext)
+{
+	LWCountingAllocator *countingAllocator = aContext;
+
+	LW_ATOMIC_INCREMENT(&countingAllocator->allocationCount);
+	return LWAllocatorAllocate(countingAllocator->parentAllocator, aSize);
+}
+
+static void *LWCountingAllocatorReallocate(void *aPointer, size_t aSize, void *aContext)
+{
+	LWCountingAllocator *countingAllocator = aContext;
+
+	LW_ATOMIC_INCREMENT(&countingAllocator->reallocationCount);
+	return LWAllocatorReallocate(countingAllocator->parentAllocator, aPointer, aSize);
+}
+
+static void LWCountingAllocatorFree(void *aPointer, void *aContext)
+{
+	LWCountingAllocator *countingAllocator = aContext;
+
+	LW_ATOMIC_INCREMENT(&countingAllocator->freeCount);
+	LWAllocatorFree(countingAllocator->parentAllocator, aPointer);
+}
@@ -33,43 +33,101 @@
  *
  */
 
+#define _POSIX_C_SOURCE (200112L)
+
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <Lunkwill/LunkwillDefines.h>
 #include <Lunkwill/LunkwillTypes.h>
 #include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArena.h>
 #include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWTrace.h>
+#include <Lunkwill/LWDataHandlerStats.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWTimerWheel.h>
 
 #define kLWDataHandlerInitialBufferCapacity	(256)
 #define kLWDataHandlerMaxBufferCapacity		(10240)
+#define kLWDataHandlerArenaChunkSize		(16384)
 
 #pragma mark Creating Data Handlers
 
 LWDataHandler *LWDataHandlerCreate(void *aUserInfo)
 {
+	return LWDataHandlerCreateWithAllocator(aUserInfo, NULL);
+}
+
+LWDataHandler *LWDataHandlerCreateWithAllocator(void *aUserInfo, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
 	// allocate data handler
-	LWDataHandler *dataHandler = malloc(sizeof(LWDataHandler));
+	LWDataHandler *dataHandler = LWAllocatorAllocate(allocator, sizeof(LWDataHandler));
 	if(!dataHandler)
 		return NULL;
+	dataHandler->allocator = allocator;
 
 	// initialize data handler
 	dataHandler->validator				= NULL;
 	dataHandler->isHandlingData			= false;
 	dataHandler->isScheduledForDeletion	= false;
 
+	// initialize dispatch budget
+	dataHandler->maxDispatchMessageCount	= 0;
+	dataHandler->maxDispatchTime			= 0;
+	dataHandler->hasPendingMessages			= false;
+
+	// initialize timeouts
+	dataHandler->timerWheel				= NULL;
+	dataHandler->idleTimer				= NULL;
+	dataHandler->idleTimeout			= 0;
+	dataHandler->idleTimeoutCallback	= NULL;
+	dataHandler->stallTimer				= NULL;
+	dataHandler->stallTimeout			= 0;
+	dataHandler->stallTimeoutCallback	= NULL;
+	dataHandler->isDetached				= false;
+
+	// initialize priorities
+	for(uint16_t i = 0; i < 256; ++i)
+		dataHandler->messagePriorities[i] = 0;
+	dataHandler->hasMessagePriorities	= false;
+	dataHandler->frames					= NULL;
+	dataHandler->frameOrder				= NULL;
+	dataHandler->frameCapacity			= 0;
+
+	// stats are opt-in
+	dataHandler->stats = NULL;
+
+	// decoding into an arena is opt-in
+	dataHandler->arena = NULL;
+
+	// detect wire format from the first bytes received
+	dataHandler->wireFormat = kLWWireFormatAutomatic;
+
+	// interning is opt-in
+	dataHandler->internTable = NULL;
+
+	// checksums are opt-in
+	dataHandler->isChecksumEnabled = false;
+
 	// allocate buffer
-	dataHandler->buffer = malloc(kLWDataHandlerInitialBufferCapacity*sizeof(uint8_t));
+	dataHandler->buffer = LWAllocatorAllocate(allocator, kLWDataHandlerInitialBufferCapacity*sizeof(uint8_t));
 	if(!dataHandler->buffer)
 	{
-		free(dataHandler);
+		LWAllocatorFree(allocator, dataHandler);
 		return NULL;
 	}
 	dataHandler->bufferCapacity			= kLWDataHandlerInitialBufferCapacity;
 	dataHandler->availableDataLength	= 0;
 
-	// clear callbacks
+	// clear callbacks and relays
 	LWDataHandlerClearMessageCallbacks(dataHandler);
+	LWDataHandlerClearRelays(dataHandler);
 
 	// set user info
 	dataHandler->userInfo = aUserInfo;
@@ -80,6 +138,25 @@ LWDataHandler *LWDataHandlerCreate(void *aUserInfo)
 #pragma mark -
 #pragma mark Deleting Data Handlers
 
+static void LWDataHandlerFree(LWDataHandler *aDataHandler)
+{
+	// delete timers
+	if(aDataHandler->idleTimer)
+		LWTimerDelete(aDataHandler->idleTimer);
+	if(aDataHandler->stallTimer)
+		LWTimerDelete(aDataHandler->stallTimer);
+
+	// delete data handler
+	if(aDataHandler->stats)
+		LWDataHandlerStatsDelete(aDataHandler->stats);
+	if(aDataHandler->arena)
+		LWArenaDelete(aDataHandler->arena);
+	LWAllocatorFree(aDataHandler->allocator, aDataHandler->frames);
+	LWAllocatorFree(aDataHandler->allocator, aDataHandler->frameOrder);
+	LWAllocatorFree(aDataHandler->allocator, aDataHandler->buffer);
+	LWAllocatorFree(aDataHandler->allocator, aDataHandler);
+}
+
 void LWDataHandlerDelete(LWDataHandler *aDataHandler)
 {
 	if(aDataHandler->isHandlingData)
@@ -90,8 +167,7 @@ void LWDataHandlerDelete(LWDataHandler *aDataHandler)
 	else
 	{
 		// delete data handler
-		free(aDataHandler->buffer);
-		free(aDataHandler);
+		LWDataHandlerFree(aDataHandler);
 	}
 }
 
@@ -127,6 +203,149 @@ void LWDataHandlerClearMessageCallbacks(LWDataHandler *aDataHandler)
 		aDataHandler->messageCallbacks[i] = NULL;
 }
 
+#pragma mark -
+#pragma mark Setting Relays
+
+void LWDataHandlerSetRelayWriter(LWDataHandler *aDataHandler, uint8_t aMessageID, LWWriter *aWriter)
+{
+	// set relay writer
+	aDataHandler->relayWriters[aMessageID] = aWriter;
+}
+
+void LWDataHandlerSetRelayCallback(LWDataHandler *aDataHandler, uint8_t aMessageID, LWDataHandlerRelayCallback aCallback)
+{
+	// set relay callback
+	aDataHandler->relayCallbacks[aMessageID] = aCallback;
+}
+
+void LWDataHandlerClearRelays(LWDataHandler *aDataHandler)
+{
+	// clear relay writers and callbacks
+	for(uint16_t i = 0; i < 256; ++i)
+	{
+		aDataHandler->relayWriters[i]	= NULL;
+		aDataHandler->relayCallbacks[i]	= NULL;
+	}
+}
+
+#pragma mark -
+#pragma mark Setting Priorities
+
+void LWDataHandlerSetMessagePriority(LWDataHandler *aDataHandler, uint8_t aMessageID, uint8_t aPriority)
+{
+	// set priority
+	aDataHandler->messagePriorities[aMessageID] = aPriority;
+
+	// only sort messages when some priority is set
+	aDataHandler->hasMessagePriorities = false;
+	for(uint16_t i = 0; i < 256; ++i)
+	{
+		if(aDataHandler->messagePriorities[i])
+			aDataHandler->hasMessagePriorities = true;
+	}
+}
+
+#pragma mark -
+#pragma mark Collecting Stats
+
+bool LWDataHandlerSetStatsEnabled(LWDataHandler *aDataHandler, bool aIsEnabled)
+{
+	if(aIsEnabled && !aDataHandler->stats)
+	{
+		aDataHandler->stats = LWDataHandlerStatsCreateWithAllocator(aDataHandler->allocator);
+		if(!aDataHandler->stats)
+			return false;
+	}
+	else if(!aIsEnabled && aDataHandler->stats)
+	{
+		LWDataHandlerStatsDelete(aDataHandler->stats);
+		aDataHandler->stats = NULL;
+	}
+
+	return true;
+}
+
+LWDataHandlerStats *LWDataHandlerGetStats(LWDataHandler *aDataHandler)
+{
+	return aDataHandler->stats;
+}
+
+#pragma mark -
+#pragma mark Decoding Into Arenas
+
+bool LWDataHandlerSetArenaEnabled(LWDataHandler *aDataHandler, bool aIsEnabled)
+{
+	// messages being dispatched may live in the arena
+	if(aDataHandler->isHandlingData)
+		return false;
+
+	if(aIsEnabled && !aDataHandler->arena)
+	{
+		aDataHandler->arena = LWArenaCreateWithAllocator(kLWDataHandlerArenaChunkSize, aDataHandler->allocator);
+		if(!aDataHandler->arena)
+			return false;
+	}
+	else if(!aIsEnabled && aDataHandler->arena)
+	{
+		LWArenaDelete(aDataHandler->arena);
+		aDataHandler->arena = NULL;
+	}
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Choosing Wire Formats
+
+bool LWDataHandlerSetWireFormat(LWDataHandler *aDataHandler, uint8_t aWireFormat)
+{
+	// frames being dispatched were found using the current format
+	if(aDataHandler->isHandlingData || aWireFormat > kLWWireFormatVersion2)
+		return false;
+
+	aDataHandler->wireFormat = aWireFormat;
+
+	return true;
+}
+
+uint8_t LWDataHandlerGetWireFormat(LWDataHandler *aDataHandler)
+{
+	return aDataHandler->wireFormat;
+}
+
+#pragma mark -
+#pragma mark Interning Arguments
+
+void LWDataHandlerSetInternTable(LWDataHandler *aDataHandler, LWInternTable *aInternTable)
+{
+	// set intern table
+	aDataHandler->internTable = aInternTable;
+}
+
+LWInternTable *LWDataHandlerGetInternTable(LWDataHandler *aDataHandler)
+{
+	return aDataHandler->internTable;
+}
+
+#pragma mark -
+#pragma mark Checksumming Frames
+
+bool LWDataHandlerSetChecksumEnabled(LWDataHandler *aDataHandler, bool aIsEnabled)
+{
+	// frames being dispatched were found with or without trailers
+	if(aDataHandler->isHandlingData)
+		return false;
+
+	aDataHandler->isChecksumEnabled = aIsEnabled;
+
+	return true;
+}
+
+bool LWDataHandlerIsChecksumEnabled(LWDataHandler *aDataHandler)
+{
+	return aDataHandler->isChecksumEnabled;
+}
+
 #pragma mark -
 #pragma mark Setting Validators
 
@@ -136,11 +355,619 @@ void LWDataHandlerSetValidator(LWDataHandler *aDataHandler, LWValidator *aValida
 	aDataHandler->validator = aValidator;
 }
 
+#pragma mark -
+#pragma mark Setting Dispatch Budgets
+
+void LWDataHandlerSetDispatchBudget(LWDataHandler *aDataHandler, size_t aMaxMessageCount, uint64_t aMaxNanoseconds)
+{
+	// set budget; zero means unlimited
+	aDataHandler->maxDispatchMessageCount	= aMaxMessageCount;
+	aDataHandler->maxDispatchTime			= aMaxNanoseconds;
+}
+
+#pragma mark -
+#pragma mark Setting Timeouts
+
+static void LWDataHandlerIdleTimerCallback(LWTimer *aTimer, void *aUserInfo)
+{
+#pragma unused (aTimer)
+
+	LWDataHandler *dataHandler = aUserInfo;
+	dataHandler->idleTimeoutCallback(dataHandler, dataHandler->userInfo);
+}
+
+static void LWDataHandlerStallTimerCallback(LWTimer *aTimer, void *aUserInfo)
+{
+#pragma unused (aTimer)
+
+	LWDataHandler *dataHandler = aUserInfo;
+	dataHandler->stallTimeoutCallback(dataHandler, dataHandler->userInfo);
+}
+
+static void LWDataHandlerRestartIdleTimer(LWDataHandler *aDataHandler)
+{
+	if(!aDataHandler->timerWheel || !aDataHandler->idleTimeout)
+		return;
+
+	// push idle timeout back
+	LWTimerArm(aDataHandler->idleTimer, aDataHandler->timerWheel, aDataHandler->idleTimeout);
+}
+
+static void LWDataHandlerUpdateStallTimer(LWDataHandler *aDataHandler, size_t aRemainingLength, bool aMadeProgress)
+{
+	if(!aDataHandler->timerWheel || !aDataHandler->stallTimeout)
+		return;
+
+	// leftover bytes that are not a complete message are an incomplete frame
+	if(0 == aRemainingLength || aDataHandler->hasPendingMessages)
+		LWTimerCancel(aDataHandler->stallTimer);
+	else if(aMadeProgress || !LWTimerIsArmed(aDataHandler->stallTimer))
+		LWTimerArm(aDataHandler->stallTimer, aDataHandler->timerWheel, aDataHandler->stallTimeout);
+}
+
+void LWDataHandlerSetTimerWheel(LWDataHandler *aDataHandler, LWTimerWheel *aTimerWheel)
+{
+	// stop timers on old timer wheel
+	if(aDataHandler->idleTimer)
+		LWTimerCancel(aDataHandler->idleTimer);
+	if(aDataHandler->stallTimer)
+		LWTimerCancel(aDataHandler->stallTimer);
+
+	// set timer wheel
+	aDataHandler->timerWheel = aTimerWheel;
+
+	// start timers on new timer wheel
+	LWDataHandlerRestartIdleTimer(aDataHandler);
+	LWDataHandlerUpdateStallTimer(aDataHandler, aDataHandler->availableDataLength, false);
+}
+
+bool LWDataHandlerSetIdleTimeout(LWDataHandler *aDataHandler, uint64_t aTimeout, LWDataHandlerTimeoutCallback aCallback)
+{
+	// create timer if necessary
+	if(!aDataHandler->idleTimer)
+	{
+		aDataHandler->idleTimer = LWTimerCreateWithAllocator(&LWDataHandlerIdleTimerCallback, aDataHandler, aDataHandler->allocator);
+		if(!aDataHandler->idleTimer)
+			return false;
+	}
+
+	// set timeout; zero disables it
+	aDataHandler->idleTimeout			= aCallback ? aTimeout : 0;
+	aDataHandler->idleTimeoutCallback	= aCallback;
+
+	// start or stop timer
+	LWTimerCancel(aDataHandler->idleTimer);
+	LWDataHandlerRestartIdleTimer(aDataHandler);
+
+	return true;
+}
+
+bool LWDataHandlerSetStallTimeout(LWDataHandler *aDataHandler, uint64_t aTimeout, LWDataHandlerTimeoutCallback aCallback)
+{
+	// create timer if necessary
+	if(!aDataHandler->stallTimer)
+	{
+		aDataHandler->stallTimer = LWTimerCreateWithAllocator(&LWDataHandlerStallTimerCallback, aDataHandler, aDataHandler->allocator);
+		if(!aDataHandler->stallTimer)
+			return false;
+	}
+
+	// set timeout; zero disables it
+	aDataHandler->stallTimeout			= aCallback ? aTimeout : 0;
+	aDataHandler->stallTimeoutCallback	= aCallback;
+
+	// start or stop timer
+	LWTimerCancel(aDataHandler->stallTimer);
+	LWDataHandlerUpdateStallTimer(aDataHandler, aDataHandler->availableDataLength, false);
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Moving Data Handlers Between Threads
+
+bool LWDataHandlerDetach(LWDataHandler *aDataHandler)
+{
+	// cannot detach from within a callback
+	if(aDataHandler->isHandlingData || aDataHandler->isDetached)
+		return false;
+
+	// stop timers; the buffer, including any incomplete message, stays
+	LWDataHandlerSetTimerWheel(aDataHandler, NULL);
+
+	// publish state to the thread that attaches next
+	LW_ATOMIC_STORE(&aDataHandler->isDetached, true);
+
+	return true;
+}
+
+bool LWDataHandlerAttach(LWDataHandler *aDataHandler, LWTimerWheel *aTimerWheel)
+{
+	// pick up state from the thread that detached
+	if(!LW_ATOMIC_LOAD(&aDataHandler->isDetached))
+		return false;
+	aDataHandler->isDetached = false;
+
+	// restart timers on the new thread's timer wheel
+	LWDataHandlerSetTimerWheel(aDataHandler, aTimerWheel);
+
+	return true;
+}
+
+bool LWDataHandlerIsDetached(LWDataHandler *aDataHandler)
+{
+	return LW_ATOMIC_LOAD(&aDataHandler->isDetached);
+}
+
 #pragma mark -
 #pragma mark Handling Data
 
+static uint64_t LWDataHandlerGetTime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec*1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static bool LWDataHandlerIsOverBudget(LWDataHandler *aDataHandler, size_t aMessageCount, uint64_t aDeadline)
+{
+	// always make progress
+	if(0 == aMessageCount)
+		return false;
+
+	return (aDataHandler->maxDispatchMessageCount && aMessageCount >= aDataHandler->maxDispatchMessageCount) ||
+		(aDeadline && LWDataHandlerGetTime() >= aDeadline);
+}
+
+static bool LWDataHandlerDetectWireFormat(LWDataHandler *aDataHandler, uint8_t *aData, size_t aDataLength, size_t *aPreambleLength)
+{
+	*aPreambleLength = 0;
+
+	// nothing to detect
+	if(kLWWireFormatAutomatic != aDataHandler->wireFormat)
+		return true;
+
+	// anything but the preamble means version 1
+	size_t length = (aDataLength < kLWWireFormatVersion2PreambleLength ? aDataLength : kLWWireFormatVersion2PreambleLength);
+	if(0 != memcmp(aData, kLWWireFormatVersion2Preamble, length))
+	{
+		aDataHandler->wireFormat = kLWWireFormatVersion1;
+		return true;
+	}
+
+	// wait for the rest of the preamble
+	if(length < kLWWireFormatVersion2PreambleLength)
+		return false;
+
+	aDataHandler->wireFormat	= kLWWireFormatVersion2;
+	*aPreambleLength			= kLWWireFormatVersion2PreambleLength;
+
+	return true;
+}
+
+static bool LWDataHandlerGetFrameMessageID(LWDataHandler *aDataHandler, uint8_t *aFrame, size_t aFrameLength, uint8_t *aMessageID)
+{
+	// version 1 frames start with the message ID
+	size_t offset = 0;
+	if(kLWWireFormatVersion2 == aDataHandler->wireFormat)
+	{
+		// skip over body length
+		uint64_t bodyLength;
+		if(!LWVarintRead(aFrame, aFrameLength, &bodyLength, &offset))
+			return false;
+	}
+
+	if(offset >= aFrameLength)
+		return false;
+
+	*aMessageID = aFrame[offset];
+
+	return true;
+}
+
+static bool LWDataHandlerGetFrameLength(LWDataHandler *aDataHandler, uint8_t *aData, size_t aDataLength, size_t *aFrameLength)
+{
+	if(!LWMessageGetFrameLengthWithWireFormat(aData, aDataLength, aFrameLength, aDataHandler->wireFormat))
+		return false;
+
+	// frames are only complete with their trailer
+	if(aDataHandler->isChecksumEnabled)
+	{
+		if(*aFrameLength + kLWChecksumLength > aDataLength)
+			return false;
+		*aFrameLength += kLWChecksumLength;
+	}
+
+	return true;
+}
+
+static bool LWDataHandlerIsRelayed(LWDataHandler *aDataHandler, uint8_t aMessageID)
+{
+	return aDataHandler->relayWriters[aMessageID] || aDataHandler->relayCallbacks[aMessageID];
+}
+
+static void LWDataHandlerCountMessage(LWDataHandler *aDataHandler, uint8_t aMessageID, size_t aFrameLength)
+{
+	if(!aDataHandler->stats)
+		return;
+
+	++aDataHandler->stats->messageCounts[aMessageID];
+	aDataHandler->stats->byteCounts[aMessageID] += aFrameLength;
+}
+
+static void LWDataHandlerRecordCallbackTime(LWDataHandler *aDataHandler, uint8_t aMessageID, uint64_t aStartTime)
+{
+	// stats may have been disabled by the callback
+	LWDataHandlerStats *stats = aDataHandler->stats;
+	if(!stats)
+		return;
+
+	// allocate histogram when first needed
+	if(!stats->callbackTimeHistograms[aMessageID])
+	{
+		stats->callbackTimeHistograms[aMessageID] = LWAllocatorAllocateZeroed(stats->allocator, kLWDataHandlerStatsBucketCount*sizeof(uint64_t));
+		if(!stats->callbackTimeHistograms[aMessageID])
+			return;
+	}
+
+	// bucket by power of two
+	uint64_t time = LWDataHandlerGetTime() - aStartTime;
+	size_t bucket = (0 == time ? 0 : 64 - (size_t)__builtin_clzll(time));
+	if(bucket >= kLWDataHandlerStatsBucketCount)
+		bucket = kLWDataHandlerStatsBucketCount - 1;
+	++stats->callbackTimeHistograms[aMessageID][bucket];
+}
+
+static void LWDataHandlerSkipMalformedFrame(LWDataHandler *aDataHandler)
+{
+	if(aDataHandler->stats)
+		++aDataHandler->stats->invalidMessageCount;
+}
+
+static LWMessage *LWDataHandlerDecodeMessage(LWDataHandler *aDataHandler, uint8_t *aData, size_t aDataLength, size_t *aBytesUsed, bool *aIsChecksumValid)
+{
+	// checksum frame while decoding it
+	if(aDataHandler->isChecksumEnabled)
+		return LWMessageDeserializeWithChecksum(aData, aDataLength, aBytesUsed, aDataHandler->allocator, aDataHandler->arena, aDataHandler->wireFormat, aIsChecksumValid);
+
+	*aIsChecksumValid = true;
+	if(aDataHandler->arena)
+		return LWMessageDeserializeInArenaWithWireFormat(aData, aDataLength, aBytesUsed, aDataHandler->arena, aDataHandler->wireFormat);
+
+	return LWMessageDeserializeWithWireFormat(aData, aDataLength, aBytesUsed, aDataHandler->allocator, aDataHandler->wireFormat);
+}
+
+static void LWDataHandlerFinishDispatch(LWDataHandler *aDataHandler)
+{
+	// set not handling data
+	aDataHandler->isHandlingData = false;
+
+	// messages decoded into the arena are gone after dispatch
+	if(aDataHandler->arena)
+		LWArenaReset(aDataHandler->arena);
+}
+
+static bool LWDataHandlerResolveInternedArguments(LWDataHandler *aDataHandler, LWMessage *aMessage)
+{
+	LWInternTable *internTable = aDataHandler->internTable;
+	if(!internTable)
+		return true;
+
+	// resolve in argument order, as the sender encoded them
+	uint32_t internedArguments = internTable->internedArguments[aMessage->messageID];
+	for(size_t i = 0; internedArguments && i < aMessage->argumentCount; ++i, internedArguments >>= 1)
+	{
+		if((internedArguments & 1) && !LWInternTableResolveArgument(internTable, aMessage, i))
+			return false;
+	}
+
+	return true;
+}
+
+static void LWDataHandlerDispatchMessage(LWDataHandler *aDataHandler, LWMessage *aMessage, size_t aFrameLength, bool aIsChecksumValid)
+{
+	LWDataHandlerCountMessage(aDataHandler, aMessage->messageID, aFrameLength);
+
+	// check trailer, resolve interned arguments, then validate message
+	if(!aIsChecksumValid || !LWDataHandlerResolveInternedArguments(aDataHandler, aMessage) || (aDataHandler->validator && !LWValidatorMessageIsValid(aDataHandler->validator, aMessage)))
+	{
+		// message is invalid
+		if(aDataHandler->stats)
+			++aDataHandler->stats->invalidMessageCount;
+		if(aDataHandler->invalidMessageCallback)
+			aDataHandler->invalidMessageCallback(aDataHandler, aMessage, aDataHandler->userInfo);
+
+		// skip message
+		LWMessageDelete(aMessage);
+		return;
+	}
+
+	// get appropriate callback
+	LWDataHandlerCallback callback = aDataHandler->messageCallbacks[aMessage->messageID];
+	if(!callback)
+	{
+		if(aDataHandler->stats)
+			++aDataHandler->stats->unrecognisedMessageCount;
+		callback = aDataHandler->unrecognisedMessageCallback;
+	}
+
+	// call it, timing it if necessary
+	if(callback)
+	{
+		LW_TRACE_START(dispatch, traceStartTime, aMessage->messageID);
+		if(aDataHandler->stats)
+		{
+			uint64_t startTime = LWDataHandlerGetTime();
+			callback(aDataHandler, aMessage, aDataHandler->userInfo);
+			LWDataHandlerRecordCallbackTime(aDataHandler, aMessage->messageID, startTime);
+		}
+		else
+			callback(aDataHandler, aMessage, aDataHandler->userInfo);
+		LW_TRACE_DONE(dispatch, kLWTraceEventDispatch, traceStartTime, aMessage->messageID, aFrameLength);
+	}
+
+	// delete message
+	LWMessageDelete(aMessage);
+}
+
+static void LWDataHandlerRelayFrame(LWDataHandler *aDataHandler, uint8_t aMessageID, uint8_t *aFrame, size_t aFrameLength)
+{
+	// check trailer, without decoding the frame
+	size_t messageLength = aFrameLength;
+	if(aDataHandler->isChecksumEnabled)
+	{
+		messageLength -= kLWChecksumLength;
+		if(LWChecksumUpdate(0, aFrame, messageLength) != LWChecksumRead(aFrame + messageLength))
+		{
+			// decode corrupted frame so that it is reported like any other invalid message
+			size_t		bytesUsed;
+			bool		isChecksumValid;
+			LWMessage	*message = LWDataHandlerDecodeMessage(aDataHandler, aFrame, aFrameLength, &bytesUsed, &isChecksumValid);
+			if(message)
+				LWDataHandlerDispatchMessage(aDataHandler, message, aFrameLength, false);
+			else
+			{
+				LWDataHandlerCountMessage(aDataHandler, aMessageID, aFrameLength);
+				LWDataHandlerSkipMalformedFrame(aDataHandler);
+			}
+			return;
+		}
+	}
+
+	LWDataHandlerCountMessage(aDataHandler, aMessageID, aFrameLength);
+
+	// pass on raw frame, with a trailer if the writer wants one
+	LWWriter *relayWriter = aDataHandler->relayWriters[aMessageID];
+	if(relayWriter && relayWriter->isChecksumEnabled && aDataHandler->isChecksumEnabled)
+		LWWriterWriteData(relayWriter, aFrame, aFrameLength);
+	else if(relayWriter)
+		LWWriterWriteFrame(relayWriter, aFrame, messageLength);
+	else
+		aDataHandler->relayCallbacks[aMessageID](aDataHandler, aFrame, messageLength, aDataHandler->userInfo);
+}
+
+static bool LWDataHandlerFindFrames(LWDataHandler *aDataHandler, uint8_t *aData, size_t aDataLength, size_t *aFrameCount, size_t *aFramesLength)
+{
+	*aFrameCount	= 0;
+	*aFramesLength	= 0;
+
+	size_t frameLength;
+	while(LWDataHandlerGetFrameLength(aDataHandler, aData + *aFramesLength, aDataLength - *aFramesLength, &frameLength))
+	{
+		// grow frame list if necessary
+		if(*aFrameCount == aDataHandler->frameCapacity)
+		{
+			size_t newFrameCapacity = aDataHandler->frameCapacity ? 2*aDataHandler->frameCapacity : 64;
+			struct _LWDataHandlerFrame *newFrames = LWAllocatorReallocate(aDataHandler->allocator, aDataHandler->frames, newFrameCapacity*sizeof(struct _LWDataHandlerFrame));
+			if(!newFrames)
+				return false;
+			size_t *newFrameOrder = LWAllocatorReallocate(aDataHandler->allocator, aDataHandler->frameOrder, newFrameCapacity*sizeof(size_t));
+			if(!newFrameOrder)
+			{
+				aDataHandler->frames = newFrames;
+				return false;
+			}
+			aDataHandler->frames		= newFrames;
+			aDataHandler->frameOrder	= newFrameOrder;
+			aDataHandler->frameCapacity	= newFrameCapacity;
+		}
+
+		// remember frame
+		uint8_t messageID = 0;
+		LWDataHandlerGetFrameMessageID(aDataHandler, aData + *aFramesLength, frameLength, &messageID);
+		struct _LWDataHandlerFrame *frame = &aDataHandler->frames[(*aFrameCount)++];
+		frame->offset		= *aFramesLength;
+		frame->length		= frameLength;
+		frame->priority		= aDataHandler->messagePriorities[messageID];
+		frame->isDispatched	= false;
+
+		*aFramesLength += frameLength;
+	}
+
+	return true;
+}
+
+static bool LWDataHandlerDispatchMessagesByPriority(LWDataHandler *aDataHandler, uint8_t *aData, size_t aDataLength, size_t *aBytesUsed, uint64_t aDeadline)
+{
+	// find all complete messages first; without memory for more, dispatch those found and pick up the rest later
+	size_t frameCount;
+	size_t framesLength;
+	bool hasUnfoundFrames = !LWDataHandlerFindFrames(aDataHandler, aData, aDataLength, &frameCount, &framesLength);
+
+	// order frames by descending priority; counting sort keeps arrival order within a priority
+	size_t frameIndices[256] = { 0 };
+	for(size_t i = 0; i < frameCount; ++i)
+		++frameIndices[aDataHandler->frames[i].priority];
+	for(size_t priority = 256, frameIndex = 0; priority > 0; --priority)
+	{
+		size_t count = frameIndices[priority - 1];
+		frameIndices[priority - 1] = frameIndex;
+		frameIndex += count;
+	}
+	for(size_t i = 0; i < frameCount; ++i)
+		aDataHandler->frameOrder[frameIndices[aDataHandler->frames[i].priority]++] = i;
+
+	// dispatch frames in order
+	size_t messageCount = 0;
+	for(; messageCount < frameCount; ++messageCount)
+	{
+		// stop once the budget is used up
+		if(LWDataHandlerIsOverBudget(aDataHandler, messageCount, aDeadline))
+			break;
+
+		// dispatch frame
+		struct _LWDataHandlerFrame *frame = &aDataHandler->frames[aDataHandler->frameOrder[messageCount]];
+		uint8_t *frameData = aData + frame->offset;
+		uint8_t messageID;
+		frame->isDispatched = true;
+		if(LWDataHandlerGetFrameMessageID(aDataHandler, frameData, frame->length, &messageID) && LWDataHandlerIsRelayed(aDataHandler, messageID))
+			LWDataHandlerRelayFrame(aDataHandler, messageID, frameData, frame->length);
+		else
+		{
+			size_t		bytesUsed;
+			bool		isChecksumValid;
+			LWMessage	*message = LWDataHandlerDecodeMessage(aDataHandler, frameData, frame->length, &bytesUsed, &isChecksumValid);
+			if(message)
+				LWDataHandlerDispatchMessage(aDataHandler, message, frame->length, isChecksumValid);
+			else
+				LWDataHandlerSkipMalformedFrame(aDataHandler);
+		}
+
+		// check whether data handler is scheduled for deletion
+		if(aDataHandler->isScheduledForDeletion)
+		{
+			LWDataHandlerFree(aDataHandler);
+			return false;
+		}
+	}
+
+	// move frames that were not dispatched to the end, in arrival order
+	size_t undispatchedOffset = framesLength;
+	if(messageCount < frameCount)
+	{
+		aDataHandler->hasPendingMessages = true;
+		for(size_t i = frameCount; i > 0; --i)
+		{
+			struct _LWDataHandlerFrame *frame = &aDataHandler->frames[i - 1];
+			if(frame->isDispatched)
+				continue;
+
+			undispatchedOffset -= frame->length;
+			memmove(aData + undispatchedOffset, aData + frame->offset, frame->length);
+		}
+	}
+	*aBytesUsed = undispatchedOffset;
+	if(hasUnfoundFrames)
+		aDataHandler->hasPendingMessages = true;
+
+	LWDataHandlerFinishDispatch(aDataHandler);
+
+	return true;
+}
+
+static bool LWDataHandlerDispatchMessages(LWDataHandler *aDataHandler, uint8_t *aData, size_t aDataLength, size_t *aBytesUsed)
+{
+	// set handling data
+	aDataHandler->isHandlingData		= true;
+	aDataHandler->hasPendingMessages	= false;
+
+	// determine deadline
+	uint64_t deadline = 0;
+	if(aDataHandler->maxDispatchTime)
+		deadline = LWDataHandlerGetTime() + aDataHandler->maxDispatchTime;
+
+	// dispatch by priority if necessary
+	if(aDataHandler->hasMessagePriorities)
+		return LWDataHandlerDispatchMessagesByPriority(aDataHandler, aData, aDataLength, aBytesUsed, deadline);
+
+	// look for messages in the data
+	size_t messageCount = 0;
+	*aBytesUsed = 0;
+	while(true)
+	{
+		// stop once the budget is used up
+		if(LWDataHandlerIsOverBudget(aDataHandler, messageCount, deadline))
+		{
+			size_t frameLength;
+			aDataHandler->hasPendingMessages = LWDataHandlerGetFrameLength(aDataHandler, aData + *aBytesUsed, aDataLength - *aBytesUsed, &frameLength);
+			break;
+		}
+
+		// relay frame without decoding it
+		uint8_t *frame = aData + *aBytesUsed;
+		uint8_t messageID;
+		if(LWDataHandlerGetFrameMessageID(aDataHandler, frame, aDataLength - *aBytesUsed, &messageID) && LWDataHandlerIsRelayed(aDataHandler, messageID))
+		{
+			// find end of frame
+			size_t frameLength;
+			if(!LWDataHandlerGetFrameLength(aDataHandler, frame, aDataLength - *aBytesUsed, &frameLength))
+				break;
+
+			// move to next message
+			*aBytesUsed += frameLength;
+			++messageCount;
+
+			LWDataHandlerRelayFrame(aDataHandler, messageID, frame, frameLength);
+		}
+		else
+		{
+			// get next message
+			size_t		bytesUsed;
+			bool		isChecksumValid;
+			LWMessage	*message;
+			message = LWDataHandlerDecodeMessage(aDataHandler, frame, aDataLength - *aBytesUsed, &bytesUsed, &isChecksumValid);
+			if(!message && 0 == bytesUsed)
+				break;
+
+			// move to next message
+			*aBytesUsed += bytesUsed;
+			++messageCount;
+
+			if(message)
+				LWDataHandlerDispatchMessage(aDataHandler, message, bytesUsed, isChecksumValid);
+			else
+				LWDataHandlerSkipMalformedFrame(aDataHandler);
+		}
+
+		// check whether data handler is scheduled for deletion
+		if(aDataHandler->isScheduledForDeletion)
+		{
+			LWDataHandlerFree(aDataHandler);
+			return false;
+		}
+	}
+
+	LWDataHandlerFinishDispatch(aDataHandler);
+
+	return true;
+}
+
+static void LWDataHandlerDispatchBufferedMessages(LWDataHandler *aDataHandler)
+{
+	// handle messages in the buffer
+	size_t totalBytesUsed;
+	if(!LWDataHandlerDispatchMessages(aDataHandler, aDataHandler->buffer, aDataHandler->availableDataLength, &totalBytesUsed))
+		return;
+
+	// remove used bytes from buffer
+	memmove(aDataHandler->buffer, aDataHandler->buffer + totalBytesUsed, aDataHandler->availableDataLength - totalBytesUsed);
+	aDataHandler->availableDataLength -= totalBytesUsed;
+	if(aDataHandler->stats)
+		aDataHandler->stats->carryOverByteCount += aDataHandler->availableDataLength;
+
+	// watch for incomplete messages
+	LWDataHandlerUpdateStallTimer(aDataHandler, aDataHandler->availableDataLength, totalBytesUsed > 0);
+}
+
 bool LWDataHandlerHandleData(LWDataHandler *aDataHandler, void *aData, size_t aDataLength)
 {
+	// detached data handlers belong to no thread
+	if(aDataHandler->isDetached)
+		return false;
+
+	// connection is not idle
+	LWDataHandlerRestartIdleTimer(aDataHandler);
+
 	// make sure we don't exceed the 10k buffer limit
 	if(aDataHandler->availableDataLength + aDataLength > kLWDataHandlerMaxBufferCapacity)
 		return false;
@@ -155,71 +982,103 @@ bool LWDataHandlerHandleData(LWDataHandler *aDataHandler, void *aData, size_t aD
 			return false;
 
 		// reallocate buffer
-		void *newBuffer = realloc(aDataHandler->buffer, newBufferCapacity);
+		void *newBuffer = LWAllocatorReallocate(aDataHandler->allocator, aDataHandler->buffer, newBufferCapacity);
 		if(!newBuffer)
 			return false;
 		aDataHandler->buffer = newBuffer;
 		aDataHandler->bufferCapacity = newBufferCapacity;
+		if(aDataHandler->stats)
+			++aDataHandler->stats->reallocationCount;
 	}
 
+	// trace only data that is accepted, so that every start has a done
+	LW_TRACE_START(handle_data, traceStartTime, aDataLength);
+
 	// append data
 	memcpy(aDataHandler->buffer + aDataHandler->availableDataLength, aData, aDataLength);
 	aDataHandler->availableDataLength += aDataLength;
+	if(aDataHandler->stats && aDataHandler->availableDataLength > aDataHandler->stats->bufferHighWaterMark)
+		aDataHandler->stats->bufferHighWaterMark = aDataHandler->availableDataLength;
 
-	// set handling data
-	aDataHandler->isHandlingData = true;
-
-	// look for messages in the buffer
-	size_t totalBytesUsed = 0;
-	while(true)
+	// find out which wire format the other end uses
+	size_t preambleLength;
+	if(!LWDataHandlerDetectWireFormat(aDataHandler, aDataHandler->buffer, aDataHandler->availableDataLength, &preambleLength))
 	{
-		// get next message
-		size_t		bytesUsed;
-		LWMessage	*message;
-		message = LWMessageDeserialize(aDataHandler->buffer + totalBytesUsed, aDataHandler->availableDataLength - totalBytesUsed, &bytesUsed);
-		if(!message)
-			break;
+		LWDataHandlerUpdateStallTimer(aDataHandler, aDataHandler->availableDataLength, false);
+		LW_TRACE_DONE(handle_data, kLWTraceEventHandleData, traceStartTime, 0, aDataLength);
+		return true;
+	}
+	if(preambleLength > 0)
+	{
+		memmove(aDataHandler->buffer, aDataHandler->buffer + preambleLength, aDataHandler->availableDataLength - preambleLength);
+		aDataHandler->availableDataLength -= preambleLength;
+	}
 
-		// validate message
-		if(aDataHandler->validator && !LWValidatorMessageIsValid(aDataHandler->validator, message))
-		{
-			// message is invalid
-			if(aDataHandler->invalidMessageCallback)
-				aDataHandler->invalidMessageCallback(aDataHandler, message, aDataHandler->userInfo);
+	// handle messages in the buffer
+	LWDataHandlerDispatchBufferedMessages(aDataHandler);
 
-			// skip message
-			totalBytesUsed += bytesUsed;
-			continue;
-		}
+	LW_TRACE_DONE(handle_data, kLWTraceEventHandleData, traceStartTime, 0, aDataLength);
 
-		// get appropriate callback and call it
-		LWDataHandlerCallback callback = aDataHandler->messageCallbacks[message->messageID];
-		if(callback)
-			callback(aDataHandler, message, aDataHandler->userInfo);
-		else if(aDataHandler->unrecognisedMessageCallback)
-			aDataHandler->unrecognisedMessageCallback(aDataHandler, message, aDataHandler->userInfo);
+	return true;
+}
 
-		// delete message
-		LWMessageDelete(message);
+bool LWDataHandlerHandleDataInPlace(LWDataHandler *aDataHandler, void *aData, size_t aDataLength, size_t *aBytesUsed)
+{
+	*aBytesUsed = 0;
 
-		// check whether data handler is scheduled for deletion
-		if(aDataHandler->isScheduledForDeletion)
-		{
-			free(aDataHandler->buffer);
-			free(aDataHandler);
-			return true;
-		}
+	// buffered data would have to come first
+	if(0 != aDataHandler->availableDataLength || aDataHandler->isDetached)
+		return false;
+
+	// connection is not idle
+	LWDataHandlerRestartIdleTimer(aDataHandler);
 
-		// move to next message
-		totalBytesUsed += bytesUsed;
+	LW_TRACE_START(handle_data, traceStartTime, aDataLength);
+
+	// find out which wire format the other end uses
+	size_t preambleLength;
+	if(!LWDataHandlerDetectWireFormat(aDataHandler, aData, aDataLength, &preambleLength))
+	{
+		LWDataHandlerUpdateStallTimer(aDataHandler, aDataLength, false);
+		LW_TRACE_DONE(handle_data, kLWTraceEventHandleData, traceStartTime, 0, aDataLength);
+		return true;
 	}
 
-	// remove used bytes from buffer
-	memmove(aDataHandler->buffer, aDataHandler->buffer + totalBytesUsed, aDataHandler->availableDataLength - totalBytesUsed);
-	aDataHandler->availableDataLength -= totalBytesUsed;
+	// handle messages without copying them into the buffer
+	bool isAlive = LWDataHandlerDispatchMessages(aDataHandler, (uint8_t *)aData + preambleLength, aDataLength - preambleLength, aBytesUsed);
+	*aBytesUsed += preambleLength;
+	if(!isAlive)
+	{
+		LW_TRACE_DONE(handle_data, kLWTraceEventHandleData, traceStartTime, 0, aDataLength);
+		return true;
+	}
 
-	// set not handling data
-	aDataHandler->isHandlingData = false;
+	// unused bytes will have to be passed again
+	if(aDataHandler->stats)
+		aDataHandler->stats->carryOverByteCount += aDataLength - *aBytesUsed;
+
+	// watch for incomplete messages
+	LWDataHandlerUpdateStallTimer(aDataHandler, aDataLength - *aBytesUsed, *aBytesUsed > 0);
+
+	LW_TRACE_DONE(handle_data, kLWTraceEventHandleData, traceStartTime, 0, aDataLength);
+
+	return true;
+}
+
+bool LWDataHandlerResumeDispatch(LWDataHandler *aDataHandler)
+{
+	// cannot resume from within a callback or while detached
+	if(aDataHandler->isHandlingData || aDataHandler->isDetached)
+		return false;
+
+	// handle messages left over in the buffer
+	if(aDataHandler->hasPendingMessages)
+		LWDataHandlerDispatchBufferedMessages(aDataHandler);
 
 	return true;
 }
+
+bool LWDataHandlerHasPendingMessages(LWDataHandler *aDataHandler)
+{
+	return aDataHandler->hasPendingMessages;
+}
@@ -0,0 +1,199 @@
+/*
+ * LWDataHandlerStats.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWDataHandlerStats.h>
+
+#pragma mark Creating Stats
+
+LWDataHandlerStats *LWDataHandlerStatsCreate(void)
+{
+	return LWDataHandlerStatsCreateWithAllocator(NULL);
+}
+
+LWDataHandlerStats *LWDataHandlerStatsCreateWithAllocator(LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// histograms are allocated when first needed
+	LWDataHandlerStats *stats = LWAllocatorAllocateZeroed(allocator, sizeof(LWDataHandlerStats));
+	if(!stats)
+		return NULL;
+	stats->allocator = allocator;
+
+	return stats;
+}
+
+#pragma mark -
+#pragma mark Deleting Stats
+
+void LWDataHandlerStatsDelete(LWDataHandlerStats *aStats)
+{
+	for(uint16_t i = 0; i < 256; ++i)
+		LWAllocatorFree(aStats->allocator, aStats->callbackTimeHistograms[i]);
+	LWAllocatorFree(aStats->allocator, aStats);
+}
+
+#pragma mark -
+#pragma mark Aggregating Stats
+
+void LWDataHandlerStatsReset(LWDataHandlerStats *aStats)
+{
+	// keep histograms around, they are likely to be needed again
+	for(uint16_t i = 0; i < 256; ++i)
+	{
+		aStats->messageCounts[i]	= 0;
+		aStats->byteCounts[i]		= 0;
+		if(aStats->callbackTimeHistograms[i])
+			memset(aStats->callbackTimeHistograms[i], 0, kLWDataHandlerStatsBucketCount*sizeof(uint64_t));
+	}
+	aStats->invalidMessageCount			= 0;
+	aStats->unrecognisedMessageCount	= 0;
+	aStats->bufferHighWaterMark			= 0;
+	aStats->reallocationCount			= 0;
+	aStats->carryOverByteCount			= 0;
+}
+
+bool LWDataHandlerStatsAdd(LWDataHandlerStats *aStats, LWDataHandlerStats *aOtherStats)
+{
+	for(uint16_t i = 0; i < 256; ++i)
+	{
+		aStats->messageCounts[i]	+= aOtherStats->messageCounts[i];
+		aStats->byteCounts[i]		+= aOtherStats->byteCounts[i];
+
+		// add histogram
+		if(!aOtherStats->callbackTimeHistograms[i])
+			continue;
+		if(!aStats->callbackTimeHistograms[i])
+		{
+			aStats->callbackTimeHistograms[i] = LWAllocatorAllocateZeroed(aStats->allocator, kLWDataHandlerStatsBucketCount*sizeof(uint64_t));
+			if(!aStats->callbackTimeHistograms[i])
+				return false;
+		}
+		for(size_t j = 0; j < kLWDataHandlerStatsBucketCount; ++j)
+			aStats->callbackTimeHistograms[i][j] += aOtherStats->callbackTimeHistograms[i][j];
+	}
+	aStats->invalidMessageCount			+= aOtherStats->invalidMessageCount;
+	aStats->unrecognisedMessageCount	+= aOtherStats->unrecognisedMessageCount;
+	aStats->reallocationCount			+= aOtherStats->reallocationCount;
+	aStats->carryOverByteCount			+= aOtherStats->carryOverByteCount;
+
+	// high-water marks do not add up
+	if(aOtherStats->bufferHighWaterMark > aStats->bufferHighWaterMark)
+		aStats->bufferHighWaterMark = aOtherStats->bufferHighWaterMark;
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Querying Stats
+
+uint64_t LWDataHandlerStatsGetMessageCount(LWDataHandlerStats *aStats, uint8_t aMessageID)
+{
+	return aStats->messageCounts[aMessageID];
+}
+
+uint64_t LWDataHandlerStatsGetByteCount(LWDataHandlerStats *aStats, uint8_t aMessageID)
+{
+	return aStats->byteCounts[aMessageID];
+}
+
+uint64_t LWDataHandlerStatsGetInvalidMessageCount(LWDataHandlerStats *aStats)
+{
+	return aStats->invalidMessageCount;
+}
+
+uint64_t LWDataHandlerStatsGetUnrecognisedMessageCount(LWDataHandlerStats *aStats)
+{
+	return aStats->unrecognisedMessageCount;
+}
+
+size_t LWDataHandlerStatsGetBufferHighWaterMark(LWDataHandlerStats *aStats)
+{
+	return aStats->bufferHighWaterMark;
+}
+
+uint64_t LWDataHandlerStatsGetReallocationCount(LWDataHandlerStats *aStats)
+{
+	return aStats->reallocationCount;
+}
+
+uint64_t LWDataHandlerStatsGetCarryOverByteCount(LWDataHandlerStats *aStats)
+{
+	return aStats->carryOverByteCount;
+}
+
+uint64_t LWDataHandlerStatsGetCallbackTimeCount(LWDataHandlerStats *aStats, uint8_t aMessageID, size_t aBucket)
+{
+	if(!aStats->callbackTimeHistograms[aMessageID] || aBucket >= kLWDataHandlerStatsBucketCount)
+		return 0;
+
+	return aStats->callbackTimeHistograms[aMessageID][aBucket];
+}
+
+uint64_t LWDataHandlerStatsGetCallbackTimePercentile(LWDataHandlerStats *aStats, uint8_t aMessageID, double aPercentile)
+{
+	uint64_t *histogram = aStats->callbackTimeHistograms[aMessageID];
+	if(!histogram)
+		return 0;
+
+	// count callbacks
+	uint64_t count = 0;
+	for(size_t i = 0; i < kLWDataHandlerStatsBucketCount; ++i)
+		count += histogram[i];
+	if(0 == count)
+		return 0;
+
+	// find bucket containing the requested rank, and return its upper bound
+	uint64_t rank = (uint64_t)(aPercentile/100.0*(double)count + 0.5);
+	if(rank < 1)
+		rank = 1;
+	count = 0;
+	for(size_t i = 0; i < kLWDataHandlerStatsBucketCount; ++i)
+	{
+		count += histogram[i];
+		if(count >= rank)
+			return 0 == i ? 0 : (i == kLWDataHandlerStatsBucketCount - 1 ? UINT64_MAX : (1ULL << i) - 1);
+	}
+
+	return UINT64_MAX;
+}
@@ -0,0 +1,435 @@
+/*
+ * LWInternTable.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWInternTable.h>
+#include <Lunkwill/LWMessage.h>
+
+#pragma mark Creating Intern Tables
+
+LWInternTable *LWInternTableCreate(uint16_t aCapacity)
+{
+	return LWInternTableCreateWithAllocator(aCapacity, NULL);
+}
+
+LWInternTable *LWInternTableCreateWithAllocator(uint16_t aCapacity, LWAllocator *aAllocator)
+{
+	// slot numbers must fit in two bytes, with one value to spare
+	if(0 == aCapacity || aCapacity >= kLWInternTableNoSlot)
+		return NULL;
+
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// create intern table
+	LWInternTable *internTable = LWAllocatorAllocateZeroed(allocator, sizeof(LWInternTable));
+	if(!internTable)
+		return NULL;
+	internTable->allocator = allocator;
+
+	// create slots
+	internTable->slots = LWAllocatorAllocateZeroed(allocator, aCapacity*sizeof(struct _LWInternTableSlot));
+	if(!internTable->slots)
+	{
+		LWAllocatorFree(allocator, internTable);
+		return NULL;
+	}
+	internTable->capacity	= aCapacity;
+	internTable->count		= 0;
+	internTable->firstSlot	= kLWInternTableNoSlot;
+	internTable->lastSlot	= kLWInternTableNoSlot;
+
+	// create buckets, keeping the load factor at or below one half
+	size_t bucketCount = 2;
+	while(bucketCount < 2ul*aCapacity)
+		bucketCount *= 2;
+	internTable->buckets = LWAllocatorAllocateZeroed(allocator, bucketCount*sizeof(uint32_t));
+	if(!internTable->buckets)
+	{
+		LWAllocatorFree(allocator, internTable->slots);
+		LWAllocatorFree(allocator, internTable);
+		return NULL;
+	}
+	internTable->bucketMask = (uint32_t)(bucketCount - 1);
+
+	return internTable;
+}
+
+#pragma mark -
+#pragma mark Deleting Intern Tables
+
+void LWInternTableDelete(LWInternTable *aInternTable)
+{
+	// release interned arguments
+	for(size_t i = 0; i < aInternTable->capacity; ++i)
+	{
+		if(aInternTable->slots[i].argument)
+			LWArgumentRelease(aInternTable->slots[i].argument);
+	}
+
+	// delete intern table
+	LWAllocatorFree(aInternTable->allocator, aInternTable->buckets);
+	LWAllocatorFree(aInternTable->allocator, aInternTable->slots);
+	LWAllocatorFree(aInternTable->allocator, aInternTable);
+}
+
+#pragma mark -
+#pragma mark Choosing Interned Arguments
+
+bool LWInternTableSetArgumentInterned(LWInternTable *aInternTable, uint8_t aMessageID, size_t aArgumentIndex, bool aIsInterned)
+{
+	if(aArgumentIndex > kLWInternTableMaxArgumentIndex)
+		return false;
+
+	if(aIsInterned)
+		aInternTable->internedArguments[aMessageID] |= (UINT32_C(1) << aArgumentIndex);
+	else
+		aInternTable->internedArguments[aMessageID] &= ~(UINT32_C(1) << aArgumentIndex);
+
+	return true;
+}
+
+bool LWInternTableIsArgumentInterned(LWInternTable *aInternTable, uint8_t aMessageID, size_t aArgumentIndex)
+{
+	if(aArgumentIndex > kLWInternTableMaxArgumentIndex)
+		return false;
+
+	return 0 != (aInternTable->internedArguments[aMessageID] & (UINT32_C(1) << aArgumentIndex));
+}
+
+#pragma mark -
+#pragma mark Querying Intern Tables
+
+uint16_t LWInternTableGetCapacity(LWInternTable *aInternTable)
+{
+	return aInternTable->capacity;
+}
+
+uint16_t LWInternTableGetCount(LWInternTable *aInternTable)
+{
+	return aInternTable->count;
+}
+
+LWArgument *LWInternTableGetArgumentInSlot(LWInternTable *aInternTable, uint16_t aSlot)
+{
+	if(aSlot >= aInternTable->capacity)
+		return NULL;
+
+	return aInternTable->slots[aSlot].argument;
+}
+
+#pragma mark -
+#pragma mark Maintaining Recency
+
+static void LWInternTableUnlinkSlot(LWInternTable *aInternTable, uint16_t aSlot)
+{
+	struct _LWInternTableSlot *slot = &aInternTable->slots[aSlot];
+
+	if(kLWInternTableNoSlot != slot->previousSlot)
+		aInternTable->slots[slot->previousSlot].nextSlot = slot->nextSlot;
+	else
+		aInternTable->firstSlot = slot->nextSlot;
+
+	if(kLWInternTableNoSlot != slot->nextSlot)
+		aInternTable->slots[slot->nextSlot].previousSlot = slot->previousSlot;
+	else
+		aInternTable->lastSlot = slot->previousSlot;
+}
+
+static void LWInternTableLinkSlotBetween(LWInternTable *aInternTable, uint16_t aSlot, uint16_t aPreviousSlot, uint16_t aNextSlot)
+{
+	struct _LWInternTableSlot *slot = &aInternTable->slots[aSlot];
+
+	slot->previousSlot	= aPreviousSlot;
+	slot->nextSlot		= aNextSlot;
+
+	if(kLWInternTableNoSlot != aPreviousSlot)
+		aInternTable->slots[aPreviousSlot].nextSlot = aSlot;
+	else
+		aInternTable->firstSlot = aSlot;
+
+	if(kLWInternTableNoSlot != aNextSlot)
+		aInternTable->slots[aNextSlot].previousSlot = aSlot;
+	else
+		aInternTable->lastSlot = aSlot;
+}
+
+static void LWInternTableLinkSlotFirst(LWInternTable *aInternTable, uint16_t aSlot)
+{
+	struct _LWInternTableSlot *slot = &aInternTable->slots[aSlot];
+
+	slot->previousSlot	= kLWInternTableNoSlot;
+	slot->nextSlot		= aInternTable->firstSlot;
+
+	if(kLWInternTableNoSlot != aInternTable->firstSlot)
+		aInternTable->slots[aInternTable->firstSlot].previousSlot = aSlot;
+	else
+		aInternTable->lastSlot = aSlot;
+	aInternTable->firstSlot = aSlot;
+}
+
+#pragma mark -
+#pragma mark Looking Up Arguments
+
+static uint32_t LWInternTableHash(uint8_t *aData, size_t aLength)
+{
+	// FNV-1a
+	uint32_t hash = UINT32_C(2166136261);
+	for(size_t i = 0; i < aLength; ++i)
+	{
+		hash ^= aData[i];
+		hash *= UINT32_C(16777619);
+	}
+
+	return hash;
+}
+
+static uint16_t LWInternTableFindSlot(LWInternTable *aInternTable, uint8_t *aData, size_t aLength, uint32_t aHash)
+{
+	// probe linearly until an empty bucket is found
+	for(uint32_t bucket = aHash & aInternTable->bucketMask; aInternTable->buckets[bucket]; bucket = (bucket + 1) & aInternTable->bucketMask)
+	{
+		uint16_t					slotIndex	= (uint16_t)(aInternTable->buckets[bucket] - 1);
+		struct _LWInternTableSlot	*slot		= &aInternTable->slots[slotIndex];
+		if(slot->hash == aHash && slot->argument->length == aLength && 0 == memcmp(slot->argument->data, aData, aLength))
+			return slotIndex;
+	}
+
+	return kLWInternTableNoSlot;
+}
+
+static void LWInternTableInsertSlot(LWInternTable *aInternTable, uint16_t aSlot)
+{
+	uint32_t bucket = aInternTable->slots[aSlot].hash & aInternTable->bucketMask;
+	while(aInternTable->buckets[bucket])
+		bucket = (bucket + 1) & aInternTable->bucketMask;
+
+	aInternTable->buckets[bucket] = (uint32_t)aSlot + 1;
+}
+
+static void LWInternTableRemoveSlot(LWInternTable *aInternTable, uint16_t aSlot)
+{
+	uint32_t mask = aInternTable->bucketMask;
+
+	// find bucket pointing at slot
+	uint32_t bucket = aInternTable->slots[aSlot].hash & mask;
+	while(aInternTable->buckets[bucket] != (uint32_t)aSlot + 1)
+		bucket = (bucket + 1) & mask;
+
+	// shift later entries of the probe sequence back, so that no tombstones are needed
+	uint32_t next = bucket;
+	while(true)
+	{
+		next = (next + 1) & mask;
+		if(!aInternTable->buckets[next])
+			break;
+
+		// an entry can move back only if its home bucket is not between the hole and itself
+		uint32_t home = aInternTable->slots[aInternTable->buckets[next] - 1].hash & mask;
+		if(((next - home) & mask) >= ((next - bucket) & mask))
+		{
+			aInternTable->buckets[bucket] = aInternTable->buckets[next];
+			bucket = next;
+		}
+	}
+	aInternTable->buckets[bucket] = 0;
+}
+
+#pragma mark -
+#pragma mark Encoding And Resolving Arguments
+
+bool LWInternTableEncodeArgument(LWInternTable *aInternTable, LWArgument *aArgument, LWArgument *aEncodedArgument, uint8_t *aReferenceData, struct _LWInternTableChange *aChange)
+{
+	uint32_t	hash		= LWInternTableHash(aArgument->data, aArgument->length);
+	uint16_t	slotIndex	= LWInternTableFindSlot(aInternTable, aArgument->data, aArgument->length, hash);
+
+	aEncodedArgument->isRetainable		= false;
+	aEncodedArgument->retainCount		= 1;
+	aEncodedArgument->allocator			= aInternTable->allocator;
+	aEncodedArgument->compressedData	= NULL;
+
+	// refer to known arguments by slot
+	if(kLWInternTableNoSlot != slotIndex)
+	{
+		aChange->slot				= slotIndex;
+		aChange->previousSlot		= aInternTable->slots[slotIndex].previousSlot;
+		aChange->nextSlot			= aInternTable->slots[slotIndex].nextSlot;
+		aChange->isDefinition		= false;
+		aChange->evictedArgument	= NULL;
+
+		LWInternTableUnlinkSlot(aInternTable, slotIndex);
+		LWInternTableLinkSlotFirst(aInternTable, slotIndex);
+
+		aReferenceData[0] = kLWInternTagReference;
+		aReferenceData[1] = (uint8_t)(slotIndex >> 8);
+		aReferenceData[2] = (uint8_t)(slotIndex & 0xff);
+
+		aEncodedArgument->data		= aReferenceData;
+		aEncodedArgument->length	= 3;
+		aEncodedArgument->ownsData	= false;
+
+		return true;
+	}
+
+	// copy argument before touching the table, so that failure leaves it intact
+	LWArgument *argument = LWArgumentCreateWithAllocator(aArgument->data, aArgument->length, aInternTable->allocator);
+	if(!argument)
+		return false;
+	uint8_t *definition = LWAllocatorAllocate(aInternTable->allocator, aArgument->length + 3);
+	if(!definition)
+	{
+		LWArgumentRelease(argument);
+		return false;
+	}
+
+	// take a free slot, or evict the least recently used one, keeping it until the change is committed
+	aChange->isDefinition		= true;
+	aChange->evictedArgument	= NULL;
+	if(aInternTable->count < aInternTable->capacity)
+		slotIndex = aInternTable->count++;
+	else
+	{
+		slotIndex = aInternTable->lastSlot;
+		aChange->previousSlot		= aInternTable->slots[slotIndex].previousSlot;
+		aChange->nextSlot			= aInternTable->slots[slotIndex].nextSlot;
+		aChange->evictedArgument	= aInternTable->slots[slotIndex].argument;
+		aChange->evictedHash		= aInternTable->slots[slotIndex].hash;
+		LWInternTableUnlinkSlot(aInternTable, slotIndex);
+		LWInternTableRemoveSlot(aInternTable, slotIndex);
+	}
+	aChange->slot = slotIndex;
+
+	// intern argument
+	aInternTable->slots[slotIndex].argument	= argument;
+	aInternTable->slots[slotIndex].hash		= hash;
+	LWInternTableInsertSlot(aInternTable, slotIndex);
+	LWInternTableLinkSlotFirst(aInternTable, slotIndex);
+
+	// define slot
+	definition[0] = kLWInternTagDefinition;
+	definition[1] = (uint8_t)(slotIndex >> 8);
+	definition[2] = (uint8_t)(slotIndex & 0xff);
+	memcpy(definition + 3, aArgument->data, aArgument->length);
+
+	aEncodedArgument->data		= definition;
+	aEncodedArgument->length	= aArgument->length + 3;
+	aEncodedArgument->ownsData	= true;
+
+	return true;
+}
+
+void LWInternTableCommitChange(LWInternTable *aInternTable, struct _LWInternTableChange *aChange)
+{
+#pragma unused (aInternTable)
+	if(aChange->evictedArgument)
+		LWArgumentRelease(aChange->evictedArgument);
+}
+
+void LWInternTableRevertChange(LWInternTable *aInternTable, struct _LWInternTableChange *aChange)
+{
+	struct _LWInternTableSlot *slot = &aInternTable->slots[aChange->slot];
+
+	// changes must be reverted newest first, so that the slot is still first
+	LWInternTableUnlinkSlot(aInternTable, aChange->slot);
+
+	// forget defined argument, and bring back the evicted one
+	if(aChange->isDefinition)
+	{
+		LWInternTableRemoveSlot(aInternTable, aChange->slot);
+		LWArgumentRelease(slot->argument);
+		slot->argument = aChange->evictedArgument;
+		if(!aChange->evictedArgument)
+		{
+			--aInternTable->count;
+			return;
+		}
+		slot->hash = aChange->evictedHash;
+		LWInternTableInsertSlot(aInternTable, aChange->slot);
+	}
+
+	// put slot back where it was in recency order
+	LWInternTableLinkSlotBetween(aInternTable, aChange->slot, aChange->previousSlot, aChange->nextSlot);
+}
+
+bool LWInternTableResolveArgument(LWInternTable *aInternTable, LWMessage *aMessage, size_t aArgumentIndex)
+{
+	LWArgument	*encodedArgument	= aMessage->arguments[aArgumentIndex];
+	uint8_t		*data				= encodedArgument->data;
+
+	// check tag and slot
+	if(encodedArgument->length < 3)
+		return false;
+	uint16_t slotIndex = (uint16_t)((data[1] << 8) | data[2]);
+	if(slotIndex >= aInternTable->capacity)
+		return false;
+	struct _LWInternTableSlot *slot = &aInternTable->slots[slotIndex];
+
+	if(kLWInternTagReference == data[0])
+	{
+		// refer to an argument defined earlier
+		if(3 != encodedArgument->length || !slot->argument)
+			return false;
+	}
+	else if(kLWInternTagDefinition == data[0])
+	{
+		// the sender decides which slot to reuse
+		if(3 == encodedArgument->length)
+			return false;
+		LWArgument *argument = LWArgumentCreateWithAllocator(data + 3, encodedArgument->length - 3, aInternTable->allocator);
+		if(!argument)
+			return false;
+		if(slot->argument)
+			LWArgumentRelease(slot->argument);
+		else
+			++aInternTable->count;
+		slot->argument = argument;
+	}
+	else
+		return false;
+
+	// share interned argument
+	aMessage->arguments[aArgumentIndex] = LWArgumentRetain(slot->argument);
+	if(encodedArgument->isRetainable)
+		LWArgumentRelease(encodedArgument);
+
+	return true;
+}
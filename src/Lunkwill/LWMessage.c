@@ -41,7 +41,10 @@
 #include <Lunkwill/LunkwillDefines.h>
 #include <Lunkwill/LunkwillTypes.h>
 #include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArena.h>
 #include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWTrace.h>
 
 #pragma mark Creating Messages
 
@@ -51,12 +54,15 @@ LWMessage *LWMessageCreate(uint8_t aMessageID, LWArgument *aArguments, ...)
 	LWArgument *argument;
 
 	// allocate message
-	LWMessage *message = malloc(sizeof(LWMessage));
+	LWAllocator *allocator = LWAllocatorGetDefault();
+	LWMessage *message = LWAllocatorAllocate(allocator, sizeof(LWMessage));
 	if(!message)
 		return NULL;
+	message->allocator = allocator;
 
 	// set message id
 	message->messageID = aMessageID;
+	message->retainCount = 1;
 
 	// count arguments
 	message->argumentCount = 0;
@@ -70,11 +76,11 @@ LWMessage *LWMessageCreate(uint8_t aMessageID, LWArgument *aArguments, ...)
 	va_end(ap);
 
 	// allocate arguments
-	message->arguments = malloc(message->argumentCount*sizeof(LWArgument *));
+	message->arguments = LWAllocatorAllocate(allocator, message->argumentCount*sizeof(LWArgument *));
 	message->argumentCapacity = message->argumentCount;
 	if(!message->arguments)
 	{
-		free(message);
+		LWAllocatorFree(allocator, message);
 		return NULL;
 	}
 
@@ -93,23 +99,33 @@ LWMessage *LWMessageCreate(uint8_t aMessageID, LWArgument *aArguments, ...)
 
 LWMessage *LWMessageCreate2(uint8_t aMessageID, size_t aArgumentCount, LWArgument **aArguments)
 {
+	return LWMessageCreateWithAllocator(aMessageID, aArgumentCount, aArguments, NULL);
+}
+
+LWMessage *LWMessageCreateWithAllocator(uint8_t aMessageID, size_t aArgumentCount, LWArgument **aArguments, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
 	// allocate message
-	LWMessage *message = malloc(sizeof(LWMessage));
+	LWMessage *message = LWAllocatorAllocate(allocator, sizeof(LWMessage));
 	if(!message)
 		return NULL;
+	message->allocator = allocator;
 
 	// set arguments count
 	message->argumentCount = aArgumentCount;
 
 	// set message id
 	message->messageID = aMessageID;
+	message->retainCount = 1;
 
 	// allocate arguments
-	message->arguments = malloc(aArgumentCount*sizeof(LWArgument *));
+	message->arguments = LWAllocatorAllocate(allocator, aArgumentCount*sizeof(LWArgument *));
 	message->argumentCapacity = aArgumentCount;
 	if(!message->arguments)
 	{
-		free(message);
+		LWAllocatorFree(allocator, message);
 		return NULL;
 	}
 
@@ -121,18 +137,37 @@ LWMessage *LWMessageCreate2(uint8_t aMessageID, size_t aArgumentCount, LWArgumen
 }
 
 #pragma mark -
-#pragma mark Deleting Messages
+#pragma mark Retaining And Releasing Messages
 
-void LWMessageDelete(LWMessage *aMessage)
+LWMessage *LWMessageRetain(LWMessage *aMessage)
 {
+	LW_ATOMIC_INCREMENT(&aMessage->retainCount);
+	return aMessage;
+}
+
+void LWMessageRelease(LWMessage *aMessage)
+{
+	// only delete message when the last reference is gone
+	if(0 != LW_ATOMIC_DECREMENT(&aMessage->retainCount))
+		return;
+
+	// release the references this message holds on its arguments
 	for(size_t i = 0; i < aMessage->argumentCount; ++i)
 	{
 		if(aMessage->arguments[i]->isRetainable)
-			LWArgumentDelete(aMessage->arguments[i]);
+			LWArgumentRelease(aMessage->arguments[i]);
 	}
 	if(aMessage->arguments)
-		free(aMessage->arguments);
-	free(aMessage);
+		LWAllocatorFree(aMessage->allocator, aMessage->arguments);
+	LWAllocatorFree(aMessage->allocator, aMessage);
+}
+
+#pragma mark -
+#pragma mark Deleting Messages
+
+void LWMessageDelete(LWMessage *aMessage)
+{
+	LWMessageRelease(aMessage);
 }
 
 #pragma mark -
@@ -145,12 +180,12 @@ void LWMessageAddArgument(LWMessage *aMessage, LWArgument *aArgument)
 	{
 		aMessage->argumentCapacity = 5;
 		aMessage->argumentCount = 0;
-		aMessage->arguments = malloc(aMessage->argumentCapacity*sizeof(LWArgument *));
+		aMessage->arguments = LWAllocatorAllocate(aMessage->allocator, aMessage->argumentCapacity*sizeof(LWArgument *));
 	}
 	// Double array capacity if necessary
 	else if(aMessage->argumentCapacity == aMessage->argumentCount)
 	{
-		LWArgument **newArguments = realloc(aMessage->arguments, sizeof(LWArgument *)*aMessage->argumentCapacity*2);
+		LWArgument **newArguments = LWAllocatorReallocate(aMessage->allocator, aMessage->arguments, sizeof(LWArgument *)*aMessage->argumentCapacity*2);
 		if(!newArguments)
 			return;
 
@@ -163,10 +198,39 @@ void LWMessageAddArgument(LWMessage *aMessage, LWArgument *aArgument)
 	++aMessage->argumentCount;
 }
 
+#pragma mark -
+#pragma mark Compressing Arguments
+
+bool LWMessageCompressArguments(LWMessage *aMessage, size_t aThreshold)
+{
+	for(size_t i = 0; i < aMessage->argumentCount; ++i)
+	{
+		if(!LWArgumentCompress(aMessage->arguments[i], aThreshold))
+			return false;
+	}
+
+	return true;
+}
+
 #pragma mark -
 #pragma mark Serializing And Deserializing Messages
 
-bool LWMessageSerialize(LWMessage *aMessage, size_t *aLength, void **aSerializedMessage)
+static inline void LWMessageCopyData(void *aDestination, const void *aSource, size_t aLength, uint32_t *aChecksum)
+{
+	// checksum data while copying it, so that it is only touched once
+	if(aChecksum)
+		*aChecksum = LWChecksumCopy(*aChecksum, aDestination, aSource, aLength);
+	else
+		memcpy(aDestination, aSource, aLength);
+}
+
+static inline void LWMessageChecksumData(const void *aData, size_t aLength, uint32_t *aChecksum)
+{
+	if(aChecksum)
+		*aChecksum = LWChecksumUpdate(*aChecksum, aData, aLength);
+}
+
+size_t LWMessageGetSerializedLength(LWMessage *aMessage)
 {
 	// calculate serialized message length
 	size_t length = 1 + 1;
@@ -176,13 +240,18 @@ bool LWMessageSerialize(LWMessage *aMessage, size_t *aLength, void **aSerialized
 		length += argument->length/255 + argument->length + 1;
 	}
 
-	// allocate buffer
-	*aSerializedMessage = malloc(length*sizeof(uint8_t));
-	if(!*aSerializedMessage)
-		return false;
+	return length;
+}
+
+static size_t LWMessageSerializeIntoBufferVersion1(LWMessage *aMessage, void *aBuffer, uint32_t *aChecksum)
+{
+	LW_TRACE_START(serialize, traceStartTime, aMessage->messageID);
+
+	uint8_t *buffer = aBuffer;
 
 	// serialize message
-	((uint8_t *)*aSerializedMessage)[0] = aMessage->messageID;
+	buffer[0] = aMessage->messageID;
+	LWMessageChecksumData(buffer, 1, aChecksum);
 	size_t nextArgumentIndex = 1;
 	for(size_t i = 0; i < aMessage->argumentCount; ++i)
 	{
@@ -191,14 +260,15 @@ bool LWMessageSerialize(LWMessage *aMessage, size_t *aLength, void **aSerialized
 		// serialize argument
 		ssize_t		remainingLength		= argument->length;
 		uint8_t		*remainingData		= argument->data;
-		uint8_t		*serializedArgument	= *aSerializedMessage + nextArgumentIndex;
+		uint8_t		*serializedArgument	= buffer + nextArgumentIndex;
 		size_t		position = 0;
 		while(remainingLength >= 0)
 		{
 			size_t subLength = (remainingLength > 255 ? 255 : remainingLength);
 			serializedArgument[position] = subLength;
+			LWMessageChecksumData(serializedArgument + position, 1, aChecksum);
 			if(0 != subLength)
-				memcpy(serializedArgument + position + 1, remainingData, subLength);
+				LWMessageCopyData(serializedArgument + position + 1, remainingData, subLength, aChecksum);
 			position		+= 1 + subLength;
 			remainingData	+= subLength;
 			remainingLength	-= 255;
@@ -208,7 +278,31 @@ bool LWMessageSerialize(LWMessage *aMessage, size_t *aLength, void **aSerialized
 		size_t serializedArgumentLength = argument->length/255 + argument->length + 1;
 		nextArgumentIndex += serializedArgumentLength;
 	}
-	((uint8_t *)*aSerializedMessage)[length-1] = 0;
+	buffer[nextArgumentIndex] = 0;
+	LWMessageChecksumData(buffer + nextArgumentIndex, 1, aChecksum);
+
+	LW_TRACE_DONE(serialize, kLWTraceEventSerialize, traceStartTime, aMessage->messageID, nextArgumentIndex + 1);
+
+	return nextArgumentIndex + 1;
+}
+
+size_t LWMessageSerializeIntoBuffer(LWMessage *aMessage, void *aBuffer)
+{
+	return LWMessageSerializeIntoBufferVersion1(aMessage, aBuffer, NULL);
+}
+
+bool LWMessageSerialize(LWMessage *aMessage, size_t *aLength, void **aSerializedMessage)
+{
+	// calculate serialized message length
+	size_t length = LWMessageGetSerializedLength(aMessage);
+
+	// allocate buffer
+	*aSerializedMessage = LWAllocatorAllocate(NULL, length*sizeof(uint8_t));
+	if(!*aSerializedMessage)
+		return false;
+
+	// serialize message
+	LWMessageSerializeIntoBuffer(aMessage, *aSerializedMessage);
 
 	// set length
 	*aLength = length;
@@ -216,7 +310,47 @@ bool LWMessageSerialize(LWMessage *aMessage, size_t *aLength, void **aSerialized
 	return true;
 }
 
+bool LWMessageGetFrameLength(void *aData, size_t aLength, size_t *aFrameLength)
+{
+	uint8_t	*data = (uint8_t *)aData;
+
+	// initialize frame length
+	*aFrameLength = 0;
+
+	// ignore small messages
+	if(aLength < 2)
+		return false;
+
+	// skip over arguments without copying them
+	size_t	pos								= 1;
+	bool	previousArgumentWasIncomplete	= false;
+	while(true)
+	{
+		// check bounds
+		if(pos >= aLength)
+			return false;
+
+		// at end of message
+		if(0 == data[pos] && !previousArgumentWasIncomplete)
+			break;
+
+		// move to next argument index
+		previousArgumentWasIncomplete = (255 == data[pos]);
+		pos += 1ul + data[pos];
+	}
+
+	// set frame length
+	*aFrameLength = pos + 1;
+
+	return true;
+}
+
 LWMessage *LWMessageDeserialize(void *aData, size_t aLength, size_t *aBytesUsed)
+{
+	return LWMessageDeserializeWithAllocator(aData, aLength, aBytesUsed, NULL);
+}
+
+static LWMessage *LWMessageDeserializeVersion1WithAllocator(void *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator, uint32_t *aChecksum)
 {
 	size_t	pos;
 	uint8_t	*data = (uint8_t *)aData;
@@ -255,12 +389,22 @@ LWMessage *LWMessageDeserialize(void *aData, size_t aLength, size_t *aBytesUsed)
 		pos += 1ul + data[pos];
 	}
 
+	// trace complete frames only, so that every start has a done
+	LW_TRACE_START(deserialize, traceStartTime, aLength);
+
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
 	// allocate arguments
-	LWArgument **arguments = malloc(argumentCount*sizeof(LWArgument *));
+	LWArgument **arguments = LWAllocatorAllocate(allocator, argumentCount*sizeof(LWArgument *));
 	if(!arguments)
+	{
+		LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, data[0], 0);
 		return NULL;
+	}
 
 	// copy arguments
+	LWMessageChecksumData(data, 1, aChecksum);
 	pos						= 1;
 	size_t	currentArgument	= 0;
 	while(pos < aLength)
@@ -289,48 +433,623 @@ LWMessage *LWMessageDeserialize(void *aData, size_t aLength, size_t *aBytesUsed)
 		uint8_t	remainingBytes			= argumentLength % 255;
 
 		// create data buffer
-		void *argumentData = malloc((argumentLength+1)*sizeof(uint8_t));
+		void *argumentData = LWAllocatorAllocate(allocator, (argumentLength+1)*sizeof(uint8_t));
 		if(!argumentData)
 		{
-			free(arguments);
+			LWAllocatorFree(allocator, arguments);
+			LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, data[0], 0);
 			return NULL;
 		}
 
 		// copy argument data
 		for(size_t i = 0; i < fullSubArgumentCount; ++i)
 		{
-			memcpy(
+			LWMessageChecksumData(data + pos + i*256, 1, aChecksum);
+			LWMessageCopyData(
 				argumentData + i*255,
 				data + pos + 1 + i*256,
-				255
+				255,
+				aChecksum
 			);
 		}
-		memcpy(
+		LWMessageChecksumData(data + pos + fullSubArgumentCount*256, 1, aChecksum);
+		LWMessageCopyData(
 			argumentData + fullSubArgumentCount*255,
 			data + pos + 1 + fullSubArgumentCount*256,
-			remainingBytes
+			remainingBytes,
+			aChecksum
 		);
 		((uint8_t *)argumentData)[argumentLength] = 0;
 
 		// create argument
-		arguments[currentArgument] = LWArgumentCreateWithoutCopying(argumentData, argumentLength);
+		arguments[currentArgument] = LWArgumentCreateWithoutCopyingWithAllocator(argumentData, argumentLength, allocator);
 		LWArgumentSetOwnsData(arguments[currentArgument], true);
 		++currentArgument;
 
 		// move to next argument index
 		pos += serializedArgumentLength;
 	}
+	LWMessageChecksumData(data + pos, 1, aChecksum);
 
 	// create message
-	LWMessage *message = LWMessageCreate2(
+	LWMessage *message = LWMessageCreateWithAllocator(
 		data[0],
 		argumentCount,
-		arguments
+		arguments,
+		allocator
 	);
+	LWAllocatorFree(allocator, arguments);
+
+	// set bytes used
+	*aBytesUsed = pos + 1;
+
+	LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, data[0], pos + 1);
+
+	return message;
+}
+
+LWMessage *LWMessageDeserializeWithAllocator(void *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator)
+{
+	return LWMessageDeserializeVersion1WithAllocator(aData, aLength, aBytesUsed, aAllocator, NULL);
+}
+
+static LWMessage *LWMessageDeserializeVersion1InArena(void *aData, size_t aLength, size_t *aBytesUsed, LWArena *aArena, uint32_t *aChecksum)
+{
+	uint8_t	*data = (uint8_t *)aData;
+
+	// initialize number of bytes used
+	*aBytesUsed = 0;
+
+	// ignore small messages
+	if(aLength < 2)
+		return NULL;
+
+	// check message-wellformedness, count arguments and their data
+	size_t	pos								= 1;
+	bool	previousArgumentWasIncomplete	= false;
+	size_t	argumentCount					= 0;
+	size_t	argumentDataLength				= 0;
+	while(true)
+	{
+		// check bounds
+		if(pos >= aLength)
+			return NULL;
+
+		// at end of message
+		if(0 == data[pos] && !previousArgumentWasIncomplete)
+			break;
+
+		// at end of argument
+		if(255 != data[pos])
+		{
+			++argumentCount;
+			argumentDataLength += 1;
+		}
+		previousArgumentWasIncomplete = (255 == data[pos]);
+		argumentDataLength += data[pos];
+
+		// move to next argument index
+		pos += 1ul + data[pos];
+	}
+
+	// trace complete frames only, so that every start has a done
+	LW_TRACE_START(deserialize, traceStartTime, aLength);
+
+	// allocate message, arguments and their data at once
+	LWAllocator	*allocator	= LWArenaGetAllocator(aArena);
+	uint8_t		*block		= LWAllocatorAllocate(allocator, sizeof(LWMessage) + argumentCount*sizeof(LWArgument) + argumentDataLength);
+	if(!block)
+	{
+		LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, data[0], 0);
+		return NULL;
+	}
+
+	// allocate argument list separately, so that arguments can still be added
+	LWArgument **arguments = LWAllocatorAllocate(allocator, argumentCount*sizeof(LWArgument *));
+	if(!arguments)
+	{
+		LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, data[0], 0);
+		return NULL;
+	}
+
+	// initialize message
+	LWMessage *message = (LWMessage *)block;
+	message->messageID			= data[0];
+	message->argumentCapacity	= argumentCount;
+	message->argumentCount		= argumentCount;
+	message->arguments			= arguments;
+	message->retainCount		= 1;
+	message->allocator			= allocator;
+
+	// copy arguments
+	LWArgument	*argument		= (LWArgument *)(block + sizeof(LWMessage));
+	uint8_t		*argumentData	= block + sizeof(LWMessage) + argumentCount*sizeof(LWArgument);
+	LWMessageChecksumData(data, 1, aChecksum);
+	pos = 1;
+	for(size_t i = 0; i < argumentCount; ++i, ++argument)
+	{
+		// concatenate sub-arguments
+		size_t	argumentLength = 0;
+		uint8_t	subLength;
+		while(255 == (subLength = data[pos]))
+		{
+			LWMessageChecksumData(data + pos, 1, aChecksum);
+			LWMessageCopyData(argumentData + argumentLength, data + pos + 1, 255, aChecksum);
+			argumentLength	+= 255;
+			pos				+= 256;
+		}
+		LWMessageChecksumData(data + pos, 1, aChecksum);
+		LWMessageCopyData(argumentData + argumentLength, data + pos + 1, subLength, aChecksum);
+		argumentLength	+= subLength;
+		pos				+= 1ul + subLength;
+		argumentData[argumentLength] = 0;
+
+		// initialize argument
+		argument->length			= argumentLength;
+		argument->data				= argumentData;
+		argument->ownsData			= false;
+		argument->isRetainable		= true;
+		argument->retainCount		= 1;
+		argument->allocator			= allocator;
+		argument->compressedData	= NULL;
+		arguments[i]				= argument;
+
+		argumentData += argumentLength + 1;
+	}
+	LWMessageChecksumData(data + pos, 1, aChecksum);
 
 	// set bytes used
 	*aBytesUsed = pos + 1;
 
+	LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, data[0], pos + 1);
+
+	return message;
+}
+
+LWMessage *LWMessageDeserializeInArena(void *aData, size_t aLength, size_t *aBytesUsed, LWArena *aArena)
+{
+	return LWMessageDeserializeVersion1InArena(aData, aLength, aBytesUsed, aArena, NULL);
+}
+
+#pragma mark -
+#pragma mark Choosing Wire Formats
+
+// version 2 frames look like this:
+//
+//   [varint body length][message ID]([varint argument length << 1 | flags][argument data])*
+//
+// the flags bit is set for compressed arguments. like in version 1 frames,
+// arguments cannot be empty
+
+static size_t LWMessageGetBodyLengthVersion2(LWMessage *aMessage)
+{
+	size_t length = 1;
+	for(size_t i = 0; i < aMessage->argumentCount; ++i)
+	{
+		LWArgument	*argument		= aMessage->arguments[i];
+		size_t		argumentLength	= (argument->compressedData ? argument->compressedLength : argument->length);
+		if(0 == argumentLength)
+			return 0;
+		length += LWVarintGetLength((uint64_t)argumentLength << 1) + argumentLength;
+	}
+
+	return length;
+}
+
+static size_t LWMessageSerializeIntoBufferVersion2(LWMessage *aMessage, void *aBuffer, uint32_t *aChecksum)
+{
+	// messages with empty arguments cannot be serialized
+	size_t bodyLength = LWMessageGetBodyLengthVersion2(aMessage);
+	if(0 == bodyLength)
+		return 0;
+
+	LW_TRACE_START(serialize, traceStartTime, aMessage->messageID);
+
+	uint8_t *buffer = aBuffer;
+
+	// write header
+	size_t position = LWVarintWrite(buffer, bodyLength);
+	buffer[position++] = aMessage->messageID;
+	LWMessageChecksumData(buffer, position, aChecksum);
+
+	// write arguments
+	for(size_t i = 0; i < aMessage->argumentCount; ++i)
+	{
+		LWArgument	*argument		= aMessage->arguments[i];
+		size_t		varintLength;
+		if(argument->compressedData)
+		{
+			varintLength = LWVarintWrite(buffer + position, ((uint64_t)argument->compressedLength << 1) | 1);
+			LWMessageChecksumData(buffer + position, varintLength, aChecksum);
+			position += varintLength;
+			LWMessageCopyData(buffer + position, argument->compressedData, argument->compressedLength, aChecksum);
+			position += argument->compressedLength;
+		}
+		else
+		{
+			varintLength = LWVarintWrite(buffer + position, (uint64_t)argument->length << 1);
+			LWMessageChecksumData(buffer + position, varintLength, aChecksum);
+			position += varintLength;
+			LWMessageCopyData(buffer + position, argument->data, argument->length, aChecksum);
+			position += argument->length;
+		}
+	}
+
+	LW_TRACE_DONE(serialize, kLWTraceEventSerialize, traceStartTime, aMessage->messageID, position);
+
+	return position;
+}
+
+static bool LWMessageGetFrameLengthVersion2(uint8_t *aData, size_t aLength, size_t *aFrameLength, size_t *aHeaderLength)
+{
+	// initialize frame length
+	*aFrameLength = 0;
+
+	// read body length
+	uint64_t	bodyLength;
+	size_t		headerLength;
+	if(!LWVarintRead(aData, aLength, &bodyLength, &headerLength))
+		return false;
+
+	// check bounds
+	if(bodyLength > aLength - headerLength)
+		return false;
+
+	// set frame length
+	*aFrameLength	= headerLength + bodyLength;
+	*aHeaderLength	= headerLength;
+
+	return true;
+}
+
+static bool LWMessageReadArgumentVersion2(uint8_t *aData, size_t aLength, uint8_t **aArgumentData, size_t *aEncodedLength, size_t *aArgumentLength, bool *aIsCompressed, size_t *aBytesUsed)
+{
+	uint64_t	lengthAndFlags;
+	size_t		varintLength;
+	if(!LWVarintRead(aData, aLength, &lengthAndFlags, &varintLength))
+		return false;
+
+	// reject empty or overlong arguments
+	uint64_t encodedLength = lengthAndFlags >> 1;
+	if(0 == encodedLength || encodedLength > aLength - varintLength)
+		return false;
+	*aArgumentData		= aData + varintLength;
+	*aEncodedLength		= (size_t)encodedLength;
+	*aArgumentLength	= (size_t)encodedLength;
+	*aIsCompressed		= (lengthAndFlags & 1);
+	*aBytesUsed			= varintLength + (size_t)encodedLength;
+
+	// compressed arguments start with their uncompressed length
+	if(*aIsCompressed)
+	{
+		uint64_t	argumentLength;
+		size_t		prefixLength;
+		if(!LWVarintRead(*aArgumentData, *aEncodedLength, &argumentLength, &prefixLength) || prefixLength == *aEncodedLength)
+			return false;
+		*aArgumentData	+= prefixLength;
+		*aEncodedLength	-= prefixLength;
+
+		// no data decompresses to nothing, or to much more than it could describe
+		if(0 == argumentLength || argumentLength > (uint64_t)*aEncodedLength*kLWCompressionMaxRatio)
+			return false;
+		*aArgumentLength = (size_t)argumentLength;
+	}
+
+	return true;
+}
+
+static bool LWMessageCopyArgumentVersion2(uint8_t *aArgument, uint8_t *aArgumentData, size_t aEncodedLength, size_t aArgumentLength, bool aIsCompressed, uint8_t *aBuffer, uint32_t *aChecksum)
+{
+	// checksum everything up to the data
+	LWMessageChecksumData(aArgument, (size_t)(aArgumentData - aArgument), aChecksum);
+
+	// decompress directly into the argument's buffer
+	if(aIsCompressed)
+	{
+		LWMessageChecksumData(aArgumentData, aEncodedLength, aChecksum);
+		return LWCompressionDecompress(aArgumentData, aEncodedLength, aBuffer, aArgumentLength);
+	}
+
+	LWMessageCopyData(aBuffer, aArgumentData, aArgumentLength, aChecksum);
+	return true;
+}
+
+static LWMessage *LWMessageDeserializeVersion2(uint8_t *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator, LWArena *aArena, uint32_t *aChecksum)
+{
+	// initialize number of bytes used
+	*aBytesUsed = 0;
+
+	// find frame
+	size_t frameLength;
+	size_t headerLength;
+	if(!LWMessageGetFrameLengthVersion2(aData, aLength, &frameLength, &headerLength))
+		return NULL;
+
+	// skip malformed frames as a whole from here on
+	*aBytesUsed = frameLength;
+
+	// check message-wellformedness, count arguments and their data
+	if(headerLength == frameLength)
+		return NULL;
+	uint8_t	messageID			= aData[headerLength];
+	size_t	pos					= headerLength + 1;
+	size_t	argumentCount		= 0;
+	size_t	argumentDataLength	= 0;
+	while(pos < frameLength)
+	{
+		uint8_t	*argumentData;
+		size_t	encodedLength;
+		size_t	argumentLength;
+		bool	isCompressed;
+		size_t	bytesUsed;
+		if(!LWMessageReadArgumentVersion2(aData + pos, frameLength - pos, &argumentData, &encodedLength, &argumentLength, &isCompressed, &bytesUsed))
+			return NULL;
+
+		++argumentCount;
+		argumentDataLength	+= argumentLength + 1;
+		pos					+= bytesUsed;
+	}
+	LWMessageChecksumData(aData, headerLength + 1, aChecksum);
+
+	// trace well-formed frames only, so that every start has a done
+	LW_TRACE_START(deserialize, traceStartTime, aLength);
+
+	LWMessage *message;
+	if(aArena)
+	{
+		// allocate message, arguments and their data at once
+		LWAllocator	*allocator	= LWArenaGetAllocator(aArena);
+		uint8_t		*block		= LWAllocatorAllocate(allocator, sizeof(LWMessage) + argumentCount*sizeof(LWArgument) + argumentDataLength);
+		if(!block)
+		{
+			LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+			return NULL;
+		}
+
+		// allocate argument list separately, so that arguments can still be added
+		LWArgument **arguments = LWAllocatorAllocate(allocator, argumentCount*sizeof(LWArgument *));
+		if(!arguments)
+		{
+			LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+			return NULL;
+		}
+
+		// initialize message
+		message = (LWMessage *)block;
+		message->messageID			= messageID;
+		message->argumentCapacity	= argumentCount;
+		message->argumentCount		= argumentCount;
+		message->arguments			= arguments;
+		message->retainCount		= 1;
+		message->allocator			= allocator;
+
+		// copy arguments
+		LWArgument	*argument		= (LWArgument *)(block + sizeof(LWMessage));
+		uint8_t		*argumentData	= block + sizeof(LWMessage) + argumentCount*sizeof(LWArgument);
+		pos = headerLength + 1;
+		for(size_t i = 0; i < argumentCount; ++i, ++argument)
+		{
+			uint8_t	*encodedData;
+			size_t	encodedLength;
+			size_t	argumentLength;
+			bool	isCompressed;
+			size_t	bytesUsed;
+			LWMessageReadArgumentVersion2(aData + pos, frameLength - pos, &encodedData, &encodedLength, &argumentLength, &isCompressed, &bytesUsed);
+			if(!LWMessageCopyArgumentVersion2(aData + pos, encodedData, encodedLength, argumentLength, isCompressed, argumentData, aChecksum))
+			{
+				LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+				return NULL;
+			}
+			argumentData[argumentLength] = 0;
+			pos += bytesUsed;
+
+			// initialize argument
+			argument->length			= argumentLength;
+			argument->data				= argumentData;
+			argument->ownsData			= false;
+			argument->isRetainable		= true;
+			argument->retainCount		= 1;
+			argument->allocator			= allocator;
+			argument->compressedData	= NULL;
+			arguments[i]				= argument;
+
+			argumentData += argumentLength + 1;
+		}
+	}
+	else
+	{
+		// find allocator
+		LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+		// allocate message
+		message = LWAllocatorAllocate(allocator, sizeof(LWMessage));
+		if(!message)
+		{
+			LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+			return NULL;
+		}
+		message->messageID			= messageID;
+		message->argumentCapacity	= argumentCount;
+		message->argumentCount		= 0;
+		message->retainCount		= 1;
+		message->allocator			= allocator;
+
+		// allocate arguments
+		message->arguments = LWAllocatorAllocate(allocator, argumentCount*sizeof(LWArgument *));
+		if(!message->arguments)
+		{
+			LWAllocatorFree(allocator, message);
+			LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+			return NULL;
+		}
+
+		// copy arguments
+		pos = headerLength + 1;
+		for(size_t i = 0; i < argumentCount; ++i)
+		{
+			uint8_t	*encodedData;
+			size_t	encodedLength;
+			size_t	argumentLength;
+			bool	isCompressed;
+			size_t	bytesUsed;
+			LWMessageReadArgumentVersion2(aData + pos, frameLength - pos, &encodedData, &encodedLength, &argumentLength, &isCompressed, &bytesUsed);
+
+			// copy or decompress data
+			uint8_t *argumentData = LWAllocatorAllocate(allocator, argumentLength + 1);
+			if(!argumentData)
+			{
+				LWMessageRelease(message);
+				LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+				return NULL;
+			}
+			if(!LWMessageCopyArgumentVersion2(aData + pos, encodedData, encodedLength, argumentLength, isCompressed, argumentData, aChecksum))
+			{
+				LWAllocatorFree(allocator, argumentData);
+				LWMessageRelease(message);
+				LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+				return NULL;
+			}
+			argumentData[argumentLength] = 0;
+
+			// create argument owning the data
+			LWArgument *argument = LWArgumentCreateWithoutCopyingWithAllocator(argumentData, argumentLength, allocator);
+			if(!argument)
+			{
+				LWAllocatorFree(allocator, argumentData);
+				LWMessageRelease(message);
+				LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, 0);
+				return NULL;
+			}
+			LWArgumentSetOwnsData(argument, true);
+			message->arguments[message->argumentCount++] = argument;
+
+			pos += bytesUsed;
+		}
+	}
+
+	LW_TRACE_DONE(deserialize, kLWTraceEventDeserialize, traceStartTime, messageID, frameLength);
+
+	return message;
+}
+
+size_t LWMessageGetSerializedLengthWithWireFormat(LWMessage *aMessage, uint8_t aWireFormat)
+{
+	if(kLWWireFormatVersion2 != aWireFormat)
+		return LWMessageGetSerializedLength(aMessage);
+
+	// messages with empty arguments cannot be serialized
+	size_t bodyLength = LWMessageGetBodyLengthVersion2(aMessage);
+	if(0 == bodyLength)
+		return 0;
+
+	return LWVarintGetLength(bodyLength) + bodyLength;
+}
+
+size_t LWMessageSerializeIntoBufferWithWireFormat(LWMessage *aMessage, void *aBuffer, uint8_t aWireFormat)
+{
+	if(kLWWireFormatVersion2 != aWireFormat)
+		return LWMessageSerializeIntoBuffer(aMessage, aBuffer);
+
+	return LWMessageSerializeIntoBufferVersion2(aMessage, aBuffer, NULL);
+}
+
+bool LWMessageSerializeWithWireFormat(LWMessage *aMessage, size_t *aLength, void **aSerializedMessage, uint8_t aWireFormat)
+{
+	// calculate serialized message length
+	size_t length = LWMessageGetSerializedLengthWithWireFormat(aMessage, aWireFormat);
+	if(0 == length)
+		return false;
+
+	// allocate buffer
+	*aSerializedMessage = LWAllocatorAllocate(NULL, length*sizeof(uint8_t));
+	if(!*aSerializedMessage)
+		return false;
+
+	// serialize message
+	LWMessageSerializeIntoBufferWithWireFormat(aMessage, *aSerializedMessage, aWireFormat);
+
+	// set length
+	*aLength = length;
+
+	return true;
+}
+
+bool LWMessageGetFrameLengthWithWireFormat(void *aData, size_t aLength, size_t *aFrameLength, uint8_t aWireFormat)
+{
+	if(kLWWireFormatVersion2 != aWireFormat)
+		return LWMessageGetFrameLength(aData, aLength, aFrameLength);
+
+	size_t headerLength;
+	return LWMessageGetFrameLengthVersion2(aData, aLength, aFrameLength, &headerLength);
+}
+
+LWMessage *LWMessageDeserializeWithWireFormat(void *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator, uint8_t aWireFormat)
+{
+	if(kLWWireFormatVersion2 != aWireFormat)
+		return LWMessageDeserializeWithAllocator(aData, aLength, aBytesUsed, aAllocator);
+
+	return LWMessageDeserializeVersion2(aData, aLength, aBytesUsed, aAllocator, NULL, NULL);
+}
+
+LWMessage *LWMessageDeserializeInArenaWithWireFormat(void *aData, size_t aLength, size_t *aBytesUsed, LWArena *aArena, uint8_t aWireFormat)
+{
+	if(kLWWireFormatVersion2 != aWireFormat)
+		return LWMessageDeserializeInArena(aData, aLength, aBytesUsed, aArena);
+
+	return LWMessageDeserializeVersion2(aData, aLength, aBytesUsed, NULL, aArena, NULL);
+}
+
+#pragma mark -
+#pragma mark Checksumming Frames
+
+size_t LWMessageSerializeIntoBufferWithChecksum(LWMessage *aMessage, void *aBuffer, uint8_t aWireFormat)
+{
+	// checksum frame while serializing it
+	uint32_t	checksum = 0;
+	size_t		length;
+	if(kLWWireFormatVersion2 != aWireFormat)
+		length = LWMessageSerializeIntoBufferVersion1(aMessage, aBuffer, &checksum);
+	else
+		length = LWMessageSerializeIntoBufferVersion2(aMessage, aBuffer, &checksum);
+	if(0 == length)
+		return 0;
+
+	// append trailer
+	LWChecksumWrite((uint8_t *)aBuffer + length, checksum);
+
+	return length + kLWChecksumLength;
+}
+
+LWMessage *LWMessageDeserializeWithChecksum(void *aData, size_t aLength, size_t *aBytesUsed, LWAllocator *aAllocator, LWArena *aArena, uint8_t aWireFormat, bool *aIsChecksumValid)
+{
+	*aIsChecksumValid = false;
+
+	// checksum frame while deserializing it
+	uint32_t	checksum = 0;
+	LWMessage	*message;
+	if(kLWWireFormatVersion2 == aWireFormat)
+		message = LWMessageDeserializeVersion2(aData, aLength, aBytesUsed, aAllocator, aArena, &checksum);
+	else if(aArena)
+		message = LWMessageDeserializeVersion1InArena(aData, aLength, aBytesUsed, aArena, &checksum);
+	else
+		message = LWMessageDeserializeVersion1WithAllocator(aData, aLength, aBytesUsed, aAllocator, &checksum);
+
+	// wait for the trailer
+	if(0 == *aBytesUsed)
+		return message;
+	if(*aBytesUsed + kLWChecksumLength > aLength)
+	{
+		*aBytesUsed = 0;
+		if(message)
+			LWMessageDelete(message);
+		return NULL;
+	}
+
+	// check trailer
+	if(message)
+		*aIsChecksumValid = (LWChecksumRead((uint8_t *)aData + *aBytesUsed) == checksum);
+	*aBytesUsed += kLWChecksumLength;
+
 	return message;
 }
 
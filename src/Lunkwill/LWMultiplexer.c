@@ -0,0 +1,405 @@
+/*
+ * LWMultiplexer.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWBuffer.h>
+#include <Lunkwill/LWWriteQueue.h>
+#include <Lunkwill/LWMultiplexer.h>
+
+#define kLWMultiplexerInitialBufferCapacity	(256)
+#define kLWMultiplexerMaxBufferCapacity		(262144)
+#define kLWMultiplexerDefaultWindowSize		(65536)
+
+#define kLWMultiplexerCreditMessageID		(1)
+
+#pragma mark Creating Multiplexers
+
+LWMultiplexer *LWMultiplexerCreate(LWWriter *aWriter, void *aUserInfo)
+{
+	return LWMultiplexerCreateWithAllocator(aWriter, aUserInfo, NULL);
+}
+
+LWMultiplexer *LWMultiplexerCreateWithAllocator(LWWriter *aWriter, void *aUserInfo, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate multiplexer
+	LWMultiplexer *multiplexer = LWAllocatorAllocate(allocator, sizeof(LWMultiplexer));
+	if(!multiplexer)
+		return NULL;
+	multiplexer->allocator = allocator;
+
+	// allocate buffer
+	multiplexer->buffer = LWAllocatorAllocate(allocator, kLWMultiplexerInitialBufferCapacity*sizeof(uint8_t));
+	if(!multiplexer->buffer)
+	{
+		LWAllocatorFree(allocator, multiplexer);
+		return NULL;
+	}
+	multiplexer->bufferCapacity			= kLWMultiplexerInitialBufferCapacity;
+	multiplexer->availableDataLength	= 0;
+
+	// initialize channels
+	for(uint16_t i = 0; i < 256; ++i)
+		multiplexer->channels[i] = NULL;
+	multiplexer->windowSize		= kLWMultiplexerDefaultWindowSize;
+	multiplexer->nextChannelID	= 1;
+
+	// initialize multiplexer
+	multiplexer->writer					= aWriter;
+	multiplexer->userInfo				= aUserInfo;
+	multiplexer->isHandlingData			= false;
+	multiplexer->isScheduledForDeletion	= false;
+
+	return multiplexer;
+}
+
+#pragma mark -
+#pragma mark Deleting Multiplexers
+
+static void LWMultiplexerFree(LWMultiplexer *aMultiplexer)
+{
+	// delete channels
+	for(uint16_t i = 0; i < 256; ++i)
+	{
+		if(aMultiplexer->channels[i])
+			LWMultiplexerCloseChannel(aMultiplexer, (uint8_t)i);
+	}
+
+	// delete multiplexer
+	LWAllocatorFree(aMultiplexer->allocator, aMultiplexer->buffer);
+	LWAllocatorFree(aMultiplexer->allocator, aMultiplexer);
+}
+
+void LWMultiplexerDelete(LWMultiplexer *aMultiplexer)
+{
+	if(aMultiplexer->isHandlingData)
+	{
+		// schedule multiplexer for deletion
+		aMultiplexer->isScheduledForDeletion = true;
+	}
+	else
+	{
+		// delete multiplexer
+		LWMultiplexerFree(aMultiplexer);
+	}
+}
+
+#pragma mark -
+#pragma mark Managing Channels
+
+void LWMultiplexerSetWindowSize(LWMultiplexer *aMultiplexer, size_t aWindowSize)
+{
+	// set window size; both ends must use the same one
+	aMultiplexer->windowSize = aWindowSize;
+}
+
+bool LWMultiplexerOpenChannel(LWMultiplexer *aMultiplexer, uint8_t aChannelID, LWDataHandler *aDataHandler)
+{
+	// don't open control channel or channels that are open already
+	if(kLWMultiplexerControlChannelID == aChannelID || aMultiplexer->channels[aChannelID])
+		return false;
+
+	// allocate channel
+	struct _LWMultiplexerChannel *channel = LWAllocatorAllocate(aMultiplexer->allocator, sizeof(struct _LWMultiplexerChannel));
+	if(!channel)
+		return false;
+
+	// create write queue
+	channel->writeQueue = LWWriteQueueCreateWithAllocator(aMultiplexer->allocator);
+	if(!channel->writeQueue)
+	{
+		LWAllocatorFree(aMultiplexer->allocator, channel);
+		return false;
+	}
+
+	// initialize channel
+	channel->dataHandler	= aDataHandler;
+	channel->receivedLength	= 0;
+	channel->sendCredit		= (ssize_t)aMultiplexer->windowSize;
+
+	aMultiplexer->channels[aChannelID] = channel;
+
+	return true;
+}
+
+void LWMultiplexerCloseChannel(LWMultiplexer *aMultiplexer, uint8_t aChannelID)
+{
+	struct _LWMultiplexerChannel *channel = aMultiplexer->channels[aChannelID];
+	if(!channel)
+		return;
+
+	// delete channel; the data handler belongs to the caller
+	LWWriteQueueDelete(channel->writeQueue);
+	LWAllocatorFree(aMultiplexer->allocator, channel);
+
+	aMultiplexer->channels[aChannelID] = NULL;
+}
+
+#pragma mark -
+#pragma mark Sending Messages
+
+static LWBuffer *LWMultiplexerCreateFrame(LWMultiplexer *aMultiplexer, uint8_t aChannelID, LWMessage *aMessage)
+{
+	// frames are always version 1, whatever the writer's format, interning or
+	// checksum setting, because the receiving end parses them itself
+	LWBuffer *buffer = LWBufferCreateWithCapacityAndAllocator(1 + LWMessageGetSerializedLength(aMessage), aMultiplexer->allocator);
+	if(!buffer)
+		return NULL;
+	buffer->data[0]	= aChannelID;
+	buffer->length	= 1 + LWMessageSerializeIntoBuffer(aMessage, buffer->data + 1);
+
+	return buffer;
+}
+
+static bool LWMultiplexerWriteControlMessage(LWMultiplexer *aMultiplexer, LWMessage *aMessage)
+{
+	// control messages bypass flow control
+	LWBuffer *buffer = LWMultiplexerCreateFrame(aMultiplexer, kLWMultiplexerControlChannelID, aMessage);
+	if(!buffer)
+		return false;
+
+	bool success = LWWriterWriteBuffer(aMultiplexer->writer, buffer);
+	LWBufferRelease(buffer);
+
+	return success;
+}
+
+static void LWMultiplexerSchedule(LWMultiplexer *aMultiplexer)
+{
+	// hand frames to the writer one channel at a time, so that a busy channel
+	// cannot starve the others
+	uint8_t		channelID			= aMultiplexer->nextChannelID;
+	uint16_t	idleChannelCount	= 0;
+	while(idleChannelCount < 256 && LWWriterIsWritable(aMultiplexer->writer))
+	{
+		struct _LWMultiplexerChannel *channel = aMultiplexer->channels[channelID];
+		if(channel && channel->sendCredit > 0 && !LWWriteQueueIsEmpty(channel->writeQueue))
+		{
+			// move first frame from channel to writer without copying
+			LWBuffer *buffer = channel->writeQueue->buffers[channel->writeQueue->firstBufferIndex];
+			if(!LWWriterWriteBuffer(aMultiplexer->writer, buffer))
+				break;
+			channel->sendCredit -= (ssize_t)buffer->length;
+			LWWriteQueueConsume(channel->writeQueue, buffer->length);
+
+			idleChannelCount = 0;
+		}
+		else
+			++idleChannelCount;
+
+		++channelID;
+	}
+	aMultiplexer->nextChannelID = channelID;
+}
+
+bool LWMultiplexerSendMessage(LWMultiplexer *aMultiplexer, uint8_t aChannelID, LWMessage *aMessage)
+{
+	// find channel
+	struct _LWMultiplexerChannel *channel = aMultiplexer->channels[aChannelID];
+	if(!channel)
+		return false;
+
+	// create frame tagged with channel ID
+	LWBuffer *buffer = LWMultiplexerCreateFrame(aMultiplexer, aChannelID, aMessage);
+	if(!buffer)
+		return false;
+
+	// queue frame on channel
+	bool success = LWWriteQueueEnqueueBuffer(channel->writeQueue, buffer);
+	LWBufferRelease(buffer);
+	if(!success)
+		return false;
+
+	// pass it on to the writer if possible
+	LWMultiplexerSchedule(aMultiplexer);
+
+	return true;
+}
+
+bool LWMultiplexerFlush(LWMultiplexer *aMultiplexer)
+{
+	// send as much as possible, then refill writer
+	LWMultiplexerSchedule(aMultiplexer);
+	bool success = LWWriterFlush(aMultiplexer->writer);
+	LWMultiplexerSchedule(aMultiplexer);
+
+	return success;
+}
+
+#pragma mark -
+#pragma mark Handling Data
+
+static void LWMultiplexerHandleControlFrame(LWMultiplexer *aMultiplexer, uint8_t *aFrame, size_t aFrameLength)
+{
+	// get control message
+	size_t bytesUsed;
+	LWMessage *message = LWMessageDeserialize(aFrame, aFrameLength, &bytesUsed);
+	if(!message)
+		return;
+
+	// add credit to channel
+	if(kLWMultiplexerCreditMessageID == message->messageID && LWMessageIsValid(message, 2, 1, 4))
+	{
+		uint8_t		channelID	= LWArgumentGet8BitUnsignedIntegerValue(message->arguments[0]);
+		uint32_t	credit		= LWArgumentGet32BitUnsignedIntegerValue(message->arguments[1]);
+		if(aMultiplexer->channels[channelID])
+			aMultiplexer->channels[channelID]->sendCredit += credit;
+	}
+
+	LWMessageDelete(message);
+}
+
+static void LWMultiplexerHandleChannelFrame(LWMultiplexer *aMultiplexer, uint8_t aChannelID, uint8_t *aFrame, size_t aFrameLength)
+{
+	// frames are complete, so the data handler does not need to buffer them
+	size_t bytesUsed;
+	LWDataHandler *dataHandler = aMultiplexer->channels[aChannelID]->dataHandler;
+	if(!LWDataHandlerHandleDataInPlace(dataHandler, aFrame, aFrameLength, &bytesUsed))
+		LWDataHandlerHandleData(dataHandler, aFrame, aFrameLength);
+
+	// channel may have been closed by a callback
+	struct _LWMultiplexerChannel *channel = aMultiplexer->channels[aChannelID];
+	if(!channel)
+		return;
+
+	// give credit back once half the window has been used up
+	channel->receivedLength += 1 + aFrameLength;
+	if(channel->receivedLength >= aMultiplexer->windowSize/2)
+	{
+		LWMessage *message = LWMessageCreate(
+			kLWMultiplexerCreditMessageID,
+			LWArgumentCreateFrom8BitUnsignedInteger(aChannelID),
+			LWArgumentCreateFrom32BitUnsignedInteger((uint32_t)channel->receivedLength),
+			NULL
+		);
+		if(message && LWMultiplexerWriteControlMessage(aMultiplexer, message))
+			channel->receivedLength = 0;
+		if(message)
+			LWMessageDelete(message);
+	}
+}
+
+bool LWMultiplexerHandleData(LWMultiplexer *aMultiplexer, void *aData, size_t aDataLength)
+{
+	// make sure we don't exceed the buffer limit
+	if(aMultiplexer->availableDataLength + aDataLength > kLWMultiplexerMaxBufferCapacity)
+		return false;
+
+	// resize buffer if necessary
+	if(aMultiplexer->availableDataLength + aDataLength > aMultiplexer->bufferCapacity)
+	{
+		// determine new buffer size
+		size_t newBufferCapacity = aMultiplexer->availableDataLength + aDataLength;
+		newBufferCapacity = (newBufferCapacity/1024 + 1)*1024;
+		if(newBufferCapacity > kLWMultiplexerMaxBufferCapacity)
+			newBufferCapacity = kLWMultiplexerMaxBufferCapacity;
+
+		// reallocate buffer
+		void *newBuffer = LWAllocatorReallocate(aMultiplexer->allocator, aMultiplexer->buffer, newBufferCapacity);
+		if(!newBuffer)
+			return false;
+		aMultiplexer->buffer = newBuffer;
+		aMultiplexer->bufferCapacity = newBufferCapacity;
+	}
+
+	// append data
+	memcpy(aMultiplexer->buffer + aMultiplexer->availableDataLength, aData, aDataLength);
+	aMultiplexer->availableDataLength += aDataLength;
+
+	// set handling data
+	aMultiplexer->isHandlingData = true;
+
+	// look for frames in the buffer
+	size_t totalBytesUsed = 0;
+	while(totalBytesUsed < aMultiplexer->availableDataLength)
+	{
+		// find end of frame
+		uint8_t	channelID	= aMultiplexer->buffer[totalBytesUsed];
+		uint8_t	*frame		= aMultiplexer->buffer + totalBytesUsed + 1;
+		size_t	frameLength;
+		if(!LWMessageGetFrameLength(frame, aMultiplexer->availableDataLength - totalBytesUsed - 1, &frameLength))
+			break;
+		totalBytesUsed += 1 + frameLength;
+
+		// route frame; frames for channels that are not open are dropped
+		if(kLWMultiplexerControlChannelID == channelID)
+			LWMultiplexerHandleControlFrame(aMultiplexer, frame, frameLength);
+		else if(aMultiplexer->channels[channelID])
+			LWMultiplexerHandleChannelFrame(aMultiplexer, channelID, frame, frameLength);
+
+		// check whether multiplexer is scheduled for deletion
+		if(aMultiplexer->isScheduledForDeletion)
+		{
+			LWMultiplexerFree(aMultiplexer);
+			return true;
+		}
+	}
+
+	// remove used bytes from buffer
+	memmove(aMultiplexer->buffer, aMultiplexer->buffer + totalBytesUsed, aMultiplexer->availableDataLength - totalBytesUsed);
+	aMultiplexer->availableDataLength -= totalBytesUsed;
+
+	// set not handling data
+	aMultiplexer->isHandlingData = false;
+
+	// received credit may allow more frames to be sent
+	LWMultiplexerSchedule(aMultiplexer);
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Querying Multiplexers
+
+size_t LWMultiplexerGetPendingLength(LWMultiplexer *aMultiplexer, uint8_t aChannelID)
+{
+	struct _LWMultiplexerChannel *channel = aMultiplexer->channels[aChannelID];
+	return channel ? LWWriteQueueGetPendingLength(channel->writeQueue) : 0;
+}
+
+ssize_t LWMultiplexerGetSendCredit(LWMultiplexer *aMultiplexer, uint8_t aChannelID)
+{
+	struct _LWMultiplexerChannel *channel = aMultiplexer->channels[aChannelID];
+	return channel ? channel->sendCredit : 0;
+}
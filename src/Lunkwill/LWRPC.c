@@ -0,0 +1,308 @@
+/*
+ * LWRPC.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#	include <winsock2.h>
+#else
+#	include <arpa/inet.h>
+#endif
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWRPC.h>
+
+#define kLWRPCInitialRequestCapacity	(64)
+#define kLWRPCStackArgumentCount		(16)
+
+#pragma mark Creating RPCs
+
+LWRPC *LWRPCCreate(LWWriter *aWriter)
+{
+	return LWRPCCreateWithAllocator(aWriter, NULL);
+}
+
+LWRPC *LWRPCCreateWithAllocator(LWWriter *aWriter, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate RPC
+	LWRPC *rpc = LWAllocatorAllocate(allocator, sizeof(LWRPC));
+	if(!rpc)
+		return NULL;
+	rpc->allocator = allocator;
+
+	// allocate in-flight request table
+	rpc->requests = LWAllocatorAllocateZeroed(allocator, kLWRPCInitialRequestCapacity*sizeof(struct _LWRPCRequest));
+	if(!rpc->requests)
+	{
+		LWAllocatorFree(allocator, rpc);
+		return NULL;
+	}
+	rpc->requestCapacity	= kLWRPCInitialRequestCapacity;
+	rpc->requestCount		= 0;
+	rpc->nextCorrelationID	= 1;
+
+	// initialize RPC
+	rpc->writer = aWriter;
+
+	return rpc;
+}
+
+#pragma mark -
+#pragma mark Managing In-Flight Requests
+
+static size_t LWRPCFindRequest(LWRPC *aRPC, uint32_t aCorrelationID)
+{
+	// correlation IDs are mostly sequential, so they make a good hash
+	size_t mask = aRPC->requestCapacity - 1;
+	for(size_t index = aCorrelationID & mask; aRPC->requests[index].correlationID; index = (index + 1) & mask)
+	{
+		if(aRPC->requests[index].correlationID == aCorrelationID)
+			return index;
+	}
+
+	return aRPC->requestCapacity;
+}
+
+static void LWRPCInsertRequest(struct _LWRPCRequest *aRequests, size_t aCapacity, struct _LWRPCRequest *aRequest)
+{
+	// find first free slot
+	size_t mask = aCapacity - 1;
+	size_t index = aRequest->correlationID & mask;
+	while(aRequests[index].correlationID)
+		index = (index + 1) & mask;
+
+	aRequests[index] = *aRequest;
+}
+
+static bool LWRPCGrowRequests(LWRPC *aRPC)
+{
+	// allocate larger table
+	size_t newRequestCapacity = aRPC->requestCapacity*2;
+	struct _LWRPCRequest *newRequests = LWAllocatorAllocateZeroed(aRPC->allocator, newRequestCapacity*sizeof(struct _LWRPCRequest));
+	if(!newRequests)
+		return false;
+
+	// move requests
+	for(size_t i = 0; i < aRPC->requestCapacity; ++i)
+	{
+		if(aRPC->requests[i].correlationID)
+			LWRPCInsertRequest(newRequests, newRequestCapacity, &aRPC->requests[i]);
+	}
+
+	LWAllocatorFree(aRPC->allocator, aRPC->requests);
+	aRPC->requests			= newRequests;
+	aRPC->requestCapacity	= newRequestCapacity;
+
+	return true;
+}
+
+static void LWRPCRemoveRequest(LWRPC *aRPC, size_t aIndex)
+{
+	// shift later entries of the same probe sequence back, so no tombstones are needed
+	size_t mask = aRPC->requestCapacity - 1;
+	size_t hole = aIndex;
+	for(size_t index = (aIndex + 1) & mask; aRPC->requests[index].correlationID; index = (index + 1) & mask)
+	{
+		size_t home = aRPC->requests[index].correlationID & mask;
+		if(((index - home) & mask) >= ((index - hole) & mask))
+		{
+			aRPC->requests[hole] = aRPC->requests[index];
+			hole = index;
+		}
+	}
+
+	aRPC->requests[hole].correlationID = 0;
+	--aRPC->requestCount;
+}
+
+#pragma mark -
+#pragma mark Deleting RPCs
+
+void LWRPCDelete(LWRPC *aRPC)
+{
+	// fail requests that are still in flight
+	for(size_t i = 0; i < aRPC->requestCapacity; ++i)
+	{
+		if(aRPC->requests[i].correlationID)
+			aRPC->requests[i].callback(aRPC, NULL, aRPC->requests[i].context);
+	}
+
+	// delete RPC
+	LWAllocatorFree(aRPC->allocator, aRPC->requests);
+	LWAllocatorFree(aRPC->allocator, aRPC);
+}
+
+#pragma mark -
+#pragma mark Sending Requests
+
+static bool LWRPCWriteMessage(LWWriter *aWriter, uint32_t aCorrelationID, LWMessage *aMessage)
+{
+	// build correlation ID argument
+	uint32_t			correlationID		= htonl(aCorrelationID);
+	struct _LWArgument	correlationArgument	= {
+		.length			= sizeof(uint32_t),
+		.data			= (uint8_t *)&correlationID,
+		.ownsData		= false,
+		.isRetainable	= false,
+		.retainCount	= 1
+	};
+
+	// prepend it to the message's arguments without copying them
+	size_t		argumentCount = 1 + aMessage->argumentCount;
+	LWArgument	*stackArguments[kLWRPCStackArgumentCount];
+	LWArgument	**arguments = stackArguments;
+	if(argumentCount > kLWRPCStackArgumentCount)
+	{
+		arguments = LWAllocatorAllocate(aWriter->allocator, argumentCount*sizeof(LWArgument *));
+		if(!arguments)
+			return false;
+	}
+	arguments[0] = &correlationArgument;
+	memcpy(arguments + 1, aMessage->arguments, aMessage->argumentCount*sizeof(LWArgument *));
+	struct _LWMessage message = {
+		.messageID			= aMessage->messageID,
+		.argumentCapacity	= argumentCount,
+		.argumentCount		= argumentCount,
+		.arguments			= arguments,
+		.retainCount		= 1
+	};
+
+	bool success = LWWriterWriteMessage(aWriter, &message);
+	if(arguments != stackArguments)
+		LWAllocatorFree(aWriter->allocator, arguments);
+
+	return success;
+}
+
+bool LWRPCSendRequest(LWRPC *aRPC, LWMessage *aRequest, LWRPCResponseCallback aCallback, void *aContext, uint32_t *aCorrelationID)
+{
+	// keep table at most half full
+	if(2*(aRPC->requestCount + 1) > aRPC->requestCapacity && !LWRPCGrowRequests(aRPC))
+		return false;
+
+	// pick correlation ID that is not in use
+	uint32_t correlationID;
+	do
+	{
+		correlationID = aRPC->nextCorrelationID++;
+	} while(0 == correlationID || LWRPCFindRequest(aRPC, correlationID) != aRPC->requestCapacity);
+
+	// send request
+	if(!LWRPCWriteMessage(aRPC->writer, correlationID, aRequest))
+		return false;
+
+	// remember request
+	struct _LWRPCRequest request = { correlationID, aCallback, aContext };
+	LWRPCInsertRequest(aRPC->requests, aRPC->requestCapacity, &request);
+	++aRPC->requestCount;
+
+	if(aCorrelationID)
+		*aCorrelationID = correlationID;
+
+	return true;
+}
+
+bool LWRPCCancelRequest(LWRPC *aRPC, uint32_t aCorrelationID)
+{
+	// find request
+	size_t index = LWRPCFindRequest(aRPC, aCorrelationID);
+	if(index == aRPC->requestCapacity)
+		return false;
+
+	// forget request; a late response will be ignored
+	LWRPCRemoveRequest(aRPC, index);
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Handling Responses
+
+bool LWRPCHandleResponse(LWRPC *aRPC, LWMessage *aResponse)
+{
+	// get correlation ID
+	uint32_t correlationID;
+	if(!LWRPCGetCorrelationID(aResponse, &correlationID))
+		return false;
+
+	// find request
+	size_t index = LWRPCFindRequest(aRPC, correlationID);
+	if(index == aRPC->requestCapacity)
+		return false;
+
+	// remove request before calling back, so the callback may send new requests
+	struct _LWRPCRequest request = aRPC->requests[index];
+	LWRPCRemoveRequest(aRPC, index);
+	request.callback(aRPC, aResponse, request.context);
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Sending Responses
+
+bool LWRPCWriteResponse(LWWriter *aWriter, uint32_t aCorrelationID, LWMessage *aResponse)
+{
+	return LWRPCWriteMessage(aWriter, aCorrelationID, aResponse);
+}
+
+#pragma mark -
+#pragma mark Querying RPCs
+
+bool LWRPCGetCorrelationID(LWMessage *aMessage, uint32_t *aCorrelationID)
+{
+	// correlation ID is the first argument
+	if(aMessage->argumentCount < 1 || aMessage->arguments[0]->length != sizeof(uint32_t))
+		return false;
+
+	*aCorrelationID = LWArgumentGet32BitUnsignedIntegerValue(aMessage->arguments[0]);
+
+	return true;
+}
+
+size_t LWRPCGetInFlightRequestCount(LWRPC *aRPC)
+{
+	return aRPC->requestCount;
+}
@@ -0,0 +1,412 @@
+/*
+ * LWSharedRing.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifdef __linux__
+#	define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#	include <linux/futex.h>
+#	include <sys/syscall.h>
+#endif
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWSharedRing.h>
+
+#define kLWSharedRingMagic			(0x4c575352)
+#define kLWSharedRingCacheLineSize	(64)
+
+// Header at the start of the shared region; each side writes its own cache line
+struct _LWSharedRingHeader {
+	// Layout
+	uint32_t	magic;
+	uint32_t	reserved;
+	uint64_t	capacity;
+	uint8_t		layoutPadding[kLWSharedRingCacheLineSize - 16];
+
+	// Written by producer
+	uint64_t	writePosition;
+	uint32_t	dataSignal;
+	uint32_t	isProducerWaiting;
+	uint8_t		producerPadding[kLWSharedRingCacheLineSize - 16];
+
+	// Written by consumer
+	uint64_t	readPosition;
+	uint32_t	spaceSignal;
+	uint32_t	isConsumerWaiting;
+	uint8_t		consumerPadding[kLWSharedRingCacheLineSize - 16];
+};
+
+#pragma mark Waiting And Waking
+
+#ifdef __linux__
+
+static void LWSharedRingWaitForSignal(uint32_t *aSignal, uint32_t aValue, int aTimeout)
+{
+	// sleep until woken, unless the signal has already changed
+	struct timespec timeout = { aTimeout / 1000, (aTimeout % 1000) * 1000000 };
+	syscall(SYS_futex, aSignal, FUTEX_WAIT, aValue, aTimeout < 0 ? NULL : &timeout, NULL, 0);
+}
+
+static void LWSharedRingSendSignal(uint32_t *aSignal)
+{
+	LW_ATOMIC_INCREMENT(aSignal);
+	syscall(SYS_futex, aSignal, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+#else
+
+static void LWSharedRingWaitForSignal(uint32_t *aSignal, uint32_t aValue, int aTimeout)
+{
+#pragma unused (aSignal, aValue, aTimeout)
+
+	// no futexes; poll instead
+	struct timespec timeout = { 0, 1000000 };
+	nanosleep(&timeout, NULL);
+}
+
+static void LWSharedRingSendSignal(uint32_t *aSignal)
+{
+	LW_ATOMIC_INCREMENT(aSignal);
+}
+
+#endif
+
+#pragma mark -
+#pragma mark Creating Shared Rings
+
+static int LWSharedRingCreateRegion(void)
+{
+#ifdef __linux__
+	return memfd_create("lunkwill", MFD_CLOEXEC);
+#else
+	// create a uniquely named region and unlink it right away
+	char name[64];
+	snprintf(name, sizeof(name), "/lunkwill-%ld-%ld", (long)getpid(), (long)clock());
+	int fileDescriptor = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(fileDescriptor >= 0)
+		shm_unlink(name);
+	return fileDescriptor;
+#endif
+}
+
+static LWSharedRing *LWSharedRingMap(int aFileDescriptor, size_t aCapacity, LWAllocator *aAllocator)
+{
+	size_t headerLength		= sysconf(_SC_PAGESIZE);
+	size_t mappingLength	= headerLength + 2*aCapacity;
+
+	// reserve address space
+	uint8_t *mapping = mmap(NULL, mappingLength, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(MAP_FAILED == mapping)
+		return NULL;
+
+	// map header and data, then map data a second time right behind it, so
+	// that data wrapping around the end of the ring is still contiguous
+	if(
+		MAP_FAILED == mmap(mapping, headerLength + aCapacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, aFileDescriptor, 0)
+		|| MAP_FAILED == mmap(mapping + headerLength + aCapacity, aCapacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, aFileDescriptor, headerLength)
+	)
+	{
+		munmap(mapping, mappingLength);
+		return NULL;
+	}
+
+	// allocate shared ring
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+	LWSharedRing *sharedRing = LWAllocatorAllocate(allocator, sizeof(LWSharedRing));
+	if(!sharedRing)
+	{
+		munmap(mapping, mappingLength);
+		return NULL;
+	}
+	sharedRing->allocator = allocator;
+
+	// initialize shared ring
+	sharedRing->fileDescriptor	= aFileDescriptor;
+	sharedRing->header			= (struct _LWSharedRingHeader *)mapping;
+	sharedRing->data			= mapping + headerLength;
+	sharedRing->capacity		= aCapacity;
+	sharedRing->mappingLength	= mappingLength;
+
+	return sharedRing;
+}
+
+LWSharedRing *LWSharedRingCreate(size_t aCapacity)
+{
+	return LWSharedRingCreateWithAllocator(aCapacity, NULL);
+}
+
+LWSharedRing *LWSharedRingCreateWithAllocator(size_t aCapacity, LWAllocator *aAllocator)
+{
+	// round capacity up to whole pages
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t capacity = (aCapacity + pageSize - 1) / pageSize * pageSize;
+	if(0 == capacity)
+		capacity = pageSize;
+
+	// create shared region
+	int fileDescriptor = LWSharedRingCreateRegion();
+	if(fileDescriptor < 0)
+		return NULL;
+	if(0 != ftruncate(fileDescriptor, pageSize + capacity))
+	{
+		close(fileDescriptor);
+		return NULL;
+	}
+
+	// map it
+	LWSharedRing *sharedRing = LWSharedRingMap(fileDescriptor, capacity, aAllocator);
+	if(!sharedRing)
+	{
+		close(fileDescriptor);
+		return NULL;
+	}
+
+	// initialize header; the rest of the region is zero-filled already
+	sharedRing->header->capacity	= capacity;
+	sharedRing->header->magic		= kLWSharedRingMagic;
+
+	return sharedRing;
+}
+
+LWSharedRing *LWSharedRingCreateWithFileDescriptor(int aFileDescriptor)
+{
+	return LWSharedRingCreateWithFileDescriptorAndAllocator(aFileDescriptor, NULL);
+}
+
+LWSharedRing *LWSharedRingCreateWithFileDescriptorAndAllocator(int aFileDescriptor, LWAllocator *aAllocator)
+{
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+
+	// read capacity from header
+	struct _LWSharedRingHeader *header = mmap(NULL, pageSize, PROT_READ, MAP_SHARED, aFileDescriptor, 0);
+	if(MAP_FAILED == header)
+		return NULL;
+	uint32_t	magic		= header->magic;
+	size_t		capacity	= header->capacity;
+	munmap(header, pageSize);
+
+	// make sure this is a shared ring
+	if(kLWSharedRingMagic != magic || 0 == capacity || 0 != capacity % pageSize)
+		return NULL;
+
+	return LWSharedRingMap(aFileDescriptor, capacity, aAllocator);
+}
+
+#pragma mark -
+#pragma mark Deleting Shared Rings
+
+void LWSharedRingDelete(LWSharedRing *aSharedRing)
+{
+	// unmap and close shared region
+	munmap(aSharedRing->header, aSharedRing->mappingLength);
+	close(aSharedRing->fileDescriptor);
+
+	// delete shared ring
+	LWAllocatorFree(aSharedRing->allocator, aSharedRing);
+}
+
+#pragma mark -
+#pragma mark Producing Data
+
+static uint8_t *LWSharedRingReserve(LWSharedRing *aSharedRing, size_t aLength)
+{
+	struct _LWSharedRingHeader *header = aSharedRing->header;
+
+	// check for free space
+	uint64_t writePosition	= header->writePosition;
+	uint64_t readPosition	= LW_ATOMIC_LOAD(&header->readPosition);
+	if(aSharedRing->capacity - (size_t)(writePosition - readPosition) < aLength)
+		return NULL;
+
+	return aSharedRing->data + writePosition % aSharedRing->capacity;
+}
+
+static void LWSharedRingPublish(LWSharedRing *aSharedRing, size_t aLength)
+{
+	struct _LWSharedRingHeader *header = aSharedRing->header;
+
+	// make data visible to consumer
+	LW_ATOMIC_STORE(&header->writePosition, header->writePosition + aLength);
+
+	// wake consumer if it is sleeping
+	LW_ATOMIC_FENCE();
+	if(LW_ATOMIC_LOAD(&header->isConsumerWaiting))
+		LWSharedRingSendSignal(&header->dataSignal);
+}
+
+bool LWSharedRingWriteData(LWSharedRing *aSharedRing, void *aData, size_t aLength)
+{
+	// reserve space
+	uint8_t *data = LWSharedRingReserve(aSharedRing, aLength);
+	if(!data)
+		return false;
+
+	// copy data
+	memcpy(data, aData, aLength);
+	LWSharedRingPublish(aSharedRing, aLength);
+
+	return true;
+}
+
+bool LWSharedRingWriteMessage(LWSharedRing *aSharedRing, LWMessage *aMessage)
+{
+	// reserve space
+	size_t length = LWMessageGetSerializedLength(aMessage);
+	uint8_t *data = LWSharedRingReserve(aSharedRing, length);
+	if(!data)
+		return false;
+
+	// serialize message directly into ring
+	LWMessageSerializeIntoBuffer(aMessage, data);
+	LWSharedRingPublish(aSharedRing, length);
+
+	return true;
+}
+
+bool LWSharedRingWaitForSpace(LWSharedRing *aSharedRing, size_t aLength, int aTimeout)
+{
+	struct _LWSharedRingHeader *header = aSharedRing->header;
+
+	while(true)
+	{
+		// announce that we are about to sleep
+		uint32_t signal = LW_ATOMIC_LOAD(&header->spaceSignal);
+		LW_ATOMIC_STORE(&header->isProducerWaiting, 1);
+		LW_ATOMIC_FENCE();
+
+		// check for space
+		bool hasSpace = (NULL != LWSharedRingReserve(aSharedRing, aLength));
+		if(hasSpace || 0 == aTimeout)
+		{
+			LW_ATOMIC_STORE(&header->isProducerWaiting, 0);
+			return hasSpace;
+		}
+
+		// sleep until the consumer frees up space
+		LWSharedRingWaitForSignal(&header->spaceSignal, signal, aTimeout);
+		LW_ATOMIC_STORE(&header->isProducerWaiting, 0);
+		if(aTimeout > 0)
+			return NULL != LWSharedRingReserve(aSharedRing, aLength);
+	}
+}
+
+#pragma mark -
+#pragma mark Consuming Data
+
+bool LWSharedRingHandleData(LWSharedRing *aSharedRing, LWDataHandler *aDataHandler)
+{
+	struct _LWSharedRingHeader *header = aSharedRing->header;
+
+	// check for data
+	uint64_t readPosition	= header->readPosition;
+	uint64_t writePosition	= LW_ATOMIC_LOAD(&header->writePosition);
+	if(readPosition == writePosition)
+		return true;
+
+	// handle messages straight from the ring
+	size_t bytesUsed;
+	if(!LWDataHandlerHandleDataInPlace(aDataHandler, aSharedRing->data + readPosition % aSharedRing->capacity, (size_t)(writePosition - readPosition), &bytesUsed))
+		return false;
+	if(0 == bytesUsed)
+		return true;
+
+	// give space back to producer
+	LW_ATOMIC_STORE(&header->readPosition, readPosition + bytesUsed);
+
+	// wake producer if it is sleeping
+	LW_ATOMIC_FENCE();
+	if(LW_ATOMIC_LOAD(&header->isProducerWaiting))
+		LWSharedRingSendSignal(&header->spaceSignal);
+
+	return true;
+}
+
+bool LWSharedRingWaitForData(LWSharedRing *aSharedRing, int aTimeout)
+{
+	struct _LWSharedRingHeader *header = aSharedRing->header;
+
+	while(true)
+	{
+		// announce that we are about to sleep
+		uint32_t signal = LW_ATOMIC_LOAD(&header->dataSignal);
+		LW_ATOMIC_STORE(&header->isConsumerWaiting, 1);
+		LW_ATOMIC_FENCE();
+
+		// check for data
+		bool hasData = (0 != LWSharedRingGetAvailableLength(aSharedRing));
+		if(hasData || 0 == aTimeout)
+		{
+			LW_ATOMIC_STORE(&header->isConsumerWaiting, 0);
+			return hasData;
+		}
+
+		// sleep until the producer publishes data
+		LWSharedRingWaitForSignal(&header->dataSignal, signal, aTimeout);
+		LW_ATOMIC_STORE(&header->isConsumerWaiting, 0);
+		if(aTimeout > 0)
+			return 0 != LWSharedRingGetAvailableLength(aSharedRing);
+	}
+}
+
+#pragma mark -
+#pragma mark Querying Shared Rings
+
+int LWSharedRingGetFileDescriptor(LWSharedRing *aSharedRing)
+{
+	return aSharedRing->fileDescriptor;
+}
+
+size_t LWSharedRingGetCapacity(LWSharedRing *aSharedRing)
+{
+	return aSharedRing->capacity;
+}
+
+size_t LWSharedRingGetAvailableLength(LWSharedRing *aSharedRing)
+{
+	return (size_t)(LW_ATOMIC_LOAD(&aSharedRing->header->writePosition) - LW_ATOMIC_LOAD(&aSharedRing->header->readPosition));
+}
@@ -0,0 +1,297 @@
+/*
+ * LWTimerWheel.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWTimerWheel.h>
+
+#define kLWTimerWheelSlotBits	(8)
+#define kLWTimerWheelSlotMask	(kLWTimerWheelSlotCount - 1)
+
+#pragma mark Creating Timer Wheels
+
+LWTimerWheel *LWTimerWheelCreate(uint64_t aCurrentTime)
+{
+	return LWTimerWheelCreateWithAllocator(aCurrentTime, NULL);
+}
+
+LWTimerWheel *LWTimerWheelCreateWithAllocator(uint64_t aCurrentTime, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate timer wheel
+	LWTimerWheel *timerWheel = LWAllocatorAllocate(allocator, sizeof(LWTimerWheel));
+	if(!timerWheel)
+		return NULL;
+	timerWheel->allocator = allocator;
+
+	// clear slots
+	for(uint8_t level = 0; level < kLWTimerWheelLevelCount; ++level)
+	{
+		for(uint16_t index = 0; index < kLWTimerWheelSlotCount; ++index)
+			timerWheel->slots[level][index] = NULL;
+	}
+
+	// initialize timer wheel
+	timerWheel->currentTime	= aCurrentTime;
+	timerWheel->timerCount	= 0;
+
+	return timerWheel;
+}
+
+#pragma mark -
+#pragma mark Deleting Timer Wheels
+
+void LWTimerWheelDelete(LWTimerWheel *aTimerWheel)
+{
+	// disarm remaining timers; they belong to the caller
+	for(uint8_t level = 0; level < kLWTimerWheelLevelCount; ++level)
+	{
+		for(uint16_t index = 0; index < kLWTimerWheelSlotCount; ++index)
+		{
+			for(LWTimer *timer = aTimerWheel->slots[level][index]; timer; timer = timer->next)
+			{
+				timer->timerWheel	= NULL;
+				timer->link			= NULL;
+			}
+		}
+	}
+
+	// delete timer wheel
+	LWAllocatorFree(aTimerWheel->allocator, aTimerWheel);
+}
+
+#pragma mark -
+#pragma mark Managing Slots
+
+static void LWTimerWheelInsertTimer(LWTimerWheel *aTimerWheel, LWTimer *aTimer, uint64_t aBaseTime)
+{
+	// find slot; timers that are due go into the slot for the base time
+	uint64_t	slotTime	= aTimer->expirationTime < aBaseTime ? aBaseTime : aTimer->expirationTime;
+	uint64_t	delta		= slotTime - aBaseTime;
+	uint8_t		level;
+	if(delta < (1ull << kLWTimerWheelSlotBits))
+		level = 0;
+	else if(delta < (1ull << 2*kLWTimerWheelSlotBits))
+		level = 1;
+	else if(delta < (1ull << 3*kLWTimerWheelSlotBits))
+		level = 2;
+	else
+	{
+		// timers beyond the last level are cascaded again until they are due
+		level = 3;
+		if(delta >= (1ull << 4*kLWTimerWheelSlotBits))
+			slotTime = aBaseTime + (1ull << 4*kLWTimerWheelSlotBits) - 1;
+	}
+	LWTimer **slot = &aTimerWheel->slots[level][(slotTime >> level*kLWTimerWheelSlotBits) & kLWTimerWheelSlotMask];
+
+	// prepend timer to slot
+	aTimer->next = *slot;
+	if(aTimer->next)
+		aTimer->next->link = &aTimer->next;
+	aTimer->link = slot;
+	*slot = aTimer;
+}
+
+static void LWTimerWheelRemoveTimer(LWTimer *aTimer)
+{
+	// unlink timer
+	*aTimer->link = aTimer->next;
+	if(aTimer->next)
+		aTimer->next->link = aTimer->link;
+	aTimer->next = NULL;
+	aTimer->link = NULL;
+}
+
+static void LWTimerWheelCascade(LWTimerWheel *aTimerWheel, uint8_t aLevel)
+{
+	// take timers out of slot
+	uint8_t	index	= (aTimerWheel->currentTime >> aLevel*kLWTimerWheelSlotBits) & kLWTimerWheelSlotMask;
+	LWTimer	*timer	= aTimerWheel->slots[aLevel][index];
+	aTimerWheel->slots[aLevel][index] = NULL;
+
+	// spread them over the lower levels
+	while(timer)
+	{
+		LWTimer *next = timer->next;
+		LWTimerWheelInsertTimer(aTimerWheel, timer, aTimerWheel->currentTime);
+		timer = next;
+	}
+
+	// cascade next level when this level wraps around
+	if(0 == index && aLevel + 1 < kLWTimerWheelLevelCount)
+		LWTimerWheelCascade(aTimerWheel, aLevel + 1);
+}
+
+#pragma mark -
+#pragma mark Advancing Timer Wheels
+
+size_t LWTimerWheelAdvance(LWTimerWheel *aTimerWheel, uint64_t aCurrentTime)
+{
+	size_t firedTimerCount = 0;
+
+	while(aTimerWheel->currentTime < aCurrentTime)
+	{
+		// skip ahead when there is nothing to fire
+		if(0 == aTimerWheel->timerCount)
+		{
+			aTimerWheel->currentTime = aCurrentTime;
+			break;
+		}
+
+		// move to next tick
+		++aTimerWheel->currentTime;
+		if(0 == (aTimerWheel->currentTime & kLWTimerWheelSlotMask))
+			LWTimerWheelCascade(aTimerWheel, 1);
+
+		// take expired timers out of the wheel, so that callbacks can rearm them
+		uint8_t	index			= aTimerWheel->currentTime & kLWTimerWheelSlotMask;
+		LWTimer	*expiredTimers	= aTimerWheel->slots[0][index];
+		aTimerWheel->slots[0][index] = NULL;
+		if(expiredTimers)
+			expiredTimers->link = &expiredTimers;
+
+		// fire expired timers
+		while(expiredTimers)
+		{
+			LWTimer *timer = expiredTimers;
+			LWTimerWheelRemoveTimer(timer);
+			timer->timerWheel = NULL;
+			--aTimerWheel->timerCount;
+
+			timer->callback(timer, timer->userInfo);
+			++firedTimerCount;
+		}
+	}
+
+	return firedTimerCount;
+}
+
+#pragma mark -
+#pragma mark Querying Timer Wheels
+
+uint64_t LWTimerWheelGetCurrentTime(LWTimerWheel *aTimerWheel)
+{
+	return aTimerWheel->currentTime;
+}
+
+size_t LWTimerWheelGetTimerCount(LWTimerWheel *aTimerWheel)
+{
+	return aTimerWheel->timerCount;
+}
+
+#pragma mark -
+#pragma mark Creating Timers
+
+LWTimer *LWTimerCreate(LWTimerCallback aCallback, void *aUserInfo)
+{
+	return LWTimerCreateWithAllocator(aCallback, aUserInfo, NULL);
+}
+
+LWTimer *LWTimerCreateWithAllocator(LWTimerCallback aCallback, void *aUserInfo, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate timer
+	LWTimer *timer = LWAllocatorAllocate(allocator, sizeof(LWTimer));
+	if(!timer)
+		return NULL;
+	timer->allocator = allocator;
+
+	// initialize timer
+	timer->next				= NULL;
+	timer->link				= NULL;
+	timer->timerWheel		= NULL;
+	timer->expirationTime	= 0;
+	timer->callback			= aCallback;
+	timer->userInfo			= aUserInfo;
+
+	return timer;
+}
+
+#pragma mark -
+#pragma mark Deleting Timers
+
+void LWTimerDelete(LWTimer *aTimer)
+{
+	// delete timer
+	LWTimerCancel(aTimer);
+	LWAllocatorFree(aTimer->allocator, aTimer);
+}
+
+#pragma mark -
+#pragma mark Arming Timers
+
+void LWTimerArm(LWTimer *aTimer, LWTimerWheel *aTimerWheel, uint64_t aTimeout)
+{
+	// disarm first if necessary
+	LWTimerCancel(aTimer);
+
+	// a timeout of zero fires on the next tick
+	aTimer->timerWheel		= aTimerWheel;
+	aTimer->expirationTime	= aTimerWheel->currentTime + (aTimeout ? aTimeout : 1);
+	LWTimerWheelInsertTimer(aTimerWheel, aTimer, aTimerWheel->currentTime + 1);
+	++aTimerWheel->timerCount;
+}
+
+void LWTimerCancel(LWTimer *aTimer)
+{
+	if(!aTimer->timerWheel)
+		return;
+
+	// remove timer from wheel
+	LWTimerWheelRemoveTimer(aTimer);
+	--aTimer->timerWheel->timerCount;
+	aTimer->timerWheel = NULL;
+}
+
+#pragma mark -
+#pragma mark Querying Timers
+
+bool LWTimerIsArmed(LWTimer *aTimer)
+{
+	return NULL != aTimer->timerWheel;
+}
+
+uint64_t LWTimerGetExpirationTime(LWTimer *aTimer)
+{
+	return aTimer->expirationTime;
+}
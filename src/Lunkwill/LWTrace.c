@@ -0,0 +1,85 @@
+/*
+ * LWTrace.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _POSIX_C_SOURCE (200112L)
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWTrace.h>
+
+LWTraceCallback	gLWTraceCallback;
+static void		*gLWTraceUserInfo;
+
+#pragma mark Tracing
+
+bool LWTraceIsAvailable(void)
+{
+#ifdef LW_ENABLE_TRACING
+	return true;
+#else
+	return false;
+#endif
+}
+
+void LWTraceSetCallback(LWTraceCallback aCallback, void *aUserInfo)
+{
+	// set user info first, so that it is never paired with the wrong callback
+	gLWTraceUserInfo = aUserInfo;
+	LW_ATOMIC_STORE(&gLWTraceCallback, aCallback);
+}
+
+uint64_t LWTraceGetTime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec*1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+#pragma mark -
+#pragma mark Firing Events
+
+void LWTraceFire(uint8_t aEvent, uint8_t aMessageID, size_t aLength, uint64_t aStartTime)
+{
+	// callback may have been cleared since the event started
+	LWTraceCallback callback = LW_ATOMIC_LOAD(&gLWTraceCallback);
+	if(!callback)
+		return;
+
+	callback(aEvent, aMessageID, aLength, aStartTime, LWTraceGetTime(), gLWTraceUserInfo);
+}
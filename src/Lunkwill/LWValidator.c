@@ -38,16 +38,27 @@
 #include <Lunkwill/LunkwillDefines.h>
 #include <Lunkwill/LunkwillTypes.h>
 #include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
 #include <Lunkwill/LWValidator.h>
+#include <Lunkwill/LWTrace.h>
 
 #pragma mark Creating Validators
 
 LWValidator *LWValidatorCreate()
 {
+	return LWValidatorCreateWithAllocator(NULL);
+}
+
+LWValidator *LWValidatorCreateWithAllocator(LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
 	// allocate validator
-	LWValidator *validator = malloc(sizeof(LWValidator));
+	LWValidator *validator = LWAllocatorAllocate(allocator, sizeof(LWValidator));
 	if(!validator)
 		return NULL;
+	validator->allocator = allocator;
 
 	// clear callbacks
 	for(uint16_t i = 0; i < 256; ++i)
@@ -62,7 +73,7 @@ LWValidator *LWValidatorCreate()
 void LWValidatorDelete(LWValidator *aValidator)
 {
 	// delete validator
-	free(aValidator);
+	LWAllocatorFree(aValidator->allocator, aValidator);
 }
 
 #pragma mark -
@@ -92,5 +103,9 @@ bool LWValidatorMessageIsValid(LWValidator *aValidator, LWMessage *aMessage)
 		return true;
 
 	// validate message
-	return callback(aMessage);
+	LW_TRACE_START(validate, traceStartTime, aMessage->messageID);
+	bool isValid = callback(aMessage);
+	LW_TRACE_DONE(validate, kLWTraceEventValidate, traceStartTime, aMessage->messageID, isValid);
+
+	return isValid;
 }
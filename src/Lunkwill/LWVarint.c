@@ -0,0 +1,157 @@
+/*
+ * LWVarint.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+
+// varints are little-endian base 128: seven bits per byte, high bit set on
+// all but the last byte
+
+#pragma mark Measuring Varints
+
+size_t LWVarintGetLength(uint64_t aValue)
+{
+	size_t length = 1;
+	while(aValue >= 0x80)
+	{
+		aValue >>= 7;
+		++length;
+	}
+
+	return length;
+}
+
+#pragma mark -
+#pragma mark Writing Varints
+
+size_t LWVarintWrite(uint8_t *aBuffer, uint64_t aValue)
+{
+	size_t length = 0;
+	while(aValue >= 0x80)
+	{
+		aBuffer[length++] = (uint8_t)(aValue | 0x80);
+		aValue >>= 7;
+	}
+	aBuffer[length++] = (uint8_t)aValue;
+
+	return length;
+}
+
+#pragma mark -
+#pragma mark Reading Varints
+
+static uint64_t LWVarintCompact(uint64_t aWord)
+{
+	// squeeze the seven-bit groups of up to eight little-endian bytes together,
+	// doubling the group width in each step
+	uint64_t value = aWord & 0x7f7f7f7f7f7f7f7full;
+	value = ((value & 0x7f007f007f007f00ull) >> 1) | (value & 0x007f007f007f007full);
+	value = ((value & 0x3fff00003fff0000ull) >> 2) | (value & 0x00003fff00003fffull);
+	value = ((value & 0x0fffffff00000000ull) >> 4) | (value & 0x000000000fffffffull);
+
+	return value;
+}
+
+bool LWVarintRead(uint8_t *aData, size_t aLength, uint64_t *aValue, size_t *aBytesUsed)
+{
+	// find the last byte in one go when eight bytes are available
+	if(aLength >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, aData, 8);
+		word = LW_LITTLE_ENDIAN_64(word);
+
+		uint64_t lastBytes = ~word & 0x8080808080808080ull;
+		if(lastBytes)
+		{
+			size_t length = (size_t)__builtin_ctzll(lastBytes)/8 + 1;
+			if(length < 8)
+				word &= (1ull << (8*length)) - 1;
+
+			*aValue		= LWVarintCompact(word);
+			*aBytesUsed	= length;
+			return true;
+		}
+	}
+
+	uint64_t value = 0;
+	for(size_t i = 0; i < aLength && i < kLWVarintMaxLength; ++i)
+	{
+		value |= (uint64_t)(aData[i] & 0x7f) << (7*i);
+		if(!(aData[i] & 0x80))
+		{
+			*aValue		= value;
+			*aBytesUsed	= i + 1;
+			return true;
+		}
+	}
+
+	// incomplete or too long
+	return false;
+}
+
+bool LWVarintDecode(uint8_t *aData, size_t aLength, uint64_t *aValue)
+{
+	if(0 == aLength || aLength > kLWVarintMaxLength)
+		return false;
+
+	// load the first eight bytes at most
+	uint64_t	word		= 0;
+	size_t		wordLength	= (aLength < 8 ? aLength : 8);
+	for(size_t i = 0; i < wordLength; ++i)
+		word |= (uint64_t)aData[i] << (8*i);
+
+	// all bytes but the last must have their continuation bit set
+	uint64_t continuationBits = (aLength > 8 ? 0x8080808080808080ull : 0x8080808080808080ull & ((1ull << (8*(aLength - 1))) - 1));
+	if((word & 0x8080808080808080ull) != continuationBits)
+		return false;
+
+	// remaining bytes of long varints
+	uint64_t value = LWVarintCompact(word);
+	for(size_t i = 8; i < aLength; ++i)
+	{
+		if(!(aData[i] & 0x80) != (i == aLength - 1))
+			return false;
+		value |= (uint64_t)(aData[i] & 0x7f) << (7*i);
+	}
+
+	*aValue = value;
+
+	return true;
+}
@@ -0,0 +1,288 @@
+/*
+ * LWWriteQueue.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#	include <winsock2.h>
+#else
+#	include <sys/uio.h>
+#	include <unistd.h>
+#endif
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWWriteQueue.h>
+
+#define kLWWriteQueueInitialBufferCapacity	(16)
+#define kLWWriteQueueMaxVectorCount			(64)
+
+#pragma mark Creating Write Queues
+
+LWWriteQueue *LWWriteQueueCreate(void)
+{
+	return LWWriteQueueCreateWithAllocator(NULL);
+}
+
+LWWriteQueue *LWWriteQueueCreateWithAllocator(LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate write queue
+	LWWriteQueue *writeQueue = LWAllocatorAllocate(allocator, sizeof(LWWriteQueue));
+	if(!writeQueue)
+		return NULL;
+	writeQueue->allocator = allocator;
+
+	// allocate buffers
+	writeQueue->buffers = LWAllocatorAllocate(allocator, kLWWriteQueueInitialBufferCapacity*sizeof(LWBuffer *));
+	if(!writeQueue->buffers)
+	{
+		LWAllocatorFree(allocator, writeQueue);
+		return NULL;
+	}
+	writeQueue->bufferCapacity		= kLWWriteQueueInitialBufferCapacity;
+	writeQueue->firstBufferIndex	= 0;
+	writeQueue->bufferCount			= 0;
+
+	// initialize progress
+	writeQueue->firstBufferOffset	= 0;
+	writeQueue->pendingLength		= 0;
+
+	return writeQueue;
+}
+
+#pragma mark -
+#pragma mark Deleting Write Queues
+
+void LWWriteQueueDelete(LWWriteQueue *aWriteQueue)
+{
+	// release unsent buffers
+	for(size_t i = 0; i < aWriteQueue->bufferCount; ++i)
+		LWBufferRelease(aWriteQueue->buffers[(aWriteQueue->firstBufferIndex + i) % aWriteQueue->bufferCapacity]);
+
+	// delete write queue
+	LWAllocatorFree(aWriteQueue->allocator, aWriteQueue->buffers);
+	LWAllocatorFree(aWriteQueue->allocator, aWriteQueue);
+}
+
+#pragma mark -
+#pragma mark Enqueueing Data
+
+static bool LWWriteQueueGrow(LWWriteQueue *aWriteQueue)
+{
+	// allocate new buffers
+	size_t newBufferCapacity = aWriteQueue->bufferCapacity*2;
+	LWBuffer **newBuffers = LWAllocatorAllocate(aWriteQueue->allocator, newBufferCapacity*sizeof(LWBuffer *));
+	if(!newBuffers)
+		return false;
+
+	// move buffers, unwrapping them in the process
+	for(size_t i = 0; i < aWriteQueue->bufferCount; ++i)
+		newBuffers[i] = aWriteQueue->buffers[(aWriteQueue->firstBufferIndex + i) % aWriteQueue->bufferCapacity];
+
+	LWAllocatorFree(aWriteQueue->allocator, aWriteQueue->buffers);
+	aWriteQueue->buffers			= newBuffers;
+	aWriteQueue->bufferCapacity		= newBufferCapacity;
+	aWriteQueue->firstBufferIndex	= 0;
+
+	return true;
+}
+
+bool LWWriteQueueEnqueueBuffer(LWWriteQueue *aWriteQueue, LWBuffer *aBuffer)
+{
+	// nothing to do for empty buffers
+	if(0 == aBuffer->length)
+		return true;
+
+	// make room if necessary
+	if(aWriteQueue->bufferCount == aWriteQueue->bufferCapacity && !LWWriteQueueGrow(aWriteQueue))
+		return false;
+
+	// append buffer
+	size_t index = (aWriteQueue->firstBufferIndex + aWriteQueue->bufferCount) % aWriteQueue->bufferCapacity;
+	aWriteQueue->buffers[index] = LWBufferRetain(aBuffer);
+	++aWriteQueue->bufferCount;
+	aWriteQueue->pendingLength += aBuffer->length;
+
+	return true;
+}
+
+bool LWWriteQueueEnqueueMessage(LWWriteQueue *aWriteQueue, LWMessage *aMessage)
+{
+	// serialize message
+	LWBuffer *buffer = LWBufferCreateFromMessageWithWireFormatAndAllocator(aMessage, kLWWireFormatVersion1, aWriteQueue->allocator);
+	if(!buffer)
+		return false;
+
+	// enqueue it
+	bool success = LWWriteQueueEnqueueBuffer(aWriteQueue, buffer);
+	LWBufferRelease(buffer);
+
+	return success;
+}
+
+bool LWWriteQueueBroadcastMessage(LWMessage *aMessage, LWWriteQueue **aWriteQueues, size_t aWriteQueueCount)
+{
+	// serialize message only once, with the first queue's allocator
+	LWAllocator *allocator = (aWriteQueueCount > 0 ? aWriteQueues[0]->allocator : NULL);
+	LWBuffer *buffer = LWBufferCreateFromMessageWithWireFormatAndAllocator(aMessage, kLWWireFormatVersion1, allocator);
+	if(!buffer)
+		return false;
+
+	// share buffer between all queues
+	bool success = true;
+	for(size_t i = 0; i < aWriteQueueCount; ++i)
+	{
+		if(!LWWriteQueueEnqueueBuffer(aWriteQueues[i], buffer))
+			success = false;
+	}
+
+	// the last queue to send the buffer will delete it
+	LWBufferRelease(buffer);
+
+	return success;
+}
+
+#pragma mark -
+#pragma mark Writing Data
+
+void *LWWriteQueuePeek(LWWriteQueue *aWriteQueue, size_t *aLength)
+{
+	// check whether there is anything to write
+	if(0 == aWriteQueue->bufferCount)
+	{
+		*aLength = 0;
+		return NULL;
+	}
+
+	// get unsent part of first buffer
+	LWBuffer *buffer = aWriteQueue->buffers[aWriteQueue->firstBufferIndex];
+	*aLength = buffer->length - aWriteQueue->firstBufferOffset;
+	return buffer->data + aWriteQueue->firstBufferOffset;
+}
+
+void LWWriteQueueConsume(LWWriteQueue *aWriteQueue, size_t aLength)
+{
+	while(aLength > 0 && aWriteQueue->bufferCount > 0)
+	{
+		LWBuffer	*buffer				= aWriteQueue->buffers[aWriteQueue->firstBufferIndex];
+		size_t		remainingLength		= buffer->length - aWriteQueue->firstBufferOffset;
+
+		// first buffer only partially consumed
+		if(aLength < remainingLength)
+		{
+			aWriteQueue->firstBufferOffset	+= aLength;
+			aWriteQueue->pendingLength		-= aLength;
+			break;
+		}
+
+		// first buffer completely consumed
+		aLength							-= remainingLength;
+		aWriteQueue->pendingLength		-= remainingLength;
+		aWriteQueue->firstBufferIndex	= (aWriteQueue->firstBufferIndex + 1) % aWriteQueue->bufferCapacity;
+		aWriteQueue->firstBufferOffset	= 0;
+		--aWriteQueue->bufferCount;
+		LWBufferRelease(buffer);
+	}
+}
+
+bool LWWriteQueueWriteToFileDescriptor(LWWriteQueue *aWriteQueue, int aFileDescriptor)
+{
+	while(aWriteQueue->bufferCount > 0)
+	{
+#ifdef WIN32
+		// write first buffer
+		size_t	length;
+		void	*data			= LWWriteQueuePeek(aWriteQueue, &length);
+		int		bytesWritten	= send(aFileDescriptor, data, (int)length, 0);
+		if(bytesWritten < 0)
+			return WSAEWOULDBLOCK == WSAGetLastError();
+#else
+		// gather as many buffers as possible
+		struct iovec	vectors[kLWWriteQueueMaxVectorCount];
+		int				vectorCount	= 0;
+		size_t			length		= 0;
+		for(size_t i = 0; i < aWriteQueue->bufferCount && vectorCount < kLWWriteQueueMaxVectorCount; ++i)
+		{
+			LWBuffer	*buffer	= aWriteQueue->buffers[(aWriteQueue->firstBufferIndex + i) % aWriteQueue->bufferCapacity];
+			size_t		offset	= (0 == i ? aWriteQueue->firstBufferOffset : 0);
+
+			vectors[vectorCount].iov_base	= buffer->data + offset;
+			vectors[vectorCount].iov_len	= buffer->length - offset;
+			length += buffer->length - offset;
+			++vectorCount;
+		}
+
+		// write them in one go
+		ssize_t bytesWritten = writev(aFileDescriptor, vectors, vectorCount);
+		if(bytesWritten < 0)
+		{
+			if(EINTR == errno)
+				continue;
+
+			// a full socket buffer is not an error
+			return EAGAIN == errno || EWOULDBLOCK == errno;
+		}
+#endif
+
+		// drop sent data, releasing sent buffers
+		LWWriteQueueConsume(aWriteQueue, (size_t)bytesWritten);
+
+		// stop after a partial write; the file descriptor will not take more
+		if((size_t)bytesWritten < length)
+			break;
+	}
+
+	return true;
+}
+
+#pragma mark -
+#pragma mark Querying Write Queues
+
+bool LWWriteQueueIsEmpty(LWWriteQueue *aWriteQueue)
+{
+	return 0 == aWriteQueue->bufferCount;
+}
+
+size_t LWWriteQueueGetPendingLength(LWWriteQueue *aWriteQueue)
+{
+	return aWriteQueue->pendingLength;
+}
@@ -0,0 +1,484 @@
+/*
+ * LWWriter.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillDefines.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWInternTable.h>
+#include <Lunkwill/LWWriter.h>
+
+#define kLWWriterBufferCapacity			(16384)
+#define kLWWriterDefaultLowWatermark	(16384)
+#define kLWWriterDefaultHighWatermark	(65536)
+
+#pragma mark Creating Writers
+
+LWWriter *LWWriterCreate(int aFileDescriptor, void *aUserInfo)
+{
+	return LWWriterCreateWithAllocator(aFileDescriptor, aUserInfo, NULL);
+}
+
+LWWriter *LWWriterCreateWithAllocator(int aFileDescriptor, void *aUserInfo, LWAllocator *aAllocator)
+{
+	// find allocator
+	LWAllocator *allocator = (aAllocator ? aAllocator : LWAllocatorGetDefault());
+
+	// allocate writer
+	LWWriter *writer = LWAllocatorAllocate(allocator, sizeof(LWWriter));
+	if(!writer)
+		return NULL;
+	writer->allocator = allocator;
+
+	// create write queue
+	writer->writeQueue = LWWriteQueueCreateWithAllocator(allocator);
+	if(!writer->writeQueue)
+	{
+		LWAllocatorFree(allocator, writer);
+		return NULL;
+	}
+	writer->fileDescriptor = aFileDescriptor;
+
+	// initialize writer
+	writer->tailBuffer			= NULL;
+	writer->lowWatermark		= kLWWriterDefaultLowWatermark;
+	writer->highWatermark		= kLWWriterDefaultHighWatermark;
+	writer->isWritable			= true;
+	writer->writabilityCallback	= NULL;
+	writer->wireFormat			= kLWWireFormatVersion1;
+	writer->internTable			= NULL;
+	writer->isChecksumEnabled	= false;
+
+	// set user info
+	writer->userInfo = aUserInfo;
+
+	return writer;
+}
+
+#pragma mark -
+#pragma mark Deleting Writers
+
+void LWWriterDelete(LWWriter *aWriter)
+{
+	// delete write queue and tail buffer
+	LWWriteQueueDelete(aWriter->writeQueue);
+	if(aWriter->tailBuffer)
+		LWBufferRelease(aWriter->tailBuffer);
+
+	// delete writer
+	LWAllocatorFree(aWriter->allocator, aWriter);
+}
+
+#pragma mark -
+#pragma mark Setting Backpressure Options
+
+void LWWriterSetWatermarks(LWWriter *aWriter, size_t aLowWatermark, size_t aHighWatermark)
+{
+	// set watermarks
+	aWriter->lowWatermark	= aLowWatermark;
+	aWriter->highWatermark	= aHighWatermark;
+}
+
+void LWWriterSetWritabilityCallback(LWWriter *aWriter, LWWriterWritabilityCallback aCallback)
+{
+	// set callback
+	aWriter->writabilityCallback = aCallback;
+}
+
+#pragma mark -
+#pragma mark Choosing Wire Formats
+
+bool LWWriterSetWireFormat(LWWriter *aWriter, uint8_t aWireFormat)
+{
+	if(aWireFormat == aWriter->wireFormat)
+		return true;
+
+	// the other end cannot be told to go back to version 1
+	if(kLWWireFormatVersion2 != aWireFormat)
+		return false;
+
+	// announce version 2 frames
+	if(!LWWriterWriteData(aWriter, (void *)kLWWireFormatVersion2Preamble, kLWWireFormatVersion2PreambleLength))
+		return false;
+	aWriter->wireFormat = aWireFormat;
+
+	return true;
+}
+
+uint8_t LWWriterGetWireFormat(LWWriter *aWriter)
+{
+	return aWriter->wireFormat;
+}
+
+#pragma mark -
+#pragma mark Interning Arguments
+
+void LWWriterSetInternTable(LWWriter *aWriter, LWInternTable *aInternTable)
+{
+	// set intern table
+	aWriter->internTable = aInternTable;
+}
+
+LWInternTable *LWWriterGetInternTable(LWWriter *aWriter)
+{
+	return aWriter->internTable;
+}
+
+#pragma mark -
+#pragma mark Checksumming Frames
+
+void LWWriterSetChecksumEnabled(LWWriter *aWriter, bool aIsEnabled)
+{
+	aWriter->isChecksumEnabled = aIsEnabled;
+}
+
+bool LWWriterIsChecksumEnabled(LWWriter *aWriter)
+{
+	return aWriter->isChecksumEnabled;
+}
+
+#pragma mark -
+#pragma mark Writing Data
+
+static void LWWriterUpdateWritability(LWWriter *aWriter)
+{
+	size_t pendingLength = aWriter->writeQueue->pendingLength;
+
+	// check whether a watermark has been crossed
+	if(aWriter->isWritable && pendingLength >= aWriter->highWatermark)
+		aWriter->isWritable = false;
+	else if(!aWriter->isWritable && pendingLength <= aWriter->lowWatermark)
+		aWriter->isWritable = true;
+	else
+		return;
+
+	// notify
+	if(aWriter->writabilityCallback)
+		aWriter->writabilityCallback(aWriter, aWriter->isWritable, aWriter->userInfo);
+}
+
+static uint8_t *LWWriterReserve(LWWriter *aWriter, size_t aLength)
+{
+	LWWriteQueue	*writeQueue	= aWriter->writeQueue;
+	LWBuffer		*tailBuffer	= aWriter->tailBuffer;
+
+	// append to tail buffer if it is still at the end of the queue
+	if(tailBuffer && writeQueue->bufferCount > 0)
+	{
+		size_t lastBufferIndex = (writeQueue->firstBufferIndex + writeQueue->bufferCount - 1) % writeQueue->bufferCapacity;
+		if(writeQueue->buffers[lastBufferIndex] == tailBuffer && tailBuffer->capacity - tailBuffer->length >= aLength)
+		{
+			uint8_t *data = tailBuffer->data + tailBuffer->length;
+			tailBuffer->length			+= aLength;
+			writeQueue->pendingLength	+= aLength;
+			return data;
+		}
+	}
+
+	// large data gets a buffer of its own
+	if(aLength > kLWWriterBufferCapacity)
+	{
+		LWBuffer *buffer = LWBufferCreateWithCapacityAndAllocator(aLength, aWriter->allocator);
+		if(!buffer)
+			return NULL;
+		buffer->length = aLength;
+
+		bool success = LWWriteQueueEnqueueBuffer(writeQueue, buffer);
+		LWBufferRelease(buffer);
+
+		return success ? buffer->data : NULL;
+	}
+
+	// reuse tail buffer if it has been sent completely, or start a new one
+	if(tailBuffer && 1 == tailBuffer->retainCount)
+		tailBuffer->length = 0;
+	else
+	{
+		if(tailBuffer)
+			LWBufferRelease(tailBuffer);
+		tailBuffer = aWriter->tailBuffer = LWBufferCreateWithCapacityAndAllocator(kLWWriterBufferCapacity, aWriter->allocator);
+		if(!tailBuffer)
+			return NULL;
+	}
+
+	// enqueue tail buffer
+	tailBuffer->length = aLength;
+	if(!LWWriteQueueEnqueueBuffer(writeQueue, tailBuffer))
+	{
+		tailBuffer->length = 0;
+		return NULL;
+	}
+
+	return tailBuffer->data;
+}
+
+static bool LWWriterSerializeMessage(LWWriter *aWriter, LWMessage *aMessage)
+{
+	// reserve space for the frame and its trailer
+	size_t length = LWMessageGetSerializedLengthWithWireFormat(aMessage, aWriter->wireFormat);
+	if(0 == length)
+		return false;
+	if(aWriter->isChecksumEnabled)
+		length += kLWChecksumLength;
+	uint8_t *data = LWWriterReserve(aWriter, length);
+	if(!data)
+		return false;
+
+	// serialize message directly into reserved space
+	if(aWriter->isChecksumEnabled)
+		LWMessageSerializeIntoBufferWithChecksum(aMessage, data, aWriter->wireFormat);
+	else
+		LWMessageSerializeIntoBufferWithWireFormat(aMessage, data, aWriter->wireFormat);
+
+	return true;
+}
+
+static bool LWWriterWriteInternedMessage(LWWriter *aWriter, LWMessage *aMessage)
+{
+	LWInternTable	*internTable		= aWriter->internTable;
+	uint32_t		internedArguments	= internTable->internedArguments[aMessage->messageID];
+
+	// only the first arguments can be interned
+	size_t internedArgumentCount = aMessage->argumentCount;
+	if(internedArgumentCount > kLWInternTableMaxArgumentIndex + 1)
+		internedArgumentCount = kLWInternTableMaxArgumentIndex + 1;
+
+	// build a message referring to encoded arguments
+	LWArgument	*stackArguments[kLWInternTableMaxArgumentIndex + 1];
+	LWArgument	**arguments = stackArguments;
+	if(aMessage->argumentCount > kLWInternTableMaxArgumentIndex + 1)
+	{
+		arguments = LWAllocatorAllocate(aWriter->allocator, aMessage->argumentCount*sizeof(LWArgument *));
+		if(!arguments)
+			return false;
+	}
+	memcpy(arguments, aMessage->arguments, aMessage->argumentCount*sizeof(LWArgument *));
+	LWMessage message = *aMessage;
+	message.arguments = arguments;
+
+	// encode arguments in order, so that the other end sees the same evictions
+	LWArgument					encodedArguments[kLWInternTableMaxArgumentIndex + 1];
+	uint8_t						referenceData[kLWInternTableMaxArgumentIndex + 1][3];
+	struct _LWInternTableChange	changes[kLWInternTableMaxArgumentIndex + 1];
+	size_t						changeCount = 0;
+	bool						success = true;
+	for(size_t i = 0; i < internedArgumentCount; ++i)
+		encodedArguments[i].ownsData = false;
+	for(size_t i = 0; success && i < internedArgumentCount; ++i)
+	{
+		if(!(internedArguments & (UINT32_C(1) << i)))
+			continue;
+		success = LWInternTableEncodeArgument(internTable, aMessage->arguments[i], &encodedArguments[i], referenceData[i], &changes[changeCount]);
+		if(success)
+			++changeCount;
+		arguments[i] = &encodedArguments[i];
+	}
+
+	// serialize message directly into reserved space
+	if(success)
+		success = LWWriterSerializeMessage(aWriter, &message);
+
+	// keep table changes only once the frame is queued, so that the other end sees the same table
+	if(success)
+	{
+		for(size_t i = 0; i < changeCount; ++i)
+			LWInternTableCommitChange(internTable, &changes[i]);
+	}
+	else
+	{
+		for(size_t i = changeCount; i > 0; --i)
+			LWInternTableRevertChange(internTable, &changes[i - 1]);
+	}
+
+	// clean up definitions
+	for(size_t i = 0; i < internedArgumentCount; ++i)
+	{
+		if(encodedArguments[i].ownsData)
+			LWAllocatorFree(encodedArguments[i].allocator, encodedArguments[i].data);
+	}
+	if(arguments != stackArguments)
+		LWAllocatorFree(aWriter->allocator, arguments);
+
+	if(success)
+		LWWriterUpdateWritability(aWriter);
+
+	return success;
+}
+
+bool LWWriterWriteMessage(LWWriter *aWriter, LWMessage *aMessage)
+{
+	// replace interned arguments
+	if(aWriter->internTable && aWriter->internTable->internedArguments[aMessage->messageID])
+		return LWWriterWriteInternedMessage(aWriter, aMessage);
+
+	// serialize message directly into reserved space
+	if(!LWWriterSerializeMessage(aWriter, aMessage))
+		return false;
+
+	LWWriterUpdateWritability(aWriter);
+
+	return true;
+}
+
+bool LWWriterWriteBuffer(LWWriter *aWriter, LWBuffer *aBuffer)
+{
+	// enqueue shared buffer without copying
+	if(!LWWriteQueueEnqueueBuffer(aWriter->writeQueue, aBuffer))
+		return false;
+
+	LWWriterUpdateWritability(aWriter);
+
+	return true;
+}
+
+bool LWWriterWriteData(LWWriter *aWriter, void *aData, size_t aLength)
+{
+	// reserve space
+	uint8_t *data = LWWriterReserve(aWriter, aLength);
+	if(!data)
+		return false;
+
+	// copy data
+	memcpy(data, aData, aLength);
+
+	LWWriterUpdateWritability(aWriter);
+
+	return true;
+}
+
+bool LWWriterWriteFrame(LWWriter *aWriter, void *aFrame, size_t aLength)
+{
+	if(!aWriter->isChecksumEnabled)
+		return LWWriterWriteData(aWriter, aFrame, aLength);
+
+	// reserve space for the frame and its trailer
+	uint8_t *data = LWWriterReserve(aWriter, aLength + kLWChecksumLength);
+	if(!data)
+		return false;
+
+	// checksum frame while copying it
+	LWChecksumWrite(data + aLength, LWChecksumCopy(0, data, aFrame, aLength));
+
+	LWWriterUpdateWritability(aWriter);
+
+	return true;
+}
+
+static LWBuffer *LWWriterCreateBuffer(LWWriter *aWriter, LWMessage *aMessage)
+{
+	if(!aWriter->isChecksumEnabled)
+		return LWBufferCreateFromMessageWithWireFormatAndAllocator(aMessage, aWriter->wireFormat, aWriter->allocator);
+
+	// create buffer with room for the trailer
+	size_t length = LWMessageGetSerializedLengthWithWireFormat(aMessage, aWriter->wireFormat);
+	if(0 == length)
+		return NULL;
+	LWBuffer *buffer = LWBufferCreateWithCapacityAndAllocator(length + kLWChecksumLength, aWriter->allocator);
+	if(!buffer)
+		return NULL;
+
+	// serialize message directly into buffer
+	buffer->length = LWMessageSerializeIntoBufferWithChecksum(aMessage, buffer->data, aWriter->wireFormat);
+
+	return buffer;
+}
+
+bool LWWriterBroadcastMessage(LWMessage *aMessage, LWWriter **aWriters, size_t aWriterCount)
+{
+	// serialize message only once per wire format, with and without trailer
+	LWBuffer *buffers[2][kLWWireFormatVersion2 + 1] = { { NULL } };
+
+	// share buffers between all writers
+	bool success = true;
+	for(size_t i = 0; i < aWriterCount; ++i)
+	{
+		// interned arguments are encoded per connection
+		if(aWriters[i]->internTable && aWriters[i]->internTable->internedArguments[aMessage->messageID])
+		{
+			if(!LWWriterWriteMessage(aWriters[i], aMessage))
+				success = false;
+			continue;
+		}
+
+		LWBuffer **buffer = &buffers[aWriters[i]->isChecksumEnabled][aWriters[i]->wireFormat];
+		if(!*buffer)
+			*buffer = LWWriterCreateBuffer(aWriters[i], aMessage);
+		if(!*buffer || !LWWriterWriteBuffer(aWriters[i], *buffer))
+			success = false;
+	}
+
+	// the last writer to send a buffer will delete it
+	for(size_t i = 0; i < 2; ++i)
+	{
+		for(size_t j = 0; j <= kLWWireFormatVersion2; ++j)
+		{
+			if(buffers[i][j])
+				LWBufferRelease(buffers[i][j]);
+		}
+	}
+
+	return success;
+}
+
+bool LWWriterFlush(LWWriter *aWriter)
+{
+	// write as much as possible
+	bool success = LWWriteQueueWriteToFileDescriptor(aWriter->writeQueue, aWriter->fileDescriptor);
+
+	LWWriterUpdateWritability(aWriter);
+
+	return success;
+}
+
+#pragma mark -
+#pragma mark Querying Writers
+
+bool LWWriterIsWritable(LWWriter *aWriter)
+{
+	return aWriter->isWritable;
+}
+
+size_t LWWriterGetPendingLength(LWWriter *aWriter)
+{
+	return aWriter->writeQueue->pendingLength;
+}
+
+int LWWriterGetFileDescriptor(LWWriter *aWriter)
+{
+	return aWriter->fileDescriptor;
+}
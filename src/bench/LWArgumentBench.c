@@ -0,0 +1,187 @@
+/*
+ * LWArgumentBench.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+
+#include "bench/LWBench.h"
+#include "bench/LWArgumentBench.h"
+
+#define kBenchArrayCount	(1024*1024)
+#define kBenchBatchSize		(1000)
+
+static const uint64_t gArgumentBenchIntegers[] = { 100, 100000, 4000000000ull };
+
+#pragma mark -
+
+static void bench_copy_array(size_t aElementSize)
+{
+	// plain memcpy of the same data, as a memory bandwidth reference
+	size_t length = kBenchArrayCount*aElementSize;
+	void *elements = calloc(kBenchArrayCount, aElementSize);
+	void *copy = malloc(length);
+
+	uint64_t arrayCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		memcpy(copy, elements, length);
+		++arrayCount;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"elements\": %d, \"element_size\": %zu", kBenchArrayCount, aElementSize);
+	bench_report("copy_array", parameters, arrayCount, arrayCount*length, duration);
+
+	free(copy);
+	free(elements);
+}
+
+static LWArgument *bench_create_array_argument(void *aElements, size_t aElementSize)
+{
+	switch(aElementSize)
+	{
+		case 2:		return LWArgumentCreateFrom16BitIntegerArray(aElements, kBenchArrayCount);
+		case 4:		return LWArgumentCreateFrom32BitIntegerArray(aElements, kBenchArrayCount);
+		default:	return LWArgumentCreateFrom64BitIntegerArray(aElements, kBenchArrayCount);
+	}
+}
+
+static void bench_create_array(size_t aElementSize)
+{
+	size_t length = kBenchArrayCount*aElementSize;
+	void *elements = calloc(kBenchArrayCount, aElementSize);
+
+	uint64_t arrayCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		LWArgumentDelete(bench_create_array_argument(elements, aElementSize));
+		++arrayCount;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"elements\": %d, \"element_size\": %zu", kBenchArrayCount, aElementSize);
+	bench_report("create_array", parameters, arrayCount, arrayCount*length, duration);
+
+	free(elements);
+}
+
+static void bench_get_array(size_t aElementSize)
+{
+	size_t length = kBenchArrayCount*aElementSize;
+	void *elements = calloc(kBenchArrayCount, aElementSize);
+	LWArgument *argument = bench_create_array_argument(elements, aElementSize);
+
+	uint64_t arrayCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		switch(aElementSize)
+		{
+			case 2:		LWArgumentGet16BitIntegerArrayValue(argument, elements, kBenchArrayCount); break;
+			case 4:		LWArgumentGet32BitIntegerArrayValue(argument, elements, kBenchArrayCount); break;
+			default:	LWArgumentGet64BitIntegerArrayValue(argument, elements, kBenchArrayCount); break;
+		}
+		++arrayCount;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"elements\": %d, \"element_size\": %zu", kBenchArrayCount, aElementSize);
+	bench_report("get_array", parameters, arrayCount, arrayCount*length, duration);
+
+	LWArgumentDelete(argument);
+	free(elements);
+}
+
+static void bench_get_integer(uint64_t aInteger, bool aIsVarint)
+{
+	LWArgument *argument = (aIsVarint ? LWArgumentCreateFromVarint(aInteger) : LWArgumentCreateFrom32BitUnsignedInteger((uint32_t)aInteger));
+
+	// sum results so that the loop is not optimized away
+	uint64_t sum			= 0;
+	uint64_t integerCount	= 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		for(size_t i = 0; i < kBenchBatchSize; ++i)
+		{
+			uint64_t integer = 0;
+			if(aIsVarint)
+				LWArgumentGetVarintValue(argument, &integer);
+			else
+				integer = LWArgumentGet32BitUnsignedIntegerValue(argument);
+			sum += integer;
+		}
+		integerCount += kBenchBatchSize;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"integer\": %llu, \"argument_length\": %zu", (unsigned long long)aInteger, LWArgumentGetLength(argument));
+	bench_report(aIsVarint ? "get_varint" : "get_32_bit_integer", parameters, integerCount, integerCount*LWArgumentGetLength(argument) + (sum & 1), duration);
+
+	LWArgumentDelete(argument);
+}
+
+#pragma mark -
+
+void bench_argument(void)
+{
+	for(size_t elementSize = 2; elementSize <= 8; elementSize *= 2)
+	{
+		bench_copy_array(elementSize);
+		bench_create_array(elementSize);
+		bench_get_array(elementSize);
+	}
+
+	for(size_t i = 0; i < sizeof(gArgumentBenchIntegers)/sizeof(uint64_t); ++i)
+	{
+		bench_get_integer(gArgumentBenchIntegers[i], false);
+		bench_get_integer(gArgumentBenchIntegers[i], true);
+	}
+}
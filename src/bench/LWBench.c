@@ -0,0 +1,128 @@
+/*
+ * LWBench.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _POSIX_C_SOURCE (200112L)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWCountingAllocator.h>
+#include <Lunkwill/LWMessage.h>
+
+#include "bench/LWBench.h"
+
+static LWCountingAllocator *gBenchCountingAllocator;
+
+#pragma mark -
+#pragma mark Counting Allocations
+
+// every allocation made by the library goes through the default allocator,
+// which lunkwill_bench replaces with a counting allocator before doing
+// anything else
+void bench_count_allocations(void)
+{
+	gBenchCountingAllocator = LWCountingAllocatorCreate(NULL);
+	LWAllocatorSetDefault(LWCountingAllocatorGetAllocator(gBenchCountingAllocator));
+}
+
+void bench_reset_allocation_count(void)
+{
+	if(gBenchCountingAllocator)
+		LWCountingAllocatorReset(gBenchCountingAllocator);
+}
+
+uint64_t bench_get_allocation_count(void)
+{
+	if(!gBenchCountingAllocator)
+		return 0;
+
+	return LWCountingAllocatorGetAllocationCount(gBenchCountingAllocator)
+		+ LWCountingAllocatorGetReallocationCount(gBenchCountingAllocator);
+}
+
+#pragma mark -
+#pragma mark Measuring Time
+
+uint64_t bench_get_time(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+#pragma mark -
+#pragma mark Creating Messages
+
+LWMessage *bench_create_message(uint8_t aMessageID, size_t aArgumentCount, size_t aArgumentLength)
+{
+	uint8_t *data = malloc(aArgumentLength ? aArgumentLength : 1);
+	for(size_t i = 0; i < aArgumentLength; ++i)
+		data[i] = (uint8_t)i;
+
+	LWArgument **arguments = malloc(aArgumentCount*sizeof(LWArgument *));
+	for(size_t i = 0; i < aArgumentCount; ++i)
+		arguments[i] = LWArgumentCreate(data, aArgumentLength);
+
+	LWMessage *message = LWMessageCreate2(aMessageID, aArgumentCount, arguments);
+
+	free(arguments);
+	free(data);
+
+	return message;
+}
+
+#pragma mark -
+#pragma mark Reporting
+
+void bench_report(const char *aBenchmark, const char *aParameters, uint64_t aMessageCount, uint64_t aByteCount, uint64_t aDuration)
+{
+	uint64_t allocationCount = bench_get_allocation_count();
+
+	// one JSON object per line
+	printf("{\"benchmark\": \"%s\", %s, \"messages\": %llu, \"ns_per_message\": %.2f, \"bytes_per_second\": %.0f, \"allocations_per_message\": %.2f}\n",
+		aBenchmark,
+		aParameters,
+		(unsigned long long)aMessageCount,
+		(double)aDuration / (double)aMessageCount,
+		(double)aByteCount * 1e9 / (double)(aDuration ? aDuration : 1),
+		(double)allocationCount / (double)aMessageCount);
+	fflush(stdout);
+}
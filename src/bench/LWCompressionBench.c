@@ -0,0 +1,250 @@
+/*
+ * LWCompressionBench.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _POSIX_C_SOURCE (200112L)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWWriter.h>
+
+#include "bench/LWBench.h"
+#include "bench/LWCompressionBench.h"
+
+#define kBenchMessageID		(1)
+#define kBenchReadLength	(65536)
+
+static const size_t gCompressionBenchArgumentLengths[]	= { 256, 1024, 4096, 8192 };
+
+// links are simulated by assuming sending and processing overlap perfectly,
+// so that the slower of the two determines throughput; zero means loopback
+static const uint64_t gCompressionBenchLinkSpeeds[]		= { 0, 1000000000, 100000000, 10000000 };
+static const char *gCompressionBenchLinkNames[]			= { "loopback", "1 Gbit/s", "100 Mbit/s", "10 Mbit/s" };
+
+uint64_t gCompressionBenchMessageCount;
+
+#pragma mark -
+
+static void message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aMessage, aUserInfo)
+
+	++gCompressionBenchMessageCount;
+}
+
+static char *bench_create_json(size_t aLength)
+{
+	// records that look alike, but not exactly
+	char *json = malloc(aLength + 128);
+	size_t length = 0;
+	uint32_t seed = 1;
+	while(length < aLength)
+	{
+		seed = seed * 1103515245 + 12345;
+		length += (size_t)snprintf(json + length, 128, "{\"id\": %u, \"name\": \"user%u\", \"active\": %s, \"score\": %u},\n",
+			seed >> 16, (seed >> 8) % 1000, (seed & 0x100) ? "true" : "false", seed % 100);
+	}
+
+	return json;
+}
+
+#pragma mark -
+
+static void bench_compress(size_t aArgumentLength)
+{
+	char *json = bench_create_json(aArgumentLength);
+	LWArgument *argument = LWArgumentCreate(json, aArgumentLength);
+
+	uint64_t argumentCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		// drop the previous result, so that every pass compresses
+		LWAllocatorFree(argument->allocator, argument->compressedData);
+		argument->compressedData = NULL;
+		LWArgumentCompress(argument, 0);
+		++argumentCount;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"argument_length\": %zu, \"compressed_length\": %zu", aArgumentLength, argument->compressedLength);
+	bench_report("compress", parameters, argumentCount, argumentCount*aArgumentLength, duration);
+
+	LWArgumentDelete(argument);
+	free(json);
+}
+
+static void bench_decompress(size_t aArgumentLength, bool aIsCompressed)
+{
+	// decompression happens while deserializing
+	char *json = bench_create_json(aArgumentLength);
+	LWMessage *message = LWMessageCreate(kBenchMessageID, LWArgumentCreate(json, aArgumentLength), NULL);
+	if(aIsCompressed)
+		LWMessageCompressArguments(message, 0);
+	size_t frameLength;
+	void *frame;
+	LWMessageSerializeWithWireFormat(message, &frameLength, &frame, kLWWireFormatVersion2);
+	LWMessageDelete(message);
+
+	uint64_t messageCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		size_t bytesUsed;
+		LWMessageDelete(LWMessageDeserializeWithWireFormat(frame, frameLength, &bytesUsed, NULL, kLWWireFormatVersion2));
+		++messageCount;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"argument_length\": %zu, \"compressed\": %s, \"frame_length\": %zu", aArgumentLength, aIsCompressed ? "true" : "false", frameLength);
+	bench_report("deserialize_blob", parameters, messageCount, messageCount*aArgumentLength, duration);
+
+	free(frame);
+	free(json);
+}
+
+static void bench_transfer(size_t aArgumentLength, bool aIsCompressed)
+{
+	char *json = bench_create_json(aArgumentLength);
+	uint8_t *data = malloc(kBenchReadLength);
+
+	// send over a socket pair, from a writer to a data handler
+	int fileDescriptors[2];
+	if(0 != socketpair(AF_UNIX, SOCK_STREAM, 0, fileDescriptors))
+	{
+		perror("transfer: socketpair");
+		return;
+	}
+	LWWriter *writer = LWWriterCreate(fileDescriptors[0], NULL);
+	LWWriterSetWireFormat(writer, kLWWireFormatVersion2);
+	LWWriterFlush(writer);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, kBenchMessageID, &message_callback);
+	read(fileDescriptors[1], data, kLWWireFormatVersion2PreambleLength);
+	LWDataHandlerHandleData(dataHandler, kLWWireFormatVersion2Preamble, kLWWireFormatVersion2PreambleLength);
+
+	// every message carries a freshly created, and possibly compressed, argument
+	uint64_t messageCount = 0;
+	uint64_t frameByteCount = 0;
+	gCompressionBenchMessageCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		LWMessage *message = LWMessageCreate(kBenchMessageID, LWArgumentCreate(json, aArgumentLength), NULL);
+		if(aIsCompressed)
+			LWMessageCompressArguments(message, kLWArgumentDefaultCompressionThreshold);
+		LWWriterWriteMessage(writer, message);
+		LWMessageDelete(message);
+
+		size_t frameLength = LWWriterGetPendingLength(writer);
+		LWWriterFlush(writer);
+		for(size_t receivedLength = 0; receivedLength < frameLength; )
+		{
+			ssize_t length = read(fileDescriptors[1], data, kBenchReadLength);
+			if(length <= 0)
+				break;
+			LWDataHandlerHandleData(dataHandler, data, (size_t)length);
+			receivedLength += (size_t)length;
+		}
+
+		frameByteCount += frameLength;
+		++messageCount;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	if(gCompressionBenchMessageCount != messageCount)
+		fprintf(stderr, "transfer: expected %llu messages, got %llu\n", (unsigned long long)messageCount, (unsigned long long)gCompressionBenchMessageCount);
+
+	for(size_t i = 0; i < sizeof(gCompressionBenchLinkSpeeds)/sizeof(uint64_t); ++i)
+	{
+		// the link is the bottleneck when sending takes longer than processing
+		uint64_t linkDuration = duration;
+		if(gCompressionBenchLinkSpeeds[i])
+		{
+			uint64_t sendDuration = (uint64_t)((double)frameByteCount * 8 * 1e9 / (double)gCompressionBenchLinkSpeeds[i]);
+			if(sendDuration > linkDuration)
+				linkDuration = sendDuration;
+		}
+
+		char parameters[192];
+		snprintf(parameters, sizeof(parameters), "\"argument_length\": %zu, \"compressed\": %s, \"link\": \"%s\", \"frame_length\": %llu",
+			aArgumentLength,
+			aIsCompressed ? "true" : "false",
+			gCompressionBenchLinkNames[i],
+			(unsigned long long)(frameByteCount / messageCount));
+		bench_report("transfer", parameters, messageCount, messageCount*aArgumentLength, linkDuration);
+	}
+
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(writer);
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+	free(data);
+	free(json);
+}
+
+#pragma mark -
+
+void bench_compression(void)
+{
+	for(size_t i = 0; i < sizeof(gCompressionBenchArgumentLengths)/sizeof(size_t); ++i)
+		bench_compress(gCompressionBenchArgumentLengths[i]);
+
+	for(size_t i = 0; i < sizeof(gCompressionBenchArgumentLengths)/sizeof(size_t); ++i)
+	{
+		bench_decompress(gCompressionBenchArgumentLengths[i], false);
+		bench_decompress(gCompressionBenchArgumentLengths[i], true);
+	}
+
+	for(size_t i = 0; i < sizeof(gCompressionBenchArgumentLengths)/sizeof(size_t); ++i)
+	{
+		bench_transfer(gCompressionBenchArgumentLengths[i], false);
+		bench_transfer(gCompressionBenchArgumentLengths[i], true);
+	}
+}
@@ -0,0 +1,336 @@
+/*
+ * LWDataHandlerBench.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWValidator.h>
+
+#include "bench/LWBench.h"
+#include "bench/LWDataHandlerBench.h"
+
+#define kBenchMessageID				(1)
+#define kBenchStreamLength			(1024*1024)
+#define kBenchDripStreamLength		(64*1024)
+#define kBenchMinimumMessageCount	(4)
+#define kBenchMaximumSplitLength	(1024)
+#define kBenchMaximumFrameLength	(10240)
+
+enum {
+	kBenchFragmentationWhole,
+	kBenchFragmentationDrip,
+	kBenchFragmentationRandom
+};
+
+enum {
+	kBenchThreadMain,
+	kBenchThreadOther
+};
+
+static const char *gDataHandlerBenchFragmentationNames[] = { "whole", "drip", "random" };
+
+static const size_t gDataHandlerBenchArgumentCounts[]	= { 1, 4, 16 };
+static const size_t gDataHandlerBenchArgumentLengths[]	= { 16, 254, 255, 256, 1024 };
+
+uint64_t	gDataHandlerBenchMessageCount;
+size_t		gDataHandlerBenchArgumentLength;
+
+// a data handler passed back and forth between two threads
+struct _BenchMigration {
+	pthread_mutex_t	mutex;
+	pthread_cond_t	condition;
+	LWDataHandler	*dataHandler;
+	uint8_t			*frame;
+	size_t			frameLength;
+	uint8_t			owner;
+	bool			isStopping;
+	uint64_t		detachTime;
+	uint64_t		migrationCount;
+	uint64_t		latency;
+};
+
+#pragma mark -
+
+static bool validate_message(LWMessage *aMessage)
+{
+	for(size_t i = 0; i < aMessage->argumentCount; ++i)
+	{
+		if(aMessage->arguments[i]->length != gDataHandlerBenchArgumentLength)
+			return false;
+	}
+
+	return true;
+}
+
+static void message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aMessage, aUserInfo)
+
+	++gDataHandlerBenchMessageCount;
+}
+
+#pragma mark -
+
+static void handle_stream(LWDataHandler *aDataHandler, uint8_t *aData, size_t aLength, size_t aFrameLength, uint8_t aFragmentation, uint32_t *aSeed)
+{
+	size_t offset = 0;
+	while(offset < aLength)
+	{
+		size_t length;
+		switch(aFragmentation)
+		{
+			case kBenchFragmentationWhole:
+				length = aFrameLength;
+				break;
+
+			case kBenchFragmentationDrip:
+				length = 1;
+				break;
+
+			default:
+				// deterministic, so runs can be compared
+				*aSeed = *aSeed * 1103515245 + 12345;
+				length = 1 + (*aSeed >> 16) % kBenchMaximumSplitLength;
+				break;
+		}
+
+		if(length > aLength - offset)
+			length = aLength - offset;
+
+		if(!LWDataHandlerHandleData(aDataHandler, aData + offset, length))
+		{
+			fprintf(stderr, "handle_data: data handler refused data\n");
+			return;
+		}
+		offset += length;
+	}
+}
+
+static void bench_handle_data(size_t aArgumentCount, size_t aArgumentLength, uint8_t aFragmentation, bool aIsValidating, bool aIsUsingArena)
+{
+	// build stream of identical messages
+	LWMessage *message = bench_create_message(kBenchMessageID, aArgumentCount, aArgumentLength);
+	size_t frameLength = LWMessageGetSerializedLength(message);
+	if(frameLength > kBenchMaximumFrameLength)
+	{
+		// data handlers do not buffer messages this large
+		LWMessageDelete(message);
+		return;
+	}
+	size_t streamLength = (kBenchFragmentationDrip == aFragmentation ? kBenchDripStreamLength : kBenchStreamLength);
+	size_t messageCount = streamLength / frameLength;
+	if(messageCount < kBenchMinimumMessageCount)
+		messageCount = kBenchMinimumMessageCount;
+	uint8_t *data = malloc(messageCount*frameLength);
+	for(size_t i = 0; i < messageCount; ++i)
+		LWMessageSerializeIntoBuffer(message, data + i*frameLength);
+	LWMessageDelete(message);
+
+	// create data handler
+	LWValidator *validator = LWValidatorCreate();
+	LWValidatorSetMessageValidationCallback(validator, kBenchMessageID, &validate_message);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, kBenchMessageID, &message_callback);
+	if(aIsValidating)
+		LWDataHandlerSetValidator(dataHandler, validator);
+	if(aIsUsingArena)
+		LWDataHandlerSetArenaEnabled(dataHandler, true);
+	gDataHandlerBenchArgumentLength = aArgumentLength;
+
+	// handle stream repeatedly
+	uint32_t seed = 1;
+	uint64_t passCount = 0;
+	gDataHandlerBenchMessageCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		handle_stream(dataHandler, data, messageCount*frameLength, frameLength, aFragmentation, &seed);
+		++passCount;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	if(gDataHandlerBenchMessageCount != passCount*messageCount)
+		fprintf(stderr, "handle_data: expected %llu messages, got %llu\n", (unsigned long long)(passCount*messageCount), (unsigned long long)gDataHandlerBenchMessageCount);
+
+	char parameters[256];
+	snprintf(parameters, sizeof(parameters), "\"arguments\": %zu, \"argument_length\": %zu, \"fragmentation\": \"%s\", \"validator\": %s, \"arena\": %s",
+		aArgumentCount,
+		aArgumentLength,
+		gDataHandlerBenchFragmentationNames[aFragmentation],
+		aIsValidating ? "true" : "false",
+		aIsUsingArena ? "true" : "false");
+	bench_report("handle_data", parameters, passCount*messageCount, passCount*messageCount*frameLength, duration);
+
+	LWDataHandlerDelete(dataHandler);
+	LWValidatorDelete(validator);
+	free(data);
+}
+
+#pragma mark -
+
+static bool migrate_data_handler(struct _BenchMigration *aMigration, uint8_t aThread)
+{
+	// wait for the other thread to detach the data handler
+	pthread_mutex_lock(&aMigration->mutex);
+	while(aMigration->owner != aThread && !aMigration->isStopping)
+		pthread_cond_wait(&aMigration->condition, &aMigration->mutex);
+	bool isStopping = aMigration->isStopping;
+	uint64_t detachTime = aMigration->detachTime;
+	pthread_mutex_unlock(&aMigration->mutex);
+	if(isStopping)
+		return false;
+
+	// attach it here, with the first half of a frame still buffered
+	LWDataHandler *dataHandler = aMigration->dataHandler;
+	if(!LWDataHandlerAttach(dataHandler, NULL))
+		fprintf(stderr, "migrate_data_handler: data handler refused to attach\n");
+	aMigration->latency += bench_get_time() - detachTime;
+	++aMigration->migrationCount;
+
+	// complete the buffered frame, then buffer half of the next one
+	size_t splitLength = aMigration->frameLength / 2;
+	LWDataHandlerHandleData(dataHandler, aMigration->frame + splitLength, aMigration->frameLength - splitLength);
+	LWDataHandlerHandleData(dataHandler, aMigration->frame, splitLength);
+
+	// hand it over
+	pthread_mutex_lock(&aMigration->mutex);
+	aMigration->detachTime = bench_get_time();
+	if(!LWDataHandlerDetach(dataHandler))
+		fprintf(stderr, "migrate_data_handler: data handler refused to detach\n");
+	aMigration->owner = (kBenchThreadMain == aThread ? kBenchThreadOther : kBenchThreadMain);
+	pthread_cond_signal(&aMigration->condition);
+	pthread_mutex_unlock(&aMigration->mutex);
+
+	return true;
+}
+
+static void *run_migration_thread(void *aMigration)
+{
+	while(migrate_data_handler(aMigration, kBenchThreadOther))
+		;
+
+	return NULL;
+}
+
+static void bench_migrate_data_handler(size_t aArgumentLength)
+{
+	// build frame
+	LWMessage *message = bench_create_message(kBenchMessageID, 1, aArgumentLength);
+	struct _BenchMigration migration;
+	migration.frameLength	= LWMessageGetSerializedLength(message);
+	migration.frame			= malloc(migration.frameLength);
+	LWMessageSerializeIntoBuffer(message, migration.frame);
+	LWMessageDelete(message);
+
+	// create data handler with half a frame buffered, detached from this thread
+	migration.dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(migration.dataHandler, kBenchMessageID, &message_callback);
+	LWDataHandlerHandleData(migration.dataHandler, migration.frame, migration.frameLength / 2);
+	LWDataHandlerDetach(migration.dataHandler);
+	pthread_mutex_init(&migration.mutex, NULL);
+	pthread_cond_init(&migration.condition, NULL);
+	migration.owner				= kBenchThreadOther;
+	migration.isStopping		= false;
+	migration.migrationCount	= 0;
+	migration.latency			= 0;
+
+	// pass data handler back and forth
+	gDataHandlerBenchMessageCount = 0;
+	bench_reset_allocation_count();
+	pthread_t thread;
+	migration.detachTime = bench_get_time();
+	if(0 == pthread_create(&thread, NULL, &run_migration_thread, &migration))
+	{
+		uint64_t startTime = bench_get_time();
+		while(bench_get_time() - startTime < kLWBenchMinimumDuration)
+			migrate_data_handler(&migration, kBenchThreadMain);
+
+		// take data handler back and stop
+		pthread_mutex_lock(&migration.mutex);
+		while(kBenchThreadMain != migration.owner)
+			pthread_cond_wait(&migration.condition, &migration.mutex);
+		migration.isStopping = true;
+		pthread_cond_signal(&migration.condition);
+		pthread_mutex_unlock(&migration.mutex);
+		pthread_join(thread, NULL);
+
+		if(gDataHandlerBenchMessageCount != migration.migrationCount)
+			fprintf(stderr, "migrate_data_handler: expected %llu messages, got %llu\n", (unsigned long long)migration.migrationCount, (unsigned long long)gDataHandlerBenchMessageCount);
+
+		// latency from detaching on one thread until attached on the other
+		char parameters[256];
+		snprintf(parameters, sizeof(parameters), "\"argument_length\": %zu, \"buffered_length\": %zu",
+			aArgumentLength,
+			migration.frameLength / 2);
+		bench_report("migrate_data_handler", parameters, migration.migrationCount, migration.migrationCount*migration.frameLength, migration.latency);
+	}
+	else
+		fprintf(stderr, "migrate_data_handler: cannot create thread\n");
+	LWDataHandlerAttach(migration.dataHandler, NULL);
+
+	pthread_cond_destroy(&migration.condition);
+	pthread_mutex_destroy(&migration.mutex);
+	LWDataHandlerDelete(migration.dataHandler);
+	free(migration.frame);
+}
+
+#pragma mark -
+
+void bench_data_handler(void)
+{
+	for(size_t i = 0; i < sizeof(gDataHandlerBenchArgumentCounts)/sizeof(size_t); ++i)
+	{
+		for(size_t j = 0; j < sizeof(gDataHandlerBenchArgumentLengths)/sizeof(size_t); ++j)
+		{
+			for(uint8_t fragmentation = kBenchFragmentationWhole; fragmentation <= kBenchFragmentationRandom; ++fragmentation)
+			{
+				bench_handle_data(gDataHandlerBenchArgumentCounts[i], gDataHandlerBenchArgumentLengths[j], fragmentation, false, false);
+				bench_handle_data(gDataHandlerBenchArgumentCounts[i], gDataHandlerBenchArgumentLengths[j], fragmentation, true, false);
+				bench_handle_data(gDataHandlerBenchArgumentCounts[i], gDataHandlerBenchArgumentLengths[j], fragmentation, false, true);
+			}
+		}
+	}
+
+	for(size_t i = 0; i < sizeof(gDataHandlerBenchArgumentLengths)/sizeof(size_t); ++i)
+		bench_migrate_data_handler(gDataHandlerBenchArgumentLengths[i]);
+}
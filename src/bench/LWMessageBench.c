@@ -0,0 +1,201 @@
+/*
+ * LWMessageBench.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+
+#include "bench/LWBench.h"
+#include "bench/LWMessageBench.h"
+
+#define kBenchBatchSize	(1000)
+
+static const size_t gMessageBenchArgumentCounts[]	= { 1, 4, 16 };
+static const size_t gMessageBenchArgumentLengths[]	= { 16, 254, 255, 256, 1024 };
+
+#pragma mark -
+
+static void bench_serialize(size_t aArgumentCount, size_t aArgumentLength, uint8_t aWireFormat)
+{
+	LWMessage *message = bench_create_message(1, aArgumentCount, aArgumentLength);
+
+	uint64_t messageCount	= 0;
+	uint64_t byteCount		= 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		for(size_t i = 0; i < kBenchBatchSize; ++i)
+		{
+			size_t	length;
+			void	*data;
+			LWMessageSerializeWithWireFormat(message, &length, &data, aWireFormat);
+			byteCount += length;
+			LWAllocatorFree(NULL, data);
+		}
+		messageCount += kBenchBatchSize;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"arguments\": %zu, \"argument_length\": %zu, \"wire_format\": %u", aArgumentCount, aArgumentLength, aWireFormat);
+	bench_report("serialize", parameters, messageCount, byteCount, duration);
+
+	LWMessageDelete(message);
+}
+
+static void bench_serialize_into_buffer(size_t aArgumentCount, size_t aArgumentLength, uint8_t aWireFormat, bool aIsChecksumEnabled)
+{
+	LWMessage *message = bench_create_message(1, aArgumentCount, aArgumentLength);
+	size_t length = LWMessageGetSerializedLengthWithWireFormat(message, aWireFormat) + (aIsChecksumEnabled ? kLWChecksumLength : 0);
+	void *data = malloc(length);
+
+	uint64_t messageCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		if(aIsChecksumEnabled)
+		{
+			for(size_t i = 0; i < kBenchBatchSize; ++i)
+				LWMessageSerializeIntoBufferWithChecksum(message, data, aWireFormat);
+		}
+		else
+		{
+			for(size_t i = 0; i < kBenchBatchSize; ++i)
+				LWMessageSerializeIntoBufferWithWireFormat(message, data, aWireFormat);
+		}
+		messageCount += kBenchBatchSize;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"arguments\": %zu, \"argument_length\": %zu, \"wire_format\": %u, \"checksum\": %s", aArgumentCount, aArgumentLength, aWireFormat, aIsChecksumEnabled ? "true" : "false");
+	bench_report("serialize_into_buffer", parameters, messageCount, messageCount*length, duration);
+
+	free(data);
+	LWMessageDelete(message);
+}
+
+static void bench_deserialize(size_t aArgumentCount, size_t aArgumentLength, uint8_t aWireFormat, bool aIsChecksumEnabled)
+{
+	LWMessage *message = bench_create_message(1, aArgumentCount, aArgumentLength);
+	size_t	length = LWMessageGetSerializedLengthWithWireFormat(message, aWireFormat) + kLWChecksumLength;
+	void	*data = malloc(length);
+	if(aIsChecksumEnabled)
+		LWMessageSerializeIntoBufferWithChecksum(message, data, aWireFormat);
+	else
+		length = LWMessageSerializeIntoBufferWithWireFormat(message, data, aWireFormat);
+
+	uint64_t messageCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		for(size_t i = 0; i < kBenchBatchSize; ++i)
+		{
+			size_t	bytesUsed;
+			bool	isChecksumValid;
+			if(aIsChecksumEnabled)
+				LWMessageDelete(LWMessageDeserializeWithChecksum(data, length, &bytesUsed, NULL, NULL, aWireFormat, &isChecksumValid));
+			else
+				LWMessageDelete(LWMessageDeserializeWithWireFormat(data, length, &bytesUsed, NULL, aWireFormat));
+		}
+		messageCount += kBenchBatchSize;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"arguments\": %zu, \"argument_length\": %zu, \"wire_format\": %u, \"checksum\": %s", aArgumentCount, aArgumentLength, aWireFormat, aIsChecksumEnabled ? "true" : "false");
+	bench_report("deserialize", parameters, messageCount, messageCount*length, duration);
+
+	free(data);
+	LWMessageDelete(message);
+}
+
+static void bench_get_frame_length(size_t aArgumentCount, size_t aArgumentLength, uint8_t aWireFormat)
+{
+	LWMessage *message = bench_create_message(1, aArgumentCount, aArgumentLength);
+	size_t	length;
+	void	*data;
+	LWMessageSerializeWithWireFormat(message, &length, &data, aWireFormat);
+
+	uint64_t messageCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		for(size_t i = 0; i < kBenchBatchSize; ++i)
+		{
+			size_t frameLength;
+			LWMessageGetFrameLengthWithWireFormat(data, length, &frameLength, aWireFormat);
+		}
+		messageCount += kBenchBatchSize;
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"arguments\": %zu, \"argument_length\": %zu, \"wire_format\": %u", aArgumentCount, aArgumentLength, aWireFormat);
+	bench_report("get_frame_length", parameters, messageCount, messageCount*length, duration);
+
+	LWAllocatorFree(NULL, data);
+	LWMessageDelete(message);
+}
+
+#pragma mark -
+
+void bench_message(void)
+{
+	for(size_t i = 0; i < sizeof(gMessageBenchArgumentCounts)/sizeof(size_t); ++i)
+	{
+		for(size_t j = 0; j < sizeof(gMessageBenchArgumentLengths)/sizeof(size_t); ++j)
+		{
+			for(uint8_t wireFormat = kLWWireFormatVersion1; wireFormat <= kLWWireFormatVersion2; ++wireFormat)
+			{
+				bench_serialize(gMessageBenchArgumentCounts[i], gMessageBenchArgumentLengths[j], wireFormat);
+				bench_serialize_into_buffer(gMessageBenchArgumentCounts[i], gMessageBenchArgumentLengths[j], wireFormat, false);
+				bench_serialize_into_buffer(gMessageBenchArgumentCounts[i], gMessageBenchArgumentLengths[j], wireFormat, true);
+				bench_deserialize(gMessageBenchArgumentCounts[i], gMessageBenchArgumentLengths[j], wireFormat, false);
+				bench_deserialize(gMessageBenchArgumentCounts[i], gMessageBenchArgumentLengths[j], wireFormat, true);
+				bench_get_frame_length(gMessageBenchArgumentCounts[i], gMessageBenchArgumentLengths[j], wireFormat);
+			}
+		}
+	}
+}
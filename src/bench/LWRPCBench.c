@@ -0,0 +1,158 @@
+/*
+ * LWRPCBench.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriteQueue.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWRPC.h>
+
+#include "bench/LWBench.h"
+#include "bench/LWRPCBench.h"
+
+#define kBenchRequestMessageID	(1)
+#define kBenchResponseMessageID	(2)
+#define kBenchArgumentLength	(64)
+
+static const size_t gRPCBenchPipelineDepths[] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+
+LWWriter	*gRPCBenchServerWriter;
+LWMessage	*gRPCBenchResponse;
+uint64_t	gRPCBenchResponseCount;
+uint64_t	gRPCBenchByteCount;
+
+#pragma mark -
+
+static void request_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	uint32_t correlationID;
+	if(LWRPCGetCorrelationID(aMessage, &correlationID))
+		LWRPCWriteResponse(gRPCBenchServerWriter, correlationID, gRPCBenchResponse);
+}
+
+static void response_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler)
+
+	LWRPCHandleResponse((LWRPC *)aUserInfo, aMessage);
+}
+
+static void rpc_response_callback(LWRPC *aRPC, LWMessage *aResponse, void *aContext)
+{
+#pragma unused (aRPC, aContext)
+
+	if(aResponse)
+		++gRPCBenchResponseCount;
+}
+
+#pragma mark -
+
+static void move_data(LWWriter *aWriter, LWDataHandler *aDataHandler)
+{
+	void	*data;
+	size_t	length;
+	while((data = LWWriteQueuePeek(aWriter->writeQueue, &length)))
+	{
+		gRPCBenchByteCount += length;
+		LWDataHandlerHandleData(aDataHandler, data, length);
+		LWWriteQueueConsume(aWriter->writeQueue, length);
+	}
+}
+
+static void bench_pipeline_depth(size_t aPipelineDepth)
+{
+	// client side
+	LWWriter *clientWriter = LWWriterCreate(-1, NULL);
+	LWRPC *rpc = LWRPCCreate(clientWriter);
+	LWDataHandler *clientDataHandler = LWDataHandlerCreate(rpc);
+	LWDataHandlerSetMessageCallback(clientDataHandler, kBenchResponseMessageID, &response_callback);
+
+	// server side
+	gRPCBenchServerWriter = LWWriterCreate(-1, NULL);
+	LWDataHandler *serverDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(serverDataHandler, kBenchRequestMessageID, &request_callback);
+
+	LWMessage *request = bench_create_message(kBenchRequestMessageID, 1, kBenchArgumentLength);
+	gRPCBenchResponse = bench_create_message(kBenchResponseMessageID, 1, kBenchArgumentLength);
+
+	// keep pipeline full, then move requests and responses across in one go
+	uint64_t requestCount = 0;
+	gRPCBenchResponseCount = 0;
+	gRPCBenchByteCount = 0;
+	bench_reset_allocation_count();
+	uint64_t startTime = bench_get_time();
+	do
+	{
+		while(LWRPCGetInFlightRequestCount(rpc) < aPipelineDepth)
+		{
+			LWRPCSendRequest(rpc, request, &rpc_response_callback, NULL, NULL);
+			++requestCount;
+		}
+
+		move_data(clientWriter, serverDataHandler);
+		move_data(gRPCBenchServerWriter, clientDataHandler);
+	} while(bench_get_time() - startTime < kLWBenchMinimumDuration);
+	uint64_t duration = bench_get_time() - startTime;
+
+	if(gRPCBenchResponseCount != requestCount)
+		fprintf(stderr, "rpc: expected %llu responses, got %llu\n", (unsigned long long)requestCount, (unsigned long long)gRPCBenchResponseCount);
+
+	char parameters[128];
+	snprintf(parameters, sizeof(parameters), "\"pipeline_depth\": %zu, \"argument_length\": %d", aPipelineDepth, kBenchArgumentLength);
+	bench_report("rpc", parameters, gRPCBenchResponseCount, gRPCBenchByteCount, duration);
+
+	LWMessageDelete(gRPCBenchResponse);
+	LWMessageDelete(request);
+	LWDataHandlerDelete(serverDataHandler);
+	LWWriterDelete(gRPCBenchServerWriter);
+	LWDataHandlerDelete(clientDataHandler);
+	LWRPCDelete(rpc);
+	LWWriterDelete(clientWriter);
+}
+
+#pragma mark -
+
+void bench_rpc(void)
+{
+	for(size_t i = 0; i < sizeof(gRPCBenchPipelineDepths)/sizeof(size_t); ++i)
+		bench_pipeline_depth(gRPCBenchPipelineDepths[i]);
+}
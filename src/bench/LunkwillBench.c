@@ -0,0 +1,67 @@
+/*
+ * LunkwillBench.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench/LWBench.h"
+#include "bench/LWArgumentBench.h"
+#include "bench/LWCompressionBench.h"
+#include "bench/LWMessageBench.h"
+#include "bench/LWDataHandlerBench.h"
+#include "bench/LWRPCBench.h"
+
+int main(int argc, char **argv)
+{
+	// count allocations made by the library
+	bench_count_allocations();
+
+	// optionally run a single group: argument, compression, message, data_handler
+	// or rpc
+	const char *group = (argc > 1 ? argv[1] : NULL);
+
+	if(!group || 0 == strcmp(group, "argument"))
+		bench_argument();
+	if(!group || 0 == strcmp(group, "compression"))
+		bench_compression();
+	if(!group || 0 == strcmp(group, "message"))
+		bench_message();
+	if(!group || 0 == strcmp(group, "data_handler"))
+		bench_data_handler();
+	if(!group || 0 == strcmp(group, "rpc"))
+		bench_rpc();
+
+	return 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * LWLoadClient.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _XOPEN_SOURCE (600)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWRPC.h>
+#include <Lunkwill/LWClientPool.h>
+
+#include "load/LWLoadHistogram.h"
+#include "load/LWLoadServer.h"
+#include "load/LWLoadClient.h"
+
+#define kLoadMaximumOpenLoopInFlightCount	(65536)
+#define kLoadDrainTime						(1000000000ULL)
+#define kLoadReadBufferSize					(65536)
+#define kLoadDataHandlerChunkSize			(4096)
+
+struct load_request {
+	struct load_client	*client;
+	uint64_t			startTime;
+	size_t				index;
+};
+
+static void *load_client_run(void *aClient);
+
+#pragma mark -
+
+uint64_t load_get_time(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec*1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static void load_sleep_until(uint64_t aTime)
+{
+	struct timespec time;
+	time.tv_sec		= (time_t)(aTime/1000000000ULL);
+	time.tv_nsec	= (long)(aTime%1000000000ULL);
+	while(EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL))
+		;
+}
+
+static void load_client_wait(struct load_client *aClient, uint64_t aTime)
+{
+	struct timespec time;
+	time.tv_sec		= (time_t)(aTime/1000000000ULL);
+	time.tv_nsec	= (long)(aTime%1000000000ULL);
+	pthread_cond_timedwait(&aClient->condition, &aClient->mutex, &time);
+}
+
+#pragma mark -
+
+bool load_client_start(struct load_client *aClient, struct load_configuration *aConfiguration, uint32_t aSeed)
+{
+	memset(aClient, 0, sizeof(struct load_client));
+	aClient->configuration	= aConfiguration;
+	aClient->seed			= aSeed;
+	load_histogram_reset(&aClient->histogram);
+
+	// open loop needs room for requests that pile up
+	size_t slotCount = (aConfiguration->rate ? kLoadMaximumOpenLoopInFlightCount : aConfiguration->window);
+	aClient->slots		= malloc(slotCount*sizeof(struct load_request));
+	aClient->freeSlots	= malloc(slotCount*sizeof(size_t));
+	if(!aClient->slots || !aClient->freeSlots)
+		return false;
+	for(size_t i = 0; i < slotCount; ++i)
+	{
+		aClient->slots[i].client	= aClient;
+		aClient->slots[i].index		= i;
+		aClient->freeSlots[i]		= slotCount - 1 - i;
+	}
+	aClient->freeSlotCount = slotCount;
+
+	// build requests once; arguments are the response length and the payload
+	for(size_t i = 0; i < aConfiguration->mixEntryCount; ++i)
+	{
+		struct load_mix_entry *entry = &aConfiguration->mix[i];
+		uint8_t *payload = calloc(1, entry->requestLength ? entry->requestLength : 1);
+		aClient->requests[i] = LWMessageCreate(entry->messageID,
+			LWArgumentCreateFrom32BitUnsignedInteger(entry->responseLength),
+			LWArgumentCreate(payload, entry->requestLength),
+			NULL);
+		free(payload);
+	}
+
+	// timeouts use the monotonic clock
+	pthread_condattr_t conditionAttributes;
+	pthread_condattr_init(&conditionAttributes);
+	pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&aClient->condition, &conditionAttributes);
+	pthread_condattr_destroy(&conditionAttributes);
+	pthread_mutex_init(&aClient->mutex, NULL);
+
+	return 0 == pthread_create(&aClient->thread, NULL, &load_client_run, aClient);
+}
+
+void load_client_join(struct load_client *aClient)
+{
+	pthread_join(aClient->thread, NULL);
+}
+
+void load_client_finish(struct load_client *aClient)
+{
+	for(size_t i = 0; i < aClient->configuration->mixEntryCount; ++i)
+		LWMessageDelete(aClient->requests[i]);
+	pthread_cond_destroy(&aClient->condition);
+	pthread_mutex_destroy(&aClient->mutex);
+	free(aClient->freeSlots);
+	free(aClient->slots);
+}
+
+#pragma mark -
+
+static void load_client_response_callback(LWRPC *aRPC, LWMessage *aResponse, void *aContext)
+{
+#pragma unused (aRPC)
+
+	uint64_t			now		= load_get_time();
+	struct load_request	*slot	= aContext;
+	struct load_client	*client	= slot->client;
+
+	pthread_mutex_lock(&client->mutex);
+
+	// only measure after warming up
+	if(!aResponse)
+		++client->errorCount;
+	else if(slot->startTime >= client->configuration->startTime + client->configuration->warmup)
+	{
+		load_histogram_record(&client->histogram, now - slot->startTime);
+		++client->responseCount;
+	}
+
+	client->freeSlots[client->freeSlotCount++] = slot->index;
+	--client->inFlightCount;
+	pthread_cond_signal(&client->condition);
+
+	pthread_mutex_unlock(&client->mutex);
+}
+
+static LWMessage *load_client_choose_request(struct load_client *aClient)
+{
+	struct load_configuration *configuration = aClient->configuration;
+
+	uint32_t totalWeight = 0;
+	for(size_t i = 0; i < configuration->mixEntryCount; ++i)
+		totalWeight += configuration->mix[i].weight;
+
+	aClient->seed = aClient->seed * 1103515245 + 12345;
+	uint32_t weight = (aClient->seed >> 8) % totalWeight;
+	for(size_t i = 0; i < configuration->mixEntryCount; ++i)
+	{
+		if(weight < configuration->mix[i].weight)
+			return aClient->requests[i];
+		weight -= configuration->mix[i].weight;
+	}
+
+	return aClient->requests[0];
+}
+
+static void load_client_send(struct load_client *aClient, LWRPC *aRPC, uint64_t aStartTime)
+{
+	// take a slot for the request
+	pthread_mutex_lock(&aClient->mutex);
+	if(0 == aClient->freeSlotCount)
+	{
+		++aClient->droppedCount;
+		pthread_mutex_unlock(&aClient->mutex);
+		return;
+	}
+	struct load_request *slot = &aClient->slots[aClient->freeSlots[--aClient->freeSlotCount]];
+	slot->startTime = aStartTime;
+	++aClient->inFlightCount;
+	pthread_mutex_unlock(&aClient->mutex);
+
+	// send it on the shared pool or on our own connection
+	LWMessage *request = load_client_choose_request(aClient);
+	bool success;
+	if(aClient->configuration->clientPool)
+		success = LWClientPoolSendRequest(aClient->configuration->clientPool, request, &load_client_response_callback, slot);
+	else
+		success = LWRPCSendRequest(aRPC, request, &load_client_response_callback, slot, NULL);
+
+	if(!success)
+	{
+		pthread_mutex_lock(&aClient->mutex);
+		aClient->freeSlots[aClient->freeSlotCount++] = slot->index;
+		--aClient->inFlightCount;
+		++aClient->errorCount;
+		pthread_mutex_unlock(&aClient->mutex);
+	}
+}
+
+#pragma mark -
+
+static void load_client_data_handler_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler)
+
+	LWRPCHandleResponse((LWRPC *)aUserInfo, aMessage);
+}
+
+static int load_client_connect(struct load_configuration *aConfiguration)
+{
+	int fileDescriptor = socket(aConfiguration->address.ss_family, SOCK_STREAM, 0);
+	if(-1 == fileDescriptor)
+		return -1;
+	if(0 != connect(fileDescriptor, (struct sockaddr *)&aConfiguration->address, aConfiguration->addressLength))
+	{
+		close(fileDescriptor);
+		return -1;
+	}
+
+	fcntl(fileDescriptor, F_SETFL, O_NONBLOCK);
+	if(AF_INET == aConfiguration->address.ss_family || AF_INET6 == aConfiguration->address.ss_family)
+	{
+		int noDelay = 1;
+		setsockopt(fileDescriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	}
+
+	return fileDescriptor;
+}
+
+static void load_client_run_connection(struct load_client *aClient)
+{
+	struct load_configuration *configuration = aClient->configuration;
+
+	// each client drives its own connection
+	int fileDescriptor = load_client_connect(configuration);
+	if(-1 == fileDescriptor)
+	{
+		++aClient->errorCount;
+		return;
+	}
+	LWWriter *writer = LWWriterCreate(fileDescriptor, NULL);
+	LWRPC *rpc = LWRPCCreate(writer);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(rpc);
+	LWDataHandlerSetMessageCallback(dataHandler, kLoadResponseMessageID, &load_client_data_handler_callback);
+
+	uint64_t endTime		= configuration->startTime + configuration->warmup + configuration->duration;
+	uint64_t interval		= configuration->rate ? 1000000000ULL/configuration->rate : 0;
+	uint64_t nextSendTime	= configuration->startTime;
+	while(true)
+	{
+		// send requests that are due
+		uint64_t now = load_get_time();
+		if(now < endTime)
+		{
+			if(configuration->rate)
+			{
+				// open loop: latency counts from when the request should have been sent
+				for(; nextSendTime <= now; nextSendTime += interval)
+					load_client_send(aClient, rpc, nextSendTime);
+			}
+			else
+			{
+				while(aClient->inFlightCount < configuration->window)
+					load_client_send(aClient, rpc, now);
+			}
+		}
+		else if(0 == aClient->inFlightCount || now >= endTime + kLoadDrainTime)
+			break;
+
+		if(!LWWriterFlush(writer))
+			break;
+
+		// wait for responses, or until the next request is due
+		int timeout = 100;
+		if(configuration->rate && now < endTime)
+			timeout = (int)((nextSendTime - now)/1000000);
+		struct pollfd pollFileDescriptor;
+		pollFileDescriptor.fd		= fileDescriptor;
+		pollFileDescriptor.events	= POLLIN | (LWWriterGetPendingLength(writer) ? POLLOUT : 0);
+		if(poll(&pollFileDescriptor, 1, timeout) <= 0 || !(pollFileDescriptor.revents & (POLLIN | POLLERR | POLLHUP)))
+			continue;
+
+		// read responses
+		uint8_t buffer[kLoadReadBufferSize];
+		ssize_t length = read(fileDescriptor, buffer, sizeof(buffer));
+		if(0 == length || (-1 == length && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno))
+			break;
+		for(ssize_t offset = 0; offset < length; offset += kLoadDataHandlerChunkSize)
+		{
+			size_t chunkLength = (size_t)(length - offset);
+			if(chunkLength > kLoadDataHandlerChunkSize)
+				chunkLength = kLoadDataHandlerChunkSize;
+			LWDataHandlerHandleData(dataHandler, buffer + offset, chunkLength);
+		}
+	}
+
+	// requests still in flight fail
+	LWRPCDelete(rpc);
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(writer);
+	close(fileDescriptor);
+}
+
+static void load_client_run_pool(struct load_client *aClient)
+{
+	struct load_configuration *configuration = aClient->configuration;
+
+	uint64_t endTime		= configuration->startTime + configuration->warmup + configuration->duration;
+	uint64_t interval		= configuration->rate ? 1000000000ULL/configuration->rate : 0;
+	uint64_t nextSendTime	= configuration->startTime;
+	uint64_t now;
+	while((now = load_get_time()) < endTime)
+	{
+		if(configuration->rate)
+		{
+			// open loop: latency counts from when the request should have been sent
+			load_sleep_until(nextSendTime);
+			for(now = load_get_time(); nextSendTime <= now && nextSendTime < endTime; nextSendTime += interval)
+				load_client_send(aClient, NULL, nextSendTime);
+		}
+		else
+		{
+			// closed loop: wait for room in the window
+			pthread_mutex_lock(&aClient->mutex);
+			while(aClient->inFlightCount >= configuration->window && load_get_time() < endTime)
+				load_client_wait(aClient, endTime);
+			bool hasRoom = (aClient->inFlightCount < configuration->window);
+			pthread_mutex_unlock(&aClient->mutex);
+			if(hasRoom)
+				load_client_send(aClient, NULL, load_get_time());
+		}
+	}
+
+	// wait for responses still in flight
+	pthread_mutex_lock(&aClient->mutex);
+	while(aClient->inFlightCount > 0 && load_get_time() < endTime + kLoadDrainTime)
+		load_client_wait(aClient, endTime + kLoadDrainTime);
+	pthread_mutex_unlock(&aClient->mutex);
+}
+
+static void *load_client_run(void *aClient)
+{
+	struct load_client *client = aClient;
+
+	if(client->configuration->clientPool)
+		load_client_run_pool(client);
+	else
+		load_client_run_connection(client);
+
+	return NULL;
+}
@@ -0,0 +1,117 @@
+/*
+ * LWLoadHistogram.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+
+#include "load/LWLoadHistogram.h"
+
+#pragma mark -
+
+static size_t load_histogram_get_index(uint64_t aValue)
+{
+	// small values get a bucket each
+	if(aValue < kLoadHistogramSubBucketCount)
+		return (size_t)aValue;
+
+	// find power of two, then linear sub-bucket within it
+	unsigned exponent = 63 - (unsigned)__builtin_clzll(aValue);
+	unsigned shift = exponent - kLoadHistogramSubBucketBits;
+	size_t subBucket = (size_t)(aValue >> shift) - kLoadHistogramSubBucketCount;
+	return kLoadHistogramSubBucketCount + shift*kLoadHistogramSubBucketCount + subBucket;
+}
+
+static uint64_t load_histogram_get_highest_value(size_t aIndex)
+{
+	if(aIndex < kLoadHistogramSubBucketCount)
+		return aIndex;
+
+	unsigned shift = (unsigned)((aIndex - kLoadHistogramSubBucketCount)/kLoadHistogramSubBucketCount);
+	uint64_t subBucket = (aIndex - kLoadHistogramSubBucketCount)%kLoadHistogramSubBucketCount;
+	return ((kLoadHistogramSubBucketCount + subBucket) << shift) + ((1ULL << shift) - 1);
+}
+
+#pragma mark -
+
+void load_histogram_reset(struct load_histogram *aHistogram)
+{
+	memset(aHistogram, 0, sizeof(struct load_histogram));
+	aHistogram->min = UINT64_MAX;
+}
+
+void load_histogram_record(struct load_histogram *aHistogram, uint64_t aValue)
+{
+	++aHistogram->counts[load_histogram_get_index(aValue)];
+	++aHistogram->count;
+	aHistogram->sum += aValue;
+	if(aValue < aHistogram->min)
+		aHistogram->min = aValue;
+	if(aValue > aHistogram->max)
+		aHistogram->max = aValue;
+}
+
+void load_histogram_merge(struct load_histogram *aHistogram, struct load_histogram *aOtherHistogram)
+{
+	for(size_t i = 0; i < kLoadHistogramBucketCount; ++i)
+		aHistogram->counts[i] += aOtherHistogram->counts[i];
+	aHistogram->count += aOtherHistogram->count;
+	aHistogram->sum += aOtherHistogram->sum;
+	if(aOtherHistogram->min < aHistogram->min)
+		aHistogram->min = aOtherHistogram->min;
+	if(aOtherHistogram->max > aHistogram->max)
+		aHistogram->max = aOtherHistogram->max;
+}
+
+uint64_t load_histogram_get_percentile(struct load_histogram *aHistogram, double aPercentile)
+{
+	if(0 == aHistogram->count)
+		return 0;
+
+	// find bucket containing the requested rank
+	uint64_t rank = (uint64_t)(aPercentile/100.0*(double)aHistogram->count + 0.5);
+	if(rank < 1)
+		rank = 1;
+	uint64_t count = 0;
+	for(size_t i = 0; i < kLoadHistogramBucketCount; ++i)
+	{
+		count += aHistogram->counts[i];
+		if(count >= rank)
+		{
+			uint64_t value = load_histogram_get_highest_value(i);
+			return value > aHistogram->max ? aHistogram->max : value;
+		}
+	}
+
+	return aHistogram->max;
+}
@@ -0,0 +1,322 @@
+/*
+ * LWLoadServer.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _XOPEN_SOURCE (600)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWRPC.h>
+
+#include "load/LWLoadServer.h"
+
+#define kLoadServerReadBufferSize		(65536)
+#define kLoadServerResponseCacheSize	(16)
+
+struct load_server_connection {
+	struct load_server	*server;
+	int					fileDescriptor;
+	LWDataHandler		*dataHandler;
+	LWWriter			*writer;
+};
+
+struct load_server {
+	int								listenFileDescriptor;
+	int								wakeupFileDescriptors[2];
+	pthread_t						thread;
+
+	struct load_server_connection	**connections;
+	size_t							connectionCount;
+	size_t							connectionCapacity;
+
+	// responses are reused for each response length
+	LWMessage						*responses[kLoadServerResponseCacheSize];
+	uint32_t						responseLengths[kLoadServerResponseCacheSize];
+	size_t							responseCount;
+};
+
+static void *load_server_run(void *aServer);
+
+#pragma mark -
+
+static LWMessage *load_server_get_response(struct load_server *aServer, uint32_t aLength)
+{
+	for(size_t i = 0; i < aServer->responseCount; ++i)
+	{
+		if(aServer->responseLengths[i] == aLength)
+			return aServer->responses[i];
+	}
+
+	// create response, evicting the oldest one if necessary
+	uint8_t *data = calloc(1, aLength ? aLength : 1);
+	LWMessage *response = LWMessageCreate(kLoadResponseMessageID, LWArgumentCreate(data, aLength), NULL);
+	free(data);
+	if(aServer->responseCount == kLoadServerResponseCacheSize)
+	{
+		LWMessageDelete(aServer->responses[0]);
+		memmove(aServer->responses, aServer->responses + 1, (kLoadServerResponseCacheSize - 1)*sizeof(LWMessage *));
+		memmove(aServer->responseLengths, aServer->responseLengths + 1, (kLoadServerResponseCacheSize - 1)*sizeof(uint32_t));
+		--aServer->responseCount;
+	}
+	aServer->responses[aServer->responseCount]			= response;
+	aServer->responseLengths[aServer->responseCount]	= aLength;
+	++aServer->responseCount;
+
+	return response;
+}
+
+static void load_server_request_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler)
+
+	struct load_server_connection *connection = aUserInfo;
+
+	// requests carry the correlation ID and the response length
+	uint32_t correlationID;
+	if(!LWRPCGetCorrelationID(aMessage, &correlationID) || LWMessageGetArgumentCount(aMessage) < 2)
+		return;
+	LWArgument *lengthArgument = LWMessageGetArgumentAtIndex(aMessage, 1);
+	if(4 != LWArgumentGetLength(lengthArgument))
+		return;
+
+	uint32_t responseLength = LWArgumentGet32BitUnsignedIntegerValue(lengthArgument);
+	LWRPCWriteResponse(connection->writer, correlationID, load_server_get_response(connection->server, responseLength));
+}
+
+#pragma mark -
+
+struct load_server *load_server_create(struct sockaddr_storage *aAddress, socklen_t *aAddressLength)
+{
+	struct load_server *server = calloc(1, sizeof(struct load_server));
+	if(!server)
+		return NULL;
+
+	// listen, and find out which port was picked
+	server->listenFileDescriptor = socket(aAddress->ss_family, SOCK_STREAM, 0);
+	int reuseAddress = 1;
+	setsockopt(server->listenFileDescriptor, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+	if(-1 == server->listenFileDescriptor ||
+		0 != bind(server->listenFileDescriptor, (struct sockaddr *)aAddress, *aAddressLength) ||
+		0 != listen(server->listenFileDescriptor, 128) ||
+		0 != getsockname(server->listenFileDescriptor, (struct sockaddr *)aAddress, aAddressLength))
+	{
+		if(-1 != server->listenFileDescriptor)
+			close(server->listenFileDescriptor);
+		free(server);
+		return NULL;
+	}
+	fcntl(server->listenFileDescriptor, F_SETFL, O_NONBLOCK);
+
+	// start server thread
+	if(0 != pipe(server->wakeupFileDescriptors))
+	{
+		close(server->listenFileDescriptor);
+		free(server);
+		return NULL;
+	}
+	if(0 != pthread_create(&server->thread, NULL, &load_server_run, server))
+	{
+		close(server->wakeupFileDescriptors[0]);
+		close(server->wakeupFileDescriptors[1]);
+		close(server->listenFileDescriptor);
+		free(server);
+		return NULL;
+	}
+
+	return server;
+}
+
+static void load_server_close_connection(struct load_server *aServer, size_t aIndex)
+{
+	struct load_server_connection *connection = aServer->connections[aIndex];
+	LWWriterDelete(connection->writer);
+	LWDataHandlerDelete(connection->dataHandler);
+	close(connection->fileDescriptor);
+	free(connection);
+
+	aServer->connections[aIndex] = aServer->connections[--aServer->connectionCount];
+}
+
+void load_server_delete(struct load_server *aServer)
+{
+	// stop server thread
+	uint8_t byte = 0;
+	write(aServer->wakeupFileDescriptors[1], &byte, 1);
+	pthread_join(aServer->thread, NULL);
+
+	while(aServer->connectionCount > 0)
+		load_server_close_connection(aServer, aServer->connectionCount - 1);
+	for(size_t i = 0; i < aServer->responseCount; ++i)
+		LWMessageDelete(aServer->responses[i]);
+
+	close(aServer->wakeupFileDescriptors[0]);
+	close(aServer->wakeupFileDescriptors[1]);
+	close(aServer->listenFileDescriptor);
+	free(aServer->connections);
+	free(aServer);
+}
+
+#pragma mark -
+
+static void load_server_accept(struct load_server *aServer)
+{
+	int fileDescriptor;
+	while(-1 != (fileDescriptor = accept(aServer->listenFileDescriptor, NULL, NULL)))
+	{
+		fcntl(fileDescriptor, F_SETFL, O_NONBLOCK);
+		int noDelay = 1;
+		setsockopt(fileDescriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+		// grow connection list if necessary
+		if(aServer->connectionCount == aServer->connectionCapacity)
+		{
+			size_t newConnectionCapacity = aServer->connectionCapacity ? 2*aServer->connectionCapacity : 16;
+			struct load_server_connection **newConnections = realloc(aServer->connections, newConnectionCapacity*sizeof(struct load_server_connection *));
+			if(!newConnections)
+			{
+				close(fileDescriptor);
+				continue;
+			}
+			aServer->connections		= newConnections;
+			aServer->connectionCapacity	= newConnectionCapacity;
+		}
+
+		// answer every message ID
+		struct load_server_connection *connection = malloc(sizeof(struct load_server_connection));
+		connection->server			= aServer;
+		connection->fileDescriptor	= fileDescriptor;
+		connection->dataHandler		= LWDataHandlerCreate(connection);
+		connection->writer			= LWWriterCreate(fileDescriptor, NULL);
+		LWDataHandlerSetUnrecognisedMessageCallback(connection->dataHandler, &load_server_request_callback);
+
+		aServer->connections[aServer->connectionCount++] = connection;
+	}
+}
+
+static bool load_server_handle_events(struct load_server_connection *aConnection, short aEvents)
+{
+	// read requests
+	if(aEvents & (POLLIN | POLLERR | POLLHUP))
+	{
+		uint8_t buffer[kLoadServerReadBufferSize];
+		while(true)
+		{
+			ssize_t length = read(aConnection->fileDescriptor, buffer, sizeof(buffer));
+			if(length > 0)
+			{
+				// hand over what the data handler can take
+				size_t offset = 0;
+				while(offset < (size_t)length)
+				{
+					size_t chunkLength = (size_t)length - offset;
+					if(chunkLength > 4096)
+						chunkLength = 4096;
+					if(!LWDataHandlerHandleData(aConnection->dataHandler, buffer + offset, chunkLength))
+						return false;
+					offset += chunkLength;
+				}
+			}
+			else if(-1 == length && (EAGAIN == errno || EWOULDBLOCK == errno))
+				break;
+			else if(-1 == length && EINTR == errno)
+				continue;
+			else
+				return false;
+		}
+	}
+
+	// send responses
+	return LWWriterFlush(aConnection->writer);
+}
+
+static void *load_server_run(void *aServer)
+{
+	struct load_server	*server					= aServer;
+	struct pollfd		*pollFileDescriptors	= NULL;
+	size_t				pollCapacity			= 0;
+
+	while(true)
+	{
+		// build poll set; first entries are the wakeup pipe and the listening socket
+		size_t pollFileDescriptorCount = 2 + server->connectionCount;
+		if(pollFileDescriptorCount > pollCapacity)
+		{
+			pollCapacity = 2*pollFileDescriptorCount;
+			pollFileDescriptors = realloc(pollFileDescriptors, pollCapacity*sizeof(struct pollfd));
+		}
+		pollFileDescriptors[0].fd		= server->wakeupFileDescriptors[0];
+		pollFileDescriptors[0].events	= POLLIN;
+		pollFileDescriptors[1].fd		= server->listenFileDescriptor;
+		pollFileDescriptors[1].events	= POLLIN;
+		for(size_t i = 0; i < server->connectionCount; ++i)
+		{
+			pollFileDescriptors[2 + i].fd		= server->connections[i]->fileDescriptor;
+			pollFileDescriptors[2 + i].events	= POLLIN | (LWWriterGetPendingLength(server->connections[i]->writer) ? POLLOUT : 0);
+		}
+
+		if(poll(pollFileDescriptors, pollFileDescriptorCount, -1) <= 0)
+			continue;
+		if(pollFileDescriptors[0].revents)
+			break;
+
+		// handle connections back to front, so closing one does not skip another
+		for(size_t i = pollFileDescriptorCount - 2; i > 0; --i)
+		{
+			if(pollFileDescriptors[1 + i].revents && !load_server_handle_events(server->connections[i - 1], pollFileDescriptors[1 + i].revents))
+				load_server_close_connection(server, i - 1);
+		}
+		if(pollFileDescriptors[1].revents)
+			load_server_accept(server);
+	}
+
+	free(pollFileDescriptors);
+
+	return NULL;
+}
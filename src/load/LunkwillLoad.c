@@ -0,0 +1,248 @@
+/*
+ * LunkwillLoad.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _XOPEN_SOURCE (600)
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWClientPool.h>
+
+#include "load/LWLoadHistogram.h"
+#include "load/LWLoadServer.h"
+#include "load/LWLoadClient.h"
+
+static const double gLoadPercentiles[]			= { 50.0, 90.0, 99.0, 99.9, 99.99 };
+static const char	*gLoadPercentileNames[]		= { "p50", "p90", "p99", "p99.9", "p99.99" };
+
+#pragma mark -
+
+static void usage(const char *aName)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -u path    use a Unix domain socket instead of TCP loopback\n"
+		"  -c count   number of client threads (default 4)\n"
+		"  -P count   share a client pool with this many connections (default 0,\n"
+		"             one connection per client thread)\n"
+		"  -m mix     message mix as id:request_length:response_length:weight,...\n"
+		"             (default 1:16:16:1)\n"
+		"  -r rate    open loop, requests per second per client (default 0,\n"
+		"             closed loop)\n"
+		"  -w window  closed loop, requests in flight per client (default 1)\n"
+		"  -d seconds measured duration (default 5)\n"
+		"  -W seconds warmup, not measured (default 1)\n",
+		aName);
+}
+
+static bool parse_mix(struct load_configuration *aConfiguration, char *aMix)
+{
+	aConfiguration->mixEntryCount = 0;
+	for(char *entry = strtok(aMix, ","); entry; entry = strtok(NULL, ","))
+	{
+		unsigned	messageID;
+		unsigned	requestLength;
+		unsigned	responseLength;
+		unsigned	weight;
+		if(aConfiguration->mixEntryCount == kLoadMaximumMixEntryCount ||
+			4 != sscanf(entry, "%u:%u:%u:%u", &messageID, &requestLength, &responseLength, &weight) ||
+			messageID >= kLoadResponseMessageID || 0 == weight)
+			return false;
+
+		struct load_mix_entry *mixEntry = &aConfiguration->mix[aConfiguration->mixEntryCount++];
+		mixEntry->messageID			= (uint8_t)messageID;
+		mixEntry->requestLength		= requestLength;
+		mixEntry->responseLength	= responseLength;
+		mixEntry->weight			= weight;
+	}
+
+	return aConfiguration->mixEntryCount > 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct load_configuration configuration;
+	memset(&configuration, 0, sizeof(configuration));
+	configuration.window	= 1;
+	configuration.warmup	= 1000000000ULL;
+	configuration.duration	= 5000000000ULL;
+
+	const char	*socketPath				= NULL;
+	size_t		clientCount				= 4;
+	size_t		poolConnectionCount		= 0;
+	char		defaultMix[]			= "1:16:16:1";
+	char		*mix					= defaultMix;
+
+	int option;
+	while(-1 != (option = getopt(argc, argv, "u:c:P:m:r:w:d:W:h")))
+	{
+		switch(option)
+		{
+			case 'u': socketPath = optarg;									break;
+			case 'c': clientCount = strtoul(optarg, NULL, 10);				break;
+			case 'P': poolConnectionCount = strtoul(optarg, NULL, 10);		break;
+			case 'm': mix = optarg;											break;
+			case 'r': configuration.rate = strtoull(optarg, NULL, 10);		break;
+			case 'w': configuration.window = strtoul(optarg, NULL, 10);		break;
+			case 'd': configuration.duration = (uint64_t)(strtod(optarg, NULL)*1e9);	break;
+			case 'W': configuration.warmup = (uint64_t)(strtod(optarg, NULL)*1e9);		break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if(0 == clientCount || 0 == configuration.window || !parse_mix(&configuration, mix))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	// writing to a closed connection must not kill us
+	signal(SIGPIPE, SIG_IGN);
+
+	// build address; TCP uses any free loopback port
+	if(socketPath)
+	{
+		struct sockaddr_un *address = (struct sockaddr_un *)&configuration.address;
+		if(strlen(socketPath) >= sizeof(address->sun_path))
+		{
+			fprintf(stderr, "socket path too long\n");
+			return 1;
+		}
+		unlink(socketPath);
+		address->sun_family = AF_UNIX;
+		strcpy(address->sun_path, socketPath);
+		configuration.addressLength = sizeof(struct sockaddr_un);
+	}
+	else
+	{
+		struct sockaddr_in *address = (struct sockaddr_in *)&configuration.address;
+		address->sin_family			= AF_INET;
+		address->sin_port			= 0;
+		address->sin_addr.s_addr	= htonl(INADDR_LOOPBACK);
+		configuration.addressLength = sizeof(struct sockaddr_in);
+	}
+
+	// start server
+	struct load_server *server = load_server_create(&configuration.address, &configuration.addressLength);
+	if(!server)
+	{
+		perror("cannot start server");
+		return 1;
+	}
+
+	// connect shared pool
+	if(poolConnectionCount)
+	{
+		configuration.clientPool = LWClientPoolCreate((struct sockaddr *)&configuration.address, configuration.addressLength, poolConnectionCount);
+		LWClientPoolSetResponseMessageID(configuration.clientPool, kLoadResponseMessageID);
+		while(LWClientPoolGetConnectedCount(configuration.clientPool) < poolConnectionCount)
+			LWClientPoolWaitForConnection(configuration.clientPool, 100);
+	}
+
+	// run clients
+	struct load_client *clients = malloc(clientCount*sizeof(struct load_client));
+	configuration.startTime = load_get_time();
+	for(size_t i = 0; i < clientCount; ++i)
+	{
+		if(!load_client_start(&clients[i], &configuration, (uint32_t)i + 1))
+		{
+			fprintf(stderr, "cannot start client\n");
+			return 1;
+		}
+	}
+	for(size_t i = 0; i < clientCount; ++i)
+		load_client_join(&clients[i]);
+	if(configuration.clientPool)
+		LWClientPoolDelete(configuration.clientPool);
+
+	// collect results
+	struct load_histogram *histogram = malloc(sizeof(struct load_histogram));
+	load_histogram_reset(histogram);
+	uint64_t errorCount = 0;
+	uint64_t droppedCount = 0;
+	for(size_t i = 0; i < clientCount; ++i)
+	{
+		load_histogram_merge(histogram, &clients[i].histogram);
+		errorCount += clients[i].errorCount;
+		droppedCount += clients[i].droppedCount;
+		load_client_finish(&clients[i]);
+	}
+
+	// report as a single JSON object
+	printf("{\"transport\": \"%s\", \"clients\": %zu, \"pool_connections\": %zu, \"mode\": \"%s\", \"rate\": %llu, \"window\": %zu, \"mix\": [",
+		socketPath ? "unix" : "tcp",
+		clientCount,
+		poolConnectionCount,
+		configuration.rate ? "open" : "closed",
+		(unsigned long long)configuration.rate,
+		configuration.window);
+	for(size_t i = 0; i < configuration.mixEntryCount; ++i)
+	{
+		printf("%s{\"id\": %u, \"request_length\": %u, \"response_length\": %u, \"weight\": %u}",
+			i ? ", " : "",
+			configuration.mix[i].messageID,
+			configuration.mix[i].requestLength,
+			configuration.mix[i].responseLength,
+			configuration.mix[i].weight);
+	}
+	printf("], \"duration\": %.3f, \"responses\": %llu, \"errors\": %llu, \"dropped\": %llu, \"throughput\": %.0f, \"latency_ns\": {\"min\": %llu, \"mean\": %.0f",
+		(double)configuration.duration/1e9,
+		(unsigned long long)histogram->count,
+		(unsigned long long)errorCount,
+		(unsigned long long)droppedCount,
+		(double)histogram->count*1e9/(double)configuration.duration,
+		(unsigned long long)(histogram->count ? histogram->min : 0),
+		histogram->count ? (double)histogram->sum/(double)histogram->count : 0.0);
+	for(size_t i = 0; i < sizeof(gLoadPercentiles)/sizeof(double); ++i)
+		printf(", \"%s\": %llu", gLoadPercentileNames[i], (unsigned long long)load_histogram_get_percentile(histogram, gLoadPercentiles[i]));
+	printf(", \"max\": %llu}}\n", (unsigned long long)histogram->max);
+
+	free(histogram);
+	free(clients);
+	load_server_delete(server);
+	if(socketPath)
+		unlink(socketPath);
+
+	return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * LWAllocatorTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWCountingAllocator.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWDataHandlerStats.h>
+#include <Lunkwill/LWMultiplexer.h>
+#include <Lunkwill/LWRPC.h>
+#include <Lunkwill/LWTimerWheel.h>
+#include <Lunkwill/LWValidator.h>
+#include <Lunkwill/LWWriteQueue.h>
+#include <Lunkwill/LWWriter.h>
+
+uint32_t gAllocatorMessageCount;
+
+#pragma mark -
+
+static void message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	UC_ASSERT_EQUAL(2, aMessage->argumentCount);
+	++gAllocatorMessageCount;
+}
+
+static void timeout_callback(LWDataHandler *aDataHandler, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+}
+
+static void response_callback(LWRPC *aRPC, LWMessage *aResponse, void *aContext)
+{
+#pragma unused (aRPC, aResponse, aContext)
+}
+
+#pragma mark -
+
+static void test_system(void)
+{
+	LWAllocator *allocator = LWAllocatorGetSystem();
+	UC_ASSERT_NOT_NULL(allocator);
+	UC_ASSERT_EQUAL(allocator, LWAllocatorGetDefault());
+
+	// allocate
+	uint8_t *data = LWAllocatorAllocate(allocator, 16);
+	UC_ASSERT_NOT_NULL(data);
+	memset(data, 0xab, 16);
+
+	// reallocate
+	data = LWAllocatorReallocate(allocator, data, 4096);
+	UC_ASSERT_NOT_NULL(data);
+	UC_ASSERT_EQUAL(0xab, data[15]);
+	LWAllocatorFree(allocator, data);
+
+	// allocate zeroed
+	data = LWAllocatorAllocateZeroed(NULL, 32);
+	UC_ASSERT_NOT_NULL(data);
+	UC_ASSERT_EQUAL(0, data[0]);
+	UC_ASSERT_EQUAL(0, data[31]);
+	LWAllocatorFree(NULL, data);
+
+	// freeing NULL does nothing
+	LWAllocatorFree(NULL, NULL);
+}
+
+static void test_counting(void)
+{
+	LWCountingAllocator *countingAllocator = LWCountingAllocatorCreate(NULL);
+	UC_ASSERT_NOT_NULL(countingAllocator);
+	LWAllocator *allocator = LWCountingAllocatorGetAllocator(countingAllocator);
+
+	void *data = LWAllocatorAllocate(allocator, 16);
+	data = LWAllocatorReallocate(allocator, data, 32);
+	data = LWAllocatorReallocate(allocator, data, 64);
+	LWAllocatorFree(allocator, data);
+	LWAllocatorFree(allocator, NULL);
+	UC_ASSERT_EQUAL(1, LWCountingAllocatorGetAllocationCount(countingAllocator));
+	UC_ASSERT_EQUAL(2, LWCountingAllocatorGetReallocationCount(countingAllocator));
+	UC_ASSERT_EQUAL(1, LWCountingAllocatorGetFreeCount(countingAllocator));
+
+	// reset
+	LWCountingAllocatorReset(countingAllocator);
+	UC_ASSERT_EQUAL(0, LWCountingAllocatorGetAllocationCount(countingAllocator));
+	UC_ASSERT_EQUAL(0, LWCountingAllocatorGetReallocationCount(countingAllocator));
+	UC_ASSERT_EQUAL(0, LWCountingAllocatorGetFreeCount(countingAllocator));
+
+	LWCountingAllocatorDelete(countingAllocator);
+}
+
+static void test_default(void)
+{
+	LWCountingAllocator *countingAllocator = LWCountingAllocatorCreate(NULL);
+	LWAllocator *allocator = LWCountingAllocatorGetAllocator(countingAllocator);
+	LWAllocatorSetDefault(allocator);
+	UC_ASSERT_EQUAL(allocator, LWAllocatorGetDefault());
+
+	// arguments and messages use the default allocator
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(1, argument, NULL);
+	UC_ASSERT_EQUAL(allocator, argument->allocator);
+	UC_ASSERT_EQUAL(allocator, message->allocator);
+	UC_ASSERT_EQUAL(4, LWCountingAllocatorGetAllocationCount(countingAllocator));
+
+	// serialized messages use the default allocator
+	size_t length;
+	void *serializedMessage;
+	UC_ASSERT(LWMessageSerialize(message, &length, &serializedMessage));
+	UC_ASSERT_EQUAL(5, LWCountingAllocatorGetAllocationCount(countingAllocator));
+	LWAllocatorFree(NULL, serializedMessage);
+
+	// restore system allocator; objects keep the allocator they were created with
+	LWAllocatorSetDefault(NULL);
+	UC_ASSERT_EQUAL(LWAllocatorGetSystem(), LWAllocatorGetDefault());
+	LWMessageDelete(message);
+	UC_ASSERT_EQUAL(5, LWCountingAllocatorGetFreeCount(countingAllocator));
+
+	LWCountingAllocatorDelete(countingAllocator);
+}
+
+static void test_data_handler(void)
+{
+	LWCountingAllocator *countingAllocator = LWCountingAllocatorCreate(NULL);
+	LWAllocator *allocator = LWCountingAllocatorGetAllocator(countingAllocator);
+
+	// create data handler with its own allocator
+	LWDataHandler *dataHandler = LWDataHandlerCreateWithAllocator(NULL, allocator);
+	UC_ASSERT_NOT_NULL(dataHandler);
+	LWDataHandlerSetMessageCallback(dataHandler, 12, &message_callback);
+	UC_ASSERT_EQUAL(2, LWCountingAllocatorGetAllocationCount(countingAllocator));
+
+	// stats, histograms and timers use the data handler's allocator too
+	LWCountingAllocator *defaultCountingAllocator = LWCountingAllocatorCreate(NULL);
+	LWAllocatorSetDefault(LWCountingAllocatorGetAllocator(defaultCountingAllocator));
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(0);
+	LWDataHandlerSetTimerWheel(dataHandler, timerWheel);
+	UC_ASSERT(LWDataHandlerSetIdleTimeout(dataHandler, 1000, &timeout_callback));
+	UC_ASSERT(LWDataHandlerSetStatsEnabled(dataHandler, true));
+	UC_ASSERT_EQUAL(4, LWCountingAllocatorGetAllocationCount(countingAllocator));
+
+	// messages are deserialized with the data handler's allocator
+	uint8_t data[] = { 12, 2, 'a', 'b', 1, 'c', 0, 12, 1, 'd', 1, 'e', 0 };
+	gAllocatorMessageCount = 0;
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, sizeof(data)));
+	UC_ASSERT_EQUAL(2, gAllocatorMessageCount);
+	UC_ASSERT(LWCountingAllocatorGetAllocationCount(countingAllocator) > 4);
+	UC_ASSERT_EQUAL(1, LWCountingAllocatorGetAllocationCount(defaultCountingAllocator));
+
+	// everything allocated is freed
+	LWDataHandlerDelete(dataHandler);
+	UC_ASSERT_EQUAL(
+		LWCountingAllocatorGetAllocationCount(countingAllocator),
+		LWCountingAllocatorGetFreeCount(countingAllocator)
+	);
+	LWTimerWheelDelete(timerWheel);
+	LWAllocatorSetDefault(NULL);
+	UC_ASSERT_EQUAL(1, LWCountingAllocatorGetFreeCount(defaultCountingAllocator));
+
+	LWCountingAllocatorDelete(defaultCountingAllocator);
+	LWCountingAllocatorDelete(countingAllocator);
+}
+
+static void test_objects(void)
+{
+	LWCountingAllocator *countingAllocator = LWCountingAllocatorCreate(NULL);
+	LWAllocatorSetDefault(LWCountingAllocatorGetAllocator(countingAllocator));
+
+	// create objects while the counting allocator is the default
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWRPC *rpc = LWRPCCreate(writer);
+	LWMultiplexer *multiplexer = LWMultiplexerCreate(writer, NULL);
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(0);
+	LWTimer *timer = LWTimerCreate(NULL, NULL);
+	LWValidator *validator = LWValidatorCreate();
+	LWDataHandlerStats *stats = LWDataHandlerStatsCreate();
+	UC_ASSERT_NOT_NULL(writer);
+	UC_ASSERT_NOT_NULL(rpc);
+	UC_ASSERT_NOT_NULL(multiplexer);
+	UC_ASSERT_NOT_NULL(timerWheel);
+	UC_ASSERT_NOT_NULL(timer);
+	UC_ASSERT_NOT_NULL(validator);
+	UC_ASSERT_NOT_NULL(stats);
+
+	// later allocations use the allocator each object was created with
+	LWAllocatorSetDefault(NULL);
+	uint64_t allocationCount = LWCountingAllocatorGetAllocationCount(countingAllocator);
+	for(size_t i = 0; i < 100; ++i)
+	{
+		LWMessage *request = LWMessageCreate(1, LWArgumentCreateFromString("hello"), NULL);
+		UC_ASSERT(LWRPCSendRequest(rpc, request, &response_callback, NULL, NULL));
+		LWMessageDelete(request);
+	}
+	UC_ASSERT(LWMultiplexerOpenChannel(multiplexer, 1, NULL));
+	UC_ASSERT(LWCountingAllocatorGetAllocationCount(countingAllocator) > allocationCount);
+
+	// and so do frees
+	LWDataHandlerStatsDelete(stats);
+	LWValidatorDelete(validator);
+	LWTimerDelete(timer);
+	LWTimerWheelDelete(timerWheel);
+	LWMultiplexerDelete(multiplexer);
+	LWRPCDelete(rpc);
+	LWWriterDelete(writer);
+	UC_ASSERT_EQUAL(
+		LWCountingAllocatorGetAllocationCount(countingAllocator),
+		LWCountingAllocatorGetFreeCount(countingAllocator)
+	);
+
+	LWCountingAllocatorDelete(countingAllocator);
+}
+
+static void test_buffers(void)
+{
+	LWCountingAllocator *countingAllocator = LWCountingAllocatorCreate(NULL);
+	LWAllocator *allocator = LWCountingAllocatorGetAllocator(countingAllocator);
+	LWMessage *message = LWMessageCreate(1, LWArgumentCreateFromString("hello"), NULL);
+
+	// create writer, write queue and multiplexer with their own allocator
+	LWWriter *writer = LWWriterCreateWithAllocator(-1, NULL, allocator);
+	LWWriteQueue *writeQueue = LWWriteQueueCreateWithAllocator(allocator);
+	LWMultiplexer *multiplexer = LWMultiplexerCreateWithAllocator(writer, NULL, allocator);
+	UC_ASSERT_NOT_NULL(writer);
+	UC_ASSERT_NOT_NULL(writeQueue);
+	UC_ASSERT_NOT_NULL(multiplexer);
+	UC_ASSERT(LWMultiplexerOpenChannel(multiplexer, 1, NULL));
+
+	// buffers come from the owner's allocator, never from the default one
+	LWCountingAllocator *defaultCountingAllocator = LWCountingAllocatorCreate(NULL);
+	LWAllocatorSetDefault(LWCountingAllocatorGetAllocator(defaultCountingAllocator));
+	uint64_t allocationCount = LWCountingAllocatorGetAllocationCount(countingAllocator);
+	UC_ASSERT(LWWriterWriteMessage(writer, message));
+	LWWriterSetChecksumEnabled(writer, true);
+	UC_ASSERT(LWWriterWriteMessage(writer, message));
+	UC_ASSERT(LWWriteQueueEnqueueMessage(writeQueue, message));
+	UC_ASSERT(LWMultiplexerSendMessage(multiplexer, 1, message));
+	UC_ASSERT(LWCountingAllocatorGetAllocationCount(countingAllocator) > allocationCount);
+	UC_ASSERT_EQUAL(0, LWCountingAllocatorGetAllocationCount(defaultCountingAllocator));
+
+	// everything allocated is freed
+	LWMultiplexerDelete(multiplexer);
+	LWWriteQueueDelete(writeQueue);
+	LWWriterDelete(writer);
+	UC_ASSERT_EQUAL(
+		LWCountingAllocatorGetAllocationCount(countingAllocator),
+		LWCountingAllocatorGetFreeCount(countingAllocator)
+	);
+	LWAllocatorSetDefault(NULL);
+	LWMessageDelete(message);
+
+	LWCountingAllocatorDelete(defaultCountingAllocator);
+	LWCountingAllocatorDelete(countingAllocator);
+}
+
+#pragma mark -
+
+void test_allocator(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("allocator");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("system",								&test_system));
+	uc_suite_add_test(suite, uc_test_create("counting",								&test_counting));
+	uc_suite_add_test(suite, uc_test_create("default",								&test_default));
+	uc_suite_add_test(suite, uc_test_create("data handler",							&test_data_handler));
+	uc_suite_add_test(suite, uc_test_create("objects",								&test_objects));
+	uc_suite_add_test(suite, uc_test_create("buffers",								&test_buffers));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
@@ -0,0 +1,232 @@
+/*
+ * LWArenaTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWArena.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+
+#pragma mark -
+
+static void test_allocate(void)
+{
+	LWArena *arena = LWArenaCreate(256);
+	UC_ASSERT_NOT_NULL(arena);
+	LWAllocator *allocator = LWArenaGetAllocator(arena);
+	UC_ASSERT_EQUAL(0, LWArenaGetUsedLength(arena));
+
+	// blocks are aligned and do not overlap
+	uint8_t *a = LWAllocatorAllocate(allocator, 3);
+	uint8_t *b = LWAllocatorAllocate(allocator, 5);
+	UC_ASSERT_NOT_NULL(a);
+	UC_ASSERT_NOT_NULL(b);
+	UC_ASSERT_EQUAL(0, (uintptr_t)a % 16);
+	UC_ASSERT_EQUAL(0, (uintptr_t)b % 16);
+	UC_ASSERT(b >= a + 3);
+	memset(a, 1, 3);
+	memset(b, 2, 5);
+	UC_ASSERT_EQUAL(1, a[2]);
+	UC_ASSERT_EQUAL(8, LWArenaGetUsedLength(arena));
+
+	// blocks larger than a chunk get a chunk of their own
+	uint8_t *c = LWAllocatorAllocate(allocator, 1000);
+	UC_ASSERT_NOT_NULL(c);
+	memset(c, 3, 1000);
+	UC_ASSERT_EQUAL(1008, LWArenaGetUsedLength(arena));
+
+	// freeing does nothing
+	LWAllocatorFree(allocator, a);
+	UC_ASSERT_EQUAL(1, a[0]);
+
+	LWArenaDelete(arena);
+}
+
+static void test_reallocate(void)
+{
+	LWArena *arena = LWArenaCreate(0);
+	LWAllocator *allocator = LWArenaGetAllocator(arena);
+
+	// most recent block grows in place
+	uint8_t *a = LWAllocatorReallocate(allocator, NULL, 8);
+	memcpy(a, "abcdefgh", 8);
+	UC_ASSERT_EQUAL(a, LWAllocatorReallocate(allocator, a, 64));
+	UC_ASSERT_EQUAL(64, LWArenaGetUsedLength(arena));
+
+	// older blocks are moved
+	uint8_t *b = LWAllocatorAllocate(allocator, 8);
+	UC_ASSERT_NOT_NULL(b);
+	uint8_t *newA = LWAllocatorReallocate(allocator, a, 128);
+	UC_ASSERT(newA != a);
+	UC_ASSERT_EQUAL(0, memcmp(newA, "abcdefgh", 8));
+
+	// shrinking keeps contents
+	newA = LWAllocatorReallocate(allocator, newA, 4);
+	UC_ASSERT_EQUAL(0, memcmp(newA, "abcd", 4));
+
+	LWArenaDelete(arena);
+}
+
+static void test_reset(void)
+{
+	LWArena *arena = LWArenaCreate(128);
+	LWAllocator *allocator = LWArenaGetAllocator(arena);
+
+	// reset rewinds the first chunk
+	void *a = LWAllocatorAllocate(allocator, 16);
+	for(size_t i = 0; i < 32; ++i)
+		UC_ASSERT_NOT_NULL(LWAllocatorAllocate(allocator, 100));
+	LWArenaReset(arena);
+	UC_ASSERT_EQUAL(0, LWArenaGetUsedLength(arena));
+	UC_ASSERT_NULL(arena->firstChunk->next);
+	UC_ASSERT_EQUAL(a, LWAllocatorAllocate(allocator, 16));
+
+	// resetting an empty arena does nothing
+	LWArena *emptyArena = LWArenaCreate(0);
+	LWArenaReset(emptyArena);
+	UC_ASSERT_EQUAL(0, LWArenaGetUsedLength(emptyArena));
+	LWArenaDelete(emptyArena);
+
+	LWArenaDelete(arena);
+}
+
+static void test_message(void)
+{
+	LWArena *arena = LWArenaCreate(0);
+	LWAllocator *allocator = LWArenaGetAllocator(arena);
+
+	// deserialize into arena
+	size_t bytesUsed;
+	uint8_t data[] = { 7, 3, 'a', 'b', 'c', 1, 'd', 0 };
+	LWMessage *message = LWMessageDeserializeWithAllocator(data, sizeof(data), &bytesUsed, allocator);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(sizeof(data), bytesUsed);
+	UC_ASSERT_EQUAL(7, message->messageID);
+	UC_ASSERT_EQUAL(2, message->argumentCount);
+	UC_ASSERT_EQUAL(allocator, message->allocator);
+	UC_ASSERT_EQUAL(allocator, message->arguments[0]->allocator);
+	UC_ASSERT_EQUAL(0, memcmp("abc", LWArgumentGetData(message->arguments[0]), 3));
+	UC_ASSERT(LWArenaGetUsedLength(arena) > 0);
+
+	// adding arguments grows the argument list in the arena
+	for(size_t i = 0; i < 10; ++i)
+		LWMessageAddArgument(message, LWArgumentCreateWithAllocator("x", 1, allocator));
+	UC_ASSERT_EQUAL(12, message->argumentCount);
+	UC_ASSERT_EQUAL(0, memcmp("d", LWArgumentGetData(message->arguments[1]), 1));
+
+	// deleting is harmless, memory is reclaimed by resetting
+	LWMessageDelete(message);
+	LWArenaReset(arena);
+	UC_ASSERT_EQUAL(0, LWArenaGetUsedLength(arena));
+
+	LWArenaDelete(arena);
+}
+
+static void test_deserialize(void)
+{
+	LWArena *arena = LWArenaCreate(0);
+
+	// arguments of 1, 255 and 300 bytes
+	uint8_t data[600] = { 9, 1, 'x', 255 };
+	data[259] = 0;
+	data[260] = 255;
+	data[516] = 45;
+	data[562] = 0;
+
+	// incomplete messages are not deserialized
+	size_t bytesUsed;
+	UC_ASSERT_NULL(LWMessageDeserializeInArena(data, 562, &bytesUsed, arena));
+	UC_ASSERT_EQUAL(0, LWArenaGetUsedLength(arena));
+
+	LWMessage *message = LWMessageDeserializeInArena(data, sizeof(data), &bytesUsed, arena);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(563, bytesUsed);
+	UC_ASSERT_EQUAL(9, message->messageID);
+	UC_ASSERT_EQUAL(3, message->argumentCount);
+	UC_ASSERT_EQUAL(LWArenaGetAllocator(arena), message->allocator);
+	UC_ASSERT_EQUAL(1, LWArgumentGetLength(message->arguments[0]));
+	UC_ASSERT_EQUAL(255, LWArgumentGetLength(message->arguments[1]));
+	UC_ASSERT_EQUAL(300, LWArgumentGetLength(message->arguments[2]));
+	UC_ASSERT_EQUAL('x', ((uint8_t *)LWArgumentGetData(message->arguments[0]))[0]);
+	UC_ASSERT_EQUAL(0, ((uint8_t *)LWArgumentGetData(message->arguments[0]))[1]);
+	UC_ASSERT_EQUAL(0, ((uint8_t *)LWArgumentGetData(message->arguments[2]))[300]);
+
+	// same contents as a message deserialized the usual way
+	size_t otherBytesUsed;
+	LWMessage *otherMessage = LWMessageDeserialize(data, sizeof(data), &otherBytesUsed);
+	UC_ASSERT_EQUAL(bytesUsed, otherBytesUsed);
+	UC_ASSERT_EQUAL(LWMessageGetSerializedLength(otherMessage), LWMessageGetSerializedLength(message));
+	for(size_t i = 0; i < 3; ++i)
+		UC_ASSERT_EQUAL(0, memcmp(LWArgumentGetData(otherMessage->arguments[i]), LWArgumentGetData(message->arguments[i]), LWArgumentGetLength(message->arguments[i])));
+	LWMessageDelete(otherMessage);
+
+	// arguments can still be added and retained
+	LWArgument *argument = LWArgumentRetain(message->arguments[2]);
+	LWMessageAddArgument(message, LWArgumentCreateWithAllocator("y", 1, LWArenaGetAllocator(arena)));
+	UC_ASSERT_EQUAL(4, message->argumentCount);
+	LWMessageDelete(message);
+	UC_ASSERT_EQUAL(300, LWArgumentGetLength(argument));
+	LWArgumentRelease(argument);
+
+	LWArenaDelete(arena);
+}
+
+#pragma mark -
+
+void test_arena(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("arena");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("allocate",								&test_allocate));
+	uc_suite_add_test(suite, uc_test_create("reallocate",							&test_reallocate));
+	uc_suite_add_test(suite, uc_test_create("reset",								&test_reset));
+	uc_suite_add_test(suite, uc_test_create("message",								&test_message));
+	uc_suite_add_test(suite, uc_test_create("deserialize",							&test_deserialize));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
@@ -268,6 +268,279 @@ static void test_get_32_bit_unsigned_integer_value(void)
 	UC_ASSERT_EQUAL(32000000, LWArgumentGet32BitUnsignedIntegerValue(argument));
 }
 
+static void test_create_from_64_bit_integer(void)
+{
+	LWArgument *argument = LWArgumentCreateFrom64BitInteger(-0x0102030405060708ll);
+	UC_ASSERT_NOT_NULL(argument);
+
+	uint8_t expectedData[] = { 0xfe, 0xfd, 0xfc, 0xfb, 0xfa, 0xf9, 0xf8, 0xf8 };
+	UC_ASSERT(argument->length == 8);
+	UC_ASSERT(0 == memcmp(expectedData, argument->data, 8));
+	UC_ASSERT(-0x0102030405060708ll == LWArgumentGet64BitIntegerValue(argument));
+
+	LWArgumentDelete(argument);
+}
+
+static void test_create_from_64_bit_unsigned_integer(void)
+{
+	LWArgument *argument = LWArgumentCreateFrom64BitUnsignedInteger(0x0102030405060708ull);
+	UC_ASSERT_NOT_NULL(argument);
+
+	uint8_t expectedData[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	UC_ASSERT(argument->length == 8);
+	UC_ASSERT(0 == memcmp(expectedData, argument->data, 8));
+	UC_ASSERT(0x0102030405060708ull == LWArgumentGet64BitUnsignedIntegerValue(argument));
+
+	LWArgumentDelete(argument);
+}
+
+static void test_create_from_float(void)
+{
+	LWArgument *argument = LWArgumentCreateFromFloat(-1.5f);
+	UC_ASSERT_NOT_NULL(argument);
+
+	uint8_t expectedData[] = { 0xbf, 0xc0, 0, 0 };
+	UC_ASSERT(argument->length == 4);
+	UC_ASSERT(0 == memcmp(expectedData, argument->data, 4));
+	UC_ASSERT(-1.5f == LWArgumentGetFloatValue(argument));
+
+	LWArgumentDelete(argument);
+}
+
+static void test_create_from_double(void)
+{
+	LWArgument *argument = LWArgumentCreateFromDouble(0.1);
+	UC_ASSERT_NOT_NULL(argument);
+
+	uint8_t expectedData[] = { 0x3f, 0xb9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a };
+	UC_ASSERT(argument->length == 8);
+	UC_ASSERT(0 == memcmp(expectedData, argument->data, 8));
+	UC_ASSERT(0.1 == LWArgumentGetDoubleValue(argument));
+
+	LWArgumentDelete(argument);
+}
+
+static void test_create_from_varint(void)
+{
+	uint64_t	integers[]	= { 0, 127, 128, 300, 1ull << 56, UINT64_MAX };
+	size_t		lengths[]	= { 1, 1, 2, 2, 9, 10 };
+
+	for(size_t i = 0; i < 6; ++i)
+	{
+		LWArgument *argument = LWArgumentCreateFromVarint(integers[i]);
+		UC_ASSERT_NOT_NULL(argument);
+		UC_ASSERT_EQUAL(lengths[i], argument->length);
+
+		uint64_t integer;
+		UC_ASSERT(LWArgumentGetVarintValue(argument, &integer));
+		UC_ASSERT(integers[i] == integer);
+
+		LWArgumentDelete(argument);
+	}
+
+	// 300 is 0b10_0101100
+	LWArgument *argument = LWArgumentCreateFromVarint(300);
+	UC_ASSERT_EQUAL(0xac, argument->data[0]);
+	UC_ASSERT_EQUAL(0x02, argument->data[1]);
+	LWArgumentDelete(argument);
+}
+
+static void test_create_from_signed_varint(void)
+{
+	int64_t	integers[]	= { 0, -1, 1, -64, 64, INT64_MIN, INT64_MAX };
+	size_t	lengths[]	= { 1, 1, 1, 1, 2, 10, 10 };
+
+	for(size_t i = 0; i < 7; ++i)
+	{
+		LWArgument *argument = LWArgumentCreateFromSignedVarint(integers[i]);
+		UC_ASSERT_NOT_NULL(argument);
+		UC_ASSERT_EQUAL(lengths[i], argument->length);
+
+		int64_t integer;
+		UC_ASSERT(LWArgumentGetSignedVarintValue(argument, &integer));
+		UC_ASSERT(integers[i] == integer);
+
+		LWArgumentDelete(argument);
+	}
+}
+
+static void test_get_malformed_varint_value(void)
+{
+	uint8_t data1[] = { 0x80 };
+	uint8_t data2[] = { 0x01, 0x02 };
+	uint8_t data3[] = { 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x09, 0x01 };
+
+	// last byte continues, a byte in the middle ends, or a long varint ends early
+	uint64_t integer;
+	LWArgument *argument1 = LWArgumentCreate(data1, sizeof(data1));
+	LWArgument *argument2 = LWArgumentCreate(data2, sizeof(data2));
+	LWArgument *argument3 = LWArgumentCreate(data3, sizeof(data3));
+	UC_ASSERT(!LWArgumentGetVarintValue(argument1, &integer));
+	UC_ASSERT(!LWArgumentGetVarintValue(argument2, &integer));
+	UC_ASSERT(!LWArgumentGetVarintValue(argument3, &integer));
+
+	LWArgumentDelete(argument1);
+	LWArgumentDelete(argument2);
+	LWArgumentDelete(argument3);
+}
+
+static void test_compress(void)
+{
+	// repetitive text compresses, short arguments are left alone
+	char text[4000 + 1];
+	for(size_t i = 0; i < 4000; i += 40)
+		snprintf(text + i, 41, "{\"name\": \"lunkwill\", \"id\": %010zu},\n", i);
+	LWArgument *argument = LWArgumentCreate(text, 4000);
+	UC_ASSERT(LWArgumentCompress(argument, 4000 + 1));
+	UC_ASSERT(!LWArgumentIsCompressed(argument));
+	UC_ASSERT(LWArgumentCompress(argument, kLWArgumentDefaultCompressionThreshold));
+	UC_ASSERT(LWArgumentIsCompressed(argument));
+	UC_ASSERT(argument->compressedLength < 4000/4);
+
+	// compressed data starts with the original length
+	uint8_t decompressed[4000];
+	UC_ASSERT_EQUAL(0xa0, argument->compressedData[0]);
+	UC_ASSERT_EQUAL(0x1f, argument->compressedData[1]);
+	UC_ASSERT(LWCompressionDecompress(argument->compressedData + 2, argument->compressedLength - 2, decompressed, 4000));
+	UC_ASSERT_EQUAL(0, memcmp(text, decompressed, 4000));
+	UC_ASSERT(!LWCompressionDecompress(argument->compressedData + 2, argument->compressedLength - 2, decompressed, 4000 - 1));
+
+	// or decompressed with the length prefix
+	memset(decompressed, 0, sizeof(decompressed));
+	UC_ASSERT_EQUAL(4000, LWArgumentGetDecompressedLength(argument->compressedData, argument->compressedLength));
+	UC_ASSERT_EQUAL(0, LWArgumentGetDecompressedLength(argument->compressedData, 2));
+	UC_ASSERT(LWArgumentDecompressData(argument->compressedData, argument->compressedLength, decompressed, 4000));
+	UC_ASSERT_EQUAL(0, memcmp(text, decompressed, 4000));
+	UC_ASSERT(!LWArgumentDecompressData(argument->compressedData, argument->compressedLength, decompressed, 4000 - 1));
+
+	// the original data is unchanged
+	UC_ASSERT_EQUAL(4000, argument->length);
+	UC_ASSERT_EQUAL(0, memcmp(text, argument->data, 4000));
+	LWArgumentDelete(argument);
+}
+
+static void test_compress_patterns(void)
+{
+	// runs, short and long periods, and long literals
+	static uint8_t data[5][3000];
+	uint32_t state = 1;
+	for(size_t i = 0; i < 3000; ++i)
+	{
+		state = state*1103515245 + 12345;
+		data[0][i] = 'a';
+		data[1][i] = "abc"[i % 3];
+		data[2][i] = (uint8_t)(i % 10);
+		data[3][i] = (i < 1000 ? (uint8_t)(state >> 24) : data[3][i - 1000]);
+		data[4][i] = (uint8_t)(state >> 24);
+	}
+
+	uint8_t decompressed[3000];
+	for(size_t i = 0; i < 5; ++i)
+	{
+		LWArgument *argument = LWArgumentCreate(data[i], 3000);
+		UC_ASSERT(LWArgumentCompress(argument, 0));
+		if(4 == i)
+		{
+			// random data does not compress
+			UC_ASSERT(!LWArgumentIsCompressed(argument));
+		}
+		else
+		{
+			UC_ASSERT(LWArgumentIsCompressed(argument));
+			UC_ASSERT(LWCompressionDecompress(argument->compressedData + 2, argument->compressedLength - 2, decompressed, 3000));
+			UC_ASSERT_EQUAL(0, memcmp(data[i], decompressed, 3000));
+		}
+		LWArgumentDelete(argument);
+	}
+}
+
+static void test_create_from_arrays(void)
+{
+	int16_t	integers16[131];
+	int32_t	integers32[131];
+	int64_t	integers64[131];
+	double	doubles[131];
+	for(size_t i = 0; i < 131; ++i)
+	{
+		integers16[i]	= (int16_t)(i*0x0101 - 3000);
+		integers32[i]	= (int32_t)(i*0x01010101 - 70000);
+		integers64[i]	= (int64_t)(i*0x0101010101010101ull - 5000000000ll);
+		doubles[i]		= i*0.25 - 7;
+	}
+
+	// every length exercises a different mix of vector and scalar conversion
+	for(size_t count = 1; count <= 131; ++count)
+	{
+		LWArgument *argument16 = LWArgumentCreateFrom16BitIntegerArray(integers16, count);
+		LWArgument *argument32 = LWArgumentCreateFrom32BitIntegerArray(integers32, count);
+		LWArgument *argument64 = LWArgumentCreateFrom64BitIntegerArray(integers64, count);
+		UC_ASSERT_EQUAL(2*count, argument16->length);
+		UC_ASSERT_EQUAL(4*count, argument32->length);
+		UC_ASSERT_EQUAL(8*count, argument64->length);
+		for(size_t i = 0; i < count; ++i)
+		{
+			UC_ASSERT((uint16_t)integers16[i] == (uint16_t)(argument16->data[2*i] << 8 | argument16->data[2*i + 1]));
+			UC_ASSERT(integers32[i] == (int32_t)ntohl(*(uint32_t *)(argument32->data + 4*i)));
+			UC_ASSERT((uint32_t)((uint64_t)integers64[i] >> 32) == (uint32_t)ntohl(*(uint32_t *)(argument64->data + 8*i)));
+		}
+
+		int16_t	decodedIntegers16[131];
+		int32_t	decodedIntegers32[131];
+		int64_t	decodedIntegers64[131];
+		UC_ASSERT(LWArgumentGet16BitIntegerArrayValue(argument16, decodedIntegers16, count));
+		UC_ASSERT(LWArgumentGet32BitIntegerArrayValue(argument32, decodedIntegers32, count));
+		UC_ASSERT(LWArgumentGet64BitIntegerArrayValue(argument64, decodedIntegers64, count));
+		UC_ASSERT(0 == memcmp(integers16, decodedIntegers16, count*sizeof(int16_t)));
+		UC_ASSERT(0 == memcmp(integers32, decodedIntegers32, count*sizeof(int32_t)));
+		UC_ASSERT(0 == memcmp(integers64, decodedIntegers64, count*sizeof(int64_t)));
+
+		LWArgumentDelete(argument16);
+		LWArgumentDelete(argument32);
+		LWArgumentDelete(argument64);
+	}
+
+	// floating-point arrays match their scalar counterparts
+	float floats[3] = { -1.5f, 0, 1e10f };
+	LWArgument *floatArgument = LWArgumentCreateFromFloatArray(floats, 3);
+	LWArgument *doubleArgument = LWArgumentCreateFromDoubleArray(doubles, 131);
+	LWArgument *floatScalarArgument = LWArgumentCreateFromFloat(-1.5f);
+	LWArgument *doubleScalarArgument = LWArgumentCreateFromDouble(doubles[130]);
+	UC_ASSERT(0 == memcmp(floatScalarArgument->data, floatArgument->data, 4));
+	UC_ASSERT(0 == memcmp(doubleScalarArgument->data, doubleArgument->data + 8*130, 8));
+
+	float	decodedFloats[3];
+	double	decodedDoubles[131];
+	UC_ASSERT(LWArgumentGetFloatArrayValue(floatArgument, decodedFloats, 3));
+	UC_ASSERT(LWArgumentGetDoubleArrayValue(doubleArgument, decodedDoubles, 131));
+	UC_ASSERT(0 == memcmp(floats, decodedFloats, sizeof(floats)));
+	UC_ASSERT(0 == memcmp(doubles, decodedDoubles, sizeof(doubles)));
+
+	// the element count has to match
+	UC_ASSERT(!LWArgumentGetFloatArrayValue(floatArgument, decodedFloats, 2));
+	UC_ASSERT(!LWArgumentGetDoubleArrayValue(floatArgument, decodedDoubles, 1));
+	UC_ASSERT_NULL(LWArgumentCreateFromDoubleArray(doubles, 0));
+
+	LWArgumentDelete(floatArgument);
+	LWArgumentDelete(doubleArgument);
+	LWArgumentDelete(floatScalarArgument);
+	LWArgumentDelete(doubleScalarArgument);
+}
+
+static void test_retain_release(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	UC_ASSERT_EQUAL(1, argument->retainCount);
+
+	UC_ASSERT_EQUAL(argument, LWArgumentRetain(argument));
+	UC_ASSERT_EQUAL(2, argument->retainCount);
+
+	LWArgumentRelease(argument);
+	UC_ASSERT_EQUAL(1, argument->retainCount);
+	UC_ASSERT_EQUAL(5, LWArgumentGetLength(argument));
+
+	LWArgumentRelease(argument);
+}
+
 #pragma mark -
 
 void test_argument(void)
@@ -297,6 +570,17 @@ void test_argument(void)
 	uc_suite_add_test(suite, uc_test_create("get 16 bit unsigned integer value",	&test_get_16_bit_unsigned_integer_value));
 	uc_suite_add_test(suite, uc_test_create("get 32 bit integer value",				&test_get_32_bit_integer_value));
 	uc_suite_add_test(suite, uc_test_create("get 32 bit unsigned integer value",	&test_get_32_bit_unsigned_integer_value));
+	uc_suite_add_test(suite, uc_test_create("create from 64 bit integer",			&test_create_from_64_bit_integer));
+	uc_suite_add_test(suite, uc_test_create("create from 64 bit unsigned integer",	&test_create_from_64_bit_unsigned_integer));
+	uc_suite_add_test(suite, uc_test_create("create from float",					&test_create_from_float));
+	uc_suite_add_test(suite, uc_test_create("create from double",					&test_create_from_double));
+	uc_suite_add_test(suite, uc_test_create("create from varint",					&test_create_from_varint));
+	uc_suite_add_test(suite, uc_test_create("create from signed varint",			&test_create_from_signed_varint));
+	uc_suite_add_test(suite, uc_test_create("get malformed varint value",			&test_get_malformed_varint_value));
+	uc_suite_add_test(suite, uc_test_create("create from arrays",					&test_create_from_arrays));
+	uc_suite_add_test(suite, uc_test_create("compress",								&test_compress));
+	uc_suite_add_test(suite, uc_test_create("compress patterns",					&test_compress_patterns));
+	uc_suite_add_test(suite, uc_test_create("retain release",						&test_retain_release));
 
 	/* run suite */
 	uc_suite_run(suite);
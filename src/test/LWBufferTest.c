@@ -0,0 +1,116 @@
+/*
+ * LWBufferTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWAllocator.h>
+#include <Lunkwill/LWBuffer.h>
+
+static void test_create(void)
+{
+	uint8_t data[] = { 7, 2, 4 };
+
+	LWBuffer *buffer = LWBufferCreate(data, 3);
+	UC_ASSERT_NOT_NULL(buffer);
+	UC_ASSERT_EQUAL(1, buffer->retainCount);
+	UC_ASSERT_EQUAL(3, LWBufferGetLength(buffer));
+	UC_ASSERT(0 == memcmp(data, LWBufferGetData(buffer), 3));
+
+	data[0] = 3;
+
+	UC_ASSERT_EQUAL(7, ((uint8_t *)LWBufferGetData(buffer))[0]);
+
+	LWBufferRelease(buffer);
+}
+
+static void test_create_from_message(void)
+{
+	LWArgument *argument1 = LWArgumentCreateFrom8BitUnsignedInteger(8);
+	LWArgument *argument2 = LWArgumentCreateFrom8BitUnsignedInteger(4);
+	LWMessage *message = LWMessageCreate(123, argument1, argument2, NULL);
+
+	LWBuffer *buffer = LWBufferCreateFromMessage(message);
+	UC_ASSERT_NOT_NULL(buffer);
+
+	void *serializedMessage;
+	size_t serializedMessageLength;
+	UC_ASSERT(LWMessageSerialize(message, &serializedMessageLength, &serializedMessage));
+	UC_ASSERT_EQUAL(serializedMessageLength, LWBufferGetLength(buffer));
+	UC_ASSERT(0 == memcmp(serializedMessage, LWBufferGetData(buffer), serializedMessageLength));
+
+	LWAllocatorFree(NULL, serializedMessage);
+	LWBufferRelease(buffer);
+	LWMessageDelete(message);
+}
+
+static void test_retain_release(void)
+{
+	uint8_t data[] = { 7, 2, 4 };
+
+	LWBuffer *buffer = LWBufferCreate(data, 3);
+	UC_ASSERT_EQUAL(buffer, LWBufferRetain(buffer));
+	UC_ASSERT_EQUAL(2, buffer->retainCount);
+
+	LWBufferRelease(buffer);
+	UC_ASSERT_EQUAL(1, buffer->retainCount);
+
+	LWBufferRelease(buffer);
+}
+
+#pragma mark -
+
+void test_buffer(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("buffer");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("create from message",					&test_create_from_message));
+	uc_suite_add_test(suite, uc_test_create("retain release",						&test_retain_release));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
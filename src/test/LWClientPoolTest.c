@@ -0,0 +1,406 @@
+/*
+ * LWClientPoolTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define _XOPEN_SOURCE (600)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWRPC.h>
+#include <Lunkwill/LWClientPool.h>
+
+#define kTestRequestMessageID	(1)
+#define kTestResponseMessageID	(2)
+#define kTestMaxClientCount		(8)
+#define kTestMaxHeldCount		(64)
+
+struct test_client {
+	int				fileDescriptor;
+	LWDataHandler	*dataHandler;
+	LWWriter		*writer;
+	uint32_t		requestCount;
+	struct test_server	*server;
+};
+
+struct test_server {
+	int					listenFileDescriptor;
+	struct sockaddr_un	address;
+	struct test_client	clients[kTestMaxClientCount];
+	size_t				clientCount;
+	uint32_t			requestCount;
+
+	// responses held back until released
+	bool				isHoldingResponses;
+	struct test_client	*heldClients[kTestMaxHeldCount];
+	uint32_t			heldCorrelationIDs[kTestMaxHeldCount];
+	uint32_t			heldValues[kTestMaxHeldCount];
+	size_t				heldCount;
+};
+
+uint32_t gPoolResponseCount;
+uint32_t gPoolMismatchCount;
+uint32_t gPoolCancelledCount;
+uint32_t gPoolRetryFailedCount;
+
+#pragma mark -
+
+static void respond(struct test_client *aClient, uint32_t aCorrelationID, uint32_t aValue)
+{
+	LWMessage *response = LWMessageCreate(kTestResponseMessageID, LWArgumentCreateFrom32BitUnsignedInteger(aValue), NULL);
+	LWRPCWriteResponse(aClient->writer, aCorrelationID, response);
+	LWWriterFlush(aClient->writer);
+	LWMessageDelete(response);
+}
+
+static void request_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler)
+
+	struct test_client *client = aUserInfo;
+	struct test_server *server = client->server;
+	++client->requestCount;
+	++server->requestCount;
+
+	// echo request value back
+	uint32_t correlationID;
+	LWRPCGetCorrelationID(aMessage, &correlationID);
+	uint32_t value = LWArgumentGet32BitUnsignedIntegerValue(aMessage->arguments[1]);
+	if(server->isHoldingResponses && server->heldCount < kTestMaxHeldCount)
+	{
+		server->heldClients[server->heldCount]			= client;
+		server->heldCorrelationIDs[server->heldCount]	= correlationID;
+		server->heldValues[server->heldCount]			= value;
+		++server->heldCount;
+	}
+	else
+		respond(client, correlationID, value);
+}
+
+static void rpc_response_callback(LWRPC *aRPC, LWMessage *aResponse, void *aContext)
+{
+#pragma unused (aRPC)
+
+	// called on the client pool's thread
+	if(!aResponse)
+	{
+		LW_ATOMIC_INCREMENT(&gPoolCancelledCount);
+		return;
+	}
+
+	if(LWArgumentGet32BitUnsignedIntegerValue(aResponse->arguments[1]) != (uint32_t)(uintptr_t)aContext)
+		LW_ATOMIC_INCREMENT(&gPoolMismatchCount);
+	LW_ATOMIC_INCREMENT(&gPoolResponseCount);
+}
+
+static void retry_response_callback(LWRPC *aRPC, LWMessage *aResponse, void *aContext)
+{
+#pragma unused (aRPC)
+
+	if(aResponse)
+	{
+		LW_ATOMIC_INCREMENT(&gPoolResponseCount);
+		return;
+	}
+
+	// retry on another connection; the failed one must not be picked
+	LW_ATOMIC_INCREMENT(&gPoolCancelledCount);
+	LWMessage *request = LWMessageCreate(kTestRequestMessageID, LWArgumentCreateFrom32BitUnsignedInteger(0), NULL);
+	if(!LWClientPoolSendRequest(aContext, request, &retry_response_callback, aContext))
+		LW_ATOMIC_INCREMENT(&gPoolRetryFailedCount);
+	LWMessageDelete(request);
+}
+
+#pragma mark -
+
+static void server_start(struct test_server *aServer)
+{
+	memset(aServer, 0, sizeof(struct test_server));
+
+	aServer->address.sun_family = AF_UNIX;
+	snprintf(aServer->address.sun_path, sizeof(aServer->address.sun_path), "/tmp/lunkwill-test-%d.sock", (int)getpid());
+	unlink(aServer->address.sun_path);
+
+	aServer->listenFileDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+	UC_ASSERT(0 == bind(aServer->listenFileDescriptor, (struct sockaddr *)&aServer->address, sizeof(aServer->address)));
+	UC_ASSERT(0 == listen(aServer->listenFileDescriptor, kTestMaxClientCount));
+}
+
+static void server_close_clients(struct test_server *aServer)
+{
+	for(size_t i = 0; i < aServer->clientCount; ++i)
+	{
+		close(aServer->clients[i].fileDescriptor);
+		LWDataHandlerDelete(aServer->clients[i].dataHandler);
+		LWWriterDelete(aServer->clients[i].writer);
+	}
+	aServer->clientCount	= 0;
+	aServer->heldCount		= 0;
+}
+
+static void server_stop(struct test_server *aServer)
+{
+	server_close_clients(aServer);
+	close(aServer->listenFileDescriptor);
+	unlink(aServer->address.sun_path);
+}
+
+static void server_release_responses(struct test_server *aServer)
+{
+	for(size_t i = 0; i < aServer->heldCount; ++i)
+		respond(aServer->heldClients[i], aServer->heldCorrelationIDs[i], aServer->heldValues[i]);
+	aServer->heldCount			= 0;
+	aServer->isHoldingResponses	= false;
+}
+
+static void server_serve(struct test_server *aServer, int aTimeout)
+{
+	// wait for clients and requests
+	struct pollfd pollFileDescriptors[1 + kTestMaxClientCount];
+	pollFileDescriptors[0].fd		= aServer->listenFileDescriptor;
+	pollFileDescriptors[0].events	= POLLIN;
+	for(size_t i = 0; i < aServer->clientCount; ++i)
+	{
+		pollFileDescriptors[1 + i].fd		= aServer->clients[i].fileDescriptor;
+		pollFileDescriptors[1 + i].events	= POLLIN;
+	}
+	size_t clientCount = aServer->clientCount;
+	if(poll(pollFileDescriptors, 1 + clientCount, aTimeout) <= 0)
+		return;
+
+	// accept new client
+	if(pollFileDescriptors[0].revents && aServer->clientCount < kTestMaxClientCount)
+	{
+		struct test_client *client = &aServer->clients[aServer->clientCount++];
+		client->fileDescriptor	= accept(aServer->listenFileDescriptor, NULL, NULL);
+		client->dataHandler		= LWDataHandlerCreate(client);
+		client->writer			= LWWriterCreate(client->fileDescriptor, NULL);
+		client->requestCount	= 0;
+		client->server			= aServer;
+		LWDataHandlerSetMessageCallback(client->dataHandler, kTestRequestMessageID, &request_callback);
+	}
+
+	// handle requests
+	for(size_t i = 0; i < clientCount; ++i)
+	{
+		if(!pollFileDescriptors[1 + i].revents)
+			continue;
+
+		uint8_t buffer[4096];
+		ssize_t length = read(aServer->clients[i].fileDescriptor, buffer, sizeof(buffer));
+		if(length > 0)
+			LWDataHandlerHandleData(aServer->clients[i].dataHandler, buffer, (size_t)length);
+	}
+}
+
+static LWClientPool *client_pool_create(struct test_server *aServer, size_t aConnectionCount)
+{
+	LWClientPool *clientPool = LWClientPoolCreate((struct sockaddr *)&aServer->address, sizeof(aServer->address), aConnectionCount);
+	LWClientPoolSetResponseMessageID(clientPool, kTestResponseMessageID);
+	LWClientPoolSetReconnectInterval(clientPool, 10);
+
+	// wait for all connections
+	UC_ASSERT(LWClientPoolWaitForConnection(clientPool, 5000));
+	for(int i = 0; i < 500 && (LWClientPoolGetConnectedCount(clientPool) < aConnectionCount || aServer->clientCount < aConnectionCount); ++i)
+		server_serve(aServer, 10);
+	UC_ASSERT_EQUAL(aConnectionCount, LWClientPoolGetConnectedCount(clientPool));
+	UC_ASSERT_EQUAL(aConnectionCount, aServer->clientCount);
+
+	return clientPool;
+}
+
+static void send_request(LWClientPool *aClientPool, uint32_t aValue)
+{
+	LWMessage *request = LWMessageCreate(kTestRequestMessageID, LWArgumentCreateFrom32BitUnsignedInteger(aValue), NULL);
+	UC_ASSERT(LWClientPoolSendRequest(aClientPool, request, &rpc_response_callback, (void *)(uintptr_t)aValue));
+	LWMessageDelete(request);
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, "/tmp/lunkwill-test-nonexistent.sock");
+
+	// pool without server never connects
+	LWClientPool *clientPool = LWClientPoolCreate((struct sockaddr *)&address, sizeof(address), 2);
+	UC_ASSERT_NOT_NULL(clientPool);
+	UC_ASSERT(!LWClientPoolWaitForConnection(clientPool, 50));
+	UC_ASSERT_EQUAL(0, LWClientPoolGetConnectedCount(clientPool));
+
+	// requests fail without connections
+	LWMessage *request = LWMessageCreate(kTestRequestMessageID, NULL);
+	UC_ASSERT(!LWClientPoolSendRequest(clientPool, request, &rpc_response_callback, NULL));
+	LWMessageDelete(request);
+
+	LWClientPoolDelete(clientPool);
+}
+
+static void test_route_requests(void)
+{
+	struct test_server server;
+	server_start(&server);
+	LWClientPool *clientPool = client_pool_create(&server, 4);
+
+	gPoolResponseCount	= 0;
+	gPoolMismatchCount	= 0;
+	gPoolCancelledCount	= 0;
+
+	// requests go to the least loaded connection
+	server.isHoldingResponses = true;
+	for(uint32_t i = 0; i < 8; ++i)
+		send_request(clientPool, i);
+	for(int i = 0; i < 500 && server.requestCount < 8; ++i)
+		server_serve(&server, 10);
+	UC_ASSERT_EQUAL(8, server.requestCount);
+	for(size_t i = 0; i < 4; ++i)
+		UC_ASSERT_EQUAL(2, server.clients[i].requestCount);
+
+	// responses complete out of band
+	server_release_responses(&server);
+	for(uint32_t i = 8; i < 1000; ++i)
+		send_request(clientPool, i);
+	for(int i = 0; i < 2000 && LW_ATOMIC_LOAD(&gPoolResponseCount) < 1000; ++i)
+		server_serve(&server, 10);
+	UC_ASSERT_EQUAL(1000, LW_ATOMIC_LOAD(&gPoolResponseCount));
+	UC_ASSERT_EQUAL(0, LW_ATOMIC_LOAD(&gPoolMismatchCount));
+	UC_ASSERT_EQUAL(0, LW_ATOMIC_LOAD(&gPoolCancelledCount));
+
+	LWClientPoolDelete(clientPool);
+	server_stop(&server);
+}
+
+static void test_reconnect(void)
+{
+	struct test_server server;
+	server_start(&server);
+	LWClientPool *clientPool = client_pool_create(&server, 4);
+
+	gPoolResponseCount	= 0;
+	gPoolCancelledCount	= 0;
+
+	// requests in flight fail when connections drop
+	server.isHoldingResponses = true;
+	for(uint32_t i = 0; i < 4; ++i)
+		send_request(clientPool, i);
+	for(int i = 0; i < 500 && server.requestCount < 4; ++i)
+		server_serve(&server, 10);
+	server_close_clients(&server);
+	server.isHoldingResponses = false;
+
+	// connections come back in the background
+	for(int i = 0; i < 500 && (LW_ATOMIC_LOAD(&gPoolCancelledCount) < 4 || server.clientCount < 4 || LWClientPoolGetConnectedCount(clientPool) < 4); ++i)
+		server_serve(&server, 10);
+	UC_ASSERT_EQUAL(4, LW_ATOMIC_LOAD(&gPoolCancelledCount));
+	UC_ASSERT_EQUAL(4, LWClientPoolGetConnectedCount(clientPool));
+
+	send_request(clientPool, 123);
+	for(int i = 0; i < 500 && LW_ATOMIC_LOAD(&gPoolResponseCount) < 1; ++i)
+		server_serve(&server, 10);
+	UC_ASSERT_EQUAL(1, LW_ATOMIC_LOAD(&gPoolResponseCount));
+
+	LWClientPoolDelete(clientPool);
+	server_stop(&server);
+}
+
+static void test_retry_during_disconnect(void)
+{
+	struct test_server server;
+	server_start(&server);
+	LWClientPool *clientPool = client_pool_create(&server, 1);
+
+	gPoolResponseCount		= 0;
+	gPoolCancelledCount		= 0;
+	gPoolRetryFailedCount	= 0;
+
+	// failed requests retried from their callback
+	server.isHoldingResponses = true;
+	LWMessage *request = LWMessageCreate(kTestRequestMessageID, LWArgumentCreateFrom32BitUnsignedInteger(0), NULL);
+	UC_ASSERT(LWClientPoolSendRequest(clientPool, request, &retry_response_callback, clientPool));
+	LWMessageDelete(request);
+	for(int i = 0; i < 500 && server.requestCount < 1; ++i)
+		server_serve(&server, 10);
+	server_close_clients(&server);
+	server.isHoldingResponses = false;
+
+	// the only connection is gone, so the retry fails right away
+	for(int i = 0; i < 500 && LW_ATOMIC_LOAD(&gPoolCancelledCount) < 1; ++i)
+		server_serve(&server, 10);
+	UC_ASSERT_EQUAL(1, LW_ATOMIC_LOAD(&gPoolCancelledCount));
+	UC_ASSERT_EQUAL(1, LW_ATOMIC_LOAD(&gPoolRetryFailedCount));
+	UC_ASSERT_EQUAL(0, LW_ATOMIC_LOAD(&gPoolResponseCount));
+
+	LWClientPoolDelete(clientPool);
+	server_stop(&server);
+}
+
+#pragma mark -
+
+void test_client_pool(void)
+{
+	// writing to a closed connection must not kill the test
+	signal(SIGPIPE, SIG_IGN);
+
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("client pool");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("route requests",						&test_route_requests));
+	uc_suite_add_test(suite, uc_test_create("reconnect",							&test_reconnect));
+	uc_suite_add_test(suite, uc_test_create("retry during disconnect",				&test_retry_during_disconnect));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
@@ -0,0 +1,205 @@
+/*
+ * LWDataHandlerStatsTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWDataHandlerStats.h>
+#include <Lunkwill/LWValidator.h>
+
+uint32_t gStatsMessageCount;
+
+#pragma mark -
+
+static bool validate_invalid_message(LWMessage *aMessage)
+{
+#pragma unused (aMessage)
+
+	return false;
+}
+
+static void message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aMessage, aUserInfo)
+
+	++gStatsMessageCount;
+}
+
+static void disabling_message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aMessage, aUserInfo)
+
+	++gStatsMessageCount;
+	LWDataHandlerSetStatsEnabled(aDataHandler, false);
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	LWDataHandlerStats *stats = LWDataHandlerStatsCreate();
+	UC_ASSERT_NOT_NULL(stats);
+	UC_ASSERT_EQUAL(0, LWDataHandlerStatsGetMessageCount(stats, 1));
+	UC_ASSERT_EQUAL(0, LWDataHandlerStatsGetBufferHighWaterMark(stats));
+	UC_ASSERT_EQUAL(0, LWDataHandlerStatsGetCallbackTimeCount(stats, 1, 0));
+	UC_ASSERT_EQUAL(0, LWDataHandlerStatsGetCallbackTimePercentile(stats, 1, 50.0));
+	UC_ASSERT_NULL(stats->callbackTimeHistograms[1]);
+	LWDataHandlerStatsDelete(stats);
+}
+
+static void test_add(void)
+{
+	LWDataHandlerStats *stats = LWDataHandlerStatsCreate();
+	LWDataHandlerStats *otherStats = LWDataHandlerStatsCreate();
+
+	stats->messageCounts[1]			= 2;
+	stats->bufferHighWaterMark		= 100;
+	otherStats->messageCounts[1]	= 3;
+	otherStats->byteCounts[1]		= 40;
+	otherStats->invalidMessageCount	= 1;
+	otherStats->bufferHighWaterMark	= 50;
+	otherStats->callbackTimeHistograms[1] = calloc(kLWDataHandlerStatsBucketCount, sizeof(uint64_t));
+	otherStats->callbackTimeHistograms[1][4] = 3;
+
+	// counters add up, high-water marks do not
+	UC_ASSERT(LWDataHandlerStatsAdd(stats, otherStats));
+	UC_ASSERT(LWDataHandlerStatsAdd(stats, otherStats));
+	UC_ASSERT_EQUAL(8, LWDataHandlerStatsGetMessageCount(stats, 1));
+	UC_ASSERT_EQUAL(80, LWDataHandlerStatsGetByteCount(stats, 1));
+	UC_ASSERT_EQUAL(2, LWDataHandlerStatsGetInvalidMessageCount(stats));
+	UC_ASSERT_EQUAL(100, LWDataHandlerStatsGetBufferHighWaterMark(stats));
+	UC_ASSERT_EQUAL(6, LWDataHandlerStatsGetCallbackTimeCount(stats, 1, 4));
+	UC_ASSERT_EQUAL(15, LWDataHandlerStatsGetCallbackTimePercentile(stats, 1, 99.0));
+	UC_ASSERT_NULL(stats->callbackTimeHistograms[2]);
+
+	// reset keeps histograms
+	LWDataHandlerStatsReset(stats);
+	UC_ASSERT_EQUAL(0, LWDataHandlerStatsGetMessageCount(stats, 1));
+	UC_ASSERT_EQUAL(0, LWDataHandlerStatsGetCallbackTimeCount(stats, 1, 4));
+	UC_ASSERT_NOT_NULL(stats->callbackTimeHistograms[1]);
+
+	LWDataHandlerStatsDelete(otherStats);
+	LWDataHandlerStatsDelete(stats);
+}
+
+static void test_data_handler(void)
+{
+	uint8_t data[] = { 123, 1, 7, 0, 123, 1, 8, 0, 50, 1, 1, 0, 124, 1, 2, 0 };
+
+	LWValidator *validator = LWValidatorCreate();
+	LWValidatorSetMessageValidationCallback(validator, 124, &validate_invalid_message);
+
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 124, &message_callback);
+	LWDataHandlerSetValidator(dataHandler, validator);
+
+	// stats are off by default
+	UC_ASSERT_NULL(LWDataHandlerGetStats(dataHandler));
+	UC_ASSERT(LWDataHandlerSetStatsEnabled(dataHandler, true));
+	LWDataHandlerStats *stats = LWDataHandlerGetStats(dataHandler);
+	UC_ASSERT_NOT_NULL(stats);
+
+	// split in the middle of a message
+	gStatsMessageCount = 0;
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 10));
+	UC_ASSERT_EQUAL(2, LWDataHandlerStatsGetCarryOverByteCount(stats));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 10, sizeof(data) - 10));
+	UC_ASSERT_EQUAL(2, gStatsMessageCount);
+	UC_ASSERT_EQUAL(2, LWDataHandlerStatsGetCarryOverByteCount(stats));
+	UC_ASSERT_EQUAL(2, LWDataHandlerStatsGetMessageCount(stats, 123));
+	UC_ASSERT_EQUAL(8, LWDataHandlerStatsGetByteCount(stats, 123));
+	UC_ASSERT_EQUAL(1, LWDataHandlerStatsGetMessageCount(stats, 50));
+	UC_ASSERT_EQUAL(1, LWDataHandlerStatsGetMessageCount(stats, 124));
+	UC_ASSERT_EQUAL(1, LWDataHandlerStatsGetUnrecognisedMessageCount(stats));
+	UC_ASSERT_EQUAL(1, LWDataHandlerStatsGetInvalidMessageCount(stats));
+	UC_ASSERT_EQUAL(10, LWDataHandlerStatsGetBufferHighWaterMark(stats));
+	UC_ASSERT_EQUAL(0, LWDataHandlerStatsGetReallocationCount(stats));
+
+	// only called callbacks are timed
+	uint64_t callbackCount = 0;
+	for(size_t i = 0; i < kLWDataHandlerStatsBucketCount; ++i)
+		callbackCount += LWDataHandlerStatsGetCallbackTimeCount(stats, 123, i);
+	UC_ASSERT_EQUAL(2, callbackCount);
+	UC_ASSERT_NULL(stats->callbackTimeHistograms[124]);
+
+	// large messages grow the buffer
+	uint8_t argumentData[400] = { 0 };
+	LWMessage *message = LWMessageCreate(123, LWArgumentCreate(argumentData, sizeof(argumentData)), NULL);
+	size_t length;
+	void *serializedMessage;
+	UC_ASSERT(LWMessageSerialize(message, &length, &serializedMessage));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, serializedMessage, length));
+	UC_ASSERT_EQUAL(1, LWDataHandlerStatsGetReallocationCount(stats));
+	UC_ASSERT_EQUAL(length, LWDataHandlerStatsGetBufferHighWaterMark(stats));
+	free(serializedMessage);
+	LWMessageDelete(message);
+
+	// stats can be turned off from within a callback
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &disabling_message_callback);
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 8));
+	UC_ASSERT_NULL(LWDataHandlerGetStats(dataHandler));
+	UC_ASSERT_EQUAL(5, gStatsMessageCount);
+
+	LWDataHandlerDelete(dataHandler);
+	LWValidatorDelete(validator);
+}
+
+#pragma mark -
+
+void test_data_handler_stats(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("data handler stats");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("add",									&test_add));
+	uc_suite_add_test(suite, uc_test_create("data handler",							&test_data_handler));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
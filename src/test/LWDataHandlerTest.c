@@ -34,6 +34,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <uctest/uctest.h>
 
@@ -41,11 +43,21 @@
 #include <Lunkwill/LunkwillTypes.h>
 #include <Lunkwill/LWArgument.h>
 #include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWArena.h>
 #include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWDataHandlerStats.h>
 #include <Lunkwill/LWValidator.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWTimerWheel.h>
 
 uint8_t gTestNumber;
 uint8_t gCount;
+uint8_t gRelayCount;
+uint8_t gIdleTimeoutCount;
+uint8_t gStallTimeoutCount;
+uint8_t gDispatchOrder[8];
+uint8_t gInvalidCount;
+size_t gReallocationsLeft;
 
 enum {
 	kTestNumberIncompleteMessage,
@@ -54,7 +66,13 @@ enum {
 	kTestNumberTwoMessages,
 	kTestNumberUnrecognisedMessage,
 	kTestNumberValidMessage,
-	kTestNumberInvalidMessage
+	kTestNumberInvalidMessage,
+	kTestNumberRelayedMessages,
+	kTestNumberDispatchBudget,
+	kTestNumberMessagePriorities,
+	kTestNumberArena,
+	kTestNumberWireFormat,
+	kTestNumberChecksum
 };
 
 #pragma mark -
@@ -75,6 +93,33 @@ static bool validate_invalid_message(LWMessage *aMessage)
 
 #pragma mark -
 
+static void *failing_allocate(size_t aSize, void *aContext)
+{
+#pragma unused (aContext)
+
+	return malloc(aSize);
+}
+
+static void *failing_reallocate(void *aPointer, size_t aSize, void *aContext)
+{
+#pragma unused (aContext)
+
+	if(0 == gReallocationsLeft)
+		return NULL;
+	--gReallocationsLeft;
+
+	return realloc(aPointer, aSize);
+}
+
+static void failing_free(void *aPointer, void *aContext)
+{
+#pragma unused (aContext)
+
+	free(aPointer);
+}
+
+#pragma mark -
+
 static void unrecognised_message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
 {
 #pragma unused (aDataHandler, aMessage, aUserInfo)
@@ -87,6 +132,10 @@ static void unrecognised_message_callback(LWDataHandler *aDataHandler, LWMessage
 		case kTestNumberTwoMessages:
 		case kTestNumberInvalidMessage:
 		case kTestNumberValidMessage:
+		case kTestNumberRelayedMessages:
+		case kTestNumberDispatchBudget:
+		case kTestNumberMessagePriorities:
+		case kTestNumberArena:
 			UC_ASSERT(false);
 			break;
 
@@ -108,12 +157,20 @@ static void invalid_message_callback(LWDataHandler *aDataHandler, LWMessage *aMe
 		case kTestNumberTwoMessages:
 		case kTestNumberUnrecognisedMessage:
 		case kTestNumberValidMessage:
+		case kTestNumberRelayedMessages:
+		case kTestNumberDispatchBudget:
+		case kTestNumberMessagePriorities:
+		case kTestNumberArena:
 			UC_ASSERT(false);
 			break;
 
 		case kTestNumberInvalidMessage:
 			UC_ASSERT(true);
 			break;
+
+		case kTestNumberChecksum:
+			++gInvalidCount;
+			break;
 	}
 }
 
@@ -156,9 +213,53 @@ static void message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, v
 		case kTestNumberValidMessage:
 			UC_ASSERT(true);
 			break;
+
+		case kTestNumberRelayedMessages:
+		case kTestNumberDispatchBudget:
+			++gCount;
+			break;
+
+		case kTestNumberMessagePriorities:
+			gDispatchOrder[gCount++] = *(uint8_t *)LWArgumentGetData(aMessage->arguments[0]);
+			break;
+
+		case kTestNumberArena:
+			UC_ASSERT_EQUAL(LWArenaGetAllocator(aDataHandler->arena), aMessage->allocator);
+			UC_ASSERT(LWArenaGetUsedLength(aDataHandler->arena) > 0);
+			UC_ASSERT(!LWDataHandlerSetArenaEnabled(aDataHandler, false));
+			gDispatchOrder[gCount++] = (uint8_t)LWArgumentGetLength(aMessage->arguments[aMessage->argumentCount - 1]);
+			break;
+
+		case kTestNumberWireFormat:
+		case kTestNumberChecksum:
+			gDispatchOrder[gCount++] = *(uint8_t *)LWArgumentGetData(aMessage->arguments[0]);
+			break;
 	}
 }
 
+static void relay_callback(LWDataHandler *aDataHandler, void *aFrame, size_t aFrameLength, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	++gRelayCount;
+	UC_ASSERT_EQUAL(11, ((uint8_t *)aFrame)[0]);
+	UC_ASSERT_EQUAL(4, aFrameLength);
+}
+
+static void idle_timeout_callback(LWDataHandler *aDataHandler, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	++gIdleTimeoutCount;
+}
+
+static void stall_timeout_callback(LWDataHandler *aDataHandler, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	++gStallTimeoutCount;
+}
+
 #pragma mark -
 
 static void test_create(void)
@@ -318,6 +419,477 @@ static void test_append_invalid_message(void)
 	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 5));
 }
 
+static void test_handle_data_in_place(void)
+{
+	uint8_t data[] = { 123, 2, 1, 2, 0, 123, 2, 4, 3, 0, 123, 1 };
+
+	gTestNumber = kTestNumberTwoMessages;
+	gCount = 0;
+
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetUnrecognisedMessageCallback(dataHandler, &unrecognised_message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &invalid_message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+
+	size_t bytesUsed;
+	UC_ASSERT(LWDataHandlerHandleDataInPlace(dataHandler, data, 12, &bytesUsed));
+	UC_ASSERT_EQUAL(10, bytesUsed);
+	UC_ASSERT_EQUAL(2, gCount);
+	UC_ASSERT_EQUAL(0, dataHandler->availableDataLength);
+
+	// not possible while data is buffered
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 10, 2));
+	UC_ASSERT(!LWDataHandlerHandleDataInPlace(dataHandler, data, 12, &bytesUsed));
+	UC_ASSERT_EQUAL(0, bytesUsed);
+
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_relay_messages(void)
+{
+	uint8_t data[] = { 10, 2, 1, 2, 0, 123, 2, 4, 3, 0, 11, 1, 7, 0, 10, 1, 9, 0, 123, 1 };
+	uint8_t relayedData[] = { 10, 2, 1, 2, 0, 10, 1, 9, 0 };
+
+	gTestNumber = kTestNumberRelayedMessages;
+	gCount = 0;
+	gRelayCount = 0;
+
+	// relayed messages are neither decoded nor validated
+	LWValidator *validator = LWValidatorCreate();
+	LWValidatorSetMessageValidationCallback(validator, 10, &validate_invalid_message);
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetUnrecognisedMessageCallback(dataHandler, &unrecognised_message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &invalid_message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetValidator(dataHandler, validator);
+	LWDataHandlerSetRelayWriter(dataHandler, 10, writer);
+	LWDataHandlerSetRelayCallback(dataHandler, 11, &relay_callback);
+
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, sizeof(data)));
+	UC_ASSERT_EQUAL(1, gCount);
+	UC_ASSERT_EQUAL(1, gRelayCount);
+	UC_ASSERT_EQUAL(2, dataHandler->availableDataLength);
+
+	// raw frames end up in the writer
+	size_t length;
+	void *pendingData = LWWriteQueuePeek(writer->writeQueue, &length);
+	UC_ASSERT_EQUAL(sizeof(relayedData), length);
+	UC_ASSERT_EQUAL(0, memcmp(relayedData, pendingData, sizeof(relayedData)));
+
+	// cleared relays no longer apply
+	LWDataHandlerClearRelays(dataHandler);
+	UC_ASSERT_NULL(dataHandler->relayWriters[10]);
+	UC_ASSERT_NULL(dataHandler->relayCallbacks[11]);
+
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(writer);
+	LWValidatorDelete(validator);
+}
+
+static void test_dispatch_budget(void)
+{
+	uint8_t data[] = { 123, 1, 1, 0, 123, 1, 2, 0, 123, 1, 3, 0, 123, 1, 4, 0, 123, 1, 5, 0, 123, 1 };
+
+	gTestNumber = kTestNumberDispatchBudget;
+	gCount = 0;
+
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetUnrecognisedMessageCallback(dataHandler, &unrecognised_message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &invalid_message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetDispatchBudget(dataHandler, 2, 0);
+
+	// only two messages at a time
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, sizeof(data)));
+	UC_ASSERT_EQUAL(2, gCount);
+	UC_ASSERT(LWDataHandlerHasPendingMessages(dataHandler));
+	UC_ASSERT(LWDataHandlerResumeDispatch(dataHandler));
+	UC_ASSERT_EQUAL(4, gCount);
+	UC_ASSERT(LWDataHandlerHasPendingMessages(dataHandler));
+	UC_ASSERT(LWDataHandlerResumeDispatch(dataHandler));
+	UC_ASSERT_EQUAL(5, gCount);
+	UC_ASSERT(!LWDataHandlerHasPendingMessages(dataHandler));
+	UC_ASSERT_EQUAL(2, dataHandler->availableDataLength);
+
+	// nothing left to resume
+	UC_ASSERT(LWDataHandlerResumeDispatch(dataHandler));
+	UC_ASSERT_EQUAL(5, gCount);
+
+	// tiny time budget still makes progress
+	size_t bytesUsed;
+	gCount = 0;
+	LWDataHandler *inPlaceDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(inPlaceDataHandler, 123, &message_callback);
+	LWDataHandlerSetDispatchBudget(inPlaceDataHandler, 0, 1);
+	UC_ASSERT(LWDataHandlerHandleDataInPlace(inPlaceDataHandler, data, sizeof(data), &bytesUsed));
+	UC_ASSERT(gCount >= 1);
+	UC_ASSERT_EQUAL(4*gCount, bytesUsed);
+
+	LWDataHandlerDelete(inPlaceDataHandler);
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_message_priorities(void)
+{
+	uint8_t data[] = { 123, 1, 1, 0, 123, 1, 2, 0, 124, 1, 3, 0, 123, 1, 4, 0, 125, 1, 5, 0, 124, 1, 6, 0, 123, 1 };
+	uint8_t expectedOrder[] = { 5, 3, 6, 1, 2, 4 };
+	uint8_t expectedData[] = { 123, 1, 2, 0, 123, 1, 4, 0, 123, 1 };
+
+	gTestNumber = kTestNumberMessagePriorities;
+	gCount = 0;
+
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetUnrecognisedMessageCallback(dataHandler, &unrecognised_message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &invalid_message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 124, &message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 125, &message_callback);
+	LWDataHandlerSetMessagePriority(dataHandler, 124, 1);
+	LWDataHandlerSetMessagePriority(dataHandler, 125, 2);
+	LWDataHandlerSetDispatchBudget(dataHandler, 4, 0);
+
+	// higher priorities first, arrival order within a priority
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, sizeof(data)));
+	UC_ASSERT_EQUAL(4, gCount);
+	UC_ASSERT(LWDataHandlerHasPendingMessages(dataHandler));
+
+	// undispatched messages are kept in arrival order
+	UC_ASSERT_EQUAL(sizeof(expectedData), dataHandler->availableDataLength);
+	UC_ASSERT_EQUAL(0, memcmp(expectedData, dataHandler->buffer, sizeof(expectedData)));
+
+	UC_ASSERT(LWDataHandlerResumeDispatch(dataHandler));
+	UC_ASSERT_EQUAL(6, gCount);
+	UC_ASSERT(!LWDataHandlerHasPendingMessages(dataHandler));
+	UC_ASSERT_EQUAL(0, memcmp(expectedOrder, gDispatchOrder, sizeof(expectedOrder)));
+
+	// resetting all priorities restores arrival order
+	LWDataHandlerSetMessagePriority(dataHandler, 124, 0);
+	LWDataHandlerSetMessagePriority(dataHandler, 125, 0);
+	UC_ASSERT(!dataHandler->hasMessagePriorities);
+
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_arena(void)
+{
+	uint8_t data[320] = { 123, 1, 7, 2, 'a', 'b', 0, 124, 255 };
+	data[264] = 45;
+	data[310] = 0;
+	data[311] = 123;
+
+	gTestNumber = kTestNumberArena;
+	gCount = 0;
+
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetUnrecognisedMessageCallback(dataHandler, &unrecognised_message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &invalid_message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetMessageCallback(dataHandler, 124, &message_callback);
+	UC_ASSERT(LWDataHandlerSetArenaEnabled(dataHandler, true));
+	UC_ASSERT_NOT_NULL(dataHandler->arena);
+
+	// messages are decoded into the arena, which is reset after dispatch
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 312));
+	UC_ASSERT_EQUAL(2, gCount);
+	UC_ASSERT_EQUAL(2, gDispatchOrder[0]);
+	UC_ASSERT_EQUAL(300 - 256, gDispatchOrder[1]);
+	UC_ASSERT_EQUAL(0, LWArenaGetUsedLength(dataHandler->arena));
+	UC_ASSERT_EQUAL(1, dataHandler->availableDataLength);
+
+	// also when dispatching by priority
+	LWDataHandlerSetMessagePriority(dataHandler, 124, 1);
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 1, 311));
+	UC_ASSERT_EQUAL(4, gCount);
+	UC_ASSERT_EQUAL(300 - 256, gDispatchOrder[2]);
+	UC_ASSERT_EQUAL(2, gDispatchOrder[3]);
+	UC_ASSERT_EQUAL(0, LWArenaGetUsedLength(dataHandler->arena));
+
+	UC_ASSERT(LWDataHandlerSetArenaEnabled(dataHandler, false));
+	UC_ASSERT_NULL(dataHandler->arena);
+
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_wire_format(void)
+{
+	uint8_t data1[] = { 123, 1, 6, 0 };
+	uint8_t data2[] = {
+		0xff, 'L', 'W', 2,
+		3, 123, 2, 7,
+		3, 10, 2, 9,
+		3, 123, 3, 7,
+		3, 123, 2, 8,
+		3, 123
+	};
+
+	gTestNumber = kTestNumberWireFormat;
+	gCount = 0;
+
+	// anything but the preamble means version 1
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	UC_ASSERT_EQUAL(kLWWireFormatAutomatic, LWDataHandlerGetWireFormat(dataHandler));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data1, sizeof(data1)));
+	UC_ASSERT_EQUAL(kLWWireFormatVersion1, LWDataHandlerGetWireFormat(dataHandler));
+	UC_ASSERT_EQUAL(1, gCount);
+	UC_ASSERT_EQUAL(6, gDispatchOrder[0]);
+	LWDataHandlerDelete(dataHandler);
+
+	// the preamble may arrive in pieces
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetRelayWriter(dataHandler, 10, writer);
+	UC_ASSERT(LWDataHandlerSetStatsEnabled(dataHandler, true));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data2, 2));
+	UC_ASSERT_EQUAL(kLWWireFormatAutomatic, LWDataHandlerGetWireFormat(dataHandler));
+	UC_ASSERT_EQUAL(2, dataHandler->availableDataLength);
+
+	// malformed frames are skipped and counted as invalid
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data2 + 2, sizeof(data2) - 2));
+	UC_ASSERT_EQUAL(kLWWireFormatVersion2, LWDataHandlerGetWireFormat(dataHandler));
+	UC_ASSERT_EQUAL(3, gCount);
+	UC_ASSERT_EQUAL(7, gDispatchOrder[1]);
+	UC_ASSERT_EQUAL(8, gDispatchOrder[2]);
+	UC_ASSERT_EQUAL(1, LWDataHandlerStatsGetInvalidMessageCount(LWDataHandlerGetStats(dataHandler)));
+	UC_ASSERT_EQUAL(2, dataHandler->availableDataLength);
+
+	// relayed frames keep their version 2 framing
+	size_t length;
+	uint8_t *pendingData = LWWriteQueuePeek(writer->writeQueue, &length);
+	UC_ASSERT_EQUAL(4, length);
+	UC_ASSERT_EQUAL(0, memcmp(data2 + 8, pendingData, 4));
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(writer);
+
+	// handling data in place skips over the preamble as well
+	size_t bytesUsed;
+	dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	UC_ASSERT(LWDataHandlerHandleDataInPlace(dataHandler, data2, 3, &bytesUsed));
+	UC_ASSERT_EQUAL(0, bytesUsed);
+	UC_ASSERT(LWDataHandlerHandleDataInPlace(dataHandler, data2, 10, &bytesUsed));
+	UC_ASSERT_EQUAL(8, bytesUsed);
+	UC_ASSERT_EQUAL(4, gCount);
+
+	// the format can also be fixed up front
+	UC_ASSERT(!LWDataHandlerSetWireFormat(dataHandler, 3));
+	UC_ASSERT(LWDataHandlerSetWireFormat(dataHandler, kLWWireFormatVersion1));
+	UC_ASSERT_EQUAL(kLWWireFormatVersion1, LWDataHandlerGetWireFormat(dataHandler));
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_checksum(void)
+{
+	// write frames with trailers
+	uint8_t		values[] = { 7, 8, 9, 6 };
+	uint8_t		messageIDs[] = { 123, 123, 10, 123 };
+	LWWriter	*writer = LWWriterCreate(-1, NULL);
+	LWWriterSetChecksumEnabled(writer, true);
+	for(size_t i = 0; i < 4; ++i)
+	{
+		LWMessage *message = LWMessageCreate(messageIDs[i], LWArgumentCreate(&values[i], 1), NULL);
+		UC_ASSERT(LWWriterWriteMessage(writer, message));
+		LWMessageDelete(message);
+	}
+	size_t length;
+	uint8_t data[32];
+	memcpy(data, LWWriteQueuePeek(writer->writeQueue, &length), sizeof(data));
+	UC_ASSERT_EQUAL(sizeof(data), length);
+	LWWriterDelete(writer);
+
+	// corrupt the last frame
+	data[26] = 5;
+
+	gTestNumber = kTestNumberChecksum;
+	gCount = 0;
+	gInvalidCount = 0;
+
+	LWWriter *relayWriter = LWWriterCreate(-1, NULL);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &invalid_message_callback);
+	LWDataHandlerSetRelayWriter(dataHandler, 10, relayWriter);
+	UC_ASSERT(LWDataHandlerSetStatsEnabled(dataHandler, true));
+	UC_ASSERT(!LWDataHandlerIsChecksumEnabled(dataHandler));
+	UC_ASSERT(LWDataHandlerSetChecksumEnabled(dataHandler, true));
+	UC_ASSERT(LWDataHandlerIsChecksumEnabled(dataHandler));
+
+	// frames wait for their trailer
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 30));
+	UC_ASSERT_EQUAL(2, gCount);
+	UC_ASSERT_EQUAL(7, gDispatchOrder[0]);
+	UC_ASSERT_EQUAL(8, gDispatchOrder[1]);
+	UC_ASSERT_EQUAL(6, dataHandler->availableDataLength);
+
+	// corrupted frames go to the invalid message callback
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 30, 2));
+	UC_ASSERT_EQUAL(2, gCount);
+	UC_ASSERT_EQUAL(1, gInvalidCount);
+	UC_ASSERT_EQUAL(1, LWDataHandlerStatsGetInvalidMessageCount(LWDataHandlerGetStats(dataHandler)));
+	UC_ASSERT_EQUAL(0, dataHandler->availableDataLength);
+
+	// relayed frames lose their trailer, unless the relay writer wants one
+	size_t pendingLength;
+	uint8_t *pendingData = LWWriteQueuePeek(relayWriter->writeQueue, &pendingLength);
+	UC_ASSERT_EQUAL(4, pendingLength);
+	UC_ASSERT_EQUAL(0, memcmp(data + 16, pendingData, 4));
+	LWWriterSetChecksumEnabled(relayWriter, true);
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 16, 8));
+	UC_ASSERT_EQUAL(12, LWWriterGetPendingLength(relayWriter));
+
+	// corrupted relayed frames go to the invalid message callback too
+	data[18] = 5;
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 16, 8));
+	UC_ASSERT_EQUAL(12, LWWriterGetPendingLength(relayWriter));
+	UC_ASSERT_EQUAL(2, gInvalidCount);
+	UC_ASSERT_EQUAL(2, LWDataHandlerStatsGetInvalidMessageCount(LWDataHandlerGetStats(dataHandler)));
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(relayWriter);
+
+	// checking works the same by priority and in arenas
+	gCount = 0;
+	dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &invalid_message_callback);
+	LWDataHandlerSetMessagePriority(dataHandler, 123, 1);
+	UC_ASSERT(LWDataHandlerSetArenaEnabled(dataHandler, true));
+	UC_ASSERT(LWDataHandlerSetChecksumEnabled(dataHandler, true));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 8));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 24, 8));
+	UC_ASSERT_EQUAL(1, gCount);
+	UC_ASSERT_EQUAL(3, gInvalidCount);
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_message_priorities_without_memory(void)
+{
+	LWAllocator allocator = { &failing_allocate, &failing_reallocate, &failing_free, NULL };
+
+	uint8_t data[100*4];
+	for(size_t i = 0; i < 100; ++i)
+	{
+		data[4*i + 0] = 123;
+		data[4*i + 1] = 1;
+		data[4*i + 2] = (uint8_t)i;
+		data[4*i + 3] = 0;
+	}
+
+	gTestNumber = kTestNumberDispatchBudget;
+	gCount = 0;
+	gReallocationsLeft = SIZE_MAX;
+
+	LWDataHandler *dataHandler = LWDataHandlerCreateWithAllocator(NULL, &allocator);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetMessagePriority(dataHandler, 123, 1);
+
+	// the frame list can hold 64 frames; leave enough memory to grow the buffer, but not the frame list
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 4));
+	UC_ASSERT_EQUAL(1, gCount);
+	UC_ASSERT_EQUAL(64, dataHandler->frameCapacity);
+	gReallocationsLeft = 1;
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 4, sizeof(data) - 4));
+
+	// frames that were found are dispatched, the others are kept for later
+	UC_ASSERT_EQUAL(65, gCount);
+	UC_ASSERT(LWDataHandlerHasPendingMessages(dataHandler));
+	UC_ASSERT_EQUAL(sizeof(data) - 65*4, dataHandler->availableDataLength);
+
+	gReallocationsLeft = SIZE_MAX;
+	UC_ASSERT(LWDataHandlerResumeDispatch(dataHandler));
+	UC_ASSERT_EQUAL(100, gCount);
+	UC_ASSERT(!LWDataHandlerHasPendingMessages(dataHandler));
+
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_timeouts(void)
+{
+	uint8_t data[] = { 123, 1, 7, 0, 123, 1, 8, 0 };
+
+	gIdleTimeoutCount = 0;
+	gStallTimeoutCount = 0;
+
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(0);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetTimerWheel(dataHandler, timerWheel);
+	UC_ASSERT(LWDataHandlerSetIdleTimeout(dataHandler, 100, &idle_timeout_callback));
+	UC_ASSERT(LWDataHandlerSetStallTimeout(dataHandler, 50, &stall_timeout_callback));
+
+	// idle timeout is pushed back by incoming data
+	LWTimerWheelAdvance(timerWheel, 90);
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 4));
+	LWTimerWheelAdvance(timerWheel, 189);
+	UC_ASSERT_EQUAL(0, gIdleTimeoutCount);
+	UC_ASSERT_EQUAL(0, gStallTimeoutCount);
+	LWTimerWheelAdvance(timerWheel, 190);
+	UC_ASSERT_EQUAL(1, gIdleTimeoutCount);
+
+	// incomplete message stalls
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 4, 2));
+	LWTimerWheelAdvance(timerWheel, 220);
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 6, 1));
+	LWTimerWheelAdvance(timerWheel, 239);
+	UC_ASSERT_EQUAL(0, gStallTimeoutCount);
+	LWTimerWheelAdvance(timerWheel, 240);
+	UC_ASSERT_EQUAL(1, gStallTimeoutCount);
+
+	// completed message stops the stall timer
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 7, 1));
+	UC_ASSERT(!LWTimerIsArmed(dataHandler->stallTimer));
+	UC_ASSERT(LWTimerIsArmed(dataHandler->idleTimer));
+
+	// detaching from timer wheel stops all timers
+	LWDataHandlerSetTimerWheel(dataHandler, NULL);
+	UC_ASSERT_EQUAL(0, LWTimerWheelGetTimerCount(timerWheel));
+
+	LWDataHandlerDelete(dataHandler);
+	LWTimerWheelDelete(timerWheel);
+}
+
+static void test_detach_and_attach(void)
+{
+	uint8_t data[] = { 123, 2, 1, 2, 0, 123, 2, 4, 3, 0 };
+
+	gTestNumber = kTestNumberTwoMessages;
+	gCount = 0;
+	gStallTimeoutCount = 0;
+
+	LWTimerWheel *oldTimerWheel = LWTimerWheelCreate(0);
+	LWTimerWheel *newTimerWheel = LWTimerWheelCreate(5000);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	LWDataHandlerSetTimerWheel(dataHandler, oldTimerWheel);
+	LWDataHandlerSetStallTimeout(dataHandler, 50, &stall_timeout_callback);
+
+	// leave an incomplete message in the buffer
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 7));
+	UC_ASSERT_EQUAL(1, gCount);
+
+	// detached data handlers do not handle data
+	UC_ASSERT(LWDataHandlerDetach(dataHandler));
+	UC_ASSERT(LWDataHandlerIsDetached(dataHandler));
+	UC_ASSERT(!LWDataHandlerDetach(dataHandler));
+	UC_ASSERT(!LWDataHandlerHandleData(dataHandler, data + 7, 3));
+	UC_ASSERT_EQUAL(0, LWTimerWheelGetTimerCount(oldTimerWheel));
+
+	// incomplete message and timers move along
+	UC_ASSERT(LWDataHandlerAttach(dataHandler, newTimerWheel));
+	UC_ASSERT(!LWDataHandlerIsDetached(dataHandler));
+	UC_ASSERT(!LWDataHandlerAttach(dataHandler, newTimerWheel));
+	UC_ASSERT_EQUAL(1, LWTimerWheelGetTimerCount(newTimerWheel));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 7, 3));
+	UC_ASSERT_EQUAL(2, gCount);
+	UC_ASSERT_EQUAL(0, LWTimerWheelGetTimerCount(newTimerWheel));
+	UC_ASSERT_EQUAL(0, gStallTimeoutCount);
+
+	LWDataHandlerDelete(dataHandler);
+	LWTimerWheelDelete(oldTimerWheel);
+	LWTimerWheelDelete(newTimerWheel);
+}
+
 #pragma mark -
 
 void test_data_handler(void)
@@ -339,6 +911,16 @@ void test_data_handler(void)
 	uc_suite_add_test(suite, uc_test_create("append unrecognised message",			&test_append_unrecognised_message));
 	uc_suite_add_test(suite, uc_test_create("append valid message",					&test_append_valid_message));
 	uc_suite_add_test(suite, uc_test_create("append invalid message",				&test_append_invalid_message));
+	uc_suite_add_test(suite, uc_test_create("handle data in place",					&test_handle_data_in_place));
+	uc_suite_add_test(suite, uc_test_create("relay messages",						&test_relay_messages));
+	uc_suite_add_test(suite, uc_test_create("dispatch budget",						&test_dispatch_budget));
+	uc_suite_add_test(suite, uc_test_create("message priorities",					&test_message_priorities));
+	uc_suite_add_test(suite, uc_test_create("message priorities without memory",	&test_message_priorities_without_memory));
+	uc_suite_add_test(suite, uc_test_create("timeouts",								&test_timeouts));
+	uc_suite_add_test(suite, uc_test_create("detach and attach",					&test_detach_and_attach));
+	uc_suite_add_test(suite, uc_test_create("arena",								&test_arena));
+	uc_suite_add_test(suite, uc_test_create("wire format",							&test_wire_format));
+	uc_suite_add_test(suite, uc_test_create("checksum",								&test_checksum));
 
 	/* run suite */
 	uc_suite_run(suite);
@@ -0,0 +1,352 @@
+/*
+ * LWInternTableTest.c
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWDataHandlerStats.h>
+#include <Lunkwill/LWInternTable.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWWriteQueue.h>
+#include <Lunkwill/LWWriter.h>
+
+LWArgument	*gInternReceivedArguments[8];
+size_t		gInternReceivedArgumentCount;
+size_t		gInternInvalidMessageCount;
+
+#pragma mark -
+
+static void intern_message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	for(size_t i = 0; i < aMessage->argumentCount && gInternReceivedArgumentCount < 8; ++i)
+		gInternReceivedArguments[gInternReceivedArgumentCount++] = aMessage->arguments[i];
+}
+
+static void intern_invalid_message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aMessage, aUserInfo)
+
+	++gInternInvalidMessageCount;
+}
+
+static void write_strings(LWWriter *aWriter, char *aFirstString, char *aSecondString)
+{
+	LWMessage *message = LWMessageCreate(7, LWArgumentCreateFromString(aFirstString), LWArgumentCreateFromString(aSecondString), NULL);
+	UC_ASSERT(LWWriterWriteMessage(aWriter, message));
+	LWMessageDelete(message);
+}
+
+static void pass_written_data(LWWriter *aWriter, LWDataHandler *aDataHandler)
+{
+	size_t length;
+	uint8_t *data;
+	while((data = LWWriteQueuePeek(aWriter->writeQueue, &length)))
+	{
+		UC_ASSERT(LWDataHandlerHandleData(aDataHandler, data, length));
+		LWWriteQueueConsume(aWriter->writeQueue, length);
+	}
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	UC_ASSERT_NULL(LWInternTableCreate(0));
+	UC_ASSERT_NULL(LWInternTableCreate(kLWInternTableNoSlot));
+
+	LWInternTable *internTable = LWInternTableCreate(100);
+	UC_ASSERT_NOT_NULL(internTable);
+	UC_ASSERT_EQUAL(100, LWInternTableGetCapacity(internTable));
+	UC_ASSERT_EQUAL(0, LWInternTableGetCount(internTable));
+	UC_ASSERT_NULL(LWInternTableGetArgumentInSlot(internTable, 0));
+	UC_ASSERT_NULL(LWInternTableGetArgumentInSlot(internTable, 100));
+	LWInternTableDelete(internTable);
+}
+
+static void test_set_argument_interned(void)
+{
+	LWInternTable *internTable = LWInternTableCreate(4);
+	UC_ASSERT(!LWInternTableIsArgumentInterned(internTable, 7, 1));
+	UC_ASSERT(LWInternTableSetArgumentInterned(internTable, 7, 1, true));
+	UC_ASSERT(LWInternTableIsArgumentInterned(internTable, 7, 1));
+	UC_ASSERT(!LWInternTableIsArgumentInterned(internTable, 7, 0));
+	UC_ASSERT(!LWInternTableIsArgumentInterned(internTable, 8, 1));
+	UC_ASSERT(LWInternTableSetArgumentInterned(internTable, 7, 1, false));
+	UC_ASSERT(!LWInternTableIsArgumentInterned(internTable, 7, 1));
+
+	// only the first arguments can be interned
+	UC_ASSERT(LWInternTableSetArgumentInterned(internTable, 7, kLWInternTableMaxArgumentIndex, true));
+	UC_ASSERT(!LWInternTableSetArgumentInterned(internTable, 7, kLWInternTableMaxArgumentIndex + 1, true));
+	UC_ASSERT(!LWInternTableIsArgumentInterned(internTable, 7, kLWInternTableMaxArgumentIndex + 1));
+	LWInternTableDelete(internTable);
+}
+
+static void test_write_interned_message(void)
+{
+	LWInternTable *internTable = LWInternTableCreate(4);
+	LWInternTableSetArgumentInterned(internTable, 7, 1, true);
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWWriterSetInternTable(writer, internTable);
+	UC_ASSERT_EQUAL(internTable, LWWriterGetInternTable(writer));
+
+	// the first occurrence defines a slot, later ones refer to it
+	write_strings(writer, "hi", "hello");
+	write_strings(writer, "hi", "hello");
+	size_t length;
+	uint8_t *data = LWWriteQueuePeek(writer->writeQueue, &length);
+	uint8_t expectedData[] = {
+		7, 2, 'h', 'i', 8, 1, 0, 0, 'h', 'e', 'l', 'l', 'o', 0,
+		7, 2, 'h', 'i', 3, 0, 0, 0, 0
+	};
+	UC_ASSERT_EQUAL(sizeof(expectedData), length);
+	UC_ASSERT_EQUAL(0, memcmp(expectedData, data, sizeof(expectedData)));
+	UC_ASSERT_EQUAL(1, LWInternTableGetCount(internTable));
+
+	LWWriterDelete(writer);
+	LWInternTableDelete(internTable);
+}
+
+static void test_resolve_interned_arguments(void)
+{
+	LWInternTable *sendingInternTable = LWInternTableCreate(4);
+	LWInternTable *receivingInternTable = LWInternTableCreate(4);
+	LWInternTableSetArgumentInterned(sendingInternTable, 7, 1, true);
+	LWInternTableSetArgumentInterned(receivingInternTable, 7, 1, true);
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWWriterSetInternTable(writer, sendingInternTable);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetInternTable(dataHandler, receivingInternTable);
+	UC_ASSERT_EQUAL(receivingInternTable, LWDataHandlerGetInternTable(dataHandler));
+	LWDataHandlerSetMessageCallback(dataHandler, 7, &intern_message_callback);
+
+	gInternReceivedArgumentCount = 0;
+	write_strings(writer, "a", "hello");
+	write_strings(writer, "b", "hello");
+	pass_written_data(writer, dataHandler);
+
+	// both messages share the interned argument
+	UC_ASSERT_EQUAL(4, gInternReceivedArgumentCount);
+	LWArgument *argument = LWInternTableGetArgumentInSlot(receivingInternTable, 0);
+	UC_ASSERT_NOT_NULL(argument);
+	UC_ASSERT_EQUAL(argument, gInternReceivedArguments[1]);
+	UC_ASSERT_EQUAL(argument, gInternReceivedArguments[3]);
+	UC_ASSERT_EQUAL(5, argument->length);
+	UC_ASSERT_EQUAL(0, memcmp("hello", argument->data, 5));
+	UC_ASSERT_EQUAL(1, argument->retainCount);
+	UC_ASSERT_EQUAL(1, LWInternTableGetCount(receivingInternTable));
+
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(writer);
+	LWInternTableDelete(receivingInternTable);
+	LWInternTableDelete(sendingInternTable);
+}
+
+static void test_evict_least_recently_used(void)
+{
+	LWInternTable *sendingInternTable = LWInternTableCreate(2);
+	LWInternTable *receivingInternTable = LWInternTableCreate(2);
+	LWInternTableSetArgumentInterned(sendingInternTable, 7, 0, true);
+	LWInternTableSetArgumentInterned(sendingInternTable, 7, 1, true);
+	LWInternTableSetArgumentInterned(receivingInternTable, 7, 0, true);
+	LWInternTableSetArgumentInterned(receivingInternTable, 7, 1, true);
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWWriterSetInternTable(writer, sendingInternTable);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetInternTable(dataHandler, receivingInternTable);
+	LWDataHandlerSetMessageCallback(dataHandler, 7, &intern_message_callback);
+
+	// "a" is used more recently than "b", so "c" replaces "b"
+	gInternReceivedArgumentCount = 0;
+	write_strings(writer, "a", "b");
+	write_strings(writer, "a", "c");
+	write_strings(writer, "c", "a");
+	pass_written_data(writer, dataHandler);
+
+	UC_ASSERT_EQUAL(6, gInternReceivedArgumentCount);
+	UC_ASSERT_EQUAL(2, LWInternTableGetCount(sendingInternTable));
+	UC_ASSERT_EQUAL(2, LWInternTableGetCount(receivingInternTable));
+	for(uint16_t slot = 0; slot < 2; ++slot)
+	{
+		LWArgument *sentArgument = LWInternTableGetArgumentInSlot(sendingInternTable, slot);
+		LWArgument *receivedArgument = LWInternTableGetArgumentInSlot(receivingInternTable, slot);
+		UC_ASSERT_EQUAL(1, receivedArgument->length);
+		UC_ASSERT_EQUAL(sentArgument->data[0], receivedArgument->data[0]);
+	}
+	UC_ASSERT_EQUAL('a', LWInternTableGetArgumentInSlot(receivingInternTable, 0)->data[0]);
+	UC_ASSERT_EQUAL('c', LWInternTableGetArgumentInSlot(receivingInternTable, 1)->data[0]);
+	UC_ASSERT_EQUAL('c', gInternReceivedArguments[3]->data[0]);
+	UC_ASSERT_EQUAL(gInternReceivedArguments[3], gInternReceivedArguments[4]);
+	UC_ASSERT_EQUAL(gInternReceivedArguments[0], gInternReceivedArguments[5]);
+
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(writer);
+	LWInternTableDelete(receivingInternTable);
+	LWInternTableDelete(sendingInternTable);
+}
+
+static void test_resolve_invalid_reference(void)
+{
+	LWInternTable *internTable = LWInternTableCreate(4);
+	LWInternTableSetArgumentInterned(internTable, 7, 0, true);
+
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetStatsEnabled(dataHandler, true);
+	LWDataHandlerSetInternTable(dataHandler, internTable);
+	LWDataHandlerSetMessageCallback(dataHandler, 7, &intern_message_callback);
+	LWDataHandlerSetInvalidMessageCallback(dataHandler, &intern_invalid_message_callback);
+
+	// undefined slot, slot out of range, unknown tag, empty definition
+	uint8_t data[] = {
+		7, 3, 0, 0, 1, 0,
+		7, 3, 0, 0, 4, 0,
+		7, 4, 2, 0, 0, 'x', 0,
+		7, 3, 1, 0, 0, 0
+	};
+	gInternReceivedArgumentCount = 0;
+	gInternInvalidMessageCount = 0;
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, sizeof(data)));
+	UC_ASSERT_EQUAL(0, gInternReceivedArgumentCount);
+	UC_ASSERT_EQUAL(4, gInternInvalidMessageCount);
+	UC_ASSERT_EQUAL(4, LWDataHandlerStatsGetInvalidMessageCount(LWDataHandlerGetStats(dataHandler)));
+	UC_ASSERT_EQUAL(0, LWInternTableGetCount(internTable));
+
+	LWDataHandlerDelete(dataHandler);
+	LWInternTableDelete(internTable);
+}
+
+static void test_broadcast_interned_message(void)
+{
+	LWInternTable *internTable = LWInternTableCreate(4);
+	LWInternTableSetArgumentInterned(internTable, 7, 0, true);
+
+	LWWriter *writers[2] = { LWWriterCreate(-1, NULL), LWWriterCreate(-1, NULL) };
+	LWWriterSetInternTable(writers[1], internTable);
+
+	// only the writer with an intern table encodes the argument
+	LWMessage *message = LWMessageCreate(7, LWArgumentCreateFromString("hello"), NULL);
+	UC_ASSERT(LWWriterBroadcastMessage(message, writers, 2));
+	UC_ASSERT(LWWriterBroadcastMessage(message, writers, 2));
+	UC_ASSERT_EQUAL(16, LWWriterGetPendingLength(writers[0]));
+	UC_ASSERT_EQUAL(11 + 6, LWWriterGetPendingLength(writers[1]));
+	LWMessageDelete(message);
+
+	LWWriterDelete(writers[0]);
+	LWWriterDelete(writers[1]);
+	LWInternTableDelete(internTable);
+}
+
+static void test_failed_write_keeps_table(void)
+{
+	LWInternTable *sendingInternTable = LWInternTableCreate(2);
+	LWInternTable *receivingInternTable = LWInternTableCreate(2);
+	LWInternTableSetArgumentInterned(sendingInternTable, 7, 0, true);
+	LWInternTableSetArgumentInterned(sendingInternTable, 7, 1, true);
+	LWInternTableSetArgumentInterned(receivingInternTable, 7, 0, true);
+	LWInternTableSetArgumentInterned(receivingInternTable, 7, 1, true);
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	UC_ASSERT(LWWriterSetWireFormat(writer, kLWWireFormatVersion2));
+	LWWriterSetInternTable(writer, sendingInternTable);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetInternTable(dataHandler, receivingInternTable);
+	LWDataHandlerSetMessageCallback(dataHandler, 7, &intern_message_callback);
+
+	gInternReceivedArgumentCount = 0;
+	LWMessage *message = LWMessageCreate(7, LWArgumentCreateFromString("a"), LWArgumentCreateFromString("b"), LWArgumentCreateFromString("x"), NULL);
+	UC_ASSERT(LWWriterWriteMessage(writer, message));
+	LWMessageDelete(message);
+
+	// an empty argument cannot be sent as version 2, so "c" must not replace "b"
+	message = LWMessageCreate(7, LWArgumentCreateFromString("a"), LWArgumentCreateFromString("c"), LWArgumentCreateFromString("x"), NULL);
+	message->arguments[2]->length = 0;
+	size_t pendingLength = LWWriterGetPendingLength(writer);
+	UC_ASSERT(!LWWriterWriteMessage(writer, message));
+	UC_ASSERT_EQUAL(pendingLength, LWWriterGetPendingLength(writer));
+	UC_ASSERT_EQUAL(2, LWInternTableGetCount(sendingInternTable));
+	UC_ASSERT_EQUAL('a', LWInternTableGetArgumentInSlot(sendingInternTable, 0)->data[0]);
+	UC_ASSERT_EQUAL('b', LWInternTableGetArgumentInSlot(sendingInternTable, 1)->data[0]);
+	message->arguments[2]->length = 1;
+	LWMessageDelete(message);
+
+	// "a" is still the least recently used, so "c" replaces it
+	write_strings(writer, "c", "b");
+	pass_written_data(writer, dataHandler);
+
+	UC_ASSERT_EQUAL(5, gInternReceivedArgumentCount);
+	UC_ASSERT_EQUAL('c', LWInternTableGetArgumentInSlot(sendingInternTable, 0)->data[0]);
+	UC_ASSERT_EQUAL('c', LWInternTableGetArgumentInSlot(receivingInternTable, 0)->data[0]);
+	UC_ASSERT_EQUAL('b', LWInternTableGetArgumentInSlot(receivingInternTable, 1)->data[0]);
+	UC_ASSERT_EQUAL(gInternReceivedArguments[1], gInternReceivedArguments[4]);
+
+	LWDataHandlerDelete(dataHandler);
+	LWWriterDelete(writer);
+	LWInternTableDelete(receivingInternTable);
+	LWInternTableDelete(sendingInternTable);
+}
+
+#pragma mark -
+
+void test_intern_table(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("intern table");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("set argument interned",				&test_set_argument_interned));
+	uc_suite_add_test(suite, uc_test_create("write interned message",				&test_write_interned_message));
+	uc_suite_add_test(suite, uc_test_create("resolve interned arguments",			&test_resolve_interned_arguments));
+	uc_suite_add_test(suite, uc_test_create("evict least recently used",			&test_evict_least_recently_used));
+	uc_suite_add_test(suite, uc_test_create("resolve invalid reference",			&test_resolve_invalid_reference));
+	uc_suite_add_test(suite, uc_test_create("broadcast interned message",			&test_broadcast_interned_message));
+	uc_suite_add_test(suite, uc_test_create("failed write keeps table",				&test_failed_write_keeps_table));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
@@ -34,13 +34,17 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <uctest/uctest.h>
 
 #include <Lunkwill/LunkwillPrivate.h>
 #include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArena.h>
 #include <Lunkwill/LWArgument.h>
 #include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWBuffer.h>
 
 static void test_create_with_no_arguments(void)
 {
@@ -431,6 +435,313 @@ static void test_deserialize_more_than_complete(void)
 	UC_ASSERT_EQUAL(0, message->argumentCount);
 }
 
+static void test_get_frame_length(void)
+{
+	uint8_t data1[] = { 123, 2, 1, 2, 1, 3, 0, 234 };
+	uint8_t data2[] = { 123, 255 };
+
+	size_t frameLength;
+	UC_ASSERT(LWMessageGetFrameLength(data1, 8, &frameLength));
+	UC_ASSERT_EQUAL(7, frameLength);
+	UC_ASSERT(!LWMessageGetFrameLength(data1, 6, &frameLength));
+	UC_ASSERT_EQUAL(0, frameLength);
+	UC_ASSERT(!LWMessageGetFrameLength(data2, 2, &frameLength));
+}
+
+static void test_serialize_v2(void)
+{
+	LWArgument *argument1 = LWArgumentCreateFrom8BitUnsignedInteger(8);
+	LWArgument *argument2 = LWArgumentCreateFromString("hi");
+
+	LWMessage *message = LWMessageCreate(123, argument1, argument2, NULL);
+	void *serializedMessage;
+	size_t serializedMessageLength;
+	UC_ASSERT_EQUAL(7, LWMessageGetSerializedLengthWithWireFormat(message, kLWWireFormatVersion2));
+	UC_ASSERT(LWMessageSerializeWithWireFormat(message, &serializedMessageLength, &serializedMessage, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(7, serializedMessageLength);
+	UC_ASSERT_EQUAL(6, ((uint8_t *)serializedMessage)[0]);
+	UC_ASSERT_EQUAL(123, ((uint8_t *)serializedMessage)[1]);
+	UC_ASSERT_EQUAL(2, ((uint8_t *)serializedMessage)[2]);
+	UC_ASSERT_EQUAL(8, ((uint8_t *)serializedMessage)[3]);
+	UC_ASSERT_EQUAL(4, ((uint8_t *)serializedMessage)[4]);
+	UC_ASSERT_EQUAL('h', ((uint8_t *)serializedMessage)[5]);
+	UC_ASSERT_EQUAL('i', ((uint8_t *)serializedMessage)[6]);
+
+	free(serializedMessage);
+	LWMessageDelete(message);
+}
+
+static void test_deserialize_v2(void)
+{
+	// a 300-byte argument needs a two-byte length
+	uint8_t argumentData[300];
+	memset(argumentData, 'x', 300);
+	LWMessage *message = LWMessageCreate(
+		42,
+		LWArgumentCreate(argumentData, 300),
+		LWArgumentCreateFromString("end"),
+		NULL
+	);
+	uint8_t data[400];
+	size_t length = LWMessageSerializeIntoBufferWithWireFormat(message, data, kLWWireFormatVersion2);
+	UC_ASSERT_EQUAL(LWMessageGetSerializedLengthWithWireFormat(message, kLWWireFormatVersion2), length);
+	UC_ASSERT_EQUAL(2 + 1 + 2 + 300 + 1 + 3, length);
+	LWMessageDelete(message);
+
+	// decode with an allocator
+	size_t bytesUsed;
+	message = LWMessageDeserializeWithWireFormat(data, length, &bytesUsed, NULL, kLWWireFormatVersion2);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(length, bytesUsed);
+	UC_ASSERT_EQUAL(42, message->messageID);
+	UC_ASSERT_EQUAL(2, message->argumentCount);
+	UC_ASSERT_EQUAL(300, LWMessageGetArgumentAtIndex(message, 0)->length);
+	UC_ASSERT_EQUAL(0, memcmp(LWMessageGetArgumentAtIndex(message, 0)->data, argumentData, 300));
+	UC_ASSERT_EQUAL(0, strcmp("end", (char *)LWMessageGetArgumentAtIndex(message, 1)->data));
+	LWMessageDelete(message);
+
+	// decode into an arena
+	LWArena *arena = LWArenaCreate(0);
+	message = LWMessageDeserializeInArenaWithWireFormat(data, length, &bytesUsed, arena, kLWWireFormatVersion2);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(length, bytesUsed);
+	UC_ASSERT_EQUAL(2, message->argumentCount);
+	UC_ASSERT_EQUAL(0, strcmp("end", (char *)LWMessageGetArgumentAtIndex(message, 1)->data));
+	LWArenaDelete(arena);
+
+	// incomplete frames are not decoded
+	message = LWMessageDeserializeWithWireFormat(data, length - 1, &bytesUsed, NULL, kLWWireFormatVersion2);
+	UC_ASSERT_NULL(message);
+	UC_ASSERT_EQUAL(0, bytesUsed);
+}
+
+static void test_empty_argument_v2(void)
+{
+	// empty arguments cannot be created, but can be made
+	LWArgument *argument = LWArgumentCreateFromString("x");
+	LWMessage *message = LWMessageCreate(42, argument, LWArgumentCreateFromString("end"), NULL);
+	argument->length = 0;
+
+	// so they are not serialized
+	uint8_t data[16];
+	void *serializedMessage;
+	size_t length;
+	UC_ASSERT_EQUAL(0, LWMessageGetSerializedLengthWithWireFormat(message, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(0, LWMessageSerializeIntoBufferWithWireFormat(message, data, kLWWireFormatVersion2));
+	UC_ASSERT(!LWMessageSerializeWithWireFormat(message, &length, &serializedMessage, kLWWireFormatVersion2));
+	UC_ASSERT_NULL(LWBufferCreateFromMessageWithWireFormat(message, kLWWireFormatVersion2));
+	LWMessageDelete(message);
+
+	// nor deserialized
+	uint8_t emptyData[] = { 6, 42, 0, 6, 'e', 'n', 'd' };
+	size_t bytesUsed;
+	UC_ASSERT_NULL(LWMessageDeserializeWithWireFormat(emptyData, sizeof(emptyData), &bytesUsed, NULL, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(sizeof(emptyData), bytesUsed);
+}
+
+static void test_deserialize_malformed_v2(void)
+{
+	// compressed argument without compressed data, then an argument running past the end of the frame
+	uint8_t data1[] = { 3, 123, 3, 1, 234 };
+	uint8_t data2[] = { 3, 123, 6, 1, 234 };
+
+	size_t bytesUsed;
+	UC_ASSERT_NULL(LWMessageDeserializeWithWireFormat(data1, 5, &bytesUsed, NULL, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(4, bytesUsed);
+	UC_ASSERT_NULL(LWMessageDeserializeWithWireFormat(data2, 5, &bytesUsed, NULL, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(4, bytesUsed);
+}
+
+static void test_serialize_compressed_v2(void)
+{
+	uint8_t argumentData[2000];
+	memset(argumentData, 'x', sizeof(argumentData));
+	LWMessage *message = LWMessageCreate(42, LWArgumentCreate(argumentData, 2000), LWArgumentCreateFromString("end"), NULL);
+	UC_ASSERT(LWMessageCompressArguments(message, 100));
+	UC_ASSERT(LWArgumentIsCompressed(LWMessageGetArgumentAtIndex(message, 0)));
+	UC_ASSERT(!LWArgumentIsCompressed(LWMessageGetArgumentAtIndex(message, 1)));
+
+	// version 1 frames are not compressed
+	UC_ASSERT_EQUAL(1 + 7*256 + 1 + 215 + 1 + 3 + 1, LWMessageGetSerializedLengthWithWireFormat(message, kLWWireFormatVersion1));
+
+	// version 2 frames flag compressed arguments
+	uint8_t data[100];
+	size_t length = LWMessageGetSerializedLengthWithWireFormat(message, kLWWireFormatVersion2);
+	UC_ASSERT(length < sizeof(data));
+	UC_ASSERT_EQUAL(length, LWMessageSerializeIntoBufferWithWireFormat(message, data, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(1, data[2] & 1);
+	UC_ASSERT_EQUAL(0xd0, data[3]);
+	UC_ASSERT_EQUAL(0x0f, data[4]);
+	LWMessageDelete(message);
+
+	// decompress with an allocator
+	size_t bytesUsed;
+	message = LWMessageDeserializeWithWireFormat(data, length, &bytesUsed, NULL, kLWWireFormatVersion2);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(length, bytesUsed);
+	UC_ASSERT_EQUAL(2000, LWMessageGetArgumentAtIndex(message, 0)->length);
+	UC_ASSERT_EQUAL(0, memcmp(argumentData, LWMessageGetArgumentAtIndex(message, 0)->data, 2000));
+	UC_ASSERT_EQUAL(0, LWMessageGetArgumentAtIndex(message, 0)->data[2000]);
+	UC_ASSERT_EQUAL(0, strcmp("end", (char *)LWMessageGetArgumentAtIndex(message, 1)->data));
+	LWMessageDelete(message);
+
+	// decompress into an arena
+	LWArena *arena = LWArenaCreate(0);
+	message = LWMessageDeserializeInArenaWithWireFormat(data, length, &bytesUsed, arena, kLWWireFormatVersion2);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(2000, LWMessageGetArgumentAtIndex(message, 0)->length);
+	UC_ASSERT_EQUAL(0, memcmp(argumentData, LWMessageGetArgumentAtIndex(message, 0)->data, 2000));
+	LWArenaDelete(arena);
+}
+
+static void test_deserialize_malformed_compressed_v2(void)
+{
+	// "aaaa...": literal 'a', then a match at offset 1
+	uint8_t data1[] = { 8, 1, 13, 20, 0x1f, 'a', 1, 0, 0 };
+	uint8_t data2[] = { 8, 1, 13, 21, 0x1f, 'a', 1, 0, 0 };
+	uint8_t data3[] = { 8, 1, 13, 20, 0x1f, 'a', 2, 0, 0 };
+	uint8_t data4[] = { 6, 1, 9, 0xff, 0x0f, 0x10, 'a' };
+
+	// correct, too long, bad offset, too much for the compressed data
+	size_t bytesUsed;
+	LWMessage *message = LWMessageDeserializeWithWireFormat(data1, sizeof(data1), &bytesUsed, NULL, kLWWireFormatVersion2);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(20, LWMessageGetArgumentAtIndex(message, 0)->length);
+	UC_ASSERT_EQUAL('a', LWMessageGetArgumentAtIndex(message, 0)->data[19]);
+	LWMessageDelete(message);
+	UC_ASSERT_NULL(LWMessageDeserializeWithWireFormat(data2, sizeof(data2), &bytesUsed, NULL, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(sizeof(data2), bytesUsed);
+	UC_ASSERT_NULL(LWMessageDeserializeWithWireFormat(data3, sizeof(data3), &bytesUsed, NULL, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(sizeof(data3), bytesUsed);
+	UC_ASSERT_NULL(LWMessageDeserializeWithWireFormat(data4, sizeof(data4), &bytesUsed, NULL, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(sizeof(data4), bytesUsed);
+}
+
+static void test_get_frame_length_v2(void)
+{
+	uint8_t data1[] = { 0x81, 0x01, 123 };
+	uint8_t data2[] = { 4, 123, 2, 1, 234 };
+
+	// the frame length is known from the header alone
+	size_t frameLength;
+	UC_ASSERT(!LWMessageGetFrameLengthWithWireFormat(data1, 1, &frameLength, kLWWireFormatVersion2));
+	UC_ASSERT(!LWMessageGetFrameLengthWithWireFormat(data1, 3, &frameLength, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(0, frameLength);
+	UC_ASSERT(LWMessageGetFrameLengthWithWireFormat(data2, 5, &frameLength, kLWWireFormatVersion2));
+	UC_ASSERT_EQUAL(5, frameLength);
+	UC_ASSERT(!LWMessageGetFrameLengthWithWireFormat(data2, 4, &frameLength, kLWWireFormatVersion2));
+}
+
+static void test_checksum(void)
+{
+	// known CRC32C check value
+	UC_ASSERT_EQUAL(0xe3069283, LWChecksumUpdate(0, "123456789", 9));
+	UC_ASSERT_EQUAL(0xe3069283, LWChecksumUpdate(LWChecksumUpdate(0, "1234", 4), "56789", 5));
+
+	uint8_t argumentData[600];
+	for(size_t i = 0; i < sizeof(argumentData); ++i)
+		argumentData[i] = (uint8_t)i;
+	LWMessage *message = LWMessageCreate(42, LWArgumentCreate(argumentData, 600), LWArgumentCreateFromString("end"), NULL);
+
+	for(uint8_t wireFormat = kLWWireFormatVersion1; wireFormat <= kLWWireFormatVersion2; ++wireFormat)
+	{
+		// the trailer follows the frame
+		uint8_t data[700];
+		size_t length = LWMessageGetSerializedLengthWithWireFormat(message, wireFormat);
+		UC_ASSERT_EQUAL(length + kLWChecksumLength, LWMessageSerializeIntoBufferWithChecksum(message, data, wireFormat));
+		UC_ASSERT_EQUAL(LWChecksumUpdate(0, data, length), LWChecksumRead(data + length));
+
+		// check it with an allocator
+		size_t		bytesUsed;
+		bool		isChecksumValid;
+		LWMessage	*message2 = LWMessageDeserializeWithChecksum(data, length + kLWChecksumLength, &bytesUsed, NULL, NULL, wireFormat, &isChecksumValid);
+		UC_ASSERT_NOT_NULL(message2);
+		UC_ASSERT(isChecksumValid);
+		UC_ASSERT_EQUAL(length + kLWChecksumLength, bytesUsed);
+		UC_ASSERT_EQUAL(600, LWMessageGetArgumentAtIndex(message2, 0)->length);
+		UC_ASSERT_EQUAL(0, memcmp(argumentData, LWMessageGetArgumentAtIndex(message2, 0)->data, 600));
+		LWMessageDelete(message2);
+
+		// frames are incomplete without their trailer
+		message2 = LWMessageDeserializeWithChecksum(data, length + kLWChecksumLength - 1, &bytesUsed, NULL, NULL, wireFormat, &isChecksumValid);
+		UC_ASSERT_NULL(message2);
+		UC_ASSERT_EQUAL(0, bytesUsed);
+
+		// corrupted data still decodes, but fails the check
+		LWArena *arena = LWArenaCreate(0);
+		data[length - 10] ^= 1;
+		message2 = LWMessageDeserializeWithChecksum(data, length + kLWChecksumLength, &bytesUsed, NULL, arena, wireFormat, &isChecksumValid);
+		UC_ASSERT_NOT_NULL(message2);
+		UC_ASSERT(!isChecksumValid);
+		UC_ASSERT_EQUAL(length + kLWChecksumLength, bytesUsed);
+		data[length - 10] ^= 1;
+		message2 = LWMessageDeserializeWithChecksum(data, length + kLWChecksumLength, &bytesUsed, NULL, arena, wireFormat, &isChecksumValid);
+		UC_ASSERT_NOT_NULL(message2);
+		UC_ASSERT(isChecksumValid);
+		UC_ASSERT_NULL(LWMessageGetArgumentAtIndex(message2, 0)->compressedData);
+		LWArenaDelete(arena);
+	}
+
+	// compressed arguments are checked as sent
+	uint8_t data[100];
+	memset(argumentData, 'x', sizeof(argumentData));
+	LWMessage *message2 = LWMessageCreate(42, LWArgumentCreate(argumentData, 600), NULL);
+	UC_ASSERT(LWMessageCompressArguments(message2, 100));
+	size_t length = LWMessageSerializeIntoBufferWithChecksum(message2, data, kLWWireFormatVersion2);
+	LWMessageDelete(message2);
+	size_t	bytesUsed;
+	bool	isChecksumValid;
+	message2 = LWMessageDeserializeWithChecksum(data, length, &bytesUsed, NULL, NULL, kLWWireFormatVersion2, &isChecksumValid);
+	UC_ASSERT_NOT_NULL(message2);
+	UC_ASSERT(isChecksumValid);
+	UC_ASSERT_EQUAL(0, memcmp(argumentData, LWMessageGetArgumentAtIndex(message2, 0)->data, 600));
+	LWMessageDelete(message2);
+
+	LWMessageDelete(message);
+}
+
+static void test_retain_release(void)
+{
+	LWMessage *message = LWMessageCreate(123, NULL);
+	UC_ASSERT_EQUAL(1, message->retainCount);
+
+	UC_ASSERT_EQUAL(message, LWMessageRetain(message));
+	UC_ASSERT_EQUAL(2, message->retainCount);
+
+	LWMessageRelease(message);
+	UC_ASSERT_EQUAL(1, message->retainCount);
+	UC_ASSERT_EQUAL(123, LWMessageGetMessageID(message));
+
+	LWMessageRelease(message);
+}
+
+static void test_share_argument(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("snapshot");
+
+	LWMessage *message1 = LWMessageCreate(123, argument, NULL);
+	LWMessage *message2 = LWMessageCreate(234, LWArgumentRetain(argument), NULL);
+	UC_ASSERT_EQUAL(2, argument->retainCount);
+
+	LWMessageDelete(message1);
+	UC_ASSERT_EQUAL(1, argument->retainCount);
+	UC_ASSERT_EQUAL(8, LWArgumentGetLength(LWMessageGetArgumentAtIndex(message2, 0)));
+
+	LWMessageDelete(message2);
+}
+
+static void test_share_non_retainable_argument(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWArgumentSetRetainable(argument, false);
+
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+	LWMessageDelete(message);
+	UC_ASSERT_EQUAL(1, argument->retainCount);
+
+	LWArgumentDelete(argument);
+}
+
 #pragma mark -
 
 void test_message(void)
@@ -460,6 +771,18 @@ void test_message(void)
 	uc_suite_add_test(suite, uc_test_create("deserialize with two arguments",		&test_deserialize_with_two_arguments));
 	uc_suite_add_test(suite, uc_test_create("deserialize incomplete",				&test_deserialize_incomplete));
 	uc_suite_add_test(suite, uc_test_create("deserialize more than complete",		&test_deserialize_more_than_complete));
+	uc_suite_add_test(suite, uc_test_create("retain release",						&test_retain_release));
+	uc_suite_add_test(suite, uc_test_create("share argument",						&test_share_argument));
+	uc_suite_add_test(suite, uc_test_create("share non-retainable argument",		&test_share_non_retainable_argument));
+	uc_suite_add_test(suite, uc_test_create("get frame length",						&test_get_frame_length));
+	uc_suite_add_test(suite, uc_test_create("serialize v2",							&test_serialize_v2));
+	uc_suite_add_test(suite, uc_test_create("deserialize v2",						&test_deserialize_v2));
+	uc_suite_add_test(suite, uc_test_create("empty argument v2",					&test_empty_argument_v2));
+	uc_suite_add_test(suite, uc_test_create("deserialize malformed v2",				&test_deserialize_malformed_v2));
+	uc_suite_add_test(suite, uc_test_create("serialize compressed v2",				&test_serialize_compressed_v2));
+	uc_suite_add_test(suite, uc_test_create("deserialize malformed compressed v2",	&test_deserialize_malformed_compressed_v2));
+	uc_suite_add_test(suite, uc_test_create("get frame length v2",					&test_get_frame_length_v2));
+	uc_suite_add_test(suite, uc_test_create("checksum",								&test_checksum));
 
 	/* run suite */
 	uc_suite_run(suite);
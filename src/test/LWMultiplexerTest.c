@@ -0,0 +1,341 @@
+/*
+ * LWMultiplexerTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWInternTable.h>
+#include <Lunkwill/LWMultiplexer.h>
+
+uint32_t gBulkMessageCount;
+uint32_t gControlMessageCount;
+uint32_t gBulkMessageCountAtControlMessage;
+
+#pragma mark -
+
+static void bulk_message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aMessage, aUserInfo)
+
+	++gBulkMessageCount;
+}
+
+static void control_message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aMessage, aUserInfo)
+
+	++gControlMessageCount;
+	gBulkMessageCountAtControlMessage = gBulkMessageCount;
+}
+
+#pragma mark -
+
+static void pump(LWMultiplexer *aSource, int aFileDescriptor, LWMultiplexer *aDestination)
+{
+	// flush source and feed everything written into destination
+	LWMultiplexerFlush(aSource);
+
+	uint8_t buffer[4096];
+	ssize_t length;
+	while((length = read(aFileDescriptor, buffer, sizeof(buffer))) > 0)
+		UC_ASSERT(LWMultiplexerHandleData(aDestination, buffer, (size_t)length));
+}
+
+static void create_pair(int aFileDescriptors[4], LWWriter *aWriters[2], LWMultiplexer *aMultiplexers[2])
+{
+	pipe(aFileDescriptors);
+	pipe(aFileDescriptors + 2);
+	for(int i = 0; i < 4; ++i)
+		fcntl(aFileDescriptors[i], F_SETFL, O_NONBLOCK);
+
+	// first multiplexer writes to first pipe, second to second pipe
+	aWriters[0] = LWWriterCreate(aFileDescriptors[1], NULL);
+	aWriters[1] = LWWriterCreate(aFileDescriptors[3], NULL);
+	aMultiplexers[0] = LWMultiplexerCreate(aWriters[0], NULL);
+	aMultiplexers[1] = LWMultiplexerCreate(aWriters[1], NULL);
+}
+
+static void delete_pair(int aFileDescriptors[4], LWWriter *aWriters[2], LWMultiplexer *aMultiplexers[2])
+{
+	for(int i = 0; i < 2; ++i)
+	{
+		LWMultiplexerDelete(aMultiplexers[i]);
+		LWWriterDelete(aWriters[i]);
+	}
+	for(int i = 0; i < 4; ++i)
+		close(aFileDescriptors[i]);
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWMultiplexer *multiplexer = LWMultiplexerCreate(writer, NULL);
+	UC_ASSERT_NOT_NULL(multiplexer);
+
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	UC_ASSERT(!LWMultiplexerOpenChannel(multiplexer, kLWMultiplexerControlChannelID, dataHandler));
+	UC_ASSERT(LWMultiplexerOpenChannel(multiplexer, 1, dataHandler));
+	UC_ASSERT(!LWMultiplexerOpenChannel(multiplexer, 1, dataHandler));
+	UC_ASSERT_EQUAL(65536, LWMultiplexerGetSendCredit(multiplexer, 1));
+	UC_ASSERT_EQUAL(0, LWMultiplexerGetPendingLength(multiplexer, 1));
+	LWMultiplexerCloseChannel(multiplexer, 1);
+
+	// sending on closed channel fails
+	LWMessage *message = LWMessageCreate(1, NULL);
+	UC_ASSERT(!LWMultiplexerSendMessage(multiplexer, 1, message));
+	LWMessageDelete(message);
+
+	LWDataHandlerDelete(dataHandler);
+	LWMultiplexerDelete(multiplexer);
+	LWWriterDelete(writer);
+}
+
+static void test_route_messages(void)
+{
+	int				fileDescriptors[4];
+	LWWriter		*writers[2];
+	LWMultiplexer	*multiplexers[2];
+	create_pair(fileDescriptors, writers, multiplexers);
+
+	// create receiving data handlers
+	LWDataHandler *bulkDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(bulkDataHandler, 10, &bulk_message_callback);
+	LWDataHandler *controlDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(controlDataHandler, 10, &control_message_callback);
+
+	// open channels
+	UC_ASSERT(LWMultiplexerOpenChannel(multiplexers[0], 1, NULL));
+	UC_ASSERT(LWMultiplexerOpenChannel(multiplexers[0], 2, NULL));
+	UC_ASSERT(LWMultiplexerOpenChannel(multiplexers[1], 1, bulkDataHandler));
+	UC_ASSERT(LWMultiplexerOpenChannel(multiplexers[1], 2, controlDataHandler));
+
+	// send messages
+	LWMessage *message = LWMessageCreate(10, LWArgumentCreateFromString("hello"), NULL);
+	gBulkMessageCount = 0;
+	gControlMessageCount = 0;
+	UC_ASSERT(LWMultiplexerSendMessage(multiplexers[0], 1, message));
+	UC_ASSERT(LWMultiplexerSendMessage(multiplexers[0], 1, message));
+	UC_ASSERT(LWMultiplexerSendMessage(multiplexers[0], 2, message));
+	UC_ASSERT(LWMultiplexerSendMessage(multiplexers[0], 3, message) == false);
+	LWMessageDelete(message);
+
+	// receive messages
+	pump(multiplexers[0], fileDescriptors[0], multiplexers[1]);
+	UC_ASSERT_EQUAL(2, gBulkMessageCount);
+	UC_ASSERT_EQUAL(1, gControlMessageCount);
+
+	LWDataHandlerDelete(bulkDataHandler);
+	LWDataHandlerDelete(controlDataHandler);
+	delete_pair(fileDescriptors, writers, multiplexers);
+}
+
+static void test_interleave_channels(void)
+{
+	int				fileDescriptors[4];
+	LWWriter		*writers[2];
+	LWMultiplexer	*multiplexers[2];
+	create_pair(fileDescriptors, writers, multiplexers);
+
+	// writer only accepts a frame when it is empty
+	LWWriterSetWatermarks(writers[0], 0, 1);
+
+	LWDataHandler *bulkDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(bulkDataHandler, 10, &bulk_message_callback);
+	LWDataHandler *controlDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(controlDataHandler, 10, &control_message_callback);
+
+	LWMultiplexerOpenChannel(multiplexers[0], 1, NULL);
+	LWMultiplexerOpenChannel(multiplexers[0], 2, NULL);
+	LWMultiplexerOpenChannel(multiplexers[1], 1, bulkDataHandler);
+	LWMultiplexerOpenChannel(multiplexers[1], 2, controlDataHandler);
+
+	// queue lots of bulk messages, then one control message
+	uint8_t data[1000];
+	memset(data, 'x', sizeof(data));
+	LWMessage *bulkMessage = LWMessageCreate(10, LWArgumentCreate(data, sizeof(data)), NULL);
+	LWMessage *controlMessage = LWMessageCreate(10, NULL);
+	gBulkMessageCount = 0;
+	gControlMessageCount = 0;
+	for(int i = 0; i < 10; ++i)
+		LWMultiplexerSendMessage(multiplexers[0], 1, bulkMessage);
+	LWMultiplexerSendMessage(multiplexers[0], 2, controlMessage);
+	LWMessageDelete(bulkMessage);
+	LWMessageDelete(controlMessage);
+
+	// control message must not wait for the bulk messages
+	for(int i = 0; i < 20; ++i)
+		pump(multiplexers[0], fileDescriptors[0], multiplexers[1]);
+	UC_ASSERT_EQUAL(10, gBulkMessageCount);
+	UC_ASSERT_EQUAL(1, gControlMessageCount);
+	UC_ASSERT(gBulkMessageCountAtControlMessage <= 2);
+
+	LWDataHandlerDelete(bulkDataHandler);
+	LWDataHandlerDelete(controlDataHandler);
+	delete_pair(fileDescriptors, writers, multiplexers);
+}
+
+static void test_credit(void)
+{
+	int				fileDescriptors[4];
+	LWWriter		*writers[2];
+	LWMultiplexer	*multiplexers[2];
+	create_pair(fileDescriptors, writers, multiplexers);
+
+	LWDataHandler *bulkDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(bulkDataHandler, 10, &bulk_message_callback);
+	LWDataHandler *controlDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(controlDataHandler, 10, &control_message_callback);
+
+	for(int i = 0; i < 2; ++i)
+	{
+		LWMultiplexerSetWindowSize(multiplexers[i], 4000);
+		LWMultiplexerOpenChannel(multiplexers[i], 1, i ? bulkDataHandler : NULL);
+		LWMultiplexerOpenChannel(multiplexers[i], 2, i ? controlDataHandler : NULL);
+	}
+
+	// send more bulk data than the window allows
+	uint8_t data[1000];
+	memset(data, 'x', sizeof(data));
+	LWMessage *bulkMessage = LWMessageCreate(10, LWArgumentCreate(data, sizeof(data)), NULL);
+	gBulkMessageCount = 0;
+	gControlMessageCount = 0;
+	for(int i = 0; i < 20; ++i)
+		LWMultiplexerSendMessage(multiplexers[0], 1, bulkMessage);
+	LWMessageDelete(bulkMessage);
+	UC_ASSERT(LWMultiplexerGetSendCredit(multiplexers[0], 1) <= 0);
+	UC_ASSERT(LWMultiplexerGetPendingLength(multiplexers[0], 1) > 0);
+
+	// stalled channel does not block other channels
+	LWMessage *controlMessage = LWMessageCreate(10, NULL);
+	LWMultiplexerSendMessage(multiplexers[0], 2, controlMessage);
+	LWMessageDelete(controlMessage);
+	UC_ASSERT_EQUAL(0, LWMultiplexerGetPendingLength(multiplexers[0], 2));
+
+	// receiver hands out credit as it consumes data
+	pump(multiplexers[0], fileDescriptors[0], multiplexers[1]);
+	UC_ASSERT_EQUAL(4, gBulkMessageCount);
+	UC_ASSERT_EQUAL(1, gControlMessageCount);
+	for(int i = 0; i < 10; ++i)
+	{
+		pump(multiplexers[1], fileDescriptors[2], multiplexers[0]);
+		pump(multiplexers[0], fileDescriptors[0], multiplexers[1]);
+	}
+	UC_ASSERT_EQUAL(20, gBulkMessageCount);
+	UC_ASSERT_EQUAL(0, LWMultiplexerGetPendingLength(multiplexers[0], 1));
+
+	LWDataHandlerDelete(bulkDataHandler);
+	LWDataHandlerDelete(controlDataHandler);
+	delete_pair(fileDescriptors, writers, multiplexers);
+}
+
+static void test_writer_settings(void)
+{
+	int				fileDescriptors[4];
+	LWWriter		*writers[2];
+	LWMultiplexer	*multiplexers[2];
+	create_pair(fileDescriptors, writers, multiplexers);
+
+	LWDataHandler *bulkDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(bulkDataHandler, 10, &bulk_message_callback);
+	LWInternTable *internTable = LWInternTableCreate(4);
+	LWInternTableSetArgumentInterned(internTable, 1, 0, true);
+
+	// writers set up for plain messages; the preamble belongs to the connection
+	uint8_t preamble[kLWWireFormatVersion2PreambleLength];
+	for(int i = 0; i < 2; ++i)
+	{
+		UC_ASSERT(LWWriterSetWireFormat(writers[i], kLWWireFormatVersion2));
+		LWWriterSetChecksumEnabled(writers[i], true);
+		LWWriterSetInternTable(writers[i], internTable);
+		LWWriterFlush(writers[i]);
+		UC_ASSERT_EQUAL(kLWWireFormatVersion2PreambleLength, read(fileDescriptors[2*i], preamble, sizeof(preamble)));
+
+		LWMultiplexerSetWindowSize(multiplexers[i], 4000);
+		LWMultiplexerOpenChannel(multiplexers[i], 1, i ? bulkDataHandler : NULL);
+	}
+
+	// credit updates keep the stream in sync
+	uint8_t data[1000];
+	memset(data, 'x', sizeof(data));
+	LWMessage *bulkMessage = LWMessageCreate(10, LWArgumentCreate(data, sizeof(data)), NULL);
+	gBulkMessageCount = 0;
+	for(int i = 0; i < 20; ++i)
+		LWMultiplexerSendMessage(multiplexers[0], 1, bulkMessage);
+	LWMessageDelete(bulkMessage);
+	for(int i = 0; i < 10; ++i)
+	{
+		pump(multiplexers[0], fileDescriptors[0], multiplexers[1]);
+		pump(multiplexers[1], fileDescriptors[2], multiplexers[0]);
+	}
+	UC_ASSERT_EQUAL(20, gBulkMessageCount);
+	UC_ASSERT_EQUAL(0, LWMultiplexerGetPendingLength(multiplexers[0], 1));
+
+	LWDataHandlerDelete(bulkDataHandler);
+	delete_pair(fileDescriptors, writers, multiplexers);
+	LWInternTableDelete(internTable);
+}
+
+#pragma mark -
+
+void test_multiplexer(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("multiplexer");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("route messages",						&test_route_messages));
+	uc_suite_add_test(suite, uc_test_create("interleave channels",					&test_interleave_channels));
+	uc_suite_add_test(suite, uc_test_create("credit",								&test_credit));
+	uc_suite_add_test(suite, uc_test_create("writer settings",						&test_writer_settings));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
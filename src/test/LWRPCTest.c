@@ -0,0 +1,266 @@
+/*
+ * LWRPCTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWWriteQueue.h>
+#include <Lunkwill/LWWriter.h>
+#include <Lunkwill/LWRPC.h>
+
+#define kTestRequestMessageID	(1)
+#define kTestResponseMessageID	(2)
+#define kTestRequestCount		(1000)
+
+uint32_t	gPendingCorrelationIDs[kTestRequestCount];
+size_t		gPendingCount;
+uint32_t	gResponseCount;
+uint32_t	gMismatchCount;
+uint32_t	gCancelledCount;
+
+#pragma mark -
+
+static void request_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	// remember request so it can be answered later
+	uint32_t correlationID;
+	UC_ASSERT(LWRPCGetCorrelationID(aMessage, &correlationID));
+	UC_ASSERT_EQUAL(2, LWMessageGetArgumentCount(aMessage));
+	gPendingCorrelationIDs[gPendingCount++] = correlationID;
+}
+
+static void response_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler)
+
+	UC_ASSERT(LWRPCHandleResponse((LWRPC *)aUserInfo, aMessage));
+}
+
+static void rpc_response_callback(LWRPC *aRPC, LWMessage *aResponse, void *aContext)
+{
+#pragma unused (aRPC)
+
+	if(!aResponse)
+	{
+		++gCancelledCount;
+		return;
+	}
+
+	// response carries the request number back
+	++gResponseCount;
+	if(LWArgumentGet32BitUnsignedIntegerValue(aResponse->arguments[1]) != *(uint32_t *)aContext)
+		++gMismatchCount;
+}
+
+#pragma mark -
+
+static void move_data(LWWriter *aWriter, LWDataHandler *aDataHandler)
+{
+	void	*data;
+	size_t	length;
+	while((data = LWWriteQueuePeek(aWriter->writeQueue, &length)))
+	{
+		UC_ASSERT(LWDataHandlerHandleData(aDataHandler, data, length));
+		LWWriteQueueConsume(aWriter->writeQueue, length);
+	}
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWRPC *rpc = LWRPCCreate(writer);
+	UC_ASSERT_NOT_NULL(rpc);
+	UC_ASSERT_EQUAL(0, LWRPCGetInFlightRequestCount(rpc));
+	LWRPCDelete(rpc);
+	LWWriterDelete(writer);
+}
+
+static void test_correlation_id(void)
+{
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWMessage *response = LWMessageCreate(kTestResponseMessageID, LWArgumentCreateFromString("x"), NULL);
+	UC_ASSERT(LWRPCWriteResponse(writer, 0x01020304, response));
+	LWMessageDelete(response);
+
+	// correlation ID goes first
+	uint8_t expectedData[] = { kTestResponseMessageID, 4, 1, 2, 3, 4, 1, 'x', 0 };
+	size_t length;
+	void *data = LWWriteQueuePeek(writer->writeQueue, &length);
+	UC_ASSERT_EQUAL(sizeof(expectedData), length);
+	UC_ASSERT_EQUAL(0, memcmp(expectedData, data, length));
+
+	size_t bytesUsed;
+	uint32_t correlationID;
+	LWMessage *message = LWMessageDeserialize(data, length, &bytesUsed);
+	UC_ASSERT(LWRPCGetCorrelationID(message, &correlationID));
+	UC_ASSERT_EQUAL(0x01020304, correlationID);
+	LWMessageDelete(message);
+
+	// messages without correlation ID
+	message = LWMessageCreate(kTestResponseMessageID, NULL);
+	UC_ASSERT(!LWRPCGetCorrelationID(message, &correlationID));
+	LWMessageDelete(message);
+
+	// messages with more arguments than fit on the stack
+	LWWriteQueueConsume(writer->writeQueue, length);
+	LWArgument *arguments[100];
+	for(uint32_t i = 0; i < 100; ++i)
+		arguments[i] = LWArgumentCreateFrom32BitUnsignedInteger(i);
+	response = LWMessageCreate2(kTestResponseMessageID, 100, arguments);
+	UC_ASSERT(LWRPCWriteResponse(writer, 0x01020304, response));
+	LWMessageDelete(response);
+	data = LWWriteQueuePeek(writer->writeQueue, &length);
+	message = LWMessageDeserialize(data, length, &bytesUsed);
+	UC_ASSERT_NOT_NULL(message);
+	UC_ASSERT_EQUAL(101, LWMessageGetArgumentCount(message));
+	UC_ASSERT(LWRPCGetCorrelationID(message, &correlationID));
+	UC_ASSERT_EQUAL(0x01020304, correlationID);
+	UC_ASSERT_EQUAL(99, LWArgumentGet32BitUnsignedIntegerValue(message->arguments[100]));
+	LWMessageDelete(message);
+
+	LWWriterDelete(writer);
+}
+
+static void test_pipelined_requests(void)
+{
+	uint32_t requestNumbers[kTestRequestCount];
+
+	LWWriter *clientWriter = LWWriterCreate(-1, NULL);
+	LWWriter *serverWriter = LWWriterCreate(-1, NULL);
+	LWRPC *rpc = LWRPCCreate(clientWriter);
+
+	LWDataHandler *serverDataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(serverDataHandler, kTestRequestMessageID, &request_callback);
+	LWDataHandler *clientDataHandler = LWDataHandlerCreate(rpc);
+	LWDataHandlerSetMessageCallback(clientDataHandler, kTestResponseMessageID, &response_callback);
+
+	// send all requests without waiting
+	gPendingCount	= 0;
+	gResponseCount	= 0;
+	gMismatchCount	= 0;
+	for(uint32_t i = 0; i < kTestRequestCount; ++i)
+	{
+		requestNumbers[i] = i;
+		LWMessage *request = LWMessageCreate(kTestRequestMessageID, LWArgumentCreateFrom32BitUnsignedInteger(i), NULL);
+		UC_ASSERT(LWRPCSendRequest(rpc, request, &rpc_response_callback, &requestNumbers[i], NULL));
+		LWMessageDelete(request);
+
+		// keep server buffer small
+		move_data(clientWriter, serverDataHandler);
+	}
+	UC_ASSERT_EQUAL(kTestRequestCount, LWRPCGetInFlightRequestCount(rpc));
+	UC_ASSERT_EQUAL(kTestRequestCount, gPendingCount);
+
+	// answer requests in reverse order
+	for(size_t i = gPendingCount; i > 0; --i)
+	{
+		LWMessage *response = LWMessageCreate(kTestResponseMessageID, LWArgumentCreateFrom32BitUnsignedInteger((uint32_t)(i - 1)), NULL);
+		UC_ASSERT(LWRPCWriteResponse(serverWriter, gPendingCorrelationIDs[i - 1], response));
+		LWMessageDelete(response);
+
+		move_data(serverWriter, clientDataHandler);
+	}
+	UC_ASSERT_EQUAL(kTestRequestCount, gResponseCount);
+	UC_ASSERT_EQUAL(0, gMismatchCount);
+	UC_ASSERT_EQUAL(0, LWRPCGetInFlightRequestCount(rpc));
+
+	LWDataHandlerDelete(clientDataHandler);
+	LWDataHandlerDelete(serverDataHandler);
+	LWRPCDelete(rpc);
+	LWWriterDelete(serverWriter);
+	LWWriterDelete(clientWriter);
+}
+
+static void test_cancel_requests(void)
+{
+	uint32_t requestNumber = 0;
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	LWRPC *rpc = LWRPCCreate(writer);
+	LWMessage *request = LWMessageCreate(kTestRequestMessageID, NULL);
+
+	// cancelled requests ignore their responses
+	uint32_t correlationIDs[3];
+	gCancelledCount = 0;
+	gResponseCount = 0;
+	for(int i = 0; i < 3; ++i)
+		UC_ASSERT(LWRPCSendRequest(rpc, request, &rpc_response_callback, &requestNumber, &correlationIDs[i]));
+	UC_ASSERT(LWRPCCancelRequest(rpc, correlationIDs[1]));
+	UC_ASSERT(!LWRPCCancelRequest(rpc, correlationIDs[1]));
+	UC_ASSERT_EQUAL(2, LWRPCGetInFlightRequestCount(rpc));
+
+	LWMessage *response = LWMessageCreate(kTestResponseMessageID, LWArgumentCreateFrom32BitUnsignedInteger(correlationIDs[1]), LWArgumentCreateFrom32BitUnsignedInteger(0), NULL);
+	UC_ASSERT(!LWRPCHandleResponse(rpc, response));
+	LWMessageDelete(response);
+	UC_ASSERT_EQUAL(0, gResponseCount);
+
+	// deleting fails requests still in flight
+	LWRPCDelete(rpc);
+	UC_ASSERT_EQUAL(2, gCancelledCount);
+
+	LWMessageDelete(request);
+	LWWriterDelete(writer);
+}
+
+#pragma mark -
+
+void test_rpc(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("rpc");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("correlation id",						&test_correlation_id));
+	uc_suite_add_test(suite, uc_test_create("pipelined requests",					&test_pipelined_requests));
+	uc_suite_add_test(suite, uc_test_create("cancel requests",						&test_cancel_requests));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
@@ -0,0 +1,237 @@
+/*
+ * LWSharedRingTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWSharedRing.h>
+
+uint32_t gSharedRingMessageCount;
+uint32_t gSharedRingLastSequenceNumber;
+
+#pragma mark -
+
+static void message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aUserInfo)
+
+	// messages must arrive complete and in order
+	uint32_t sequenceNumber = LWArgumentGet32BitUnsignedIntegerValue(LWMessageGetArgumentAtIndex(aMessage, 0));
+	if(0 != gSharedRingMessageCount)
+		UC_ASSERT_EQUAL(gSharedRingLastSequenceNumber + 1, sequenceNumber);
+	UC_ASSERT_EQUAL(300, LWArgumentGetLength(LWMessageGetArgumentAtIndex(aMessage, 1)));
+
+	gSharedRingLastSequenceNumber = sequenceNumber;
+	++gSharedRingMessageCount;
+}
+
+static LWMessage *create_message(uint32_t aSequenceNumber)
+{
+	static uint8_t payload[300];
+
+	return LWMessageCreate(
+		123,
+		LWArgumentCreateFrom32BitUnsignedInteger(aSequenceNumber),
+		LWArgumentCreate(payload, sizeof(payload)),
+		NULL
+	);
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	LWSharedRing *sharedRing = LWSharedRingCreate(1000);
+	UC_ASSERT_NOT_NULL(sharedRing);
+	UC_ASSERT(LWSharedRingGetFileDescriptor(sharedRing) >= 0);
+	UC_ASSERT_EQUAL(0, LWSharedRingGetCapacity(sharedRing) % sysconf(_SC_PAGESIZE));
+	UC_ASSERT(LWSharedRingGetCapacity(sharedRing) >= 1000);
+	UC_ASSERT_EQUAL(0, LWSharedRingGetAvailableLength(sharedRing));
+	LWSharedRingDelete(sharedRing);
+}
+
+static void test_create_with_file_descriptor(void)
+{
+	uint8_t data[] = { 123, 2, 1, 2, 0 };
+
+	LWSharedRing *producer = LWSharedRingCreate(4096);
+	LWSharedRing *consumer = LWSharedRingCreateWithFileDescriptor(dup(LWSharedRingGetFileDescriptor(producer)));
+	UC_ASSERT_NOT_NULL(consumer);
+	UC_ASSERT_EQUAL(LWSharedRingGetCapacity(producer), LWSharedRingGetCapacity(consumer));
+
+	UC_ASSERT(LWSharedRingWriteData(producer, data, 5));
+	UC_ASSERT_EQUAL(5, LWSharedRingGetAvailableLength(consumer));
+
+	LWSharedRingDelete(consumer);
+	LWSharedRingDelete(producer);
+}
+
+static void test_write_full(void)
+{
+	uint8_t data[1024];
+	memset(data, 1, sizeof(data));
+
+	LWSharedRing *sharedRing = LWSharedRingCreate(4096);
+	size_t capacity = LWSharedRingGetCapacity(sharedRing);
+	for(size_t i = 0; i < capacity / sizeof(data); ++i)
+		UC_ASSERT(LWSharedRingWriteData(sharedRing, data, sizeof(data)));
+	UC_ASSERT(!LWSharedRingWriteData(sharedRing, data, 1));
+	UC_ASSERT(!LWSharedRingWaitForSpace(sharedRing, 1, 0));
+	LWSharedRingDelete(sharedRing);
+}
+
+static void test_handle_data_wrapping(void)
+{
+	gSharedRingMessageCount = 0;
+
+	LWSharedRing *sharedRing = LWSharedRingCreate(4096);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+
+	// messages do not divide the ring evenly, so they wrap around its end
+	uint32_t sentMessageCount = 0;
+	for(int i = 0; i < 100; ++i)
+	{
+		while(true)
+		{
+			LWMessage *message = create_message(sentMessageCount);
+			bool success = LWSharedRingWriteMessage(sharedRing, message);
+			LWMessageDelete(message);
+			if(!success)
+				break;
+			++sentMessageCount;
+		}
+
+		UC_ASSERT(LWSharedRingWaitForData(sharedRing, 0));
+		UC_ASSERT(LWSharedRingHandleData(sharedRing, dataHandler));
+		UC_ASSERT_EQUAL(0, LWSharedRingGetAvailableLength(sharedRing));
+	}
+	UC_ASSERT(sentMessageCount > 1000);
+	UC_ASSERT_EQUAL(sentMessageCount, gSharedRingMessageCount);
+	UC_ASSERT(!LWSharedRingWaitForData(sharedRing, 0));
+
+	LWDataHandlerDelete(dataHandler);
+	LWSharedRingDelete(sharedRing);
+}
+
+static void test_handle_data_incomplete(void)
+{
+	uint8_t data[] = { 123, 4, 0, 0, 0, 7, 1 };
+
+	gSharedRingMessageCount = 0;
+
+	LWSharedRing *sharedRing = LWSharedRingCreate(4096);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+
+	// incomplete messages stay in the ring
+	UC_ASSERT(LWSharedRingWriteData(sharedRing, data, sizeof(data)));
+	UC_ASSERT(LWSharedRingHandleData(sharedRing, dataHandler));
+	UC_ASSERT_EQUAL(sizeof(data), LWSharedRingGetAvailableLength(sharedRing));
+	UC_ASSERT_EQUAL(0, gSharedRingMessageCount);
+
+	LWDataHandlerDelete(dataHandler);
+	LWSharedRingDelete(sharedRing);
+}
+
+static void test_between_processes(void)
+{
+	gSharedRingMessageCount = 0;
+
+	LWSharedRing *sharedRing = LWSharedRingCreate(4096);
+
+	pid_t pid = fork();
+	if(0 == pid)
+	{
+		// produce messages in child
+		for(uint32_t i = 0; i < 10000; ++i)
+		{
+			LWMessage *message = create_message(i);
+			while(!LWSharedRingWriteMessage(sharedRing, message))
+				LWSharedRingWaitForSpace(sharedRing, LWMessageGetSerializedLength(message), -1);
+			LWMessageDelete(message);
+		}
+		_exit(0);
+	}
+
+	// consume messages in parent
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetMessageCallback(dataHandler, 123, &message_callback);
+	while(gSharedRingMessageCount < 10000)
+	{
+		LWSharedRingWaitForData(sharedRing, -1);
+		UC_ASSERT(LWSharedRingHandleData(sharedRing, dataHandler));
+	}
+	UC_ASSERT_EQUAL(9999, gSharedRingLastSequenceNumber);
+
+	int status;
+	waitpid(pid, &status, 0);
+	UC_ASSERT(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+
+	LWDataHandlerDelete(dataHandler);
+	LWSharedRingDelete(sharedRing);
+}
+
+#pragma mark -
+
+void test_shared_ring(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("shared ring");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("create with file descriptor",			&test_create_with_file_descriptor));
+	uc_suite_add_test(suite, uc_test_create("write full",							&test_write_full));
+	uc_suite_add_test(suite, uc_test_create("handle data wrapping",					&test_handle_data_wrapping));
+	uc_suite_add_test(suite, uc_test_create("handle data incomplete",				&test_handle_data_incomplete));
+	uc_suite_add_test(suite, uc_test_create("between processes",					&test_between_processes));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
@@ -0,0 +1,231 @@
+/*
+ * LWTimerWheelTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWTimerWheel.h>
+
+struct test_timer_info {
+	LWTimerWheel	*timerWheel;
+	uint64_t		firedTime;
+	uint32_t		fireCount;
+	uint32_t		rearmCount;
+};
+
+uint32_t gLateTimerCount;
+
+#pragma mark -
+
+static void timer_callback(LWTimer *aTimer, void *aUserInfo)
+{
+#pragma unused (aTimer)
+
+	struct test_timer_info *info = aUserInfo;
+	info->firedTime = LWTimerWheelGetCurrentTime(info->timerWheel);
+	++info->fireCount;
+
+	// rearm if requested
+	if(info->rearmCount > 0)
+	{
+		--info->rearmCount;
+		LWTimerArm(aTimer, info->timerWheel, 10);
+	}
+}
+
+static void exact_timer_callback(LWTimer *aTimer, void *aUserInfo)
+{
+	LWTimerWheel *timerWheel = aUserInfo;
+	if(LWTimerGetExpirationTime(aTimer) != LWTimerWheelGetCurrentTime(timerWheel))
+		++gLateTimerCount;
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(1000);
+	UC_ASSERT_NOT_NULL(timerWheel);
+	UC_ASSERT_EQUAL(1000, LWTimerWheelGetCurrentTime(timerWheel));
+	UC_ASSERT_EQUAL(0, LWTimerWheelGetTimerCount(timerWheel));
+	UC_ASSERT_EQUAL(0, LWTimerWheelAdvance(timerWheel, 5000));
+	UC_ASSERT_EQUAL(5000, LWTimerWheelGetCurrentTime(timerWheel));
+	LWTimerWheelDelete(timerWheel);
+}
+
+static void test_arm(void)
+{
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(1000);
+	struct test_timer_info info = { timerWheel, 0, 0, 0 };
+	LWTimer *timer = LWTimerCreate(&timer_callback, &info);
+	UC_ASSERT(!LWTimerIsArmed(timer));
+
+	LWTimerArm(timer, timerWheel, 10);
+	UC_ASSERT(LWTimerIsArmed(timer));
+	UC_ASSERT_EQUAL(1010, LWTimerGetExpirationTime(timer));
+	UC_ASSERT_EQUAL(1, LWTimerWheelGetTimerCount(timerWheel));
+
+	UC_ASSERT_EQUAL(0, LWTimerWheelAdvance(timerWheel, 1009));
+	UC_ASSERT_EQUAL(0, info.fireCount);
+	UC_ASSERT_EQUAL(1, LWTimerWheelAdvance(timerWheel, 1010));
+	UC_ASSERT_EQUAL(1, info.fireCount);
+	UC_ASSERT_EQUAL(1010, info.firedTime);
+	UC_ASSERT(!LWTimerIsArmed(timer));
+	UC_ASSERT_EQUAL(0, LWTimerWheelGetTimerCount(timerWheel));
+
+	LWTimerDelete(timer);
+	LWTimerWheelDelete(timerWheel);
+}
+
+static void test_cancel_and_rearm(void)
+{
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(0);
+	struct test_timer_info info = { timerWheel, 0, 0, 0 };
+	LWTimer *timer = LWTimerCreate(&timer_callback, &info);
+
+	// cancel
+	LWTimerArm(timer, timerWheel, 10);
+	LWTimerCancel(timer);
+	UC_ASSERT(!LWTimerIsArmed(timer));
+	UC_ASSERT_EQUAL(0, LWTimerWheelAdvance(timerWheel, 20));
+
+	// rearm pushes expiration back
+	LWTimerArm(timer, timerWheel, 10);
+	LWTimerWheelAdvance(timerWheel, 25);
+	LWTimerArm(timer, timerWheel, 10);
+	LWTimerWheelAdvance(timerWheel, 30);
+	UC_ASSERT_EQUAL(0, info.fireCount);
+	LWTimerWheelAdvance(timerWheel, 35);
+	UC_ASSERT_EQUAL(1, info.fireCount);
+	UC_ASSERT_EQUAL(35, info.firedTime);
+
+	// rearm from callback
+	info.rearmCount = 3;
+	LWTimerArm(timer, timerWheel, 10);
+	UC_ASSERT_EQUAL(4, LWTimerWheelAdvance(timerWheel, 1000));
+	UC_ASSERT_EQUAL(5, info.fireCount);
+	UC_ASSERT_EQUAL(75, info.firedTime);
+
+	// deleting an armed timer disarms it
+	LWTimerArm(timer, timerWheel, 10);
+	LWTimerDelete(timer);
+	UC_ASSERT_EQUAL(0, LWTimerWheelGetTimerCount(timerWheel));
+
+	LWTimerWheelDelete(timerWheel);
+}
+
+static void test_long_timeouts(void)
+{
+	uint64_t timeouts[] = { 0, 1, 255, 256, 257, 65535, 65536, 70000, 16777215, 16777216, 20000000 };
+	size_t timeoutCount = sizeof(timeouts)/sizeof(timeouts[0]);
+
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(12345);
+	LWTimer *timers[timeoutCount];
+	gLateTimerCount = 0;
+	for(size_t i = 0; i < timeoutCount; ++i)
+	{
+		timers[i] = LWTimerCreate(&exact_timer_callback, timerWheel);
+		LWTimerArm(timers[i], timerWheel, timeouts[i]);
+	}
+
+	// advance in uneven steps
+	size_t firedTimerCount = 0;
+	for(uint64_t time = 12345; time < 12345 + 20000001; time += 777)
+		firedTimerCount += LWTimerWheelAdvance(timerWheel, time);
+	firedTimerCount += LWTimerWheelAdvance(timerWheel, 12345 + 20000000);
+	UC_ASSERT_EQUAL(timeoutCount, firedTimerCount);
+	UC_ASSERT_EQUAL(0, gLateTimerCount);
+
+	for(size_t i = 0; i < timeoutCount; ++i)
+		LWTimerDelete(timers[i]);
+	LWTimerWheelDelete(timerWheel);
+}
+
+static void test_many_timers(void)
+{
+	size_t timerCount = 100000;
+
+	LWTimerWheel *timerWheel = LWTimerWheelCreate(0);
+	LWTimer **timers = malloc(timerCount*sizeof(LWTimer *));
+	gLateTimerCount = 0;
+	srand(1);
+	for(size_t i = 0; i < timerCount; ++i)
+	{
+		timers[i] = LWTimerCreate(&exact_timer_callback, timerWheel);
+		LWTimerArm(timers[i], timerWheel, 1 + (uint64_t)rand() % 200000);
+	}
+	UC_ASSERT_EQUAL(timerCount, LWTimerWheelGetTimerCount(timerWheel));
+
+	// cancel every other timer
+	for(size_t i = 0; i < timerCount; i += 2)
+		LWTimerCancel(timers[i]);
+	UC_ASSERT_EQUAL(timerCount/2, LWTimerWheelGetTimerCount(timerWheel));
+
+	size_t firedTimerCount = 0;
+	for(uint64_t time = 0; time <= 200000; time += 1000)
+		firedTimerCount += LWTimerWheelAdvance(timerWheel, time);
+	UC_ASSERT_EQUAL(timerCount/2, firedTimerCount);
+	UC_ASSERT_EQUAL(0, gLateTimerCount);
+
+	for(size_t i = 0; i < timerCount; ++i)
+		LWTimerDelete(timers[i]);
+	free(timers);
+	LWTimerWheelDelete(timerWheel);
+}
+
+#pragma mark -
+
+void test_timer_wheel(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("timer wheel");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("arm",									&test_arm));
+	uc_suite_add_test(suite, uc_test_create("cancel and rearm",						&test_cancel_and_rearm));
+	uc_suite_add_test(suite, uc_test_create("long timeouts",						&test_long_timeouts));
+	uc_suite_add_test(suite, uc_test_create("many timers",							&test_many_timers));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
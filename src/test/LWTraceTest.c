@@ -0,0 +1,247 @@
+/*
+ * LWTraceTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWDataHandler.h>
+#include <Lunkwill/LWValidator.h>
+#include <Lunkwill/LWTrace.h>
+
+uint8_t gTraceEvents[16];
+uint8_t gTraceMessageIDs[16];
+size_t gTraceLengths[16];
+size_t gTraceEventCount;
+bool gTraceFailsAllocations;
+
+#pragma mark -
+
+static void trace_callback(uint8_t aEvent, uint8_t aMessageID, size_t aLength, uint64_t aStartTime, uint64_t aEndTime, void *aUserInfo)
+{
+	UC_ASSERT_EQUAL(&gTraceEventCount, aUserInfo);
+	UC_ASSERT(aStartTime > 0);
+	UC_ASSERT(aEndTime >= aStartTime);
+
+	if(gTraceEventCount < 16)
+	{
+		gTraceEvents[gTraceEventCount]		= aEvent;
+		gTraceMessageIDs[gTraceEventCount]	= aMessageID;
+		gTraceLengths[gTraceEventCount]		= aLength;
+	}
+	++gTraceEventCount;
+}
+
+static void *trace_allocate(size_t aSize, void *aContext)
+{
+#pragma unused (aContext)
+
+	return gTraceFailsAllocations ? NULL : malloc(aSize);
+}
+
+static void *trace_reallocate(void *aPointer, size_t aSize, void *aContext)
+{
+#pragma unused (aContext)
+
+	return realloc(aPointer, aSize);
+}
+
+static void trace_free(void *aPointer, void *aContext)
+{
+#pragma unused (aContext)
+
+	free(aPointer);
+}
+
+static bool validate_message(LWMessage *aMessage)
+{
+#pragma unused (aMessage)
+
+	return true;
+}
+
+static void message_callback(LWDataHandler *aDataHandler, LWMessage *aMessage, void *aUserInfo)
+{
+#pragma unused (aDataHandler, aMessage, aUserInfo)
+}
+
+#pragma mark -
+
+static void test_callback(void)
+{
+	LWValidator *validator = LWValidatorCreate();
+	LWValidatorSetMessageValidationCallback(validator, 5, &validate_message);
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+	LWDataHandlerSetValidator(dataHandler, validator);
+	LWDataHandlerSetMessageCallback(dataHandler, 5, &message_callback);
+	LWMessage *message = LWMessageCreate(5, LWArgumentCreateFromString("abc"), NULL);
+
+	gTraceEventCount = 0;
+	LWTraceSetCallback(&trace_callback, &gTraceEventCount);
+
+	// serialize and handle one message
+	size_t length;
+	void *serializedMessage;
+	UC_ASSERT(LWMessageSerialize(message, &length, &serializedMessage));
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, serializedMessage, length));
+
+	if(LWTraceIsAvailable())
+	{
+		uint8_t expectedEvents[] = {
+			kLWTraceEventSerialize,
+			kLWTraceEventDeserialize,
+			kLWTraceEventValidate,
+			kLWTraceEventDispatch,
+			kLWTraceEventHandleData
+		};
+		UC_ASSERT_EQUAL(sizeof(expectedEvents), gTraceEventCount);
+		UC_ASSERT_EQUAL(0, memcmp(expectedEvents, gTraceEvents, sizeof(expectedEvents)));
+		UC_ASSERT_EQUAL(5, gTraceMessageIDs[0]);
+		UC_ASSERT_EQUAL(length, gTraceLengths[0]);
+		UC_ASSERT_EQUAL(length, gTraceLengths[1]);
+		UC_ASSERT_EQUAL(1, gTraceLengths[2]);
+		UC_ASSERT_EQUAL(length, gTraceLengths[3]);
+		UC_ASSERT_EQUAL(0, gTraceMessageIDs[4]);
+		UC_ASSERT_EQUAL(length, gTraceLengths[4]);
+	}
+	else
+		UC_ASSERT_EQUAL(0, gTraceEventCount);
+
+	// no events once the callback is cleared
+	LWTraceSetCallback(NULL, NULL);
+	gTraceEventCount = 0;
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, serializedMessage, length));
+	UC_ASSERT_EQUAL(0, gTraceEventCount);
+
+	free(serializedMessage);
+	LWMessageDelete(message);
+	LWDataHandlerDelete(dataHandler);
+	LWValidatorDelete(validator);
+}
+
+static void test_handle_data_events(void)
+{
+	LWDataHandler *dataHandler = LWDataHandlerCreate(NULL);
+
+	gTraceEventCount = 0;
+	LWTraceSetCallback(&trace_callback, &gTraceEventCount);
+
+	// refused data is not traced
+	uint8_t data[] = { 0xff, 'L' };
+	UC_ASSERT(LWDataHandlerDetach(dataHandler));
+	UC_ASSERT(!LWDataHandlerHandleData(dataHandler, data, sizeof(data)));
+	UC_ASSERT(LWDataHandlerAttach(dataHandler, NULL));
+	UC_ASSERT_EQUAL(0, gTraceEventCount);
+
+	// data that only starts the preamble is
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, sizeof(data)));
+	if(LWTraceIsAvailable())
+	{
+		UC_ASSERT_EQUAL(1, gTraceEventCount);
+		UC_ASSERT_EQUAL(kLWTraceEventHandleData, gTraceEvents[0]);
+		UC_ASSERT_EQUAL(sizeof(data), gTraceLengths[0]);
+	}
+	else
+		UC_ASSERT_EQUAL(0, gTraceEventCount);
+
+	LWTraceSetCallback(NULL, NULL);
+	LWDataHandlerDelete(dataHandler);
+}
+
+static void test_deserialize_events(void)
+{
+	LWAllocator allocator = { &trace_allocate, &trace_reallocate, &trace_free, NULL };
+	LWDataHandler *dataHandler = LWDataHandlerCreateWithAllocator(NULL, &allocator);
+	LWDataHandlerSetMessageCallback(dataHandler, 5, &message_callback);
+
+	gTraceEventCount = 0;
+	gTraceFailsAllocations = false;
+	LWTraceSetCallback(&trace_callback, &gTraceEventCount);
+
+	// partial frames are not deserialized yet
+	uint8_t data[] = { 5, 3, 'a', 'b', 'c', 0 };
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data, 3));
+	if(LWTraceIsAvailable())
+	{
+		UC_ASSERT_EQUAL(1, gTraceEventCount);
+		UC_ASSERT_EQUAL(kLWTraceEventHandleData, gTraceEvents[0]);
+	}
+	else
+		UC_ASSERT_EQUAL(0, gTraceEventCount);
+
+	// complete frames that cannot be decoded still finish their event
+	gTraceEventCount = 0;
+	gTraceFailsAllocations = true;
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler, data + 3, sizeof(data) - 3));
+	gTraceFailsAllocations = false;
+	if(LWTraceIsAvailable())
+	{
+		UC_ASSERT_EQUAL(2, gTraceEventCount);
+		UC_ASSERT_EQUAL(kLWTraceEventDeserialize, gTraceEvents[0]);
+		UC_ASSERT_EQUAL(5, gTraceMessageIDs[0]);
+		UC_ASSERT_EQUAL(0, gTraceLengths[0]);
+		UC_ASSERT_EQUAL(kLWTraceEventHandleData, gTraceEvents[1]);
+	}
+	else
+		UC_ASSERT_EQUAL(0, gTraceEventCount);
+
+	LWTraceSetCallback(NULL, NULL);
+	LWDataHandlerDelete(dataHandler);
+}
+
+#pragma mark -
+
+void test_trace(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("trace");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("callback",								&test_callback));
+	uc_suite_add_test(suite, uc_test_create("handle data events",					&test_handle_data_events));
+	uc_suite_add_test(suite, uc_test_create("deserialize events",					&test_deserialize_events));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
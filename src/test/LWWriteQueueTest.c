@@ -0,0 +1,240 @@
+/*
+ * LWWriteQueueTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWBuffer.h>
+#include <Lunkwill/LWWriteQueue.h>
+
+static void test_create(void)
+{
+	LWWriteQueue *writeQueue = LWWriteQueueCreate();
+	UC_ASSERT_NOT_NULL(writeQueue);
+	UC_ASSERT(LWWriteQueueIsEmpty(writeQueue));
+	UC_ASSERT_EQUAL(0, LWWriteQueueGetPendingLength(writeQueue));
+	LWWriteQueueDelete(writeQueue);
+}
+
+static void test_enqueue_buffer(void)
+{
+	uint8_t data[] = { 7, 2, 4 };
+
+	LWBuffer *buffer = LWBufferCreate(data, 3);
+	LWWriteQueue *writeQueue = LWWriteQueueCreate();
+	UC_ASSERT(LWWriteQueueEnqueueBuffer(writeQueue, buffer));
+	UC_ASSERT(!LWWriteQueueIsEmpty(writeQueue));
+	UC_ASSERT_EQUAL(3, LWWriteQueueGetPendingLength(writeQueue));
+	UC_ASSERT_EQUAL(2, buffer->retainCount);
+
+	LWWriteQueueDelete(writeQueue);
+	UC_ASSERT_EQUAL(1, buffer->retainCount);
+	LWBufferRelease(buffer);
+}
+
+static void test_enqueue_many_buffers(void)
+{
+	uint8_t data[] = { 7, 2, 4 };
+
+	LWBuffer *buffer = LWBufferCreate(data, 3);
+	LWWriteQueue *writeQueue = LWWriteQueueCreate();
+	for(int i = 0; i < 100; ++i)
+		UC_ASSERT(LWWriteQueueEnqueueBuffer(writeQueue, buffer));
+	UC_ASSERT_EQUAL(300, LWWriteQueueGetPendingLength(writeQueue));
+	UC_ASSERT_EQUAL(101, buffer->retainCount);
+
+	LWWriteQueueDelete(writeQueue);
+	UC_ASSERT_EQUAL(1, buffer->retainCount);
+	LWBufferRelease(buffer);
+}
+
+static void test_peek_consume(void)
+{
+	uint8_t data1[] = { 7, 2, 4 };
+	uint8_t data2[] = { 9, 5 };
+
+	LWBuffer *buffer1 = LWBufferCreate(data1, 3);
+	LWBuffer *buffer2 = LWBufferCreate(data2, 2);
+	LWWriteQueue *writeQueue = LWWriteQueueCreate();
+	LWWriteQueueEnqueueBuffer(writeQueue, buffer1);
+	LWWriteQueueEnqueueBuffer(writeQueue, buffer2);
+	LWBufferRelease(buffer1);
+	LWBufferRelease(buffer2);
+
+	size_t length;
+	uint8_t *data = LWWriteQueuePeek(writeQueue, &length);
+	UC_ASSERT_EQUAL(3, length);
+	UC_ASSERT_EQUAL(7, data[0]);
+
+	LWWriteQueueConsume(writeQueue, 2);
+	data = LWWriteQueuePeek(writeQueue, &length);
+	UC_ASSERT_EQUAL(1, length);
+	UC_ASSERT_EQUAL(4, data[0]);
+	UC_ASSERT_EQUAL(3, LWWriteQueueGetPendingLength(writeQueue));
+
+	LWWriteQueueConsume(writeQueue, 2);
+	data = LWWriteQueuePeek(writeQueue, &length);
+	UC_ASSERT_EQUAL(1, length);
+	UC_ASSERT_EQUAL(5, data[0]);
+
+	LWWriteQueueConsume(writeQueue, 1);
+	UC_ASSERT(LWWriteQueueIsEmpty(writeQueue));
+	UC_ASSERT_NULL(LWWriteQueuePeek(writeQueue, &length));
+	UC_ASSERT_EQUAL(0, length);
+
+	LWWriteQueueDelete(writeQueue);
+}
+
+static void test_write_to_file_descriptor(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+
+	LWWriteQueue *writeQueue = LWWriteQueueCreate();
+	UC_ASSERT(LWWriteQueueEnqueueMessage(writeQueue, message));
+	UC_ASSERT(LWWriteQueueEnqueueMessage(writeQueue, message));
+	UC_ASSERT_EQUAL(16, LWWriteQueueGetPendingLength(writeQueue));
+
+	int fileDescriptors[2];
+	UC_ASSERT(0 == pipe(fileDescriptors));
+	UC_ASSERT(LWWriteQueueWriteToFileDescriptor(writeQueue, fileDescriptors[1]));
+	UC_ASSERT(LWWriteQueueIsEmpty(writeQueue));
+
+	uint8_t data[32];
+	UC_ASSERT_EQUAL(16, read(fileDescriptors[0], data, sizeof(data)));
+	UC_ASSERT_EQUAL(123, data[0]);
+	UC_ASSERT_EQUAL(5, data[1]);
+	UC_ASSERT_EQUAL(0, data[7]);
+	UC_ASSERT_EQUAL(123, data[8]);
+
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+	LWWriteQueueDelete(writeQueue);
+	LWMessageDelete(message);
+}
+
+static void test_write_to_full_file_descriptor(void)
+{
+	uint8_t data[4096];
+	memset(data, 1, sizeof(data));
+
+	int fileDescriptors[2];
+	UC_ASSERT(0 == pipe(fileDescriptors));
+	fcntl(fileDescriptors[1], F_SETFL, O_NONBLOCK);
+
+	LWBuffer *buffer = LWBufferCreate(data, sizeof(data));
+	LWWriteQueue *writeQueue = LWWriteQueueCreate();
+	for(int i = 0; i < 64; ++i)
+		LWWriteQueueEnqueueBuffer(writeQueue, buffer);
+	LWBufferRelease(buffer);
+
+	// a pipe cannot take 256 KB at once
+	UC_ASSERT(LWWriteQueueWriteToFileDescriptor(writeQueue, fileDescriptors[1]));
+	UC_ASSERT(!LWWriteQueueIsEmpty(writeQueue));
+	size_t pendingLength = LWWriteQueueGetPendingLength(writeQueue);
+	UC_ASSERT(pendingLength < 64*sizeof(data));
+
+	// drain pipe and resume writing
+	size_t totalBytesRead = 64*sizeof(data) - pendingLength;
+	while(!LWWriteQueueIsEmpty(writeQueue))
+	{
+		ssize_t bytesRead = read(fileDescriptors[0], data, sizeof(data));
+		UC_ASSERT(bytesRead > 0);
+		totalBytesRead += bytesRead;
+		UC_ASSERT(LWWriteQueueWriteToFileDescriptor(writeQueue, fileDescriptors[1]));
+	}
+	UC_ASSERT_EQUAL(0, LWWriteQueueGetPendingLength(writeQueue));
+
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+	LWWriteQueueDelete(writeQueue);
+}
+
+static void test_broadcast_message(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+
+	LWWriteQueue *writeQueues[3];
+	for(int i = 0; i < 3; ++i)
+		writeQueues[i] = LWWriteQueueCreate();
+
+	UC_ASSERT(LWWriteQueueBroadcastMessage(message, writeQueues, 3));
+
+	// all queues share one buffer
+	LWBuffer *buffer = writeQueues[0]->buffers[0];
+	UC_ASSERT_EQUAL(buffer, writeQueues[1]->buffers[0]);
+	UC_ASSERT_EQUAL(buffer, writeQueues[2]->buffers[0]);
+	UC_ASSERT_EQUAL(3, buffer->retainCount);
+	UC_ASSERT_EQUAL(8, LWBufferGetLength(buffer));
+
+	LWWriteQueueConsume(writeQueues[0], 8);
+	UC_ASSERT_EQUAL(2, buffer->retainCount);
+
+	for(int i = 0; i < 3; ++i)
+		LWWriteQueueDelete(writeQueues[i]);
+	LWMessageDelete(message);
+}
+
+#pragma mark -
+
+void test_write_queue(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("write queue");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("enqueue buffer",						&test_enqueue_buffer));
+	uc_suite_add_test(suite, uc_test_create("enqueue many buffers",					&test_enqueue_many_buffers));
+	uc_suite_add_test(suite, uc_test_create("peek consume",							&test_peek_consume));
+	uc_suite_add_test(suite, uc_test_create("write to file descriptor",				&test_write_to_file_descriptor));
+	uc_suite_add_test(suite, uc_test_create("write to full file descriptor",		&test_write_to_full_file_descriptor));
+	uc_suite_add_test(suite, uc_test_create("broadcast message",					&test_broadcast_message));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
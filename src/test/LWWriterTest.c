@@ -0,0 +1,336 @@
+/*
+ * LWWriterTest.c
+ * Lunkwill
+ *
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/LunkwillTypes.h>
+#include <Lunkwill/LWArgument.h>
+#include <Lunkwill/LWMessage.h>
+#include <Lunkwill/LWBuffer.h>
+#include <Lunkwill/LWWriter.h>
+
+uint8_t gWritabilityChangeCount;
+
+#pragma mark -
+
+static void writability_callback(LWWriter *aWriter, bool aIsWritable, void *aUserInfo)
+{
+#pragma unused (aWriter, aIsWritable, aUserInfo)
+
+	++gWritabilityChangeCount;
+}
+
+#pragma mark -
+
+static void test_create(void)
+{
+	LWWriter *writer = LWWriterCreate(5, NULL);
+	UC_ASSERT_NOT_NULL(writer);
+	UC_ASSERT_EQUAL(5, LWWriterGetFileDescriptor(writer));
+	UC_ASSERT(LWWriterIsWritable(writer));
+	UC_ASSERT_EQUAL(0, LWWriterGetPendingLength(writer));
+	LWWriterDelete(writer);
+}
+
+static void test_write_messages_coalesced(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	for(int i = 0; i < 10; ++i)
+		UC_ASSERT(LWWriterWriteMessage(writer, message));
+	UC_ASSERT_EQUAL(80, LWWriterGetPendingLength(writer));
+	UC_ASSERT_EQUAL(1, writer->writeQueue->bufferCount);
+	UC_ASSERT_EQUAL(123, writer->tailBuffer->data[72]);
+	UC_ASSERT_EQUAL(0, writer->tailBuffer->data[79]);
+
+	LWWriterDelete(writer);
+	LWMessageDelete(message);
+}
+
+static void test_write_buffer(void)
+{
+	uint8_t data[] = { 1, 2, 3 };
+
+	LWBuffer *buffer = LWBufferCreate(data, 3);
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	UC_ASSERT(LWWriterWriteData(writer, data, 3));
+	UC_ASSERT(LWWriterWriteBuffer(writer, buffer));
+	UC_ASSERT(LWWriterWriteData(writer, data, 3));
+	UC_ASSERT_EQUAL(3, writer->writeQueue->bufferCount);
+	UC_ASSERT_EQUAL(9, LWWriterGetPendingLength(writer));
+	UC_ASSERT_EQUAL(2, buffer->retainCount);
+
+	LWWriterDelete(writer);
+	LWBufferRelease(buffer);
+}
+
+static void test_write_large_data(void)
+{
+	static uint8_t data[100000];
+
+	LWWriter *writer = LWWriterCreate(-1, NULL);
+	UC_ASSERT(LWWriterWriteData(writer, data, 10));
+	UC_ASSERT(LWWriterWriteData(writer, data, sizeof(data)));
+	UC_ASSERT_EQUAL(2, writer->writeQueue->bufferCount);
+	UC_ASSERT_EQUAL(10 + sizeof(data), LWWriterGetPendingLength(writer));
+	LWWriterDelete(writer);
+}
+
+static void test_flush(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+
+	int fileDescriptors[2];
+	UC_ASSERT(0 == pipe(fileDescriptors));
+
+	LWWriter *writer = LWWriterCreate(fileDescriptors[1], NULL);
+	UC_ASSERT(LWWriterWriteMessage(writer, message));
+	UC_ASSERT(LWWriterWriteMessage(writer, message));
+	UC_ASSERT(LWWriterFlush(writer));
+	UC_ASSERT_EQUAL(0, LWWriterGetPendingLength(writer));
+
+	uint8_t data[32];
+	UC_ASSERT_EQUAL(16, read(fileDescriptors[0], data, sizeof(data)));
+	UC_ASSERT_EQUAL(123, data[8]);
+
+	// tail buffer is reused after having been sent
+	LWBuffer *tailBuffer = writer->tailBuffer;
+	UC_ASSERT(LWWriterWriteMessage(writer, message));
+	UC_ASSERT_EQUAL(tailBuffer, writer->tailBuffer);
+	UC_ASSERT_EQUAL(8, tailBuffer->length);
+	UC_ASSERT(LWWriterFlush(writer));
+	UC_ASSERT_EQUAL(8, read(fileDescriptors[0], data, sizeof(data)));
+
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+	LWWriterDelete(writer);
+	LWMessageDelete(message);
+}
+
+static void test_watermarks(void)
+{
+	uint8_t data[1000];
+	memset(data, 1, sizeof(data));
+
+	int fileDescriptors[2];
+	UC_ASSERT(0 == pipe(fileDescriptors));
+	fcntl(fileDescriptors[1], F_SETFL, O_NONBLOCK);
+
+	gWritabilityChangeCount = 0;
+
+	LWWriter *writer = LWWriterCreate(fileDescriptors[1], NULL);
+	LWWriterSetWatermarks(writer, 1000, 3000);
+	LWWriterSetWritabilityCallback(writer, &writability_callback);
+
+	UC_ASSERT(LWWriterWriteData(writer, data, sizeof(data)));
+	UC_ASSERT(LWWriterWriteData(writer, data, sizeof(data)));
+	UC_ASSERT(LWWriterIsWritable(writer));
+	UC_ASSERT_EQUAL(0, gWritabilityChangeCount);
+
+	UC_ASSERT(LWWriterWriteData(writer, data, sizeof(data)));
+	UC_ASSERT(!LWWriterIsWritable(writer));
+	UC_ASSERT_EQUAL(1, gWritabilityChangeCount);
+
+	UC_ASSERT(LWWriterFlush(writer));
+	UC_ASSERT(LWWriterIsWritable(writer));
+	UC_ASSERT_EQUAL(2, gWritabilityChangeCount);
+
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+	LWWriterDelete(writer);
+}
+
+static void test_partial_write(void)
+{
+	static uint8_t data[200000];
+	memset(data, 1, sizeof(data));
+
+	int fileDescriptors[2];
+	UC_ASSERT(0 == pipe(fileDescriptors));
+	fcntl(fileDescriptors[1], F_SETFL, O_NONBLOCK);
+
+	LWWriter *writer = LWWriterCreate(fileDescriptors[1], NULL);
+	UC_ASSERT(LWWriterWriteData(writer, data, sizeof(data)));
+	UC_ASSERT(LWWriterFlush(writer));
+	UC_ASSERT(LWWriterGetPendingLength(writer) > 0);
+
+	size_t totalBytesRead = 0;
+	while(totalBytesRead < sizeof(data))
+	{
+		ssize_t bytesRead = read(fileDescriptors[0], data, sizeof(data));
+		UC_ASSERT(bytesRead > 0);
+		totalBytesRead += bytesRead;
+		UC_ASSERT(LWWriterFlush(writer));
+	}
+	UC_ASSERT_EQUAL(sizeof(data), totalBytesRead);
+	UC_ASSERT_EQUAL(0, LWWriterGetPendingLength(writer));
+
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+	LWWriterDelete(writer);
+}
+
+static void test_broadcast_message(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+
+	LWWriter *writers[2] = { LWWriterCreate(-1, NULL), LWWriterCreate(-1, NULL) };
+	UC_ASSERT(LWWriterBroadcastMessage(message, writers, 2));
+	UC_ASSERT_EQUAL(writers[0]->writeQueue->buffers[0], writers[1]->writeQueue->buffers[0]);
+	UC_ASSERT_EQUAL(8, LWWriterGetPendingLength(writers[0]));
+	UC_ASSERT_EQUAL(8, LWWriterGetPendingLength(writers[1]));
+
+	LWWriterDelete(writers[0]);
+	LWWriterDelete(writers[1]);
+	LWMessageDelete(message);
+}
+
+static void test_wire_format(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+
+	// switching to version 2 announces it with the preamble
+	LWWriter *writers[2] = { LWWriterCreate(-1, NULL), LWWriterCreate(-1, NULL) };
+	UC_ASSERT_EQUAL(kLWWireFormatVersion1, LWWriterGetWireFormat(writers[1]));
+	UC_ASSERT(LWWriterSetWireFormat(writers[1], kLWWireFormatVersion2));
+	UC_ASSERT(LWWriterSetWireFormat(writers[1], kLWWireFormatVersion2));
+	UC_ASSERT(!LWWriterSetWireFormat(writers[1], kLWWireFormatVersion1));
+	UC_ASSERT_EQUAL(kLWWireFormatVersion2, LWWriterGetWireFormat(writers[1]));
+	UC_ASSERT_EQUAL(kLWWireFormatVersion2PreambleLength, LWWriterGetPendingLength(writers[1]));
+
+	// messages are written in the writer's format
+	UC_ASSERT(LWWriterWriteMessage(writers[1], message));
+	size_t length;
+	uint8_t *data = LWWriteQueuePeek(writers[1]->writeQueue, &length);
+	uint8_t expectedData[] = { 0xff, 'L', 'W', 2, 7, 123, 10, 'h', 'e', 'l', 'l', 'o' };
+	UC_ASSERT_EQUAL(sizeof(expectedData), length);
+	UC_ASSERT_EQUAL(0, memcmp(expectedData, data, sizeof(expectedData)));
+
+	// broadcasting serializes once per format
+	UC_ASSERT(LWWriterBroadcastMessage(message, writers, 2));
+	UC_ASSERT_EQUAL(8, LWWriterGetPendingLength(writers[0]));
+	UC_ASSERT_EQUAL(20, LWWriterGetPendingLength(writers[1]));
+	UC_ASSERT(writers[0]->writeQueue->buffers[0] != writers[1]->writeQueue->buffers[1]);
+
+	// messages with empty arguments have no version 2 frame
+	LWArgument *emptyArgument = LWArgumentCreateFromString("x");
+	LWMessage *emptyMessage = LWMessageCreate(123, emptyArgument, NULL);
+	emptyArgument->length = 0;
+	UC_ASSERT(!LWWriterWriteMessage(writers[1], emptyMessage));
+	LWWriterSetChecksumEnabled(writers[1], true);
+	UC_ASSERT(!LWWriterWriteMessage(writers[1], emptyMessage));
+	UC_ASSERT(!LWWriterBroadcastMessage(emptyMessage, writers + 1, 1));
+	UC_ASSERT_EQUAL(20, LWWriterGetPendingLength(writers[1]));
+	LWMessageDelete(emptyMessage);
+
+	LWWriterDelete(writers[0]);
+	LWWriterDelete(writers[1]);
+	LWMessageDelete(message);
+}
+
+static void test_checksum(void)
+{
+	LWArgument *argument = LWArgumentCreateFromString("hello");
+	LWMessage *message = LWMessageCreate(123, argument, NULL);
+
+	// checksums are opt-in
+	LWWriter *writers[2] = { LWWriterCreate(-1, NULL), LWWriterCreate(-1, NULL) };
+	UC_ASSERT(!LWWriterIsChecksumEnabled(writers[1]));
+	LWWriterSetChecksumEnabled(writers[1], true);
+	UC_ASSERT(LWWriterIsChecksumEnabled(writers[1]));
+
+	// messages are followed by a trailer
+	UC_ASSERT(LWWriterWriteMessage(writers[1], message));
+	size_t length;
+	uint8_t *data = LWWriteQueuePeek(writers[1]->writeQueue, &length);
+	uint8_t expectedData[] = { 123, 5, 'h', 'e', 'l', 'l', 'o', 0 };
+	UC_ASSERT_EQUAL(sizeof(expectedData) + kLWChecksumLength, length);
+	UC_ASSERT_EQUAL(0, memcmp(expectedData, data, sizeof(expectedData)));
+	UC_ASSERT_EQUAL(LWChecksumUpdate(0, expectedData, sizeof(expectedData)), LWChecksumRead(data + sizeof(expectedData)));
+
+	// so are raw frames
+	UC_ASSERT(LWWriterWriteFrame(writers[1], expectedData, sizeof(expectedData)));
+	UC_ASSERT(LWWriterWriteFrame(writers[0], expectedData, sizeof(expectedData)));
+	UC_ASSERT_EQUAL(24, LWWriterGetPendingLength(writers[1]));
+	UC_ASSERT_EQUAL(0, memcmp(data, data + 12, 12));
+	UC_ASSERT_EQUAL(8, LWWriterGetPendingLength(writers[0]));
+
+	// broadcasting serializes once with and once without trailer
+	UC_ASSERT(LWWriterBroadcastMessage(message, writers, 2));
+	UC_ASSERT_EQUAL(16, LWWriterGetPendingLength(writers[0]));
+	UC_ASSERT_EQUAL(36, LWWriterGetPendingLength(writers[1]));
+	UC_ASSERT(writers[0]->writeQueue->buffers[1] != writers[1]->writeQueue->buffers[1]);
+
+	LWWriterDelete(writers[0]);
+	LWWriterDelete(writers[1]);
+	LWMessageDelete(message);
+}
+
+#pragma mark -
+
+void test_writer(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("writer");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("create",								&test_create));
+	uc_suite_add_test(suite, uc_test_create("write messages coalesced",				&test_write_messages_coalesced));
+	uc_suite_add_test(suite, uc_test_create("write buffer",							&test_write_buffer));
+	uc_suite_add_test(suite, uc_test_create("write large data",						&test_write_large_data));
+	uc_suite_add_test(suite, uc_test_create("flush",								&test_flush));
+	uc_suite_add_test(suite, uc_test_create("watermarks",							&test_watermarks));
+	uc_suite_add_test(suite, uc_test_create("partial write",						&test_partial_write));
+	uc_suite_add_test(suite, uc_test_create("broadcast message",					&test_broadcast_message));
+	uc_suite_add_test(suite, uc_test_create("wire format",							&test_wire_format));
+	uc_suite_add_test(suite, uc_test_create("checksum",								&test_checksum));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
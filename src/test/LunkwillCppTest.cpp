@@ -0,0 +1,420 @@
+/*
+ * LunkwillCppTest.cpp
+ * Lunkwill
+ * 
+ * Copyright (c) 2003-2009 Denis Defreyne, Sam Rushing
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * 
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * - Neither the name of Lunkwill nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <uctest/uctest.h>
+
+#include <Lunkwill/LunkwillPrivate.h>
+#include <Lunkwill/Lunkwill.hpp>
+
+using Position	= Lunkwill::Message<12, uint32_t, double, double, int8_t>;
+using Profile	= Lunkwill::Message<13, std::string_view, Lunkwill::Varint, Lunkwill::SignedVarint, Lunkwill::Array<int32_t>, Lunkwill::Bytes>;
+using Ping		= Lunkwill::Message<14>;
+
+static_assert(Position::kIsFixedLength, "fixed-length fields make fixed-length messages");
+static_assert(Position::kSerializedLength == 2 + 5 + 9 + 9 + 2, "fixed lengths are known at compile time");
+static_assert(Position::kMaxSerializedLength == Position::kSerializedLength, "fixed lengths are maximum lengths");
+static_assert(!Profile::kIsFixedLength && 0 == Profile::kSerializedLength && 0 == Profile::kMaxSerializedLength, "strings have no fixed length");
+static_assert(Lunkwill::Message<15, Lunkwill::Varint>::kMaxSerializedLength == 13, "varints are at most ten bytes");
+static_assert(Ping::kSerializedLength == 2, "messages without arguments are two bytes");
+
+struct Handler
+{
+	size_t		positionCount	= 0;
+	size_t		profileCount	= 0;
+	uint32_t	lastIdentifier	= 0;
+	std::string	lastName;
+
+	void operator()(const Position::Decoded &aPosition)
+	{
+		++positionCount;
+		lastIdentifier = aPosition.get<0>();
+	}
+
+	void operator()(const Profile::Decoded &aProfile)
+	{
+		++profileCount;
+		lastName = std::string(aProfile.get<0>());
+	}
+};
+
+#pragma mark -
+
+static Lunkwill::UniqueMessage create_position_message(void)
+{
+	LWArgument *arguments[] = {
+		LWArgumentCreateFrom32BitUnsignedInteger(7),
+		LWArgumentCreateFromDouble(1.5),
+		LWArgumentCreateFromDouble(-2.25),
+		LWArgumentCreateFrom8BitInteger(-3)
+	};
+
+	return Lunkwill::UniqueMessage(LWMessageCreate2(12, 4, arguments));
+}
+
+static Lunkwill::UniqueMessage create_profile_message(const std::string &aName, std::vector<int32_t> &aScores, std::vector<uint8_t> &aAvatar)
+{
+	LWArgument *arguments[] = {
+		LWArgumentCreateFromString(const_cast<char *>(aName.c_str())),
+		LWArgumentCreateFromVarint(300),
+		LWArgumentCreateFromSignedVarint(-5),
+		LWArgumentCreateFrom32BitIntegerArray(aScores.data(), aScores.size()),
+		LWArgumentCreate(aAvatar.data(), aAvatar.size())
+	};
+
+	return Lunkwill::UniqueMessage(LWMessageCreate2(13, 5, arguments));
+}
+
+static bool serializes_like_message(LWMessage *aMessage, const std::vector<uint8_t> &aData, uint8_t aWireFormat)
+{
+	std::vector<uint8_t> expectedData(LWMessageGetSerializedLengthWithWireFormat(aMessage, aWireFormat));
+	LWMessageSerializeIntoBufferWithWireFormat(aMessage, expectedData.data(), aWireFormat);
+
+	return expectedData == aData;
+}
+
+static std::vector<uint8_t> get_pending_data(LWWriter *aWriter)
+{
+	std::vector<uint8_t> data;
+	while(!LWWriteQueueIsEmpty(aWriter->writeQueue))
+	{
+		size_t length;
+		uint8_t *pendingData = static_cast<uint8_t *>(LWWriteQueuePeek(aWriter->writeQueue, &length));
+		data.insert(data.end(), pendingData, pendingData + length);
+		LWWriteQueueConsume(aWriter->writeQueue, length);
+	}
+
+	return data;
+}
+
+#pragma mark -
+
+static void test_fixed_length(void)
+{
+	// same bytes as LWMessageSerialize
+	std::vector<uint8_t> data(Position::getSerializedLength(7, 1.5, -2.25, -3));
+	UC_ASSERT_EQUAL(Position::kSerializedLength, data.size());
+	UC_ASSERT_EQUAL(data.size(), Position::serializeIntoBuffer(data.data(), 7, 1.5, -2.25, -3));
+	Lunkwill::UniqueMessage message = create_position_message();
+	UC_ASSERT(serializes_like_message(message.get(), data, kLWWireFormatVersion1));
+
+	// decoded in place
+	size_t bytesUsed;
+	std::optional<Position::Decoded> position = Position::deserialize(data.data(), data.size(), &bytesUsed);
+	UC_ASSERT(position.has_value());
+	UC_ASSERT_EQUAL(data.size(), bytesUsed);
+	UC_ASSERT_EQUAL(7u, position->get<0>());
+	UC_ASSERT_EQUAL(1.5, position->get<1>());
+	UC_ASSERT_EQUAL(-2.25, position->get<2>());
+	UC_ASSERT_EQUAL(-3, position->get<3>());
+
+	// readable by LWMessageDeserialize
+	Lunkwill::UniqueMessage decodedMessage(LWMessageDeserialize(data.data(), data.size(), &bytesUsed));
+	UC_ASSERT_NOT_NULL(decodedMessage);
+	UC_ASSERT_EQUAL(7u, LWArgumentGet32BitUnsignedIntegerValue(LWMessageGetArgumentAtIndex(decodedMessage.get(), 0)));
+	UC_ASSERT_EQUAL(-2.25, LWArgumentGetDoubleValue(LWMessageGetArgumentAtIndex(decodedMessage.get(), 2)));
+
+	// messages without arguments
+	uint8_t pingData[Ping::kSerializedLength];
+	UC_ASSERT_EQUAL(2u, Ping::serializeIntoBuffer(pingData));
+	UC_ASSERT_EQUAL(14, pingData[0]);
+	UC_ASSERT_EQUAL(0, pingData[1]);
+	UC_ASSERT(Ping::deserialize(pingData, sizeof(pingData), &bytesUsed).has_value());
+}
+
+static void test_variable_length(void)
+{
+	std::string				name(600, 'n');
+	std::vector<int32_t>	scores(100);
+	std::vector<uint8_t>	avatar(255);
+	for(size_t i = 0; i < scores.size(); ++i)
+		scores[i] = -static_cast<int32_t>(i*i);
+	for(size_t i = 0; i < avatar.size(); ++i)
+		avatar[i] = static_cast<uint8_t>(i);
+	Lunkwill::UniqueMessage message = create_profile_message(name, scores, avatar);
+
+	// long arguments are split into chunks the same way
+	std::vector<uint8_t> data(Profile::getSerializedLength(name, 300, -5, scores, avatar));
+	UC_ASSERT_EQUAL(LWMessageGetSerializedLength(message.get()), data.size());
+	UC_ASSERT_EQUAL(data.size(), Profile::serializeIntoBuffer(data.data(), name, 300, -5, scores, avatar));
+	UC_ASSERT(serializes_like_message(message.get(), data, kLWWireFormatVersion1));
+
+	// split arguments are put back together
+	size_t bytesUsed;
+	std::optional<Profile::Decoded> profile = Profile::deserialize(data.data(), data.size(), &bytesUsed);
+	UC_ASSERT(profile.has_value());
+	UC_ASSERT_EQUAL(data.size(), bytesUsed);
+	UC_ASSERT(name == profile->get<0>());
+	UC_ASSERT_EQUAL(300u, profile->get<1>());
+	UC_ASSERT_EQUAL(-5, profile->get<2>());
+	UC_ASSERT_EQUAL(scores.size(), profile->get<3>().size());
+	UC_ASSERT_EQUAL(-9801, profile->get<3>()[99]);
+	UC_ASSERT_EQUAL(avatar.size(), profile->get<4>().size());
+	UC_ASSERT_EQUAL(0, memcmp(avatar.data(), profile->get<4>().data(), avatar.size()));
+
+	std::vector<int32_t> decodedScores(scores.size());
+	profile->get<3>().copyTo(decodedScores.data());
+	UC_ASSERT(scores == decodedScores);
+
+	// short arguments are viewed in place
+	std::string shortName("neil");
+	data.resize(Profile::getSerializedLength(shortName, 1, 1, scores, avatar));
+	Profile::serializeIntoBuffer(data.data(), shortName, 1, 1, scores, avatar);
+	profile = Profile::deserialize(data.data(), data.size(), &bytesUsed);
+	UC_ASSERT(profile.has_value());
+	UC_ASSERT_EQUAL(reinterpret_cast<const char *>(data.data() + 2), profile->get<0>().data());
+
+	// frames have no room for empty arguments
+	UC_ASSERT_EQUAL(0u, Profile::getSerializedLength("", 1, 1, scores, avatar));
+	UC_ASSERT_EQUAL(0u, Profile::getSerializedLengthWithWireFormat(kLWWireFormatVersion2, shortName, 1, 1, Lunkwill::Span<const int32_t>(), avatar));
+}
+
+static void test_wire_format(void)
+{
+	std::string				name(300, 'n');
+	std::vector<int32_t>	scores(3, 1);
+	std::vector<uint8_t>	avatar(1, 2);
+	Lunkwill::UniqueMessage message = create_profile_message(name, scores, avatar);
+
+	// version 2 frames carry their length up front
+	std::vector<uint8_t> data(Profile::getSerializedLengthWithWireFormat(kLWWireFormatVersion2, name, 300, -5, scores, avatar));
+	UC_ASSERT_EQUAL(data.size(), Profile::serializeIntoBufferWithWireFormat(data.data(), kLWWireFormatVersion2, name, 300, -5, scores, avatar));
+	UC_ASSERT(serializes_like_message(message.get(), data, kLWWireFormatVersion2));
+
+	size_t bytesUsed;
+	std::optional<Profile::Decoded> profile = Profile::deserializeWithWireFormat(data.data(), data.size(), &bytesUsed, kLWWireFormatVersion2);
+	UC_ASSERT(profile.has_value());
+	UC_ASSERT_EQUAL(data.size(), bytesUsed);
+	UC_ASSERT(name == profile->get<0>());
+	UC_ASSERT_EQUAL(-5, profile->get<2>());
+
+	// incomplete frames use no bytes
+	UC_ASSERT(!Profile::deserializeWithWireFormat(data.data(), data.size() - 1, &bytesUsed, kLWWireFormatVersion2).has_value());
+	UC_ASSERT_EQUAL(0u, bytesUsed);
+
+	// compressed arguments are decompressed into storage
+	UC_ASSERT(LWMessageCompressArguments(message.get(), 64));
+	data.resize(LWMessageGetSerializedLengthWithWireFormat(message.get(), kLWWireFormatVersion2));
+	LWMessageSerializeIntoBufferWithWireFormat(message.get(), data.data(), kLWWireFormatVersion2);
+	profile = Profile::deserializeWithWireFormat(data.data(), data.size(), &bytesUsed, kLWWireFormatVersion2);
+	UC_ASSERT(profile.has_value());
+	UC_ASSERT_EQUAL(data.size(), bytesUsed);
+	UC_ASSERT(name == profile->get<0>());
+
+	// unless they do not decompress to their announced length
+	uint64_t	value;
+	size_t		headerLength;
+	size_t		argumentHeaderLength;
+	UC_ASSERT(LWVarintRead(data.data(), data.size(), &value, &headerLength));
+	UC_ASSERT(LWVarintRead(data.data() + headerLength + 1, data.size(), &value, &argumentHeaderLength));
+	++data[headerLength + 1 + argumentHeaderLength];
+	UC_ASSERT(!Profile::deserializeWithWireFormat(data.data(), data.size(), &bytesUsed, kLWWireFormatVersion2).has_value());
+	UC_ASSERT_EQUAL(data.size(), bytesUsed);
+}
+
+static void test_mismatched_frames(void)
+{
+	uint8_t	data[Position::kSerializedLength + 1];
+	size_t	bytesUsed;
+	Position::serializeIntoBuffer(data, 7, 1.5, -2.25, -3);
+
+	// incomplete
+	UC_ASSERT(!Position::deserialize(data, Position::kSerializedLength - 1, &bytesUsed).has_value());
+	UC_ASSERT_EQUAL(0u, bytesUsed);
+
+	// other message types are skipped
+	UC_ASSERT(!Profile::deserialize(data, Position::kSerializedLength, &bytesUsed).has_value());
+	UC_ASSERT_EQUAL(Position::kSerializedLength, bytesUsed);
+
+	// so are arguments of the wrong length
+	uint8_t shortData[] = { 12, 4, 0, 0, 0, 7, 8, 0, 0, 0, 0, 0, 0, 0, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0 };
+	UC_ASSERT(!Position::deserialize(shortData, sizeof(shortData), &bytesUsed).has_value());
+	UC_ASSERT_EQUAL(sizeof(shortData), bytesUsed);
+
+	// and missing arguments
+	uint8_t missingData[] = { 12, 4, 0, 0, 0, 7, 0 };
+	UC_ASSERT(!Position::deserialize(missingData, sizeof(missingData), &bytesUsed).has_value());
+	UC_ASSERT_EQUAL(sizeof(missingData), bytesUsed);
+}
+
+static void test_write(void)
+{
+	Lunkwill::UniqueMessage	message = create_position_message();
+	Lunkwill::UniqueWriter	writers[2] = { Lunkwill::UniqueWriter(LWWriterCreate(-1, NULL)), Lunkwill::UniqueWriter(LWWriterCreate(-1, NULL)) };
+
+	// written in the writer's format, with the writer's trailer
+	for(size_t i = 0; i < 2; ++i)
+	{
+		UC_ASSERT(LWWriterSetWireFormat(writers[i].get(), kLWWireFormatVersion2));
+		LWWriterSetChecksumEnabled(writers[i].get(), true);
+	}
+	UC_ASSERT(Position::write(writers[0].get(), 7, 1.5, -2.25, -3));
+	UC_ASSERT(LWWriterWriteMessage(writers[1].get(), message.get()));
+
+	// messages too long for the stack
+	std::string				name(2000, 'n');
+	std::vector<int32_t>	scores(1, 1);
+	std::vector<uint8_t>	avatar(1, 1);
+	UC_ASSERT(Profile::write(writers[0].get(), name, 300, -5, scores, avatar));
+	UC_ASSERT(!Profile::write(writers[0].get(), "", 300, -5, scores, avatar));
+	message = create_profile_message(name, scores, avatar);
+	UC_ASSERT(LWWriterWriteMessage(writers[1].get(), message.get()));
+
+	UC_ASSERT(get_pending_data(writers[0].get()) == get_pending_data(writers[1].get()));
+}
+
+static void test_dispatch(void)
+{
+	std::string				name("neil");
+	std::vector<int32_t>	scores(1, 1);
+	std::vector<uint8_t>	avatar(1, 1);
+	Handler					handler;
+	uint8_t					data[64];
+
+	// picked by message ID
+	size_t length = Position::serializeIntoBuffer(data, 7, 1.5, -2.25, -3);
+	UC_ASSERT((Lunkwill::Dispatcher<Position, Profile>::dispatch(data, length, kLWWireFormatVersion1, handler)));
+	length = Profile::serializeIntoBufferWithWireFormat(data, kLWWireFormatVersion2, name, 1, 1, scores, avatar);
+	UC_ASSERT((Lunkwill::Dispatcher<Position, Profile>::dispatch(data, length, kLWWireFormatVersion2, handler)));
+	UC_ASSERT_EQUAL(1u, handler.positionCount);
+	UC_ASSERT_EQUAL(1u, handler.profileCount);
+	UC_ASSERT_EQUAL(7u, handler.lastIdentifier);
+	UC_ASSERT(name == handler.lastName);
+
+	// unknown message IDs
+	length = Ping::serializeIntoBuffer(data);
+	UC_ASSERT(!(Lunkwill::Dispatcher<Position, Profile>::dispatch(data, length, kLWWireFormatVersion1, handler)));
+	UC_ASSERT(!(Lunkwill::Dispatcher<Position, Profile>::dispatch(data, 0, kLWWireFormatVersion1, handler)));
+}
+
+static void test_relay_callbacks(void)
+{
+	Handler handler;
+	Lunkwill::UniqueDataHandler dataHandler(LWDataHandlerCreate(&handler));
+	Lunkwill::Dispatcher<Position, Profile>::setRelayCallbacks<Handler>(dataHandler.get());
+	UC_ASSERT(LWDataHandlerSetChecksumEnabled(dataHandler.get(), true));
+
+	// frames reach the handler without LWMessage objects
+	uint8_t data[2*(Position::kSerializedLength + kLWChecksumLength)];
+	for(size_t i = 0; i < 2; ++i)
+	{
+		uint8_t *frame = data + i*(Position::kSerializedLength + kLWChecksumLength);
+		Position::serializeIntoBuffer(frame, static_cast<uint32_t>(i + 1), 1.5, -2.25, -3);
+		LWChecksumWrite(frame + Position::kSerializedLength, LWChecksumUpdate(0, frame, Position::kSerializedLength));
+	}
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler.get(), data, sizeof(data)));
+	UC_ASSERT_EQUAL(2u, handler.positionCount);
+	UC_ASSERT_EQUAL(2u, handler.lastIdentifier);
+}
+
+static void test_relay_compressed(void)
+{
+	Handler handler;
+	Lunkwill::UniqueDataHandler dataHandler(LWDataHandlerCreate(&handler));
+	Lunkwill::Dispatcher<Position, Profile>::setRelayCallbacks<Handler>(dataHandler.get());
+	UC_ASSERT(LWDataHandlerSetWireFormat(dataHandler.get(), kLWWireFormatVersion2));
+
+	// compressed arguments are decompressed before the handler sees them
+	std::string				name(2000, 'n');
+	std::vector<int32_t>	scores(1, 1);
+	std::vector<uint8_t>	avatar(1, 1);
+	Lunkwill::UniqueMessage message = create_profile_message(name, scores, avatar);
+	UC_ASSERT(LWMessageCompressArguments(message.get(), kLWArgumentDefaultCompressionThreshold));
+	UC_ASSERT(LWArgumentIsCompressed(message->arguments[0]));
+	std::vector<uint8_t> data(LWMessageGetSerializedLengthWithWireFormat(message.get(), kLWWireFormatVersion2));
+	LWMessageSerializeIntoBufferWithWireFormat(message.get(), data.data(), kLWWireFormatVersion2);
+	UC_ASSERT(data.size() < name.size());
+	UC_ASSERT(LWDataHandlerHandleData(dataHandler.get(), data.data(), data.size()));
+	UC_ASSERT_EQUAL(1u, handler.profileCount);
+	UC_ASSERT(name == handler.lastName);
+}
+
+static void test_move(void)
+{
+	std::string				name(1000, 'n');
+	std::vector<int32_t>	scores(1, 1);
+	std::vector<uint8_t>	avatar(1, 1);
+	std::vector<uint8_t>	data(Profile::getSerializedLength(name, 1, 1, scores, avatar));
+	Profile::serializeIntoBuffer(data.data(), name, 1, 1, scores, avatar);
+
+	// moving keeps copies of split arguments alive
+	size_t bytesUsed;
+	std::optional<Profile::Decoded> profile = Profile::deserialize(data.data(), data.size(), &bytesUsed);
+	UC_ASSERT(profile.has_value());
+	const char *nameData = profile->get<0>().data();
+	Profile::Decoded movedProfile = std::move(*profile);
+	profile.reset();
+	UC_ASSERT_EQUAL(nameData, movedProfile.get<0>().data());
+	UC_ASSERT(name == movedProfile.get<0>());
+	UC_ASSERT(name == std::get<0>(movedProfile.getViews()));
+
+	// owners release C objects
+	Lunkwill::UniqueArgument argument(LWArgumentCreateFromString(const_cast<char *>("hello")));
+	LWArgumentRetain(argument.get());
+	Lunkwill::UniqueArgument movedArgument = std::move(argument);
+	UC_ASSERT_NULL(argument);
+	UC_ASSERT_EQUAL(2u, movedArgument->retainCount);
+	LWArgumentRelease(movedArgument.get());
+	movedArgument.reset();
+}
+
+#pragma mark -
+
+extern "C" void test_cpp(void)
+{
+	/* create suite */
+	uc_suite_t *suite = uc_suite_create("cpp");
+
+	/* add tests to suite */
+	uc_suite_add_test(suite, uc_test_create("fixed length",							&test_fixed_length));
+	uc_suite_add_test(suite, uc_test_create("variable length",						&test_variable_length));
+	uc_suite_add_test(suite, uc_test_create("wire format",							&test_wire_format));
+	uc_suite_add_test(suite, uc_test_create("mismatched frames",					&test_mismatched_frames));
+	uc_suite_add_test(suite, uc_test_create("write",								&test_write));
+	uc_suite_add_test(suite, uc_test_create("dispatch",								&test_dispatch));
+	uc_suite_add_test(suite, uc_test_create("relay callbacks",						&test_relay_callbacks));
+	uc_suite_add_test(suite, uc_test_create("relay compressed",						&test_relay_compressed));
+	uc_suite_add_test(suite, uc_test_create("move",									&test_move));
+
+	/* run suite */
+	uc_suite_run(suite);
+
+	/* destroy suite */
+	uc_suite_destroy(suite);
+}
@@ -35,17 +35,45 @@
 
 #include <stdio.h>
 
+#include "test/LWAllocatorTest.h"
+#include "test/LWArenaTest.h"
 #include "test/LWArgumentTest.h"
 #include "test/LWMessageTest.h"
 #include "test/LWDataHandlerTest.h"
+#include "test/LWDataHandlerStatsTest.h"
 #include "test/LWValidatorTest.h"
+#include "test/LWBufferTest.h"
+#include "test/LWWriteQueueTest.h"
+#include "test/LWWriterTest.h"
+#include "test/LWInternTableTest.h"
+#include "test/LWSharedRingTest.h"
+#include "test/LWMultiplexerTest.h"
+#include "test/LWTimerWheelTest.h"
+#include "test/LWRPCTest.h"
+#include "test/LWClientPoolTest.h"
+#include "test/LWTraceTest.h"
+#include "test/LunkwillCppTest.h"
 
 int main(void)
 {
+	test_allocator();
+	test_arena();
 	test_argument();
 	test_message();
 	test_validator();
 	test_data_handler();
+	test_data_handler_stats();
+	test_buffer();
+	test_write_queue();
+	test_writer();
+	test_intern_table();
+	test_shared_ring();
+	test_multiplexer();
+	test_timer_wheel();
+	test_rpc();
+	test_client_pool();
+	test_trace();
+	test_cpp();
 
 	return 0;
 }